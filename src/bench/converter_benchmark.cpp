@@ -0,0 +1,139 @@
+#include <benchmark/benchmark.h>
+#include <linux/videodev2.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "format_converter.h"
+#include "parallel_converter.h"
+#include "thread_pool.h"
+
+using v4l2_demo::ConverterIsa;
+using v4l2_demo::FormatConverter;
+using v4l2_demo::ParallelConverter;
+using v4l2_demo::ScaleFilter;
+using v4l2_demo::ThreadPool;
+
+namespace {
+
+// 伪随机源帧，避免全零数据让内核走捷径
+std::vector<uint8_t> MakeSourceFrame(uint32_t width, uint32_t height) {
+  std::vector<uint8_t> frame(static_cast<size_t>(width) * height * 2);
+  uint32_t seed = 12345;
+  for (auto& byte : frame) {
+    seed = seed * 1103515245 + 12345;
+    byte = seed >> 24;
+  }
+  return frame;
+}
+
+// 参数: isa, src_format, dst_format, width, height
+void BM_Convert(benchmark::State& state) {
+  ConverterIsa isa = static_cast<ConverterIsa>(state.range(0));
+  uint32_t src_format = state.range(1);
+  uint32_t dst_format = state.range(2);
+  uint32_t width = state.range(3);
+  uint32_t height = state.range(4);
+
+  FormatConverter converter(isa);
+  std::vector<uint8_t> src = MakeSourceFrame(width, height);
+  std::vector<uint8_t> dst(
+      FormatConverter::GetFrameSize(dst_format, width, height));
+  for (auto _ : state) {
+    converter.Convert(src.data(), src.size(), src_format, width, height,
+                      dst_format, dst.data(), dst.size());
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          src.size());
+  state.SetLabel(converter.GetIsaName());
+}
+
+// 参数: dst_format, width, height, 线程数
+void BM_ParallelConvert(benchmark::State& state) {
+  uint32_t dst_format = state.range(0);
+  uint32_t width = state.range(1);
+  uint32_t height = state.range(2);
+
+  ThreadPool pool(state.range(3));
+  ParallelConverter parallel(&pool);
+  std::vector<uint8_t> src = MakeSourceFrame(width, height);
+  std::vector<uint8_t> dst(
+      FormatConverter::GetFrameSize(dst_format, width, height));
+  for (auto _ : state) {
+    parallel.Convert(src.data(), src.size(), V4L2_PIX_FMT_YUYV, width, height,
+                     dst_format, dst.data(), dst.size());
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          src.size());
+}
+
+// 参数: isa, filter, 目标宽, 目标高（源为 1920x1080 YUYV）
+void BM_Scale(benchmark::State& state) {
+  ConverterIsa isa = static_cast<ConverterIsa>(state.range(0));
+  ScaleFilter filter = static_cast<ScaleFilter>(state.range(1));
+  uint32_t dst_width = state.range(2);
+  uint32_t dst_height = state.range(3);
+
+  FormatConverter converter(isa);
+  std::vector<uint8_t> src = MakeSourceFrame(1920, 1080);
+  std::vector<uint8_t> dst(FormatConverter::GetFrameSize(
+      V4L2_PIX_FMT_YUYV, dst_width, dst_height));
+  for (auto _ : state) {
+    converter.Scale(src.data(), src.size(), V4L2_PIX_FMT_YUYV, 1920, 1080, 0,
+                    dst_width, dst_height, filter, dst.data(), dst.size());
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          src.size());
+  state.SetLabel(converter.GetIsaName());
+}
+
+void ConvertArguments(benchmark::internal::Benchmark* benchmark) {
+  const ConverterIsa isas[] = {ConverterIsa::kScalar, ConverterIsa::kSse41,
+                               ConverterIsa::kAvx2, ConverterIsa::kNeon};
+  const int64_t src_formats[] = {V4L2_PIX_FMT_YUYV, V4L2_PIX_FMT_UYVY};
+  const int64_t dst_formats[] = {V4L2_PIX_FMT_NV12, V4L2_PIX_FMT_YUV420,
+                                 V4L2_PIX_FMT_RGB24, V4L2_PIX_FMT_ABGR32};
+  for (ConverterIsa isa : isas) {
+    for (int64_t src_format : src_formats) {
+      for (int64_t dst_format : dst_formats) {
+        benchmark->Args({static_cast<int64_t>(isa), src_format, dst_format,
+                         1280, 720});
+      }
+    }
+  }
+  benchmark->ArgNames({"isa", "src", "dst", "width", "height"});
+}
+
+// 1080p 缩小到 1/2 与 1/3
+void ScaleArguments(benchmark::internal::Benchmark* benchmark) {
+  const ConverterIsa isas[] = {ConverterIsa::kScalar, ConverterIsa::kSse41,
+                               ConverterIsa::kAvx2, ConverterIsa::kNeon};
+  const ScaleFilter filters[] = {ScaleFilter::kBox, ScaleFilter::kBilinear};
+  for (ConverterIsa isa : isas) {
+    for (ScaleFilter filter : filters) {
+      benchmark->Args({static_cast<int64_t>(isa),
+                       static_cast<int64_t>(filter), 960, 540});
+      benchmark->Args({static_cast<int64_t>(isa),
+                       static_cast<int64_t>(filter), 640, 360});
+    }
+  }
+  benchmark->ArgNames({"isa", "filter", "width", "height"});
+}
+
+}  // namespace
+
+BENCHMARK(BM_Convert)->Apply(ConvertArguments)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_Scale)->Apply(ScaleArguments)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ParallelConvert)
+    ->ArgsProduct({{V4L2_PIX_FMT_NV12, V4L2_PIX_FMT_ABGR32},
+                   {1920},
+                   {1080},
+                   {1, 2, 4}})
+    ->ArgNames({"dst", "width", "height", "threads"})
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,506 @@
+#include <errno.h>
+#include <linux/videodev2.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "buffer_pool.h"
+#include "format_converter.h"
+#include "latency_histogram.h"
+#include "v4l2_utils.h"
+
+using v4l2_demo::ConverterIsa;
+using v4l2_demo::DeviceInfo;
+using v4l2_demo::DropStats;
+using v4l2_demo::FindVideoDevices;
+using v4l2_demo::FormatConverter;
+using v4l2_demo::FrameLatencyTracker;
+using v4l2_demo::FrameLease;
+using v4l2_demo::HugePageBufferPool;
+using v4l2_demo::LatencyHistogram;
+using v4l2_demo::MonotonicMicros;
+using v4l2_demo::PixelFormatToString;
+using v4l2_demo::V4L2Device;
+using v4l2_demo::VideoFormat;
+
+namespace {
+// 测量前丢弃的帧数（驱动启动、缓存预热）
+constexpr uint32_t kWarmupFrames = 10;
+
+// 等待一帧的超时时间
+constexpr int kFrameTimeoutMs = 2000;
+
+// 模拟应用读取帧数据的采样间隔（字节），一个缓存行读一次
+constexpr size_t kTouchStride = 64;
+
+// USERPTR 模式下额外分配的备用缓冲区
+constexpr uint32_t kSpareUserPtrBuffers = 2;
+
+struct BenchOptions {
+  std::string device_path;  // 为空时自动查找 vivid/v4l2loopback
+  uint32_t width = 1280;
+  uint32_t height = 720;
+  uint32_t pixel_format = V4L2_PIX_FMT_YUYV;
+  uint32_t buffer_count = 4;
+  uint32_t frames = 300;
+  uint32_t convert_iterations = 50;
+  std::vector<std::string> modes = {"mmap", "dmabuf", "userptr"};
+  std::string output_path;  // 为空时输出到 stdout
+  bool capture = true;
+  bool convert = true;
+};
+
+// 单个内存模式的捕获测量结果
+struct CaptureResult {
+  std::string mode;
+  bool ok = false;
+  std::string error;
+  VideoFormat format;
+  uint64_t frames = 0;
+  double elapsed_s = 0;
+  double fps = 0;
+  double cpu_us_per_frame = 0;  // 进程用户态 + 内核态 CPU 时间
+  double touch_us_per_frame = 0;  // 读取整帧（按缓存行采样）的耗时
+  DropStats drops;
+  LatencyHistogram dqbuf_us;  // VIDIOC_DQBUF 调用耗时
+  FrameLatencyTracker latency;  // 驱动时间戳 -> 出队等
+};
+
+// 单个转换内核的测量结果
+struct ConvertResult {
+  std::string isa;
+  uint32_t src_format;
+  uint32_t dst_format;
+  double mean_ms;
+  double min_ms;
+  double mb_per_s;  // 按源帧大小计算
+};
+
+void PrintUsage(const char* program) {
+  fprintf(stderr,
+          "用法: %s [选项]\n"
+          "  --device PATH        捕获设备，默认自动查找 vivid/v4l2loopback\n"
+          "  --width N            宽度（默认 1280）\n"
+          "  --height N           高度（默认 720）\n"
+          "  --format FOURCC      像素格式（默认 YUYV）\n"
+          "  --buffers N          驱动缓冲区数量（默认 4）\n"
+          "  --frames N           每种内存模式测量的帧数（默认 300）\n"
+          "  --modes LIST         内存模式，逗号分隔：mmap,dmabuf,userptr\n"
+          "  --convert-iterations N  每个转换内核的迭代次数（默认 50）\n"
+          "  --no-capture         只测量转换内核\n"
+          "  --no-convert         只测量捕获\n"
+          "  --output FILE        JSON 输出文件（默认 stdout）\n",
+          program);
+}
+
+std::vector<std::string> SplitList(const std::string& list) {
+  std::vector<std::string> items;
+  size_t begin = 0;
+  while (begin <= list.size()) {
+    size_t end = list.find(',', begin);
+    if (end == std::string::npos) {
+      end = list.size();
+    }
+    if (end > begin) {
+      items.push_back(list.substr(begin, end - begin));
+    }
+    begin = end + 1;
+  }
+  return items;
+}
+
+bool ParseOptions(int argc, char* argv[], BenchOptions* options) {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--no-capture") {
+      options->capture = false;
+    } else if (arg == "--no-convert") {
+      options->convert = false;
+    } else if (!has_value) {
+      return false;
+    } else if (arg == "--device") {
+      options->device_path = argv[++i];
+    } else if (arg == "--width") {
+      options->width = strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--height") {
+      options->height = strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--format") {
+      const char* fourcc = argv[++i];
+      if (strlen(fourcc) != 4) {
+        return false;
+      }
+      options->pixel_format =
+          v4l2_fourcc(fourcc[0], fourcc[1], fourcc[2], fourcc[3]);
+    } else if (arg == "--buffers") {
+      options->buffer_count = strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--frames") {
+      options->frames = strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--modes") {
+      options->modes = SplitList(argv[++i]);
+    } else if (arg == "--convert-iterations") {
+      options->convert_iterations = strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--output") {
+      options->output_path = argv[++i];
+    } else {
+      return false;
+    }
+  }
+  return options->width > 0 && options->height > 0 &&
+         options->buffer_count > 0 && options->frames > 0;
+}
+
+// 查找测试设备：优先 vivid，其次 v4l2loopback，指定路径时直接使用
+bool FindBenchDevice(const std::string& device_path, std::string* found) {
+  if (!device_path.empty()) {
+    *found = device_path;
+    return true;
+  }
+  std::vector<DeviceInfo> devices;
+  FindVideoDevices(&devices);
+  const char* drivers[] = {"vivid", "v4l2 loopback"};
+  for (const char* driver : drivers) {
+    for (const auto& info : devices) {
+      if (info.driver_name == driver) {
+        *found = info.device_path;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+int64_t ProcessCpuMicros() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return static_cast<int64_t>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) *
+             1000000 +
+         usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+bool InitBuffers(V4L2Device* device, const std::string& mode,
+                 uint32_t buffer_count, HugePageBufferPool* pool,
+                 std::string* error) {
+  if (mode == "mmap") {
+    if (!device->InitMemoryMapping(buffer_count)) {
+      *error = "初始化 MMAP 缓冲区失败";
+      return false;
+    }
+    return true;
+  }
+  if (mode == "dmabuf") {
+    if (!device->InitDmaBuf(buffer_count)) {
+      *error = "驱动不支持 VIDIOC_EXPBUF";
+      return false;
+    }
+    return true;
+  }
+  if (mode == "userptr") {
+    VideoFormat format;
+    if (!device->GetFormat(&format) || format.plane_count != 1) {
+      *error = "USERPTR 只支持单平面格式";
+      return false;
+    }
+    if (!pool->Init(buffer_count + kSpareUserPtrBuffers,
+                    format.sizeimage[0])) {
+      *error = "分配缓冲池失败";
+      return false;
+    }
+    if (!device->InitUserPtr(pool->GetBuffers(), pool->GetBufferSize(),
+                             buffer_count)) {
+      *error = "驱动不支持 USERPTR";
+      return false;
+    }
+    return true;
+  }
+  *error = "未知的内存模式";
+  return false;
+}
+
+// 按缓存行读取整帧，模拟应用访问帧数据（DMABUF/未缓存内存差异在此体现）
+uint64_t TouchFrame(const FrameLease& lease) {
+  uint64_t sum = 0;
+  for (uint32_t p = 0; p < lease.plane_count(); ++p) {
+    const volatile uint8_t* data =
+        static_cast<const volatile uint8_t*>(lease.plane_data(p));
+    for (size_t i = 0; i < lease.plane_size(p); i += kTouchStride) {
+      sum += data[i];
+    }
+  }
+  return sum;
+}
+
+void RunCapture(const std::string& device_path, const BenchOptions& options,
+                CaptureResult* result) {
+  // 缓冲池须在设备释放 USERPTR 缓冲区之后才释放，因此先于设备构造
+  HugePageBufferPool pool;
+  V4L2Device device;
+  if (!device.Open(device_path)) {
+    result->error = "无法打开设备";
+    return;
+  }
+  if (!device.SetFormat(options.width, options.height,
+                        options.pixel_format) ||
+      !device.GetFormat(&result->format)) {
+    result->error = "设置格式失败";
+    return;
+  }
+  if (!InitBuffers(&device, result->mode, options.buffer_count, &pool,
+                   &result->error)) {
+    return;
+  }
+  device.SetLatencyTracker(&result->latency);
+  if (!device.StartStreaming()) {
+    result->error = "启动视频流失败";
+    return;
+  }
+
+  uint64_t checksum = 0;
+  int64_t touch_us = 0;
+  int64_t begin_us = 0;
+  int64_t begin_cpu_us = 0;
+  uint32_t total = kWarmupFrames + options.frames;
+  for (uint32_t i = 0; i < total; ++i) {
+    if (i == kWarmupFrames) {
+      result->latency.Reset();
+      result->dqbuf_us.Reset();
+      touch_us = 0;
+      begin_us = MonotonicMicros();
+      begin_cpu_us = ProcessCpuMicros();
+    }
+    if (!device.WaitForFrame(kFrameTimeoutMs)) {
+      result->error = "等待帧超时";
+      break;
+    }
+    FrameLease lease;
+    int64_t dqbuf_begin_us = MonotonicMicros();
+    if (!device.DequeueFrame(&lease)) {
+      continue;
+    }
+    int64_t dqbuf_end_us = MonotonicMicros();
+    result->dqbuf_us.Record(dqbuf_end_us - dqbuf_begin_us);
+    checksum += TouchFrame(lease);
+    touch_us += MonotonicMicros() - dqbuf_end_us;
+    if (i >= kWarmupFrames) {
+      result->frames++;
+    }
+  }
+  (void)checksum;
+
+  if (result->frames > 0) {
+    result->ok = result->error.empty();
+    result->elapsed_s = (MonotonicMicros() - begin_us) / 1e6;
+    result->fps = result->frames / result->elapsed_s;
+    result->cpu_us_per_frame =
+        static_cast<double>(ProcessCpuMicros() - begin_cpu_us) /
+        result->frames;
+    result->touch_us_per_frame =
+        static_cast<double>(touch_us) / result->frames;
+  }
+  device.GetDropStats(&result->drops);
+  device.SetLatencyTracker(nullptr);
+  device.StopStreaming();
+  device.Close();
+}
+
+void RunConvert(const BenchOptions& options,
+                std::vector<ConvertResult>* results) {
+  const ConverterIsa isas[] = {ConverterIsa::kScalar, ConverterIsa::kSse41,
+                               ConverterIsa::kAvx2, ConverterIsa::kNeon};
+  const uint32_t src_formats[] = {V4L2_PIX_FMT_YUYV, V4L2_PIX_FMT_UYVY};
+  const uint32_t dst_formats[] = {V4L2_PIX_FMT_NV12, V4L2_PIX_FMT_YUV420,
+                                  V4L2_PIX_FMT_RGB24, V4L2_PIX_FMT_ABGR32};
+  uint32_t width = options.width & ~1u;
+  uint32_t height = options.height;
+  std::vector<uint8_t> src(static_cast<size_t>(width) * height * 2);
+  uint32_t seed = 12345;
+  for (auto& byte : src) {
+    seed = seed * 1103515245 + 12345;
+    byte = seed >> 24;
+  }
+  std::vector<uint8_t> dst(
+      FormatConverter::GetFrameSize(V4L2_PIX_FMT_ABGR32, width, height));
+  uint32_t iterations = std::max(options.convert_iterations, 1u);
+
+  std::vector<std::string> measured;
+  for (ConverterIsa isa : isas) {
+    // 当前 CPU 不支持的指令集会退回其他实现，只测量一次
+    FormatConverter converter(isa);
+    std::string name = converter.GetIsaName();
+    if (std::find(measured.begin(), measured.end(), name) != measured.end()) {
+      continue;
+    }
+    measured.push_back(name);
+
+    for (uint32_t src_format : src_formats) {
+      for (uint32_t dst_format : dst_formats) {
+        // 预热一次，消除首次缺页
+        converter.Convert(src.data(), src.size(), src_format, width, height,
+                          dst_format, dst.data(), dst.size());
+        int64_t total_us = 0;
+        int64_t min_us = INT64_MAX;
+        for (uint32_t i = 0; i < iterations; ++i) {
+          int64_t begin = MonotonicMicros();
+          converter.Convert(src.data(), src.size(), src_format, width, height,
+                            dst_format, dst.data(), dst.size());
+          int64_t elapsed = MonotonicMicros() - begin;
+          total_us += elapsed;
+          min_us = std::min(min_us, elapsed);
+        }
+        ConvertResult result;
+        result.isa = name;
+        result.src_format = src_format;
+        result.dst_format = dst_format;
+        result.mean_ms = total_us / 1000.0 / iterations;
+        result.min_ms = min_us / 1000.0;
+        result.mb_per_s = total_us > 0 ? src.size() * static_cast<double>(
+                                             iterations) / total_us
+                                       : 0.0;
+        results->push_back(result);
+      }
+    }
+  }
+}
+
+// 输出 JSON 字符串（只转义引号、反斜杠与控制字符）
+void WriteJsonString(FILE* out, const std::string& value) {
+  fputc('"', out);
+  for (unsigned char c : value) {
+    if (c == '"' || c == '\\') {
+      fprintf(out, "\\%c", c);
+    } else if (c < 0x20) {
+      fprintf(out, "\\u%04x", c);
+    } else {
+      fputc(c, out);
+    }
+  }
+  fputc('"', out);
+}
+
+void WriteHistogram(FILE* out, const char* name,
+                    const LatencyHistogram& histogram) {
+  fprintf(out,
+          "\"%s\": {\"count\": %lu, \"mean\": %.2f, \"p50\": %lu, "
+          "\"p99\": %lu, \"p999\": %lu, \"max\": %lu}",
+          name, histogram.Count(), histogram.Mean(),
+          histogram.Percentile(50), histogram.Percentile(99),
+          histogram.Percentile(99.9), histogram.Max());
+}
+
+void WriteReport(FILE* out, const BenchOptions& options,
+                 const std::string& device_path,
+                 const std::vector<CaptureResult>& captures,
+                 const std::vector<ConvertResult>& converts) {
+  fprintf(out, "{\n  \"version\": 1,\n  \"timestamp\": %ld,\n",
+          static_cast<long>(time(nullptr)));
+  fprintf(out, "  \"config\": {\"device\": ");
+  WriteJsonString(out, device_path);
+  fprintf(out,
+          ", \"width\": %u, \"height\": %u, \"format\": \"%s\", "
+          "\"buffers\": %u, \"frames\": %u, \"convert_iterations\": %u},\n",
+          options.width, options.height,
+          PixelFormatToString(options.pixel_format).c_str(),
+          options.buffer_count, options.frames, options.convert_iterations);
+
+  fprintf(out, "  \"capture\": [");
+  for (size_t i = 0; i < captures.size(); ++i) {
+    const CaptureResult& r = captures[i];
+    fprintf(out, "%s\n    {\"mode\": \"%s\", \"ok\": %s", i ? "," : "",
+            r.mode.c_str(), r.ok ? "true" : "false");
+    if (!r.error.empty()) {
+      fprintf(out, ", \"error\": ");
+      WriteJsonString(out, r.error);
+    }
+    fprintf(out,
+            ", \"width\": %u, \"height\": %u, \"format\": \"%s\", "
+            "\"frames\": %lu, \"elapsed_s\": %.3f, \"fps\": %.2f, "
+            "\"cpu_us_per_frame\": %.2f, \"touch_us_per_frame\": %.2f, "
+            "\"dropped\": %lu, \"error_frames\": %lu, \"short_frames\": %lu,"
+            "\n     \"latency_us\": {",
+            r.format.width, r.format.height,
+            PixelFormatToString(r.format.pixel_format).c_str(), r.frames,
+            r.elapsed_s, r.fps, r.cpu_us_per_frame, r.touch_us_per_frame,
+            r.drops.dropped, r.drops.error_frames, r.drops.short_frames);
+    WriteHistogram(out, "dqbuf", r.dqbuf_us);
+    fprintf(out, ",\n      ");
+    WriteHistogram(out, "sensor_to_dequeue", r.latency.sensor_to_dequeue);
+    fprintf(out, "}}");
+  }
+  fprintf(out, "%s],\n", captures.empty() ? "" : "\n  ");
+
+  fprintf(out, "  \"convert\": [");
+  for (size_t i = 0; i < converts.size(); ++i) {
+    const ConvertResult& r = converts[i];
+    fprintf(out,
+            "%s\n    {\"isa\": \"%s\", \"src\": \"%s\", \"dst\": \"%s\", "
+            "\"mean_ms\": %.3f, \"min_ms\": %.3f, \"mb_per_s\": %.1f}",
+            i ? "," : "", r.isa.c_str(),
+            PixelFormatToString(r.src_format).c_str(),
+            PixelFormatToString(r.dst_format).c_str(), r.mean_ms, r.min_ms,
+            r.mb_per_s);
+  }
+  fprintf(out, "%s]\n}\n", converts.empty() ? "" : "\n  ");
+}
+}  // namespace
+
+// 用法: v4l2_bench [选项]，结果以 JSON 输出，便于 CI 比较回归
+// 加载测试驱动: sudo modprobe vivid
+int main(int argc, char* argv[]) {
+  BenchOptions options;
+  if (!ParseOptions(argc, argv, &options)) {
+    PrintUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  std::string device_path;
+  std::vector<CaptureResult> captures(options.capture ? options.modes.size()
+                                                      : 0);
+  if (options.capture) {
+    bool found = FindBenchDevice(options.device_path, &device_path);
+    for (size_t i = 0; i < captures.size(); ++i) {
+      captures[i].mode = options.modes[i];
+      memset(&captures[i].format, 0, sizeof(captures[i].format));
+      memset(&captures[i].drops, 0, sizeof(captures[i].drops));
+      if (!found) {
+        captures[i].error = "未找到 vivid/v4l2loopback 设备";
+        continue;
+      }
+      fprintf(stderr, "捕获测量: %s %s\n", device_path.c_str(),
+              options.modes[i].c_str());
+      RunCapture(device_path, options, &captures[i]);
+    }
+  }
+
+  std::vector<ConvertResult> converts;
+  if (options.convert) {
+    fprintf(stderr, "转换内核测量: %ux%u\n", options.width, options.height);
+    RunConvert(options, &converts);
+  }
+
+  FILE* out = stdout;
+  if (!options.output_path.empty()) {
+    out = fopen(options.output_path.c_str(), "w");
+    if (!out) {
+      fprintf(stderr, "无法打开文件 %s 进行写入: %s\n",
+              options.output_path.c_str(), strerror(errno));
+      return EXIT_FAILURE;
+    }
+  }
+  WriteReport(out, options, device_path, captures, converts);
+  if (out != stdout) {
+    fclose(out);
+  }
+
+  for (const auto& capture : captures) {
+    if (!capture.ok) {
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
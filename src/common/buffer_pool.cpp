@@ -0,0 +1,117 @@
+#include "buffer_pool.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+
+namespace v4l2_demo {
+
+namespace {
+constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+size_t AlignUp(size_t value, size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+}  // namespace
+
+HugePageBufferPool::HugePageBufferPool()
+    : base_(nullptr),
+      mapped_size_(0),
+      buffer_count_(0),
+      buffer_size_(0),
+      stride_(0),
+      huge_tlb_(false) {}
+
+HugePageBufferPool::~HugePageBufferPool() {
+  Release();
+}
+
+bool HugePageBufferPool::Init(size_t buffer_count, size_t buffer_size,
+                              size_t alignment) {
+  Release();
+
+  if (buffer_count == 0 || buffer_size == 0 || alignment == 0 ||
+      (alignment & (alignment - 1)) != 0) {
+    fprintf(stderr, "无效的缓冲池参数\n");
+    return false;
+  }
+
+  stride_ = AlignUp(buffer_size, alignment);
+  mapped_size_ = AlignUp(stride_ * buffer_count, kHugePageSize);
+
+  // 优先使用显式 2 MB 大页（需要 /proc/sys/vm/nr_hugepages 预留）
+  void* ptr = mmap(nullptr, mapped_size_, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB,
+                   -1, 0);
+  huge_tlb_ = (ptr != MAP_FAILED);
+
+  if (!huge_tlb_) {
+    // 退回普通匿名映射，多映射一个大页以便手动对齐到 2 MB 边界，
+    // 再通过 MADV_HUGEPAGE 请求透明大页
+    size_t padded = mapped_size_ + kHugePageSize;
+    void* raw = mmap(nullptr, padded, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+      fprintf(stderr, "分配缓冲池失败: %s\n", strerror(errno));
+      return false;
+    }
+
+    uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+    uintptr_t aligned = AlignUp(start, kHugePageSize);
+    if (aligned > start) {
+      munmap(raw, aligned - start);
+    }
+    size_t tail = (start + padded) - (aligned + mapped_size_);
+    if (tail > 0) {
+      munmap(reinterpret_cast<void*>(aligned + mapped_size_), tail);
+    }
+    ptr = reinterpret_cast<void*>(aligned);
+    madvise(ptr, mapped_size_, MADV_HUGEPAGE);
+  }
+
+  base_ = static_cast<uint8_t*>(ptr);
+  buffer_count_ = buffer_count;
+  buffer_size_ = buffer_size;
+
+  // 预先触碰所有页面，避免捕获过程中发生缺页
+  memset(base_, 0, mapped_size_);
+  return true;
+}
+
+void HugePageBufferPool::Release() {
+  if (base_) {
+    munmap(base_, mapped_size_);
+    base_ = nullptr;
+  }
+  mapped_size_ = 0;
+  buffer_count_ = 0;
+  buffer_size_ = 0;
+  stride_ = 0;
+  huge_tlb_ = false;
+}
+
+void* HugePageBufferPool::GetBuffer(size_t index) const {
+  if (!base_ || index >= buffer_count_) {
+    return nullptr;
+  }
+  return base_ + index * stride_;
+}
+
+std::vector<void*> HugePageBufferPool::GetBuffers() const {
+  std::vector<void*> buffers;
+  buffers.reserve(buffer_count_);
+  for (size_t i = 0; i < buffer_count_; ++i) {
+    buffers.push_back(GetBuffer(i));
+  }
+  return buffers;
+}
+
+}  // namespace v4l2_demo
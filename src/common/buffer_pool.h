@@ -0,0 +1,55 @@
+#ifndef V4L2_DEMO_SRC_COMMON_BUFFER_POOL_H_
+#define V4L2_DEMO_SRC_COMMON_BUFFER_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace v4l2_demo {
+
+// 大页支撑的帧缓冲池
+// 一次性分配一整块连续内存并切分为等长、按指定边界对齐的缓冲区，
+// 优先使用 2 MB 显式大页（MAP_HUGETLB），不可用时退回透明大页，
+// 减少转换/SIMD 内核遍历整帧时的 TLB 缺失
+class HugePageBufferPool {
+ public:
+  HugePageBufferPool();
+  ~HugePageBufferPool();
+
+  HugePageBufferPool(const HugePageBufferPool&) = delete;
+  HugePageBufferPool& operator=(const HugePageBufferPool&) = delete;
+
+  // 分配缓冲池
+  // @param buffer_count 缓冲区数量
+  // @param buffer_size 每个缓冲区的最小大小
+  // @param alignment 缓冲区对齐边界（2 的幂，如 64 或 4096）
+  // @return 成功返回 true，失败返回 false
+  bool Init(size_t buffer_count, size_t buffer_size, size_t alignment = 4096);
+
+  // 释放缓冲池
+  void Release();
+
+  // 获取第 index 个缓冲区
+  void* GetBuffer(size_t index) const;
+
+  // 获取全部缓冲区地址，可直接传给 V4L2Device::InitUserPtr
+  std::vector<void*> GetBuffers() const;
+
+  size_t GetBufferCount() const { return buffer_count_; }
+  size_t GetBufferSize() const { return buffer_size_; }
+
+  // 是否由显式大页（hugetlbfs）支撑
+  bool IsHugeTlb() const { return huge_tlb_; }
+
+ private:
+  uint8_t* base_;       // 整块内存起始地址
+  size_t mapped_size_;  // 映射大小
+  size_t buffer_count_;
+  size_t buffer_size_;  // 对外报告的缓冲区大小
+  size_t stride_;       // 相邻缓冲区间隔（按对齐边界取整）
+  bool huge_tlb_;
+};
+
+}  // namespace v4l2_demo
+
+#endif  // V4L2_DEMO_SRC_COMMON_BUFFER_POOL_H_
@@ -0,0 +1,243 @@
+#include "camera_controls.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+namespace v4l2_demo {
+
+namespace {
+// 按钮与只写控制项没有可读的当前值
+bool IsReadable(const ControlInfo& info) {
+  return info.type != V4L2_CTRL_TYPE_BUTTON &&
+         !(info.flags & V4L2_CTRL_FLAG_WRITE_ONLY);
+}
+}  // namespace
+
+CameraControls::CameraControls()
+    : device_(nullptr),
+      any_pending_(false),
+      requests_(0),
+      applied_(0),
+      batches_(0),
+      failures_(0) {}
+
+std::string CameraControls::MakeKey(const std::string& name) {
+  std::string key;
+  key.reserve(name.size());
+  for (char c : name) {
+    unsigned char u = static_cast<unsigned char>(c);
+    if (isalnum(u)) {
+      key += static_cast<char>(tolower(u));
+    } else if (!key.empty() && key.back() != '_') {
+      key += '_';
+    }
+  }
+  while (!key.empty() && key.back() == '_') {
+    key.pop_back();
+  }
+  return key;
+}
+
+bool CameraControls::Init(V4L2Device* device) {
+  if (!device || !device->QueryControls(&controls_)) {
+    return false;
+  }
+  device_ = device;
+  std::sort(controls_.begin(), controls_.end(),
+            [](const ControlInfo& a, const ControlInfo& b) {
+              return a.id < b.id;
+            });
+
+  keys_.clear();
+  for (size_t i = 0; i < controls_.size(); ++i) {
+    keys_.emplace(MakeKey(controls_[i].name), i);
+  }
+  slots_.reset(new Slot[controls_.size()]);
+  for (size_t i = 0; i < controls_.size(); ++i) {
+    slots_[i].pending.store(controls_[i].default_value);
+    slots_[i].current.store(controls_[i].default_value);
+    slots_[i].dirty.store(false);
+  }
+  any_pending_ = false;
+  batch_.assign(controls_.size(), v4l2_ext_control());
+  batch_index_.assign(controls_.size(), 0);
+
+  // 一次读取全部可读控制项，个别控制项不可读时改为逐个读取
+  uint32_t count = 0;
+  for (size_t i = 0; i < controls_.size(); ++i) {
+    if (IsReadable(controls_[i])) {
+      FillControl(i, 0, &batch_[count]);
+      batch_index_[count++] = static_cast<uint32_t>(i);
+    }
+  }
+  if (count == 0) {
+    return true;
+  }
+  if (device_->GetControls(batch_.data(), count)) {
+    for (uint32_t k = 0; k < count; ++k) {
+      slots_[batch_index_[k]].current.store(
+          ReadControl(batch_index_[k], batch_[k]));
+    }
+    return true;
+  }
+  for (uint32_t k = 0; k < count; ++k) {
+    if (device_->GetControls(&batch_[k], 1)) {
+      slots_[batch_index_[k]].current.store(
+          ReadControl(batch_index_[k], batch_[k]));
+    }
+  }
+  return true;
+}
+
+int CameraControls::FindIndex(uint32_t id) const {
+  auto it = std::lower_bound(controls_.begin(), controls_.end(), id,
+                             [](const ControlInfo& info, uint32_t value) {
+                               return info.id < value;
+                             });
+  if (it == controls_.end() || it->id != id) {
+    return -1;
+  }
+  return static_cast<int>(it - controls_.begin());
+}
+
+const ControlInfo* CameraControls::Find(uint32_t id) const {
+  int index = FindIndex(id);
+  return index < 0 ? nullptr : &controls_[index];
+}
+
+const ControlInfo* CameraControls::Find(const std::string& name) const {
+  auto it = keys_.find(MakeKey(name));
+  return it == keys_.end() ? nullptr : &controls_[it->second];
+}
+
+int64_t CameraControls::ClampValue(const ControlInfo& info, int64_t value) {
+  switch (info.type) {
+    case V4L2_CTRL_TYPE_BOOLEAN:
+      return value != 0 ? 1 : 0;
+    case V4L2_CTRL_TYPE_BUTTON:
+      return 1;
+    case V4L2_CTRL_TYPE_BITMASK:
+      return value & info.maximum;
+    default:
+      break;
+  }
+  value = std::min(std::max(value, info.minimum), info.maximum);
+  if (info.step > 1) {
+    // 对齐到 minimum + n * step（四舍五入），且不越过 maximum
+    uint64_t offset = static_cast<uint64_t>(value - info.minimum);
+    offset = (offset + info.step / 2) / info.step * info.step;
+    if (offset > static_cast<uint64_t>(info.maximum - info.minimum)) {
+      offset -= info.step;
+    }
+    value = info.minimum + static_cast<int64_t>(offset);
+  }
+  return value;
+}
+
+bool CameraControls::Request(uint32_t id, int64_t value) {
+  int index = FindIndex(id);
+  if (index < 0 || (controls_[index].flags & V4L2_CTRL_FLAG_READ_ONLY)) {
+    return false;
+  }
+  Slot& slot = slots_[index];
+  slot.pending.store(ClampValue(controls_[index], value),
+                     std::memory_order_relaxed);
+  // 先写值再置位：ApplyPending 看到 dirty 时一定能读到这次的值
+  slot.dirty.store(true, std::memory_order_release);
+  any_pending_.store(true, std::memory_order_release);
+  requests_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+bool CameraControls::Request(const std::string& name, int64_t value) {
+  const ControlInfo* info = Find(name);
+  return info && Request(info->id, value);
+}
+
+void CameraControls::FillControl(size_t index, int64_t value,
+                                 struct v4l2_ext_control* control) const {
+  memset(control, 0, sizeof(*control));
+  control->id = controls_[index].id;
+  if (controls_[index].type == V4L2_CTRL_TYPE_INTEGER64) {
+    control->value64 = value;
+  } else {
+    control->value = static_cast<int32_t>(value);
+  }
+}
+
+int64_t CameraControls::ReadControl(
+    size_t index, const struct v4l2_ext_control& control) const {
+  return controls_[index].type == V4L2_CTRL_TYPE_INTEGER64 ? control.value64
+                                                           : control.value;
+}
+
+size_t CameraControls::ApplyPending() {
+  if (!any_pending_.load(std::memory_order_relaxed) ||
+      !any_pending_.exchange(false, std::memory_order_acquire)) {
+    return 0;
+  }
+
+  // 在 exchange 之后到达的请求会重新置位 any_pending_，不会丢失
+  uint32_t count = 0;
+  for (size_t i = 0; i < controls_.size(); ++i) {
+    Slot& slot = slots_[i];
+    if (slot.dirty.load(std::memory_order_relaxed) &&
+        slot.dirty.exchange(false, std::memory_order_acquire)) {
+      FillControl(i, slot.pending.load(std::memory_order_relaxed),
+                  &batch_[count]);
+      batch_index_[count++] = static_cast<uint32_t>(i);
+    }
+  }
+  if (count == 0) {
+    return 0;
+  }
+
+  batches_.fetch_add(1, std::memory_order_relaxed);
+  size_t applied = 0;
+  if (device_->SetControls(batch_.data(), count)) {
+    for (uint32_t k = 0; k < count; ++k) {
+      slots_[batch_index_[k]].current.store(
+          ReadControl(batch_index_[k], batch_[k]), std::memory_order_relaxed);
+    }
+    applied = count;
+  } else {
+    // 驱动对整批做校验，一个控制项被拒绝（如自动曝光开启时设置曝光时间）
+    // 可能导致整批不生效，逐项重试让其余控制项仍然生效
+    for (uint32_t k = 0; k < count; ++k) {
+      batches_.fetch_add(1, std::memory_order_relaxed);
+      if (device_->SetControls(&batch_[k], 1)) {
+        slots_[batch_index_[k]].current.store(
+            ReadControl(batch_index_[k], batch_[k]),
+            std::memory_order_relaxed);
+        ++applied;
+      } else {
+        fprintf(stderr, "控制项 %s 未生效\n",
+                controls_[batch_index_[k]].name.c_str());
+        failures_.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+  }
+  applied_.fetch_add(applied, std::memory_order_relaxed);
+  return applied;
+}
+
+bool CameraControls::GetValue(uint32_t id, int64_t* value) const {
+  int index = FindIndex(id);
+  if (index < 0 || !value) {
+    return false;
+  }
+  *value = slots_[index].current.load(std::memory_order_relaxed);
+  return true;
+}
+
+void CameraControls::GetStats(ControlStats* stats) const {
+  stats->requests = requests_.load(std::memory_order_relaxed);
+  stats->applied = applied_.load(std::memory_order_relaxed);
+  stats->batches = batches_.load(std::memory_order_relaxed);
+  stats->failures = failures_.load(std::memory_order_relaxed);
+}
+
+}  // namespace v4l2_demo
@@ -0,0 +1,121 @@
+#ifndef V4L2_DEMO_SRC_COMMON_CAMERA_CONTROLS_H_
+#define V4L2_DEMO_SRC_COMMON_CAMERA_CONTROLS_H_
+
+#include <linux/videodev2.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "v4l2_utils.h"
+
+namespace v4l2_demo {
+
+// 控制项统计
+struct ControlStats {
+  uint64_t requests;  // 收到的修改请求数
+  uint64_t applied;   // 已应用的控制项数（同一控制项的多次请求合并为一次）
+  uint64_t batches;   // 提交的批次数（每批一次 VIDIOC_S_EXT_CTRLS）
+  uint64_t failures;  // 被驱动拒绝的控制项数
+};
+
+// 摄像头控制项表
+// Init 时一次性枚举控制项（VIDIOC_QUERY_EXT_CTRL）并读取当前值，之后按
+// ID 或名称查询都在缓存上完成，不再发起 ioctl
+// 名称可以是驱动给出的原名，也可以是 v4l2-ctl 风格的键
+// （"Exposure Time, Absolute" -> "exposure_time_absolute"）
+// 运行时修改分两步：Request 可在任意线程调用，只把值写入该控制项的原子
+// 槽位（无锁、不分配内存，同一控制项的多次请求只保留最新值）；捕获线程
+// 在两次出队之间调用 ApplyPending，把所有待应用的值合并为一次
+// VIDIOC_S_EXT_CTRLS 提交
+// 允许多个线程同时 Request，ApplyPending 只能在一个线程调用
+class CameraControls {
+ public:
+  CameraControls();
+
+  CameraControls(const CameraControls&) = delete;
+  CameraControls& operator=(const CameraControls&) = delete;
+
+  // 枚举控制项并读取当前值
+  // @param device 已打开的设备，生命周期需长于本对象
+  // @return 成功返回 true，失败返回 false
+  bool Init(V4L2Device* device);
+
+  // 所有控制项（按 ID 排序）
+  const std::vector<ControlInfo>& controls() const { return controls_; }
+
+  // 按 ID 查找控制项
+  // @return 找不到返回 nullptr
+  const ControlInfo* Find(uint32_t id) const;
+
+  // 按名称或键查找控制项（忽略大小写与标点）
+  // @return 找不到返回 nullptr
+  const ControlInfo* Find(const std::string& name) const;
+
+  // 请求修改控制值，在下一次 ApplyPending 时生效（可在任意线程调用）
+  // 整数值限制到 [minimum, maximum] 并对齐到 step，布尔值非零即为 1
+  // @param id 控制 ID
+  // @param value 新值
+  // @return 已记录返回 true，控制项不存在或只读返回 false
+  bool Request(uint32_t id, int64_t value);
+  bool Request(const std::string& name, int64_t value);
+
+  // 提交所有待应用的修改（捕获线程在两次出队之间调用）
+  // 没有待应用的修改时只有一次原子操作；批量提交被拒绝时逐项重试，
+  // 使其余控制项仍然生效
+  // @return 本次成功应用的控制项数
+  size_t ApplyPending();
+
+  // 读取缓存的当前值（最近一次读取或成功应用的值，可在任意线程调用）
+  // @return 控制项存在返回 true
+  bool GetValue(uint32_t id, int64_t* value) const;
+
+  // 获取统计信息（可在任意线程调用）
+  void GetStats(ControlStats* stats) const;
+
+  // 把驱动名称转换为键：小写字母数字保留，其余字符变为单个 '_'，
+  // 去掉首尾的 '_'
+  static std::string MakeKey(const std::string& name);
+
+ private:
+  // 每个控制项一个槽位，与 controls_ 一一对应
+  struct Slot {
+    std::atomic<int64_t> pending;  // 最近一次请求的值
+    std::atomic<int64_t> current;  // 缓存的当前值
+    std::atomic<bool> dirty;       // pending 尚未应用
+  };
+
+  // @return controls_ 中的下标，找不到返回 -1
+  int FindIndex(uint32_t id) const;
+
+  // 把请求值限制到控制项的取值范围
+  static int64_t ClampValue(const ControlInfo& info, int64_t value);
+
+  // 把第 index 个控制项的值写入/读出 v4l2_ext_control
+  void FillControl(size_t index, int64_t value,
+                   struct v4l2_ext_control* control) const;
+  int64_t ReadControl(size_t index,
+                      const struct v4l2_ext_control& control) const;
+
+  V4L2Device* device_;
+  std::vector<ControlInfo> controls_;
+  std::unordered_map<std::string, size_t> keys_;  // 键 -> controls_ 下标
+  std::unique_ptr<Slot[]> slots_;
+  std::atomic<bool> any_pending_;  // 至少一个槽位有待应用的值
+
+  // ApplyPending 使用的批次缓冲，Init 时按控制项总数预留
+  std::vector<struct v4l2_ext_control> batch_;
+  std::vector<uint32_t> batch_index_;
+
+  std::atomic<uint64_t> requests_;
+  std::atomic<uint64_t> applied_;
+  std::atomic<uint64_t> batches_;
+  std::atomic<uint64_t> failures_;
+};
+
+}  // namespace v4l2_demo
+
+#endif  // V4L2_DEMO_SRC_COMMON_CAMERA_CONTROLS_H_
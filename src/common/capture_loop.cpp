@@ -0,0 +1,217 @@
+#include "capture_loop.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace v4l2_demo {
+
+namespace {
+// 所有缓冲区都被租约持有时，驱动 poll 返回 EPOLLERR，
+// 此时只等待退出事件，并按该间隔重新检查设备
+constexpr int kStarvedRetryMs = 1;
+
+// epoll 事件的 data.u32 标识
+constexpr uint32_t kWakeupTag = 0;
+constexpr uint32_t kDeviceTag = 1;
+}  // namespace
+
+CaptureLoop::CaptureLoop() : epoll_fd_(-1), wakeup_fd_(-1), recoveries_(0) {}
+
+CaptureLoop::~CaptureLoop() {
+  if (wakeup_fd_ >= 0) {
+    close(wakeup_fd_);
+  }
+  if (epoll_fd_ >= 0) {
+    close(epoll_fd_);
+  }
+}
+
+bool CaptureLoop::Init() {
+  if (epoll_fd_ >= 0) {
+    return true;
+  }
+
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd_ < 0) {
+    fprintf(stderr, "创建 epoll 失败: %s\n", strerror(errno));
+    return false;
+  }
+
+  wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wakeup_fd_ < 0) {
+    fprintf(stderr, "创建 eventfd 失败: %s\n", strerror(errno));
+    return false;
+  }
+
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.u32 = kWakeupTag;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wakeup_fd_, &ev) < 0) {
+    fprintf(stderr, "注册 eventfd 失败: %s\n", strerror(errno));
+    return false;
+  }
+
+  return true;
+}
+
+bool CaptureLoop::Run(V4L2Device* device, const FrameCallback& callback) {
+  if (epoll_fd_ < 0 || !device || !device->IsOpen()) {
+    return false;
+  }
+
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.u32 = kDeviceTag;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, device->GetFileDescriptor(), &ev) <
+      0) {
+    fprintf(stderr, "注册设备 fd 失败: %s\n", strerror(errno));
+    return false;
+  }
+
+  bool ok = true;
+  bool running = true;
+  FrameLease lease;
+  while (running) {
+    struct epoll_event events[2];
+    int n = epoll_wait(epoll_fd_, events, 2, -1);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fprintf(stderr, "epoll_wait 失败: %s\n", strerror(errno));
+      ok = false;
+      break;
+    }
+
+    for (int i = 0; i < n; ++i) {
+      if (events[i].data.u32 == kWakeupTag) {
+        uint64_t value;
+        ssize_t ret = read(wakeup_fd_, &value, sizeof(value));
+        (void)ret;
+        running = false;
+        break;
+      }
+
+      if (events[i].events & EPOLLERR) {
+        // 缓冲区全部被下游持有，属于背压而非设备故障；没有缓冲区时
+        // （恢复未完成）GetLeasedBufferCount 同样为 0，不能当作背压
+        if (device->GetBufferCount() > 0 &&
+            device->GetLeasedBufferCount() >= device->GetBufferCount()) {
+          // 只等待退出事件，退出事件留给下一轮 epoll_wait 处理
+          WaitForStop(kStarvedRetryMs);
+          continue;
+        }
+      } else {
+        // 一次唤醒取尽所有已就绪的帧
+        while (device->DequeueFrame(&lease)) {
+          callback(&lease);
+          lease.Release();
+        }
+        // 未开启恢复时出队错误只打印，由之后的 EPOLLERR 决定是否退出
+        if (device->GetLastError() == 0 || !recovery_.enabled) {
+          continue;
+        }
+      }
+
+      // 驱动报告错误（EIO）或设备断开（ENODEV）
+      if (!recovery_.enabled) {
+        fprintf(stderr, "设备 fd 出错，停止捕获\n");
+        ok = false;
+        running = false;
+        break;
+      }
+      RecoverResult result = Recover(device);
+      if (result != RecoverResult::kRecovered) {
+        ok = result == RecoverResult::kStopped;
+        running = false;
+      }
+      // 恢复前的其余事件已经过时
+      break;
+    }
+  }
+
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, device->GetFileDescriptor(), nullptr);
+  return ok;
+}
+
+bool CaptureLoop::WaitForStop(int timeout_ms) {
+  struct pollfd pfd;
+  pfd.fd = wakeup_fd_;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  return poll(&pfd, 1, timeout_ms) > 0;
+}
+
+CaptureLoop::RecoverResult CaptureLoop::Recover(V4L2Device* device) {
+  fprintf(stderr, "\n设备 %s 出错 (%s)，开始恢复\n",
+          device->GetDevicePath().c_str(),
+          device->GetLastError() ? strerror(device->GetLastError())
+                                 : "poll 报告错误");
+  // 重新打开后 fd 会变化，先从 epoll 中移除旧 fd
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, device->GetFileDescriptor(), nullptr);
+  // 失败的尝试会清除缓冲区与流状态，恢复目标在第一次尝试前保存
+  device->SaveRestoreState();
+
+  int64_t start_us = MonotonicMicros();
+  int backoff_ms = std::max(1, recovery_.initial_backoff_ms);
+  for (uint32_t attempt = 1;; ++attempt) {
+    // 下游持有的租约释放后缓冲区才能全部收回；未释放时只等待，不算失败
+    bool recovered = false;
+    if (device->GetLeasedBufferCount() == 0) {
+      recovered = (device->RestartStreaming() || device->Reopen()) &&
+                  device->IsStreaming() && device->GetBufferCount() > 0;
+    }
+    if (recovered) {
+      struct epoll_event ev;
+      memset(&ev, 0, sizeof(ev));
+      ev.events = EPOLLIN;
+      ev.data.u32 = kDeviceTag;
+      if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, device->GetFileDescriptor(),
+                    &ev) < 0) {
+        fprintf(stderr, "注册设备 fd 失败: %s\n", strerror(errno));
+        return RecoverResult::kFailed;
+      }
+      recoveries_.fetch_add(1, std::memory_order_relaxed);
+      fprintf(stderr, "设备 %s 已恢复（第 %u 次尝试，耗时 %.1f ms）\n",
+              device->GetDevicePath().c_str(), attempt,
+              (MonotonicMicros() - start_us) / 1000.0);
+      return RecoverResult::kRecovered;
+    }
+
+    if (recovery_.max_attempts > 0 && attempt >= recovery_.max_attempts) {
+      fprintf(stderr, "设备 %s 恢复失败，停止捕获\n",
+              device->GetDevicePath().c_str());
+      return RecoverResult::kFailed;
+    }
+    if (WaitForStop(backoff_ms)) {
+      uint64_t value;
+      ssize_t ret = read(wakeup_fd_, &value, sizeof(value));
+      (void)ret;
+      return RecoverResult::kStopped;
+    }
+    backoff_ms = std::min(backoff_ms * 2,
+                          std::max(backoff_ms, recovery_.max_backoff_ms));
+  }
+}
+
+void CaptureLoop::Stop() {
+  if (wakeup_fd_ < 0) {
+    return;
+  }
+  // write 是异步信号安全的，可在信号处理函数中调用
+  uint64_t value = 1;
+  ssize_t ret = write(wakeup_fd_, &value, sizeof(value));
+  (void)ret;
+}
+
+}  // namespace v4l2_demo
@@ -0,0 +1,83 @@
+#ifndef V4L2_DEMO_SRC_COMMON_CAPTURE_LOOP_H_
+#define V4L2_DEMO_SRC_COMMON_CAPTURE_LOOP_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+
+#include "v4l2_utils.h"
+
+namespace v4l2_demo {
+
+// 设备出错后的自动恢复配置
+// 先快速重启视频流（保留格式与缓冲区映射），失败时重新打开设备节点；
+// 每次失败后等待的时间从 initial_backoff_ms 开始翻倍，不超过 max_backoff_ms
+struct RecoveryOptions {
+  bool enabled = false;
+  int initial_backoff_ms = 20;
+  int max_backoff_ms = 2000;
+  uint32_t max_attempts = 0;  // 单次故障的最大尝试次数，0 表示不限
+};
+
+// 基于 epoll 的事件驱动捕获循环
+// 设备 fd 可读时立即出队帧并回调，没有帧时线程阻塞在 epoll_wait 上；
+// 通过 eventfd 唤醒实现干净退出
+class CaptureLoop {
+ public:
+  // 帧回调，lease 在回调返回后自动释放；
+  // 如需延长持有时间，可在回调中 std::move(*lease) 转移所有权
+  using FrameCallback = std::function<void(FrameLease* lease)>;
+
+  CaptureLoop();
+  ~CaptureLoop();
+
+  CaptureLoop(const CaptureLoop&) = delete;
+  CaptureLoop& operator=(const CaptureLoop&) = delete;
+
+  // 创建 epoll 实例与用于退出的 eventfd
+  // @return 成功返回 true，失败返回 false
+  bool Init();
+
+  // 设置自动恢复（需在 Run 之前调用），默认关闭：设备出错时 Run 返回 false
+  void SetRecoveryOptions(const RecoveryOptions& options) {
+    recovery_ = options;
+  }
+
+  // 运行捕获循环，阻塞直到 Stop() 被调用或设备出错（未开启自动恢复
+  // 或恢复失败）
+  // @param device 已开始流式传输的设备
+  // @param callback 帧回调
+  // @return 因 Stop() 正常退出返回 true，出错返回 false
+  bool Run(V4L2Device* device, const FrameCallback& callback);
+
+  // 请求退出循环，可在其他线程或信号处理函数中调用
+  void Stop();
+
+  // 累计成功恢复的次数（可在任意线程调用）
+  uint64_t GetRecoveryCount() const {
+    return recoveries_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  enum class RecoverResult {
+    kRecovered,  // 已恢复，设备 fd 已重新注册
+    kStopped,    // 恢复期间收到退出请求
+    kFailed,     // 达到最大尝试次数
+  };
+
+  // 恢复出错的设备，期间仍响应 Stop()
+  RecoverResult Recover(V4L2Device* device);
+
+  // 等待退出事件，不消耗事件（由主循环处理）
+  // @return 收到退出请求返回 true，超时返回 false
+  bool WaitForStop(int timeout_ms);
+
+  int epoll_fd_;   // epoll 实例
+  int wakeup_fd_;  // 用于退出的 eventfd
+  RecoveryOptions recovery_;
+  std::atomic<uint64_t> recoveries_;
+};
+
+}  // namespace v4l2_demo
+
+#endif  // V4L2_DEMO_SRC_COMMON_CAPTURE_LOOP_H_
@@ -0,0 +1,395 @@
+#include "device_discovery.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace v4l2_demo {
+
+namespace {
+
+constexpr const char* kCacheHeader = "v4l2_demo_device_cache 3";
+constexpr const char* kDevDirectory = "/dev";
+
+// 缓存文件以制表符分隔字段，字段内的制表符和换行替换为空格
+std::string SanitizeField(const std::string& field) {
+  std::string result = field;
+  for (char& c : result) {
+    if (c == '\t' || c == '\n') {
+      c = ' ';
+    }
+  }
+  return result;
+}
+
+// 读取节点的 sysfs 实体名（/sys/class/video4linux/videoN/name），
+// 同一设备的多个捕获节点（如 rkisp1 的 mainpath/selfpath）靠它区分
+// @return 实体名；读取失败时返回设备路径
+std::string ReadNodeName(const std::string& device_path) {
+  size_t slash = device_path.rfind('/');
+  std::string node =
+      device_path.substr(slash == std::string::npos ? 0 : slash + 1);
+  std::string path = "/sys/class/video4linux/" + node + "/name";
+
+  FILE* file = fopen(path.c_str(), "r");
+  if (!file) {
+    return device_path;
+  }
+  char name[64];
+  bool ok = fgets(name, sizeof(name), file) != nullptr;
+  fclose(file);
+  if (!ok) {
+    return device_path;
+  }
+  name[strcspn(name, "\n")] = '\0';
+  return name;
+}
+
+// 单个格式序列化为 "格式/是否压缩/宽x高@分子:分母,...;宽x高@..."，无空白
+std::string FormatToString(const FormatCapability& cap) {
+  std::string result;
+  char field[64];
+  snprintf(field, sizeof(field), "%08x/%d/", cap.pixel_format,
+           cap.compressed ? 1 : 0);
+  result = field;
+  for (size_t i = 0; i < cap.sizes.size(); ++i) {
+    const FrameSize& size = cap.sizes[i];
+    snprintf(field, sizeof(field), "%s%ux%u@", i == 0 ? "" : ";", size.width,
+             size.height);
+    result += field;
+    for (size_t j = 0; j < size.intervals.size(); ++j) {
+      snprintf(field, sizeof(field), "%s%u:%u", j == 0 ? "" : ",",
+               size.intervals[j].numerator, size.intervals[j].denominator);
+      result += field;
+    }
+  }
+  return result;
+}
+
+// 解析 FormatToString 的输出
+// @return 成功返回 true，格式错误返回 false
+bool ParseFormat(const char* text, FormatCapability* cap) {
+  unsigned int pixel_format;
+  int compressed;
+  int consumed = 0;
+  if (sscanf(text, "%x/%d/%n", &pixel_format, &compressed, &consumed) != 2 ||
+      consumed == 0) {
+    return false;
+  }
+  cap->pixel_format = pixel_format;
+  cap->compressed = compressed != 0;
+  cap->sizes.clear();
+
+  const char* ptr = text + consumed;
+  while (*ptr != '\0') {
+    FrameSize size;
+    if (sscanf(ptr, "%ux%u@%n", &size.width, &size.height, &consumed) != 2) {
+      return false;
+    }
+    ptr += consumed;
+
+    FrameInterval interval;
+    while (sscanf(ptr, "%u:%u%n", &interval.numerator, &interval.denominator,
+                  &consumed) == 2) {
+      size.intervals.push_back(interval);
+      ptr += consumed;
+      if (*ptr == ',') {
+        ptr++;
+      }
+    }
+    cap->sizes.push_back(size);
+
+    if (*ptr == ';') {
+      ptr++;
+    } else if (*ptr != '\0') {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool FormatsEqual(const std::vector<FormatCapability>& a,
+                  const std::vector<FormatCapability>& b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (FormatToString(a[i]) != FormatToString(b[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool VideoNodeLess(const DeviceInfo& a, const DeviceInfo& b) {
+  if (a.device_path.size() != b.device_path.size()) {
+    return a.device_path.size() < b.device_path.size();
+  }
+  return a.device_path < b.device_path;
+}
+
+}  // namespace
+
+DeviceInfoCache::DeviceInfoCache(const std::string& path)
+    : path_(path), dirty_(false) {}
+
+std::string DeviceInfoCache::DefaultPath() {
+  const char* xdg = getenv("XDG_CACHE_HOME");
+  if (xdg && xdg[0] != '\0') {
+    return std::string(xdg) + "/v4l2_demo_devices";
+  }
+  const char* home = getenv("HOME");
+  if (home && home[0] != '\0') {
+    return std::string(home) + "/.cache/v4l2_demo_devices";
+  }
+  return "/tmp/v4l2_demo_devices";
+}
+
+std::string DeviceInfoCache::MakeKey(const DeviceInfo& info) {
+  char version[16];
+  snprintf(version, sizeof(version), "%08x", info.driver_version);
+  return SanitizeField(info.driver_name) + "\t" + version + "\t" +
+         SanitizeField(info.bus_info) + "\t" + SanitizeField(info.card_name) +
+         "\t" + SanitizeField(ReadNodeName(info.device_path));
+}
+
+bool DeviceInfoCache::Load() {
+  FILE* file = fopen(path_.c_str(), "r");
+  if (!file) {
+    return false;
+  }
+
+  std::map<std::string, std::vector<FormatCapability>> entries;
+  char* line = nullptr;
+  size_t line_capacity = 0;
+  bool ok = getline(&line, &line_capacity, file) > 0 &&
+            strncmp(line, kCacheHeader, strlen(kCacheHeader)) == 0;
+
+  // 每行：驱动名 \t 版本 \t 总线信息 \t 设备名 \t 节点名 \t 以空格分隔的格式
+  while (ok && getline(&line, &line_capacity, file) > 0) {
+    line[strcspn(line, "\n")] = '\0';
+    char* formats = strrchr(line, '\t');
+    if (!formats) {
+      continue;
+    }
+    *formats++ = '\0';
+
+    std::vector<FormatCapability> list;
+    char* save_ptr = nullptr;
+    for (char* token = strtok_r(formats, " ", &save_ptr); token;
+         token = strtok_r(nullptr, " ", &save_ptr)) {
+      FormatCapability cap;
+      if (!ParseFormat(token, &cap)) {
+        ok = false;
+        break;
+      }
+      list.push_back(cap);
+    }
+    entries[line] = list;
+  }
+  free(line);
+  fclose(file);
+
+  if (!ok) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.swap(entries);
+  dirty_ = false;
+  return true;
+}
+
+bool DeviceInfoCache::Save() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!dirty_) {
+    return true;
+  }
+
+  std::string temp_path = path_ + ".tmp";
+  FILE* file = fopen(temp_path.c_str(), "w");
+  if (!file) {
+    fprintf(stderr, "写入设备缓存 %s 失败: %s\n", temp_path.c_str(),
+            strerror(errno));
+    return false;
+  }
+
+  fprintf(file, "%s\n", kCacheHeader);
+  for (const auto& entry : entries_) {
+    fprintf(file, "%s\t", entry.first.c_str());
+    for (size_t i = 0; i < entry.second.size(); ++i) {
+      fprintf(file, "%s%s", i == 0 ? "" : " ",
+              FormatToString(entry.second[i]).c_str());
+    }
+    fprintf(file, "\n");
+  }
+
+  bool ok = fflush(file) == 0;
+  ok = (fclose(file) == 0) && ok;
+  if (!ok || rename(temp_path.c_str(), path_.c_str()) < 0) {
+    fprintf(stderr, "写入设备缓存 %s 失败: %s\n", path_.c_str(),
+            strerror(errno));
+    unlink(temp_path.c_str());
+    return false;
+  }
+
+  dirty_ = false;
+  return true;
+}
+
+bool DeviceInfoCache::Lookup(DeviceInfo* info) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(MakeKey(*info));
+  if (it == entries_.end()) {
+    return false;
+  }
+  info->format_caps = it->second;
+  info->formats.clear();
+  for (const auto& cap : it->second) {
+    info->formats.push_back(cap.pixel_format);
+  }
+  return true;
+}
+
+void DeviceInfoCache::Insert(const DeviceInfo& info) {
+  std::string key = MakeKey(info);
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  if (it != entries_.end() &&
+      FormatsEqual(it->second, info.format_caps)) {
+    return;
+  }
+  entries_[key] = info.format_caps;
+  dirty_ = true;
+}
+
+size_t DeviceInfoCache::Size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+DeviceWatcher::DeviceWatcher() : inotify_fd_(-1), cache_(nullptr) {}
+
+DeviceWatcher::~DeviceWatcher() {
+  if (inotify_fd_ >= 0) {
+    close(inotify_fd_);
+  }
+}
+
+bool DeviceWatcher::Init(DeviceInfoCache* cache) {
+  if (inotify_fd_ >= 0) {
+    return false;
+  }
+
+  inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd_ < 0) {
+    fprintf(stderr, "创建 inotify 失败: %s\n", strerror(errno));
+    return false;
+  }
+
+  // 先开始监视再扫描，扫描期间插入的设备不会被遗漏
+  uint32_t mask = IN_CREATE | IN_DELETE | IN_ATTRIB | IN_MOVED_TO |
+                  IN_MOVED_FROM;
+  if (inotify_add_watch(inotify_fd_, kDevDirectory, mask) < 0) {
+    fprintf(stderr, "监视 %s 失败: %s\n", kDevDirectory, strerror(errno));
+    close(inotify_fd_);
+    inotify_fd_ = -1;
+    return false;
+  }
+
+  cache_ = cache;
+  std::vector<DeviceInfo> devices;
+  FindVideoDevices(&devices, cache_);
+  devices_.clear();
+  for (auto& info : devices) {
+    devices_[info.device_path] = std::move(info);
+  }
+  return true;
+}
+
+int DeviceWatcher::ProcessEvents(const EventCallback& callback) {
+  if (inotify_fd_ < 0) {
+    return -1;
+  }
+
+  int event_count = 0;
+  alignas(struct inotify_event) char buffer[4096];
+  while (true) {
+    ssize_t len = read(inotify_fd_, buffer, sizeof(buffer));
+    if (len < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN) {
+        break;
+      }
+      fprintf(stderr, "读取 inotify 事件失败: %s\n", strerror(errno));
+      return -1;
+    }
+
+    for (char* ptr = buffer; ptr < buffer + len;) {
+      const struct inotify_event* ev =
+          reinterpret_cast<const struct inotify_event*>(ptr);
+      ptr += sizeof(struct inotify_event) + ev->len;
+
+      if (ev->len == 0 || strncmp(ev->name, "video", 5) != 0) {
+        continue;
+      }
+
+      DeviceEvent event;
+      std::string device_path = std::string(kDevDirectory) + "/" + ev->name;
+      if (HandleNode(device_path, ev->mask, &event)) {
+        event_count++;
+        if (callback) {
+          callback(event);
+        }
+      }
+    }
+  }
+  return event_count;
+}
+
+bool DeviceWatcher::HandleNode(const std::string& device_path, uint32_t mask,
+                               DeviceEvent* event) {
+  auto it = devices_.find(device_path);
+
+  if (mask & (IN_DELETE | IN_MOVED_FROM)) {
+    if (it == devices_.end()) {
+      return false;
+    }
+    event->type = DeviceEventType::kRemoved;
+    event->info = std::move(it->second);
+    devices_.erase(it);
+    return true;
+  }
+
+  // IN_CREATE / IN_MOVED_TO / IN_ATTRIB：已知节点或暂无权限时忽略，
+  // udev 设置好权限后会再收到 IN_ATTRIB
+  if (it != devices_.end() ||
+      access(device_path.c_str(), R_OK | W_OK) < 0) {
+    return false;
+  }
+
+  DeviceInfo info;
+  if (!ProbeVideoDevice(device_path, cache_, &info)) {
+    return false;
+  }
+  event->type = DeviceEventType::kAdded;
+  event->info = info;
+  devices_[device_path] = std::move(info);
+  return true;
+}
+
+void DeviceWatcher::GetDevices(std::vector<DeviceInfo>* devices) const {
+  devices->clear();
+  for (const auto& entry : devices_) {
+    devices->push_back(entry.second);
+  }
+  std::sort(devices->begin(), devices->end(), VideoNodeLess);
+}
+
+}  // namespace v4l2_demo
@@ -0,0 +1,118 @@
+#ifndef V4L2_DEMO_SRC_COMMON_DEVICE_DISCOVERY_H_
+#define V4L2_DEMO_SRC_COMMON_DEVICE_DISCOVERY_H_
+
+#include <stdint.h>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "v4l2_utils.h"
+
+namespace v4l2_demo {
+
+// 设备信息磁盘缓存
+// 以 驱动名 + 驱动版本 + 总线信息 + 设备名 + 节点实体名为键缓存格式、
+// 分辨率与帧间隔（同一设备的多个捕获节点格式不同，须按节点区分），
+// 重启后命中缓存的节点只需 QUERYCAP，跳过完整的 VIDIOC_ENUM_FMT/
+// ENUM_FRAMESIZES/ENUM_FRAMEINTERVALS；
+// 驱动升级或设备换口后键变化，自动重新枚举
+// Lookup/Insert 线程安全，可在 FindVideoDevices 的并行探测中使用
+class DeviceInfoCache {
+ public:
+  // @param path 缓存文件路径
+  explicit DeviceInfoCache(const std::string& path);
+
+  DeviceInfoCache(const DeviceInfoCache&) = delete;
+  DeviceInfoCache& operator=(const DeviceInfoCache&) = delete;
+
+  // 默认缓存路径：$XDG_CACHE_HOME 或 $HOME/.cache 下的 v4l2_demo_devices
+  static std::string DefaultPath();
+
+  // 从文件加载缓存
+  // @return 成功返回 true；文件不存在或格式不符时返回 false（缓存为空）
+  bool Load();
+
+  // 将缓存写回文件（先写临时文件再 rename，未修改时直接返回）
+  // @return 成功返回 true，失败返回 false
+  bool Save();
+
+  // 查找缓存
+  // @param info 输入 QUERYCAP 得到的信息，命中时填充 formats 与 format_caps
+  // @return 命中返回 true，否则返回 false
+  bool Lookup(DeviceInfo* info) const;
+
+  // 插入或更新一条缓存
+  void Insert(const DeviceInfo& info);
+
+  // 获取缓存条目数
+  size_t Size() const;
+
+ private:
+  static std::string MakeKey(const DeviceInfo& info);
+
+  std::string path_;
+  mutable std::mutex mutex_;
+  std::map<std::string, std::vector<FormatCapability>> entries_;  // 键 -> 格式能力
+  bool dirty_;  // 是否有未写回的修改
+};
+
+// 设备热插拔事件类型
+enum class DeviceEventType {
+  kAdded,    // 新的捕获节点可用
+  kRemoved,  // 节点已移除
+};
+
+// 设备热插拔事件
+struct DeviceEvent {
+  DeviceEventType type;
+  DeviceInfo info;  // kRemoved 时为移除前的信息
+};
+
+// 视频设备热插拔监视器
+// 通过 inotify 监视 /dev 下 video* 节点的创建、删除和权限变化（udev
+// 创建节点后才设置权限），增量维护设备列表而不是重新扫描全部节点
+// 非线程安全：ProcessEvents 与 GetDevices 需在同一线程调用
+class DeviceWatcher {
+ public:
+  // 事件回调，在 ProcessEvents 中同步执行
+  using EventCallback = std::function<void(const DeviceEvent& event)>;
+
+  DeviceWatcher();
+  ~DeviceWatcher();
+
+  DeviceWatcher(const DeviceWatcher&) = delete;
+  DeviceWatcher& operator=(const DeviceWatcher&) = delete;
+
+  // 开始监视并执行一次初始扫描
+  // @param cache 设备信息缓存，可为 nullptr，须比监视器活得更久
+  // @return 成功返回 true，失败返回 false
+  bool Init(DeviceInfoCache* cache = nullptr);
+
+  // 获取 inotify 文件描述符（可读时调用 ProcessEvents，用于 poll/epoll）
+  int GetFileDescriptor() const { return inotify_fd_; }
+
+  // 处理已到达的 inotify 事件（非阻塞）
+  // @param callback 事件回调，可为空
+  // @return 产生的设备事件数，失败返回 -1
+  int ProcessEvents(const EventCallback& callback);
+
+  // 获取当前设备列表（按节点编号排序）
+  // @param devices 输出参数，设备列表
+  void GetDevices(std::vector<DeviceInfo>* devices) const;
+
+ private:
+  int inotify_fd_;
+  DeviceInfoCache* cache_;
+  std::map<std::string, DeviceInfo> devices_;  // 设备路径 -> 设备信息
+
+  // 处理单个节点的变化
+  // @return 产生设备事件返回 true
+  bool HandleNode(const std::string& device_path, uint32_t mask,
+                  DeviceEvent* event);
+};
+
+}  // namespace v4l2_demo
+
+#endif  // V4L2_DEMO_SRC_COMMON_DEVICE_DISCOVERY_H_
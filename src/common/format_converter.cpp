@@ -0,0 +1,470 @@
+#include "format_converter.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "format_converter_kernels.h"
+#include "pixel_format_traits.h"
+#include "v4l2_utils.h"
+
+namespace v4l2_demo {
+
+namespace {
+const internal::ConverterKernels* GetKernels(ConverterIsa isa) {
+  switch (isa) {
+    case ConverterIsa::kAvx2:
+      return internal::GetAvx2Kernels();
+    case ConverterIsa::kSse41:
+      return internal::GetSse41Kernels();
+    case ConverterIsa::kNeon:
+      return internal::GetNeonKernels();
+    default:
+      return internal::GetScalarKernels();
+  }
+}
+
+bool IsIsaAvailable(ConverterIsa isa) {
+  switch (isa) {
+    case ConverterIsa::kScalar:
+      return true;
+#if defined(__x86_64__) || defined(__i386__)
+    case ConverterIsa::kAvx2:
+      return __builtin_cpu_supports("avx2");
+    case ConverterIsa::kSse41:
+      return __builtin_cpu_supports("sse4.1");
+#endif
+    case ConverterIsa::kNeon:
+      return internal::GetNeonKernels() != nullptr;
+    default:
+      return false;
+  }
+}
+
+// 区域平均时 16 位累加器最多容纳的行数（255 * 257 = 65535）
+constexpr uint32_t kMaxBoxRows = 257;
+
+// 双线性采样点：两个源位置与第二个位置的 8 位定点权重
+struct ScaleTap {
+  uint32_t index0;
+  uint32_t index1;
+  uint32_t weight;
+};
+
+// 一个分量的水平双线性采样，d 指向该分量的第一个目标样本
+using ResampleFn = void (*)(const uint8_t* line, const ScaleTap* taps,
+                            uint32_t count, uint8_t* d);
+
+// 一个分量的水平区域平均，a 指向该分量的第一个累加值
+using BoxFn = void (*)(const uint16_t* a, uint32_t columns, uint32_t area,
+                       uint32_t count, uint8_t* d);
+
+// 步长为编译期常量，内层循环可完全展开
+template <uint32_t kStep>
+void ResampleComponent(const uint8_t* line, const ScaleTap* taps,
+                       uint32_t count, uint8_t* d) {
+  for (uint32_t i = 0; i < count; ++i) {
+    const ScaleTap& tap = taps[i];
+    d[i * kStep] = static_cast<uint8_t>(
+        (line[tap.index0] * (256 - tap.weight) +
+         line[tap.index1] * tap.weight + 128) >>
+        8);
+  }
+}
+
+template <uint32_t kStep>
+void BoxComponent(const uint16_t* a, uint32_t columns, uint32_t area,
+                  uint32_t count, uint8_t* d) {
+  for (uint32_t i = 0; i < count; ++i) {
+    const uint16_t* p = a + i * columns * kStep;
+    uint32_t sum = 0;
+    for (uint32_t k = 0; k < columns; ++k) {
+      sum += p[k * kStep];
+    }
+    d[i * kStep] = static_cast<uint8_t>((sum + area / 2) / area);
+  }
+}
+
+// 平面中交错排列的一个分量：第 k 个样本位于行内 offset + k * step
+struct ScaleComponent {
+  uint32_t offset;
+  uint32_t step;
+  uint32_t src_count;
+  uint32_t dst_count;
+  ResampleFn resample;
+  BoxFn box;
+};
+
+template <uint32_t kStep>
+ScaleComponent MakeComponent(uint32_t offset, uint32_t src_count,
+                             uint32_t dst_count) {
+  return {offset, kStep, src_count, dst_count, ResampleComponent<kStep>,
+          BoxComponent<kStep>};
+}
+
+// 一个待缩放的平面（源与目标的分量布局相同）
+struct ScalePlane {
+  const uint8_t* src;
+  size_t src_stride;
+  uint32_t src_rows;
+  uint8_t* dst;
+  size_t dst_stride;
+  uint32_t dst_rows;
+  int row_bytes;  // 源行的有效字节数
+  ScaleComponent components[3];
+  int component_count;
+};
+
+// 按格式描述拆分待缩放的平面，分量偏移与步长都来自 PixelFormatTraits
+// @return 平面数
+template <typename Format>
+int BuildScalePlanes(const uint8_t* src, uint32_t src_stride,
+                     uint32_t src_width, uint32_t src_height, uint8_t* dst,
+                     uint32_t dst_width, uint32_t dst_height,
+                     ScalePlane* planes) {
+  constexpr uint32_t kShiftX = Format::kChromaShiftX;
+  constexpr uint32_t kShiftY = Format::kChromaShiftY;
+  const uint32_t src_chroma = src_width >> kShiftX;
+  const uint32_t dst_chroma = dst_width >> kShiftX;
+  const int row_bytes = static_cast<int>(src_width * Format::kBytesPerPixel);
+
+  ScalePlane& luma = planes[0];
+  luma = {src, src_stride, src_height, dst, dst_width * Format::kBytesPerPixel,
+          dst_height, row_bytes, {}, 1};
+  luma.components[0] =
+      MakeComponent<Format::kYStep>(Format::kYOffset, src_width, dst_width);
+  if constexpr (Format::kLayout == PlaneLayout::kSemiPlanar) {
+    planes[1] = {src + static_cast<size_t>(src_stride) * src_height,
+                 src_stride, src_height >> kShiftY,
+                 dst + static_cast<size_t>(dst_width) * dst_height, dst_width,
+                 dst_height >> kShiftY, row_bytes, {}, 2};
+    planes[1].components[0] = MakeComponent<Format::kChromaStep>(
+        Format::kUOffset, src_chroma, dst_chroma);
+    planes[1].components[1] = MakeComponent<Format::kChromaStep>(
+        Format::kVOffset, src_chroma, dst_chroma);
+    return 2;
+  } else {
+    if constexpr (kShiftX != 0) {
+      luma.components[1] = MakeComponent<Format::kChromaStep>(
+          Format::kUOffset, src_chroma, dst_chroma);
+      luma.components[2] = MakeComponent<Format::kChromaStep>(
+          Format::kVOffset, src_chroma, dst_chroma);
+      luma.component_count = 3;
+    }
+    return 1;
+  }
+}
+
+using BuildScalePlanesFn = int (*)(const uint8_t* src, uint32_t src_stride,
+                                   uint32_t src_width, uint32_t src_height,
+                                   uint8_t* dst, uint32_t dst_width,
+                                   uint32_t dst_height, ScalePlane* planes);
+
+// 缩放的分派表，以 VIDIOC_G_FMT 返回的 pixelformat 为键
+struct ScaleFormat {
+  uint32_t fourcc;
+  BuildScalePlanesFn build_planes;
+};
+
+template <uint32_t kFourcc>
+constexpr ScaleFormat MakeScaleFormat() {
+  return {kFourcc, BuildScalePlanes<PixelFormatTraits<kFourcc>>};
+}
+
+constexpr ScaleFormat kScaleFormats[] = {
+    MakeScaleFormat<V4L2_PIX_FMT_YUYV>(),
+    MakeScaleFormat<V4L2_PIX_FMT_UYVY>(),
+    MakeScaleFormat<V4L2_PIX_FMT_NV12>(),
+    MakeScaleFormat<V4L2_PIX_FMT_YVYU>(),
+    MakeScaleFormat<V4L2_PIX_FMT_VYUY>(),
+    MakeScaleFormat<V4L2_PIX_FMT_NV21>(),
+    MakeScaleFormat<V4L2_PIX_FMT_NV16>(),
+    MakeScaleFormat<V4L2_PIX_FMT_GREY>(),
+};
+
+const ScaleFormat* FindScaleFormat(uint32_t pixel_format) {
+  for (const ScaleFormat& format : kScaleFormats) {
+    if (format.fourcc == pixel_format) {
+      return &format;
+    }
+  }
+  return nullptr;
+}
+
+// 每个线程复用的临时缓冲区，转换器本身保持无状态
+struct ScaleScratch {
+  std::vector<uint8_t> row;
+  std::vector<uint16_t> acc;
+  std::vector<ScaleTap> row_taps;
+  std::vector<ScaleTap> taps[3];
+};
+
+ScaleScratch* GetScaleScratch() {
+  thread_local ScaleScratch scratch;
+  return &scratch;
+}
+
+// 像素中心对齐：目标第 i 个样本对应源位置 (i + 0.5) * src / dst - 0.5，
+// 以 8 位定点表示，超出边界的部分取首尾样本
+void ComputeTaps(uint32_t src_count, uint32_t dst_count, uint32_t offset,
+                 uint32_t step, std::vector<ScaleTap>* taps) {
+  taps->resize(dst_count);
+  for (uint32_t i = 0; i < dst_count; ++i) {
+    int64_t pos = static_cast<int64_t>((2 * i + 1) *
+                                       static_cast<uint64_t>(src_count) *
+                                       128 / dst_count) -
+                  128;
+    if (pos < 0) {
+      pos = 0;
+    }
+    uint32_t index = static_cast<uint32_t>(pos >> 8);
+    uint32_t weight = static_cast<uint32_t>(pos & 255);
+    if (index >= src_count - 1) {
+      index = src_count - 1;
+      weight = 0;
+    }
+    uint32_t next = weight != 0 ? index + 1 : index;
+    (*taps)[i] = {offset + index * step, offset + next * step, weight};
+  }
+}
+
+void ScalePlaneBilinear(const ScalePlane& plane,
+                        const internal::ConverterKernels* kernels,
+                        ScaleScratch* scratch) {
+  ComputeTaps(plane.src_rows, plane.dst_rows, 0, 1, &scratch->row_taps);
+  for (int c = 0; c < plane.component_count; ++c) {
+    const ScaleComponent& component = plane.components[c];
+    ComputeTaps(component.src_count, component.dst_count, component.offset,
+                component.step, &scratch->taps[c]);
+  }
+  scratch->row.resize(plane.row_bytes);
+
+  for (uint32_t y = 0; y < plane.dst_rows; ++y) {
+    // 垂直：落在源行上时直接引用，否则混合相邻两行
+    const ScaleTap& row_tap = scratch->row_taps[y];
+    const uint8_t* line = plane.src + row_tap.index0 * plane.src_stride;
+    if (row_tap.weight != 0) {
+      kernels->blend_rows(line, plane.src + row_tap.index1 * plane.src_stride,
+                          scratch->row.data(), plane.row_bytes,
+                          static_cast<int>(row_tap.weight));
+      line = scratch->row.data();
+    }
+
+    uint8_t* out = plane.dst + y * plane.dst_stride;
+    for (int c = 0; c < plane.component_count; ++c) {
+      const ScaleComponent& component = plane.components[c];
+      component.resample(line, scratch->taps[c].data(), component.dst_count,
+                         out + component.offset);
+    }
+  }
+}
+
+void ScalePlaneBox(const ScalePlane& plane,
+                   const internal::ConverterKernels* kernels,
+                   ScaleScratch* scratch) {
+  const uint32_t rows = plane.src_rows / plane.dst_rows;
+  scratch->acc.resize(plane.row_bytes);
+  uint16_t* acc = scratch->acc.data();
+
+  for (uint32_t y = 0; y < plane.dst_rows; ++y) {
+    std::fill(scratch->acc.begin(), scratch->acc.end(), 0);
+    const uint8_t* line = plane.src + y * rows * plane.src_stride;
+    for (uint32_t r = 0; r < rows; ++r) {
+      kernels->accumulate_row(line, acc, plane.row_bytes);
+      line += plane.src_stride;
+    }
+
+    uint8_t* out = plane.dst + y * plane.dst_stride;
+    for (int c = 0; c < plane.component_count; ++c) {
+      const ScaleComponent& component = plane.components[c];
+      const uint32_t columns = component.src_count / component.dst_count;
+      component.box(acc + component.offset, columns, rows * columns,
+                    component.dst_count, out + component.offset);
+    }
+  }
+}
+}  // namespace
+
+FormatConverter::FormatConverter(ConverterIsa isa) {
+  if (isa == ConverterIsa::kAuto || !IsIsaAvailable(isa) ||
+      GetKernels(isa) == nullptr) {
+    isa = DetectBestIsa();
+  }
+  isa_ = isa;
+  kernels_ = GetKernels(isa);
+}
+
+ConverterIsa FormatConverter::DetectBestIsa() {
+  const ConverterIsa candidates[] = {ConverterIsa::kAvx2, ConverterIsa::kSse41,
+                                     ConverterIsa::kNeon};
+  for (ConverterIsa isa : candidates) {
+    if (GetKernels(isa) != nullptr && IsIsaAvailable(isa)) {
+      return isa;
+    }
+  }
+  return ConverterIsa::kScalar;
+}
+
+const char* FormatConverter::GetIsaName() const {
+  return kernels_->name;
+}
+
+bool FormatConverter::IsSupported(uint32_t src_format, uint32_t dst_format) {
+  return internal::SelectPackedKernels(internal::GetScalarKernels(),
+                                       src_format) != nullptr &&
+         GetFrameSize(dst_format, 2, 2) > 0;
+}
+
+size_t FormatConverter::GetFrameSize(uint32_t pixel_format, uint32_t width,
+                                     uint32_t height) {
+  switch (pixel_format) {
+    case V4L2_PIX_FMT_YUYV:
+    case V4L2_PIX_FMT_UYVY:
+    case V4L2_PIX_FMT_NV12:
+    case V4L2_PIX_FMT_YUV420:
+    case V4L2_PIX_FMT_RGB24:
+    case V4L2_PIX_FMT_ABGR32:
+      return GetRawFrameSize(pixel_format, width, height);
+    default:
+      return 0;
+  }
+}
+
+bool FormatConverter::Convert(const void* src, size_t src_size,
+                              uint32_t src_format, uint32_t width,
+                              uint32_t height, uint32_t dst_format, void* dst,
+                              size_t dst_size) const {
+  if (!src || !dst || width == 0 || height == 0 || (width & 1) != 0) {
+    return false;
+  }
+  if (!IsSupported(src_format, dst_format)) {
+    fprintf(stderr, "不支持的转换: %s -> %s\n",
+            PixelFormatToString(src_format).c_str(),
+            PixelFormatToString(dst_format).c_str());
+    return false;
+  }
+  if (src_size < GetFrameSize(src_format, width, height) ||
+      dst_size < GetFrameSize(dst_format, width, height)) {
+    return false;
+  }
+
+  ConvertRows(static_cast<const uint8_t*>(src), src_format, width, height,
+              dst_format, static_cast<uint8_t*>(dst), 0, height);
+  return true;
+}
+
+bool FormatConverter::IsScaleSupported(uint32_t pixel_format) {
+  return FindScaleFormat(pixel_format) != nullptr;
+}
+
+bool FormatConverter::Scale(const void* src, size_t src_size,
+                            uint32_t pixel_format, uint32_t src_width,
+                            uint32_t src_height, uint32_t src_stride,
+                            uint32_t dst_width, uint32_t dst_height,
+                            ScaleFilter filter, void* dst,
+                            size_t dst_size) const {
+  const ScaleFormat* format = FindScaleFormat(pixel_format);
+  if (!src || !dst || !format || src_width == 0 || src_height == 0 ||
+      dst_width == 0 || dst_height == 0 ||
+      ((src_width | dst_width) & 1) != 0) {
+    return false;
+  }
+  const PixelFormatInfo* info = FindPixelFormatInfo(pixel_format);
+  const bool semi_planar = (info->layout == PlaneLayout::kSemiPlanar);
+  if (info->chroma_shift_y != 0 && ((src_height | dst_height) & 1) != 0) {
+    return false;
+  }
+  const uint32_t row_bytes = src_width * info->bytes_per_pixel;
+  if (src_stride == 0) {
+    src_stride = row_bytes;
+  }
+  const uint32_t src_rows =
+      semi_planar ? src_height + (src_height >> info->chroma_shift_y)
+                  : src_height;
+  if (src_stride < row_bytes ||
+      src_size < static_cast<size_t>(src_stride) * (src_rows - 1) + row_bytes ||
+      dst_size < info->frame_size(dst_width, dst_height)) {
+    return false;
+  }
+  if (filter == ScaleFilter::kBox &&
+      (src_width % dst_width != 0 || src_height % dst_height != 0 ||
+       src_height / dst_height > kMaxBoxRows)) {
+    return false;
+  }
+
+  ScalePlane planes[2];
+  const int plane_count = format->build_planes(
+      static_cast<const uint8_t*>(src), src_stride, src_width, src_height,
+      static_cast<uint8_t*>(dst), dst_width, dst_height, planes);
+
+  ScaleScratch* scratch = GetScaleScratch();
+  for (int i = 0; i < plane_count; ++i) {
+    if (filter == ScaleFilter::kBox) {
+      ScalePlaneBox(planes[i], kernels_, scratch);
+    } else {
+      ScalePlaneBilinear(planes[i], kernels_, scratch);
+    }
+  }
+  return true;
+}
+
+void FormatConverter::ConvertRows(const uint8_t* src, uint32_t src_format,
+                                  uint32_t width, uint32_t height,
+                                  uint32_t dst_format, uint8_t* dst,
+                                  uint32_t row_begin, uint32_t row_end) const {
+  // 按源格式选择一次行内核，逐行调用时不再判断格式
+  const internal::PackedRowKernels* rows =
+      internal::SelectPackedKernels(kernels_, src_format);
+  if (!rows) {
+    return;
+  }
+  const size_t src_stride = static_cast<size_t>(width) * 2;
+  const int w = static_cast<int>(width);
+
+  switch (dst_format) {
+    case V4L2_PIX_FMT_RGB24:
+    case V4L2_PIX_FMT_ABGR32: {
+      const bool bgra = (dst_format == V4L2_PIX_FMT_ABGR32);
+      const size_t dst_stride = static_cast<size_t>(width) * (bgra ? 4 : 3);
+      internal::PackedToRgbRowFn fn =
+          bgra ? rows->to_bgra : rows->to_rgb24;
+      for (uint32_t y = row_begin; y < row_end; ++y) {
+        fn(src + y * src_stride, dst + y * dst_stride, w);
+      }
+      break;
+    }
+    case V4L2_PIX_FMT_NV12:
+    case V4L2_PIX_FMT_YUV420: {
+      const size_t luma_size = static_cast<size_t>(width) * height;
+      const size_t chroma_width = width / 2;
+      const size_t chroma_size = chroma_width * ((height + 1) / 2);
+      uint8_t* dst_y = dst;
+      uint8_t* dst_u = dst + luma_size;
+      uint8_t* dst_v = dst_u + chroma_size;
+
+      for (uint32_t y = row_begin; y < row_end; y += 2) {
+        // 奇数高度的最后一行与自身配对
+        uint32_t y1 = (y + 1 < height) ? y + 1 : y;
+        const uint8_t* src0 = src + y * src_stride;
+        const uint8_t* src1 = src + y1 * src_stride;
+        uint8_t* out_y0 = dst_y + static_cast<size_t>(y) * width;
+        uint8_t* out_y1 = dst_y + static_cast<size_t>(y1) * width;
+        size_t chroma_row = y / 2;
+        if (dst_format == V4L2_PIX_FMT_NV12) {
+          rows->to_nv12(src0, src1, out_y0, out_y1,
+                        dst_u + chroma_row * width, w);
+        } else {
+          rows->to_i420(src0, src1, out_y0, out_y1,
+                        dst_u + chroma_row * chroma_width,
+                        dst_v + chroma_row * chroma_width, w);
+        }
+      }
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+}  // namespace v4l2_demo
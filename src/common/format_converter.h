@@ -0,0 +1,110 @@
+#ifndef V4L2_DEMO_SRC_COMMON_FORMAT_CONVERTER_H_
+#define V4L2_DEMO_SRC_COMMON_FORMAT_CONVERTER_H_
+
+#include <linux/videodev2.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace v4l2_demo {
+
+namespace internal {
+struct ConverterKernels;
+}  // namespace internal
+
+// 转换内核使用的指令集
+enum class ConverterIsa {
+  kAuto,    // 运行时检测 CPU，选择最快的可用实现
+  kScalar,  // 标量实现，用于校验
+  kSse41,
+  kAvx2,
+  kNeon,
+};
+
+// 缩放滤波器
+enum class ScaleFilter {
+  kBox,       // 区域平均，只支持整数倍缩小，缩小时锯齿最少
+  kBilinear,  // 双线性（像素中心对齐），任意比例
+};
+
+// 像素格式转换器
+// 源格式：V4L2_PIX_FMT_YUYV、V4L2_PIX_FMT_UYVY
+// 目标格式：V4L2_PIX_FMT_NV12、V4L2_PIX_FMT_YUV420（I420）、
+//          V4L2_PIX_FMT_RGB24、V4L2_PIX_FMT_ABGR32（内存顺序 B,G,R,A）
+// 另提供同格式缩放：YUYV、UYVY、YVYU、VYUY、GREY、NV12、NV21、NV16
+// 内核按 PixelFormatTraits 逐格式实例化，每帧查表选择一次
+// 转换器无内部状态，可在多个线程中同时使用
+class FormatConverter {
+ public:
+  // @param isa 指定指令集；当前 CPU 不支持时退回可用的最快实现
+  explicit FormatConverter(ConverterIsa isa = ConverterIsa::kAuto);
+
+  // 检查是否支持该格式组合
+  static bool IsSupported(uint32_t src_format, uint32_t dst_format);
+
+  // 计算转换支持的格式一帧所需的字节数（紧密排列，无行填充）
+  // 其他未压缩格式（如缩放的输出）使用 GetRawFrameSize
+  // @return 不支持的格式返回 0
+  static size_t GetFrameSize(uint32_t pixel_format, uint32_t width,
+                             uint32_t height);
+
+  // 转换一整帧
+  // @param src 源帧数据，行间距为 width * 2
+  // @param src_size 源帧数据大小
+  // @param src_format 源像素格式
+  // @param width 宽度（必须为偶数）
+  // @param height 高度
+  // @param dst_format 目标像素格式
+  // @param dst 目标缓冲区，大小至少为 GetFrameSize(dst_format, ...)
+  // @param dst_size 目标缓冲区大小
+  // @return 成功返回 true，格式不支持或缓冲区不足返回 false
+  bool Convert(const void* src, size_t src_size, uint32_t src_format,
+               uint32_t width, uint32_t height, uint32_t dst_format,
+               void* dst, size_t dst_size) const;
+
+  // 只转换 [row_begin, row_end) 行，供按行带并行转换使用
+  // 参数校验由调用者负责；4:2:0 输出时 row_begin 必须为偶数
+  void ConvertRows(const uint8_t* src, uint32_t src_format, uint32_t width,
+                   uint32_t height, uint32_t dst_format, uint8_t* dst,
+                   uint32_t row_begin, uint32_t row_end) const;
+
+  // 检查是否支持缩放该格式
+  static bool IsScaleSupported(uint32_t pixel_format);
+
+  // 缩放一整帧，输出与源格式相同且紧密排列
+  // 垂直方向由 SIMD 内核整行混合（或累加），水平方向逐分量采样，
+  // 色度按其自身分辨率独立缩放
+  // @param src 源帧数据（NV12 等的 UV 平面紧接在 src_stride * src_height 之后）
+  // @param src_size 源帧数据大小
+  // @param pixel_format 像素格式，见 IsScaleSupported
+  // @param src_width 源宽度（必须为偶数）
+  // @param src_height 源高度（NV12/NV21 必须为偶数）
+  // @param src_stride 源行跨度（字节），0 表示紧密排列
+  // @param dst_width 目标宽度（必须为偶数）
+  // @param dst_height 目标高度（NV12/NV21 必须为偶数）
+  // @param filter 滤波器，kBox 要求源宽高是目标宽高的整数倍
+  // @param dst 目标缓冲区，大小至少为 GetRawFrameSize(pixel_format, ...)
+  //            （pixel_format_traits.h）
+  // @param dst_size 目标缓冲区大小
+  // @return 成功返回 true，格式或尺寸不支持、缓冲区不足返回 false
+  bool Scale(const void* src, size_t src_size, uint32_t pixel_format,
+             uint32_t src_width, uint32_t src_height, uint32_t src_stride,
+             uint32_t dst_width, uint32_t dst_height, ScaleFilter filter,
+             void* dst, size_t dst_size) const;
+
+  // 获取实际使用的指令集
+  ConverterIsa GetIsa() const { return isa_; }
+
+  // 指令集名称，如 "avx2"
+  const char* GetIsaName() const;
+
+  // 检测当前 CPU 支持的最快指令集
+  static ConverterIsa DetectBestIsa();
+
+ private:
+  ConverterIsa isa_;
+  const internal::ConverterKernels* kernels_;
+};
+
+}  // namespace v4l2_demo
+
+#endif  // V4L2_DEMO_SRC_COMMON_FORMAT_CONVERTER_H_
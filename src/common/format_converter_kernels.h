@@ -0,0 +1,123 @@
+#ifndef V4L2_DEMO_SRC_COMMON_FORMAT_CONVERTER_KERNELS_H_
+#define V4L2_DEMO_SRC_COMMON_FORMAT_CONVERTER_KERNELS_H_
+
+// 格式转换行内核（内部头文件，仅供 format_converter*.cpp 使用）
+//
+// 所有内核处理打包 4:2:2 格式的整行数据，width 为偶数。颜色内核以
+// PixelFormatTraits 为模板参数按源格式（YUYV、UYVY）各实例化一份，
+// 分量位置在编译期确定；每帧按源格式选择一组函数指针，内层循环不再分支。
+// RGB 转换使用 BT.601 有限范围、16 位饱和运算。亮度增益 1.164 取 16 位
+// 定点（同 libyuv），Y 扩展为 Y * 257 后取乘积的高 16 位，保证 16 -> 0、
+// 235 -> 255；色度为 6 位定点系数：
+//   y1 = ((Y * 257 * kYuvYGain) >> 16) + kYuvYBias
+//   R  = (y1 + 102 * (V - 128)) >> 6
+//   G  = (y1 - 25 * (U - 128) - 52 * (V - 128)) >> 6
+//   B  = (y1 + 129 * (U - 128)) >> 6
+// 标量与 SIMD 内核逐位一致，标量版本可用于校验
+// 4:2:0 输出的色度取上下两行的四舍五入平均 (a + b + 1) >> 1
+//
+// 缩放内核只做垂直方向的逐字节运算，与像素格式无关：
+//   双线性  dst = (row0 * (256 - w) + row1 * w + 128) >> 8，w 为 8 位定点权重
+//   区域平均 acc += row，16 位累加（调用者保证不溢出）
+
+#include <stdint.h>
+
+#include "pixel_format_traits.h"
+
+namespace v4l2_demo {
+namespace internal {
+
+// 亮度增益 1.164 * 64 * 65536 / 257
+constexpr int kYuvYGain = 18997;
+// 亮度偏移 -16 * 1.164 * 64，含右移 6 位的舍入项 32
+constexpr int kYuvYBias = -1160;
+
+// 两行打包数据 -> I420 的两行 Y 与一行 U、V
+using PackedToI420RowFn = void (*)(const uint8_t* src0, const uint8_t* src1,
+                                   uint8_t* dst_y0, uint8_t* dst_y1,
+                                   uint8_t* dst_u, uint8_t* dst_v, int width);
+
+// 两行打包数据 -> NV12 的两行 Y 与一行交错 UV
+using PackedToNV12RowFn = void (*)(const uint8_t* src0, const uint8_t* src1,
+                                   uint8_t* dst_y0, uint8_t* dst_y1,
+                                   uint8_t* dst_uv, int width);
+
+// 一行打包数据 -> 一行 RGB24 或 BGRA
+using PackedToRgbRowFn = void (*)(const uint8_t* src, uint8_t* dst,
+                                  int width);
+
+// 两行按权重混合为一行，weight 取 1-255（0 与 256 由调用者直接引用源行）
+using BlendRowsFn = void (*)(const uint8_t* row0, const uint8_t* row1,
+                             uint8_t* dst, int bytes, int weight);
+
+// 一行累加到 16 位累加器
+using AccumulateRowFn = void (*)(const uint8_t* row, uint16_t* acc,
+                                 int bytes);
+
+// 一种源格式的颜色转换行内核
+struct PackedRowKernels {
+  PackedToI420RowFn to_i420;
+  PackedToNV12RowFn to_nv12;
+  PackedToRgbRowFn to_rgb24;
+  PackedToRgbRowFn to_bgra;
+};
+
+// 一组指令集的行内核
+struct ConverterKernels {
+  const char* name;
+  PackedRowKernels yuyv;
+  PackedRowKernels uyvy;
+  BlendRowsFn blend_rows;
+  AccumulateRowFn accumulate_row;
+};
+
+// 按源格式选择颜色转换内核
+// @return 不支持的源格式返回 nullptr
+inline const PackedRowKernels* SelectPackedKernels(
+    const ConverterKernels* kernels, uint32_t src_format) {
+  switch (src_format) {
+    case V4L2_PIX_FMT_YUYV:
+      return &kernels->yuyv;
+    case V4L2_PIX_FMT_UYVY:
+      return &kernels->uyvy;
+    default:
+      return nullptr;
+  }
+}
+
+// 标量内核（总是可用，也用于 SIMD 内核处理行尾）
+const ConverterKernels* GetScalarKernels();
+
+// SIMD 内核，当前架构未编译对应实现时返回 nullptr
+const ConverterKernels* GetSse41Kernels();
+const ConverterKernels* GetAvx2Kernels();
+const ConverterKernels* GetNeonKernels();
+
+// 标量颜色转换行内核，Src 为打包 4:2:2 源格式的 PixelFormatTraits；
+// 在 format_converter_scalar.cpp 中为 YUYV、UYVY 显式实例化，
+// 供 SIMD 内核处理剩余像素
+template <typename Src>
+struct ScalarRows {
+  static void ToI420(const uint8_t* src0, const uint8_t* src1,
+                     uint8_t* dst_y0, uint8_t* dst_y1, uint8_t* dst_u,
+                     uint8_t* dst_v, int width);
+  static void ToNV12(const uint8_t* src0, const uint8_t* src1,
+                     uint8_t* dst_y0, uint8_t* dst_y1, uint8_t* dst_uv,
+                     int width);
+  static void ToRgb24(const uint8_t* src, uint8_t* dst, int width);
+  static void ToBgra(const uint8_t* src, uint8_t* dst, int width);
+};
+
+using YuyvTraits = PixelFormatTraits<V4L2_PIX_FMT_YUYV>;
+using UyvyTraits = PixelFormatTraits<V4L2_PIX_FMT_UYVY>;
+extern template struct ScalarRows<YuyvTraits>;
+extern template struct ScalarRows<UyvyTraits>;
+
+void BlendRowsScalar(const uint8_t* row0, const uint8_t* row1, uint8_t* dst,
+                     int bytes, int weight);
+void AccumulateRowScalar(const uint8_t* row, uint16_t* acc, int bytes);
+
+}  // namespace internal
+}  // namespace v4l2_demo
+
+#endif  // V4L2_DEMO_SRC_COMMON_FORMAT_CONVERTER_KERNELS_H_
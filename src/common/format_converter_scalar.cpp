@@ -0,0 +1,144 @@
+#include "format_converter_kernels.h"
+
+namespace v4l2_demo {
+namespace internal {
+
+namespace {
+// 模拟 16 位饱和加法，保证与 SIMD 内核逐位一致
+inline int SatAdd16(int a, int b) {
+  int sum = a + b;
+  if (sum > 32767) {
+    return 32767;
+  }
+  if (sum < -32768) {
+    return -32768;
+  }
+  return sum;
+}
+
+inline uint8_t ClampToByte(int value) {
+  if (value < 0) {
+    return 0;
+  }
+  if (value > 255) {
+    return 255;
+  }
+  return static_cast<uint8_t>(value);
+}
+
+// 打包像素对中 Y0/U/Y1/V 的字节偏移（编译期常量）
+template <typename Src>
+struct PackedOffsets {
+  static_assert(Src::kLayout == PlaneLayout::kPacked &&
+                    Src::kChromaStep == 4,
+                "需要打包 4:2:2 格式");
+  static constexpr int y0 = Src::kYOffset;
+  static constexpr int u = Src::kUOffset;
+  static constexpr int y1 = Src::kYOffset + 2;
+  static constexpr int v = Src::kVOffset;
+};
+
+inline void YuvToRgb(int y, int u, int v, uint8_t* r, uint8_t* g,
+                     uint8_t* b) {
+  int y1 = ((y * 0x0101 * kYuvYGain) >> 16) + kYuvYBias;
+  int du = u - 128;
+  int dv = v - 128;
+  *r = ClampToByte(SatAdd16(y1, 102 * dv) >> 6);
+  *g = ClampToByte(SatAdd16(SatAdd16(y1, -25 * du), -52 * dv) >> 6);
+  *b = ClampToByte(SatAdd16(y1, 129 * du) >> 6);
+}
+}  // namespace
+
+template <typename Src>
+void ScalarRows<Src>::ToI420(const uint8_t* src0, const uint8_t* src1,
+                             uint8_t* dst_y0, uint8_t* dst_y1, uint8_t* dst_u,
+                             uint8_t* dst_v, int width) {
+  using Offsets = PackedOffsets<Src>;
+  for (int x = 0; x < width; x += 2) {
+    const uint8_t* p0 = src0 + x * 2;
+    const uint8_t* p1 = src1 + x * 2;
+    dst_y0[x] = p0[Offsets::y0];
+    dst_y0[x + 1] = p0[Offsets::y1];
+    dst_y1[x] = p1[Offsets::y0];
+    dst_y1[x + 1] = p1[Offsets::y1];
+    dst_u[x / 2] = (p0[Offsets::u] + p1[Offsets::u] + 1) >> 1;
+    dst_v[x / 2] = (p0[Offsets::v] + p1[Offsets::v] + 1) >> 1;
+  }
+}
+
+template <typename Src>
+void ScalarRows<Src>::ToNV12(const uint8_t* src0, const uint8_t* src1,
+                             uint8_t* dst_y0, uint8_t* dst_y1,
+                             uint8_t* dst_uv, int width) {
+  using Offsets = PackedOffsets<Src>;
+  for (int x = 0; x < width; x += 2) {
+    const uint8_t* p0 = src0 + x * 2;
+    const uint8_t* p1 = src1 + x * 2;
+    dst_y0[x] = p0[Offsets::y0];
+    dst_y0[x + 1] = p0[Offsets::y1];
+    dst_y1[x] = p1[Offsets::y0];
+    dst_y1[x + 1] = p1[Offsets::y1];
+    dst_uv[x] = (p0[Offsets::u] + p1[Offsets::u] + 1) >> 1;
+    dst_uv[x + 1] = (p0[Offsets::v] + p1[Offsets::v] + 1) >> 1;
+  }
+}
+
+template <typename Src>
+void ScalarRows<Src>::ToRgb24(const uint8_t* src, uint8_t* dst, int width) {
+  using Offsets = PackedOffsets<Src>;
+  for (int x = 0; x < width; x += 2) {
+    const uint8_t* p = src + x * 2;
+    uint8_t* d = dst + x * 3;
+    YuvToRgb(p[Offsets::y0], p[Offsets::u], p[Offsets::v], &d[0], &d[1], &d[2]);
+    YuvToRgb(p[Offsets::y1], p[Offsets::u], p[Offsets::v], &d[3], &d[4], &d[5]);
+  }
+}
+
+template <typename Src>
+void ScalarRows<Src>::ToBgra(const uint8_t* src, uint8_t* dst, int width) {
+  using Offsets = PackedOffsets<Src>;
+  for (int x = 0; x < width; x += 2) {
+    const uint8_t* p = src + x * 2;
+    uint8_t* d = dst + x * 4;
+    YuvToRgb(p[Offsets::y0], p[Offsets::u], p[Offsets::v], &d[2], &d[1], &d[0]);
+    d[3] = 255;
+    YuvToRgb(p[Offsets::y1], p[Offsets::u], p[Offsets::v], &d[6], &d[5], &d[4]);
+    d[7] = 255;
+  }
+}
+
+template struct ScalarRows<YuyvTraits>;
+template struct ScalarRows<UyvyTraits>;
+
+void BlendRowsScalar(const uint8_t* row0, const uint8_t* row1, uint8_t* dst,
+                     int bytes, int weight) {
+  const int inverse = 256 - weight;
+  for (int i = 0; i < bytes; ++i) {
+    dst[i] = static_cast<uint8_t>(
+        (row0[i] * inverse + row1[i] * weight + 128) >> 8);
+  }
+}
+
+void AccumulateRowScalar(const uint8_t* row, uint16_t* acc, int bytes) {
+  for (int i = 0; i < bytes; ++i) {
+    acc[i] = static_cast<uint16_t>(acc[i] + row[i]);
+  }
+}
+
+namespace {
+template <typename Src>
+constexpr PackedRowKernels MakeScalarRows() {
+  return {ScalarRows<Src>::ToI420, ScalarRows<Src>::ToNV12,
+          ScalarRows<Src>::ToRgb24, ScalarRows<Src>::ToBgra};
+}
+}  // namespace
+
+const ConverterKernels* GetScalarKernels() {
+  static const ConverterKernels kKernels = {
+      "scalar", MakeScalarRows<YuyvTraits>(), MakeScalarRows<UyvyTraits>(),
+      BlendRowsScalar, AccumulateRowScalar};
+  return &kKernels;
+}
+
+}  // namespace internal
+}  // namespace v4l2_demo
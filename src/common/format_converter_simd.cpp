@@ -0,0 +1,710 @@
+#include "format_converter_kernels.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define V4L2_DEMO_HAVE_X86_SIMD 1
+#define V4L2_DEMO_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define V4L2_DEMO_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#if defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#define V4L2_DEMO_HAVE_NEON 1
+#endif
+
+// SIMD 行内核。x86 内核通过函数级 target 属性编译，无需全局 -mavx2，
+// 由 FormatConverter 在运行时根据 CPU 特性选择，行尾交给标量内核处理
+// 颜色转换内核按源格式实例化，YUYV 版本不含字节交换指令
+
+namespace v4l2_demo {
+namespace internal {
+
+#ifdef V4L2_DEMO_HAVE_X86_SIMD
+
+namespace {
+
+// x86 内核按 YUYV 顺序计算，UYVY 先交换每对相邻字节；是否交换在编译期
+// 由格式描述决定
+template <typename Src>
+constexpr bool NeedsSwap() {
+  static_assert(Src::kLayout == PlaneLayout::kPacked &&
+                    Src::kUOffset == (Src::kYOffset ^ 1) &&
+                    Src::kVOffset == Src::kUOffset + 2,
+                "x86 内核只支持 YUYV 与 UYVY");
+  return Src::kYOffset == 1;
+}
+
+// ---------------------------------------------------------------- SSE4.1
+
+// UYVY -> YUYV：交换每对相邻字节
+V4L2_DEMO_TARGET_SSE41 inline __m128i SwapPairs128() {
+  return _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+}
+
+// 计算 8 个像素（YUYV 顺序的 16 字节）的 RGB，结果为 16 位
+V4L2_DEMO_TARGET_SSE41 inline void ComputeRgb8(__m128i p, __m128i* r,
+                                               __m128i* g, __m128i* b) {
+  const __m128i dup_u =
+      _mm_setr_epi8(0, 1, 0, 1, 4, 5, 4, 5, 8, 9, 8, 9, 12, 13, 12, 13);
+  const __m128i dup_v =
+      _mm_setr_epi8(2, 3, 2, 3, 6, 7, 6, 7, 10, 11, 10, 11, 14, 15, 14, 15);
+
+  __m128i y = _mm_and_si128(p, _mm_set1_epi16(0x00FF));
+  __m128i uv = _mm_srli_epi16(p, 8);
+  __m128i u = _mm_sub_epi16(_mm_shuffle_epi8(uv, dup_u), _mm_set1_epi16(128));
+  __m128i v = _mm_sub_epi16(_mm_shuffle_epi8(uv, dup_v), _mm_set1_epi16(128));
+
+  y = _mm_mulhi_epu16(_mm_or_si128(y, _mm_slli_epi16(y, 8)),
+                      _mm_set1_epi16(static_cast<int16_t>(kYuvYGain)));
+  y = _mm_add_epi16(y, _mm_set1_epi16(kYuvYBias));
+
+  __m128i rr = _mm_adds_epi16(y, _mm_mullo_epi16(v, _mm_set1_epi16(102)));
+  __m128i gg = _mm_adds_epi16(y, _mm_mullo_epi16(u, _mm_set1_epi16(-25)));
+  gg = _mm_adds_epi16(gg, _mm_mullo_epi16(v, _mm_set1_epi16(-52)));
+  __m128i bb = _mm_adds_epi16(y, _mm_mullo_epi16(u, _mm_set1_epi16(129)));
+
+  *r = _mm_srai_epi16(rr, 6);
+  *g = _mm_srai_epi16(gg, 6);
+  *b = _mm_srai_epi16(bb, 6);
+}
+
+// 写出 128 位寄存器的低 12 字节
+V4L2_DEMO_TARGET_SSE41 inline void Store12(uint8_t* dst, __m128i value) {
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), value);
+  int tail = _mm_cvtsi128_si32(_mm_srli_si128(value, 8));
+  memcpy(dst + 8, &tail, 4);
+}
+
+// RGB0 x4 -> RGB x4 的压缩掩码
+V4L2_DEMO_TARGET_SSE41 inline __m128i PackRgbMask128() {
+  return _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1,
+                       -1);
+}
+
+template <typename Src>
+V4L2_DEMO_TARGET_SSE41 void PackedToI420RowSse41(
+    const uint8_t* src0, const uint8_t* src1, uint8_t* dst_y0,
+    uint8_t* dst_y1, uint8_t* dst_u, uint8_t* dst_v, int width) {
+  const __m128i mask = _mm_set1_epi16(0x00FF);
+  int x = 0;
+  for (; x + 16 <= width; x += 16) {
+    __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src0 + x * 2));
+    __m128i a1 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src0 + x * 2 + 16));
+    __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src1 + x * 2));
+    __m128i b1 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src1 + x * 2 + 16));
+    if constexpr (NeedsSwap<Src>()) {
+      a0 = _mm_shuffle_epi8(a0, SwapPairs128());
+      a1 = _mm_shuffle_epi8(a1, SwapPairs128());
+      b0 = _mm_shuffle_epi8(b0, SwapPairs128());
+      b1 = _mm_shuffle_epi8(b1, SwapPairs128());
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst_y0 + x),
+                     _mm_packus_epi16(_mm_and_si128(a0, mask),
+                                      _mm_and_si128(a1, mask)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst_y1 + x),
+                     _mm_packus_epi16(_mm_and_si128(b0, mask),
+                                      _mm_and_si128(b1, mask)));
+
+    __m128i uv0 =
+        _mm_packus_epi16(_mm_srli_epi16(a0, 8), _mm_srli_epi16(a1, 8));
+    __m128i uv1 =
+        _mm_packus_epi16(_mm_srli_epi16(b0, 8), _mm_srli_epi16(b1, 8));
+    __m128i uv = _mm_avg_epu8(uv0, uv1);
+
+    __m128i u = _mm_and_si128(uv, mask);
+    __m128i v = _mm_srli_epi16(uv, 8);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst_u + x / 2),
+                     _mm_packus_epi16(u, u));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst_v + x / 2),
+                     _mm_packus_epi16(v, v));
+  }
+  ScalarRows<Src>::ToI420(src0 + x * 2, src1 + x * 2, dst_y0 + x, dst_y1 + x,
+                          dst_u + x / 2, dst_v + x / 2, width - x);
+}
+
+template <typename Src>
+V4L2_DEMO_TARGET_SSE41 void PackedToNV12RowSse41(
+    const uint8_t* src0, const uint8_t* src1, uint8_t* dst_y0,
+    uint8_t* dst_y1, uint8_t* dst_uv, int width) {
+  const __m128i mask = _mm_set1_epi16(0x00FF);
+  int x = 0;
+  for (; x + 16 <= width; x += 16) {
+    __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src0 + x * 2));
+    __m128i a1 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src0 + x * 2 + 16));
+    __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src1 + x * 2));
+    __m128i b1 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src1 + x * 2 + 16));
+    if constexpr (NeedsSwap<Src>()) {
+      a0 = _mm_shuffle_epi8(a0, SwapPairs128());
+      a1 = _mm_shuffle_epi8(a1, SwapPairs128());
+      b0 = _mm_shuffle_epi8(b0, SwapPairs128());
+      b1 = _mm_shuffle_epi8(b1, SwapPairs128());
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst_y0 + x),
+                     _mm_packus_epi16(_mm_and_si128(a0, mask),
+                                      _mm_and_si128(a1, mask)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst_y1 + x),
+                     _mm_packus_epi16(_mm_and_si128(b0, mask),
+                                      _mm_and_si128(b1, mask)));
+
+    __m128i uv0 =
+        _mm_packus_epi16(_mm_srli_epi16(a0, 8), _mm_srli_epi16(a1, 8));
+    __m128i uv1 =
+        _mm_packus_epi16(_mm_srli_epi16(b0, 8), _mm_srli_epi16(b1, 8));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst_uv + x),
+                     _mm_avg_epu8(uv0, uv1));
+  }
+  ScalarRows<Src>::ToNV12(src0 + x * 2, src1 + x * 2, dst_y0 + x, dst_y1 + x,
+                          dst_uv + x, width - x);
+}
+
+template <typename Src>
+V4L2_DEMO_TARGET_SSE41 void PackedToRgb24RowSse41(const uint8_t* src,
+                                                  uint8_t* dst, int width) {
+  const __m128i pack = PackRgbMask128();
+  const __m128i zero = _mm_setzero_si128();
+  int x = 0;
+  for (; x + 8 <= width; x += 8) {
+    __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 2));
+    if constexpr (NeedsSwap<Src>()) {
+      p = _mm_shuffle_epi8(p, SwapPairs128());
+    }
+    __m128i r, g, b;
+    ComputeRgb8(p, &r, &g, &b);
+    __m128i r8 = _mm_packus_epi16(r, r);
+    __m128i g8 = _mm_packus_epi16(g, g);
+    __m128i b8 = _mm_packus_epi16(b, b);
+
+    __m128i rg = _mm_unpacklo_epi8(r8, g8);
+    __m128i bz = _mm_unpacklo_epi8(b8, zero);
+    __m128i lo = _mm_shuffle_epi8(_mm_unpacklo_epi16(rg, bz), pack);
+    __m128i hi = _mm_shuffle_epi8(_mm_unpackhi_epi16(rg, bz), pack);
+    Store12(dst + x * 3, lo);
+    Store12(dst + x * 3 + 12, hi);
+  }
+  ScalarRows<Src>::ToRgb24(src + x * 2, dst + x * 3, width - x);
+}
+
+template <typename Src>
+V4L2_DEMO_TARGET_SSE41 void PackedToBgraRowSse41(const uint8_t* src,
+                                                 uint8_t* dst, int width) {
+  const __m128i alpha = _mm_set1_epi8(-1);
+  int x = 0;
+  for (; x + 8 <= width; x += 8) {
+    __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 2));
+    if constexpr (NeedsSwap<Src>()) {
+      p = _mm_shuffle_epi8(p, SwapPairs128());
+    }
+    __m128i r, g, b;
+    ComputeRgb8(p, &r, &g, &b);
+    __m128i r8 = _mm_packus_epi16(r, r);
+    __m128i g8 = _mm_packus_epi16(g, g);
+    __m128i b8 = _mm_packus_epi16(b, b);
+
+    __m128i bg = _mm_unpacklo_epi8(b8, g8);
+    __m128i ra = _mm_unpacklo_epi8(r8, alpha);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4),
+                     _mm_unpacklo_epi16(bg, ra));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4 + 16),
+                     _mm_unpackhi_epi16(bg, ra));
+  }
+  ScalarRows<Src>::ToBgra(src + x * 2, dst + x * 4, width - x);
+}
+
+// 两行混合的 8 个字节：(a * (256 - w) + b * w + 128) >> 8，16 位内不溢出
+V4L2_DEMO_TARGET_SSE41 inline __m128i Blend8(__m128i a, __m128i b,
+                                             __m128i inverse,
+                                             __m128i weight) {
+  __m128i sum = _mm_add_epi16(_mm_mullo_epi16(a, inverse),
+                              _mm_mullo_epi16(b, weight));
+  return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(128)), 8);
+}
+
+V4L2_DEMO_TARGET_SSE41 void BlendRowsSse41(const uint8_t* row0,
+                                           const uint8_t* row1, uint8_t* dst,
+                                           int bytes, int weight) {
+  const __m128i inverse = _mm_set1_epi16(static_cast<int16_t>(256 - weight));
+  const __m128i w = _mm_set1_epi16(static_cast<int16_t>(weight));
+  const __m128i zero = _mm_setzero_si128();
+  int i = 0;
+  for (; i + 16 <= bytes; i += 16) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + i));
+    __m128i lo = Blend8(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero),
+                        inverse, w);
+    __m128i hi = Blend8(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero),
+                        inverse, w);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                     _mm_packus_epi16(lo, hi));
+  }
+  BlendRowsScalar(row0 + i, row1 + i, dst + i, bytes - i, weight);
+}
+
+V4L2_DEMO_TARGET_SSE41 void AccumulateRowSse41(const uint8_t* row,
+                                               uint16_t* acc, int bytes) {
+  const __m128i zero = _mm_setzero_si128();
+  int i = 0;
+  for (; i + 16 <= bytes; i += 16) {
+    __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+    __m128i* a = reinterpret_cast<__m128i*>(acc + i);
+    _mm_storeu_si128(a, _mm_add_epi16(_mm_loadu_si128(a),
+                                      _mm_unpacklo_epi8(p, zero)));
+    _mm_storeu_si128(a + 1, _mm_add_epi16(_mm_loadu_si128(a + 1),
+                                          _mm_unpackhi_epi8(p, zero)));
+  }
+  AccumulateRowScalar(row + i, acc + i, bytes - i);
+}
+
+// ------------------------------------------------------------------ AVX2
+
+V4L2_DEMO_TARGET_AVX2 inline __m256i SwapPairs256() {
+  return _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15,
+                          14, 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12,
+                          15, 14);
+}
+
+// 计算 16 个像素（YUYV 顺序的 32 字节）的 RGB，两个 128 位通道各 8 像素
+V4L2_DEMO_TARGET_AVX2 inline void ComputeRgb16(__m256i p, __m256i* r,
+                                               __m256i* g, __m256i* b) {
+  const __m256i dup_u = _mm256_setr_epi8(
+      0, 1, 0, 1, 4, 5, 4, 5, 8, 9, 8, 9, 12, 13, 12, 13, 0, 1, 0, 1, 4, 5,
+      4, 5, 8, 9, 8, 9, 12, 13, 12, 13);
+  const __m256i dup_v = _mm256_setr_epi8(
+      2, 3, 2, 3, 6, 7, 6, 7, 10, 11, 10, 11, 14, 15, 14, 15, 2, 3, 2, 3, 6,
+      7, 6, 7, 10, 11, 10, 11, 14, 15, 14, 15);
+
+  __m256i y = _mm256_and_si256(p, _mm256_set1_epi16(0x00FF));
+  __m256i uv = _mm256_srli_epi16(p, 8);
+  __m256i u = _mm256_sub_epi16(_mm256_shuffle_epi8(uv, dup_u),
+                               _mm256_set1_epi16(128));
+  __m256i v = _mm256_sub_epi16(_mm256_shuffle_epi8(uv, dup_v),
+                               _mm256_set1_epi16(128));
+
+  y = _mm256_mulhi_epu16(_mm256_or_si256(y, _mm256_slli_epi16(y, 8)),
+                         _mm256_set1_epi16(static_cast<int16_t>(kYuvYGain)));
+  y = _mm256_add_epi16(y, _mm256_set1_epi16(kYuvYBias));
+
+  __m256i rr =
+      _mm256_adds_epi16(y, _mm256_mullo_epi16(v, _mm256_set1_epi16(102)));
+  __m256i gg =
+      _mm256_adds_epi16(y, _mm256_mullo_epi16(u, _mm256_set1_epi16(-25)));
+  gg = _mm256_adds_epi16(gg, _mm256_mullo_epi16(v, _mm256_set1_epi16(-52)));
+  __m256i bb =
+      _mm256_adds_epi16(y, _mm256_mullo_epi16(u, _mm256_set1_epi16(129)));
+
+  *r = _mm256_srai_epi16(rr, 6);
+  *g = _mm256_srai_epi16(gg, 6);
+  *b = _mm256_srai_epi16(bb, 6);
+}
+
+// 两个 256 位寄存器的 16 位元素饱和打包为 32 字节，并修正通道交错顺序
+V4L2_DEMO_TARGET_AVX2 inline __m256i PackUs256(__m256i a, __m256i b) {
+  return _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+}
+
+template <typename Src>
+V4L2_DEMO_TARGET_AVX2 void PackedToI420RowAvx2(
+    const uint8_t* src0, const uint8_t* src1, uint8_t* dst_y0,
+    uint8_t* dst_y1, uint8_t* dst_u, uint8_t* dst_v, int width) {
+  const __m256i mask = _mm256_set1_epi16(0x00FF);
+  int x = 0;
+  for (; x + 32 <= width; x += 32) {
+    __m256i a0 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src0 + x * 2));
+    __m256i a1 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src0 + x * 2 + 32));
+    __m256i b0 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src1 + x * 2));
+    __m256i b1 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src1 + x * 2 + 32));
+    if constexpr (NeedsSwap<Src>()) {
+      a0 = _mm256_shuffle_epi8(a0, SwapPairs256());
+      a1 = _mm256_shuffle_epi8(a1, SwapPairs256());
+      b0 = _mm256_shuffle_epi8(b0, SwapPairs256());
+      b1 = _mm256_shuffle_epi8(b1, SwapPairs256());
+    }
+
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(dst_y0 + x),
+        PackUs256(_mm256_and_si256(a0, mask), _mm256_and_si256(a1, mask)));
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(dst_y1 + x),
+        PackUs256(_mm256_and_si256(b0, mask), _mm256_and_si256(b1, mask)));
+
+    __m256i uv0 = PackUs256(_mm256_srli_epi16(a0, 8), _mm256_srli_epi16(a1, 8));
+    __m256i uv1 = PackUs256(_mm256_srli_epi16(b0, 8), _mm256_srli_epi16(b1, 8));
+    __m256i uv = _mm256_avg_epu8(uv0, uv1);
+
+    __m256i u = _mm256_and_si256(uv, mask);
+    __m256i v = _mm256_srli_epi16(uv, 8);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst_u + x / 2),
+                     _mm256_castsi256_si128(PackUs256(u, u)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst_v + x / 2),
+                     _mm256_castsi256_si128(PackUs256(v, v)));
+  }
+  PackedToI420RowSse41<Src>(src0 + x * 2, src1 + x * 2, dst_y0 + x, dst_y1 + x,
+                            dst_u + x / 2, dst_v + x / 2, width - x);
+}
+
+template <typename Src>
+V4L2_DEMO_TARGET_AVX2 void PackedToNV12RowAvx2(
+    const uint8_t* src0, const uint8_t* src1, uint8_t* dst_y0,
+    uint8_t* dst_y1, uint8_t* dst_uv, int width) {
+  const __m256i mask = _mm256_set1_epi16(0x00FF);
+  int x = 0;
+  for (; x + 32 <= width; x += 32) {
+    __m256i a0 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src0 + x * 2));
+    __m256i a1 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src0 + x * 2 + 32));
+    __m256i b0 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src1 + x * 2));
+    __m256i b1 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src1 + x * 2 + 32));
+    if constexpr (NeedsSwap<Src>()) {
+      a0 = _mm256_shuffle_epi8(a0, SwapPairs256());
+      a1 = _mm256_shuffle_epi8(a1, SwapPairs256());
+      b0 = _mm256_shuffle_epi8(b0, SwapPairs256());
+      b1 = _mm256_shuffle_epi8(b1, SwapPairs256());
+    }
+
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(dst_y0 + x),
+        PackUs256(_mm256_and_si256(a0, mask), _mm256_and_si256(a1, mask)));
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(dst_y1 + x),
+        PackUs256(_mm256_and_si256(b0, mask), _mm256_and_si256(b1, mask)));
+
+    __m256i uv0 = PackUs256(_mm256_srli_epi16(a0, 8), _mm256_srli_epi16(a1, 8));
+    __m256i uv1 = PackUs256(_mm256_srli_epi16(b0, 8), _mm256_srli_epi16(b1, 8));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst_uv + x),
+                        _mm256_avg_epu8(uv0, uv1));
+  }
+  PackedToNV12RowSse41<Src>(src0 + x * 2, src1 + x * 2, dst_y0 + x, dst_y1 + x,
+                            dst_uv + x, width - x);
+}
+
+template <typename Src>
+V4L2_DEMO_TARGET_AVX2 void PackedToRgb24RowAvx2(const uint8_t* src,
+                                                 uint8_t* dst, int width) {
+  const __m256i pack = _mm256_setr_epi8(
+      0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1, 0, 1, 2, 4, 5,
+      6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+  const __m256i zero = _mm256_setzero_si256();
+  int x = 0;
+  for (; x + 16 <= width; x += 16) {
+    __m256i p =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x * 2));
+    if constexpr (NeedsSwap<Src>()) {
+      p = _mm256_shuffle_epi8(p, SwapPairs256());
+    }
+    __m256i r, g, b;
+    ComputeRgb16(p, &r, &g, &b);
+    // 通道内打包：每个 128 位通道的低 8 字节为该通道 8 个像素
+    __m256i r8 = _mm256_packus_epi16(r, r);
+    __m256i g8 = _mm256_packus_epi16(g, g);
+    __m256i b8 = _mm256_packus_epi16(b, b);
+
+    __m256i rg = _mm256_unpacklo_epi8(r8, g8);
+    __m256i bz = _mm256_unpacklo_epi8(b8, zero);
+    __m256i lo = _mm256_shuffle_epi8(_mm256_unpacklo_epi16(rg, bz), pack);
+    __m256i hi = _mm256_shuffle_epi8(_mm256_unpackhi_epi16(rg, bz), pack);
+
+    uint8_t* d = dst + x * 3;
+    Store12(d, _mm256_castsi256_si128(lo));
+    Store12(d + 12, _mm256_castsi256_si128(hi));
+    Store12(d + 24, _mm256_extracti128_si256(lo, 1));
+    Store12(d + 36, _mm256_extracti128_si256(hi, 1));
+  }
+  PackedToRgb24RowSse41<Src>(src + x * 2, dst + x * 3, width - x);
+}
+
+template <typename Src>
+V4L2_DEMO_TARGET_AVX2 void PackedToBgraRowAvx2(const uint8_t* src,
+                                                uint8_t* dst, int width) {
+  const __m256i alpha = _mm256_set1_epi8(-1);
+  int x = 0;
+  for (; x + 16 <= width; x += 16) {
+    __m256i p =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x * 2));
+    if constexpr (NeedsSwap<Src>()) {
+      p = _mm256_shuffle_epi8(p, SwapPairs256());
+    }
+    __m256i r, g, b;
+    ComputeRgb16(p, &r, &g, &b);
+    __m256i r8 = _mm256_packus_epi16(r, r);
+    __m256i g8 = _mm256_packus_epi16(g, g);
+    __m256i b8 = _mm256_packus_epi16(b, b);
+
+    __m256i bg = _mm256_unpacklo_epi8(b8, g8);
+    __m256i ra = _mm256_unpacklo_epi8(r8, alpha);
+    __m256i lo = _mm256_unpacklo_epi16(bg, ra);  // 像素 0-3 | 8-11
+    __m256i hi = _mm256_unpackhi_epi16(bg, ra);  // 像素 4-7 | 12-15
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4),
+                        _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4 + 32),
+                        _mm256_permute2x128_si256(lo, hi, 0x31));
+  }
+  PackedToBgraRowSse41<Src>(src + x * 2, dst + x * 4, width - x);
+}
+
+V4L2_DEMO_TARGET_AVX2 inline __m256i Blend16(__m256i a, __m256i b,
+                                             __m256i inverse,
+                                             __m256i weight) {
+  __m256i sum = _mm256_add_epi16(_mm256_mullo_epi16(a, inverse),
+                                 _mm256_mullo_epi16(b, weight));
+  return _mm256_srli_epi16(_mm256_add_epi16(sum, _mm256_set1_epi16(128)), 8);
+}
+
+// unpack 与 packus 都按 128 位通道进行，先拆后合字节顺序不变
+V4L2_DEMO_TARGET_AVX2 void BlendRowsAvx2(const uint8_t* row0,
+                                         const uint8_t* row1, uint8_t* dst,
+                                         int bytes, int weight) {
+  const __m256i inverse =
+      _mm256_set1_epi16(static_cast<int16_t>(256 - weight));
+  const __m256i w = _mm256_set1_epi16(static_cast<int16_t>(weight));
+  const __m256i zero = _mm256_setzero_si256();
+  int i = 0;
+  for (; i + 32 <= bytes; i += 32) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row0 + i));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row1 + i));
+    __m256i lo = Blend16(_mm256_unpacklo_epi8(a, zero),
+                         _mm256_unpacklo_epi8(b, zero), inverse, w);
+    __m256i hi = Blend16(_mm256_unpackhi_epi8(a, zero),
+                         _mm256_unpackhi_epi8(b, zero), inverse, w);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+                        _mm256_packus_epi16(lo, hi));
+  }
+  BlendRowsSse41(row0 + i, row1 + i, dst + i, bytes - i, weight);
+}
+
+V4L2_DEMO_TARGET_AVX2 void AccumulateRowAvx2(const uint8_t* row,
+                                             uint16_t* acc, int bytes) {
+  int i = 0;
+  for (; i + 16 <= bytes; i += 16) {
+    __m256i p = _mm256_cvtepu8_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i)));
+    __m256i* a = reinterpret_cast<__m256i*>(acc + i);
+    _mm256_storeu_si256(a, _mm256_add_epi16(_mm256_loadu_si256(a), p));
+  }
+  AccumulateRowScalar(row + i, acc + i, bytes - i);
+}
+
+template <typename Src>
+constexpr PackedRowKernels MakeSse41Rows() {
+  return {PackedToI420RowSse41<Src>, PackedToNV12RowSse41<Src>,
+          PackedToRgb24RowSse41<Src>, PackedToBgraRowSse41<Src>};
+}
+
+template <typename Src>
+constexpr PackedRowKernels MakeAvx2Rows() {
+  return {PackedToI420RowAvx2<Src>, PackedToNV12RowAvx2<Src>,
+          PackedToRgb24RowAvx2<Src>, PackedToBgraRowAvx2<Src>};
+}
+
+}  // namespace
+
+const ConverterKernels* GetSse41Kernels() {
+  static const ConverterKernels kKernels = {
+      "sse4.1", MakeSse41Rows<YuyvTraits>(), MakeSse41Rows<UyvyTraits>(),
+      BlendRowsSse41, AccumulateRowSse41};
+  return &kKernels;
+}
+
+const ConverterKernels* GetAvx2Kernels() {
+  static const ConverterKernels kKernels = {
+      "avx2", MakeAvx2Rows<YuyvTraits>(), MakeAvx2Rows<UyvyTraits>(),
+      BlendRowsAvx2, AccumulateRowAvx2};
+  return &kKernels;
+}
+
+#else
+
+const ConverterKernels* GetSse41Kernels() {
+  return nullptr;
+}
+
+const ConverterKernels* GetAvx2Kernels() {
+  return nullptr;
+}
+
+#endif  // V4L2_DEMO_HAVE_X86_SIMD
+
+#ifdef V4L2_DEMO_HAVE_NEON
+
+namespace {
+
+// 加载 16 个像素并拆分为偶数 Y、奇数 Y、U、V 四个分量
+// vld4 按字节位置解交错，分量位置直接取自格式描述
+template <typename Src>
+inline void LoadPacked16(const uint8_t* src, uint8x8_t* y_even,
+                         uint8x8_t* y_odd, uint8x8_t* u, uint8x8_t* v) {
+  uint8x8x4_t p = vld4_u8(src);
+  *y_even = p.val[Src::kYOffset];
+  *u = p.val[Src::kUOffset];
+  *y_odd = p.val[Src::kYOffset + 2];
+  *v = p.val[Src::kVOffset];
+}
+
+// 计算 8 个像素（共享同一组 U/V）的 RGB
+inline void ComputeRgb8Neon(uint8x8_t y8, int16x8_t du, int16x8_t dv,
+                            uint8x8_t* r, uint8x8_t* g, uint8x8_t* b) {
+  uint16x8_t y16 = vmovl_u8(y8);
+  y16 = vorrq_u16(y16, vshlq_n_u16(y16, 8));
+  const uint16x4_t gain = vdup_n_u16(kYuvYGain);
+  uint16x8_t y1 =
+      vcombine_u16(vshrn_n_u32(vmull_u16(vget_low_u16(y16), gain), 16),
+                   vshrn_n_u32(vmull_u16(vget_high_u16(y16), gain), 16));
+  int16x8_t y = vaddq_s16(vreinterpretq_s16_u16(y1), vdupq_n_s16(kYuvYBias));
+
+  int16x8_t rr = vqaddq_s16(y, vmulq_s16(dv, vdupq_n_s16(102)));
+  int16x8_t gg = vqaddq_s16(y, vmulq_s16(du, vdupq_n_s16(-25)));
+  gg = vqaddq_s16(gg, vmulq_s16(dv, vdupq_n_s16(-52)));
+  int16x8_t bb = vqaddq_s16(y, vmulq_s16(du, vdupq_n_s16(129)));
+
+  *r = vqmovun_s16(vshrq_n_s16(rr, 6));
+  *g = vqmovun_s16(vshrq_n_s16(gg, 6));
+  *b = vqmovun_s16(vshrq_n_s16(bb, 6));
+}
+
+// 计算 16 个像素的 RGB，按像素顺序输出（每个分量 16 字节）
+template <typename Src>
+inline void ComputeRgb16Neon(const uint8_t* src, uint8x8x2_t* r,
+                             uint8x8x2_t* g, uint8x8x2_t* b) {
+  uint8x8_t y_even, y_odd, u, v;
+  LoadPacked16<Src>(src, &y_even, &y_odd, &u, &v);
+  int16x8_t du =
+      vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(u)), vdupq_n_s16(128));
+  int16x8_t dv =
+      vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(v)), vdupq_n_s16(128));
+
+  uint8x8_t r_even, g_even, b_even, r_odd, g_odd, b_odd;
+  ComputeRgb8Neon(y_even, du, dv, &r_even, &g_even, &b_even);
+  ComputeRgb8Neon(y_odd, du, dv, &r_odd, &g_odd, &b_odd);
+  *r = vzip_u8(r_even, r_odd);
+  *g = vzip_u8(g_even, g_odd);
+  *b = vzip_u8(b_even, b_odd);
+}
+
+template <typename Src>
+void PackedToI420RowNeon(const uint8_t* src0, const uint8_t* src1,
+                         uint8_t* dst_y0, uint8_t* dst_y1, uint8_t* dst_u,
+                         uint8_t* dst_v, int width) {
+  int x = 0;
+  for (; x + 16 <= width; x += 16) {
+    uint8x8_t ae, ao, au, av, be, bo, bu, bv;
+    LoadPacked16<Src>(src0 + x * 2, &ae, &ao, &au, &av);
+    LoadPacked16<Src>(src1 + x * 2, &be, &bo, &bu, &bv);
+    vst2_u8(dst_y0 + x, (uint8x8x2_t{{ae, ao}}));
+    vst2_u8(dst_y1 + x, (uint8x8x2_t{{be, bo}}));
+    vst1_u8(dst_u + x / 2, vrhadd_u8(au, bu));
+    vst1_u8(dst_v + x / 2, vrhadd_u8(av, bv));
+  }
+  ScalarRows<Src>::ToI420(src0 + x * 2, src1 + x * 2, dst_y0 + x, dst_y1 + x,
+                          dst_u + x / 2, dst_v + x / 2, width - x);
+}
+
+template <typename Src>
+void PackedToNV12RowNeon(const uint8_t* src0, const uint8_t* src1,
+                         uint8_t* dst_y0, uint8_t* dst_y1, uint8_t* dst_uv,
+                         int width) {
+  int x = 0;
+  for (; x + 16 <= width; x += 16) {
+    uint8x8_t ae, ao, au, av, be, bo, bu, bv;
+    LoadPacked16<Src>(src0 + x * 2, &ae, &ao, &au, &av);
+    LoadPacked16<Src>(src1 + x * 2, &be, &bo, &bu, &bv);
+    vst2_u8(dst_y0 + x, (uint8x8x2_t{{ae, ao}}));
+    vst2_u8(dst_y1 + x, (uint8x8x2_t{{be, bo}}));
+    vst2_u8(dst_uv + x, (uint8x8x2_t{{vrhadd_u8(au, bu), vrhadd_u8(av, bv)}}));
+  }
+  ScalarRows<Src>::ToNV12(src0 + x * 2, src1 + x * 2, dst_y0 + x, dst_y1 + x,
+                          dst_uv + x, width - x);
+}
+
+template <typename Src>
+void PackedToRgb24RowNeon(const uint8_t* src, uint8_t* dst, int width) {
+  int x = 0;
+  for (; x + 16 <= width; x += 16) {
+    uint8x8x2_t r, g, b;
+    ComputeRgb16Neon<Src>(src + x * 2, &r, &g, &b);
+    vst3_u8(dst + x * 3, (uint8x8x3_t{{r.val[0], g.val[0], b.val[0]}}));
+    vst3_u8(dst + x * 3 + 24, (uint8x8x3_t{{r.val[1], g.val[1], b.val[1]}}));
+  }
+  ScalarRows<Src>::ToRgb24(src + x * 2, dst + x * 3, width - x);
+}
+
+template <typename Src>
+void PackedToBgraRowNeon(const uint8_t* src, uint8_t* dst, int width) {
+  const uint8x8_t alpha = vdup_n_u8(255);
+  int x = 0;
+  for (; x + 16 <= width; x += 16) {
+    uint8x8x2_t r, g, b;
+    ComputeRgb16Neon<Src>(src + x * 2, &r, &g, &b);
+    vst4_u8(dst + x * 4,
+            (uint8x8x4_t{{b.val[0], g.val[0], r.val[0], alpha}}));
+    vst4_u8(dst + x * 4 + 32,
+            (uint8x8x4_t{{b.val[1], g.val[1], r.val[1], alpha}}));
+  }
+  ScalarRows<Src>::ToBgra(src + x * 2, dst + x * 4, width - x);
+}
+
+// vrshrn_n_u16(x, 8) 即 (x + 128) >> 8，与标量舍入一致
+void BlendRowsNeon(const uint8_t* row0, const uint8_t* row1, uint8_t* dst,
+                   int bytes, int weight) {
+  const uint8x8_t inverse = vdup_n_u8(static_cast<uint8_t>(256 - weight));
+  const uint8x8_t w = vdup_n_u8(static_cast<uint8_t>(weight));
+  int i = 0;
+  for (; i + 16 <= bytes; i += 16) {
+    uint8x16_t a = vld1q_u8(row0 + i);
+    uint8x16_t b = vld1q_u8(row1 + i);
+    uint16x8_t lo = vmlal_u8(vmull_u8(vget_low_u8(a), inverse),
+                             vget_low_u8(b), w);
+    uint16x8_t hi = vmlal_u8(vmull_u8(vget_high_u8(a), inverse),
+                             vget_high_u8(b), w);
+    vst1q_u8(dst + i, vcombine_u8(vrshrn_n_u16(lo, 8), vrshrn_n_u16(hi, 8)));
+  }
+  BlendRowsScalar(row0 + i, row1 + i, dst + i, bytes - i, weight);
+}
+
+void AccumulateRowNeon(const uint8_t* row, uint16_t* acc, int bytes) {
+  int i = 0;
+  for (; i + 16 <= bytes; i += 16) {
+    uint8x16_t p = vld1q_u8(row + i);
+    vst1q_u16(acc + i, vaddw_u8(vld1q_u16(acc + i), vget_low_u8(p)));
+    vst1q_u16(acc + i + 8, vaddw_u8(vld1q_u16(acc + i + 8), vget_high_u8(p)));
+  }
+  AccumulateRowScalar(row + i, acc + i, bytes - i);
+}
+
+template <typename Src>
+constexpr PackedRowKernels MakeNeonRows() {
+  return {PackedToI420RowNeon<Src>, PackedToNV12RowNeon<Src>,
+          PackedToRgb24RowNeon<Src>, PackedToBgraRowNeon<Src>};
+}
+
+}  // namespace
+
+const ConverterKernels* GetNeonKernels() {
+  static const ConverterKernels kKernels = {
+      "neon", MakeNeonRows<YuyvTraits>(), MakeNeonRows<UyvyTraits>(),
+      BlendRowsNeon, AccumulateRowNeon};
+  return &kKernels;
+}
+
+#else
+
+const ConverterKernels* GetNeonKernels() {
+  return nullptr;
+}
+
+#endif  // V4L2_DEMO_HAVE_NEON
+
+}  // namespace internal
+}  // namespace v4l2_demo
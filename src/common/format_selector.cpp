@@ -0,0 +1,399 @@
+#include "format_selector.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <string>
+#include <tuple>
+
+#include "pixel_format_traits.h"
+
+namespace v4l2_demo {
+
+namespace {
+
+// 未指定 preferred_formats 时的格式优先级
+constexpr uint32_t kDefaultFormatOrder[] = {
+    V4L2_PIX_FMT_YUYV,  V4L2_PIX_FMT_UYVY, V4L2_PIX_FMT_NV12,
+    V4L2_PIX_FMT_YUV420, V4L2_PIX_FMT_MJPEG, V4L2_PIX_FMT_JPEG,
+};
+
+// UVC 等时传输每秒最大负载（字节）
+// 全速：1023 字节/ms；高速：3 x 1024 字节/微帧；超高速：48 KB/微帧
+constexpr uint64_t kUsbFullSpeedBandwidth = 1023ULL * 1000;
+constexpr uint64_t kUsbHighSpeedBandwidth = 3ULL * 1024 * 8000;
+constexpr uint64_t kUsbSuperSpeedBandwidth = 48ULL * 1024 * 8000;
+
+// 读取 sysfs 中的 USB speed（Mbps），不存在返回 0
+double ReadUsbSpeed(const std::string& directory) {
+  std::string path = directory + "/speed";
+  FILE* file = fopen(path.c_str(), "r");
+  if (!file) {
+    return 0;
+  }
+  double speed = 0;
+  if (fscanf(file, "%lf", &speed) != 1) {
+    speed = 0;
+  }
+  fclose(file);
+  return speed;
+}
+
+// 候选模式的排序键，数值越小越优先
+struct Candidate {
+  CaptureMode mode;
+  int size_rank;        // 0 与目标相同，1 大于目标，2 小于目标
+  double size_key;      // 同一档内的次序
+  int fps_rank;         // 0 满足 min_fps，1 帧率未知，2 不满足
+  double fps_key;
+  int transport_rank;   // 0 非压缩，1 压缩
+  size_t format_rank;   // 格式优先级
+
+  bool operator<(const Candidate& other) const {
+    return std::tie(size_rank, size_key, fps_rank, fps_key, transport_rank,
+                    format_rank) <
+           std::tie(other.size_rank, other.size_key, other.fps_rank,
+                    other.fps_key, other.transport_rank, other.format_rank);
+  }
+};
+
+size_t FormatRank(uint32_t pixel_format, const CaptureTarget& target) {
+  if (!target.preferred_formats.empty()) {
+    for (size_t i = 0; i < target.preferred_formats.size(); ++i) {
+      if (target.preferred_formats[i] == pixel_format) {
+        return i;
+      }
+    }
+    return target.preferred_formats.size();
+  }
+  size_t count = sizeof(kDefaultFormatOrder) / sizeof(kDefaultFormatOrder[0]);
+  for (size_t i = 0; i < count; ++i) {
+    if (kDefaultFormatOrder[i] == pixel_format) {
+      return i;
+    }
+  }
+  return count;
+}
+
+// 评估一个候选模式
+// @return 可用返回 true；非压缩格式超出总线带宽等情况返回 false
+bool EvaluateCandidate(const FormatCapability& cap, uint32_t width,
+                       uint32_t height, const FrameInterval* interval,
+                       const CaptureTarget& target, uint64_t bus_bandwidth,
+                       Candidate* candidate) {
+  uint64_t frame_size =
+      EstimateRawFrameSize(cap.pixel_format, width, height);
+  bool compressed = cap.compressed || frame_size == 0;
+  if (compressed && !target.allow_compressed) {
+    return false;
+  }
+
+  CaptureMode& mode = candidate->mode;
+  mode.pixel_format = cap.pixel_format;
+  mode.width = width;
+  mode.height = height;
+  mode.interval = interval ? *interval : FrameInterval{0, 0};
+  mode.fps = (interval && interval->numerator != 0)
+                 ? static_cast<double>(interval->denominator) /
+                       interval->numerator
+                 : 0;
+  mode.compressed = compressed;
+
+  // 帧率未知时按 min_fps 估算带宽
+  double fps_for_bandwidth = mode.fps > 0 ? mode.fps : target.min_fps;
+  mode.bandwidth =
+      compressed ? 0 : static_cast<uint64_t>(frame_size * fps_for_bandwidth);
+  if (!compressed && bus_bandwidth != 0 && mode.bandwidth > bus_bandwidth) {
+    return false;
+  }
+
+  uint64_t area = static_cast<uint64_t>(width) * height;
+  if (width == target.width && height == target.height) {
+    candidate->size_rank = 0;
+    candidate->size_key = 0;
+  } else if (width >= target.width && height >= target.height) {
+    candidate->size_rank = 1;
+    candidate->size_key = static_cast<double>(area);
+  } else {
+    candidate->size_rank = 2;
+    candidate->size_key = -static_cast<double>(area);
+  }
+
+  if (mode.fps <= 0) {
+    candidate->fps_rank = 1;
+    candidate->fps_key = 0;
+  } else if (mode.fps + 1e-3 >= target.min_fps) {
+    candidate->fps_rank = 0;
+    candidate->fps_key = mode.fps;
+  } else {
+    candidate->fps_rank = 2;
+    candidate->fps_key = -mode.fps;
+  }
+
+  candidate->transport_rank = compressed ? 1 : 0;
+  candidate->format_rank = FormatRank(cap.pixel_format, target);
+  return true;
+}
+
+
+// 把以 frame 为整幅画面（大小 width × height）的坐标系中的矩形换算到
+// frame 所在的坐标系
+struct v4l2_rect MapToFrame(const struct v4l2_rect& rect,
+                            const struct v4l2_rect& frame, uint32_t width,
+                            uint32_t height) {
+  struct v4l2_rect result;
+  result.left = frame.left + static_cast<int32_t>(
+                                 static_cast<int64_t>(rect.left) *
+                                 frame.width / width);
+  result.top = frame.top + static_cast<int32_t>(
+                               static_cast<int64_t>(rect.top) * frame.height /
+                               height);
+  result.width = static_cast<uint32_t>(
+      static_cast<uint64_t>(rect.width) * frame.width / width);
+  result.height = static_cast<uint32_t>(
+      static_cast<uint64_t>(rect.height) * frame.height / height);
+  return result;
+}
+
+bool RectEquals(const struct v4l2_rect& a, const struct v4l2_rect& b) {
+  return a.left == b.left && a.top == b.top && a.width == b.width &&
+         a.height == b.height;
+}
+
+bool RectContains(const struct v4l2_rect& outer,
+                  const struct v4l2_rect& inner) {
+  return inner.left >= outer.left && inner.top >= outer.top &&
+         static_cast<int64_t>(inner.left) + inner.width <=
+             static_cast<int64_t>(outer.left) + outer.width &&
+         static_cast<int64_t>(inner.top) + inner.height <=
+             static_cast<int64_t>(outer.top) + outer.height;
+}
+}  // namespace
+
+uint64_t EstimateBusBandwidth(const DeviceInfo& info) {
+  size_t slash = info.device_path.rfind('/');
+  std::string node = info.device_path.substr(
+      slash == std::string::npos ? 0 : slash + 1);
+  std::string link = "/sys/class/video4linux/" + node + "/device";
+
+  char resolved[PATH_MAX];
+  if (!realpath(link.c_str(), resolved)) {
+    return 0;
+  }
+
+  // UVC 节点的 device 指向 USB 接口，speed 位于其父目录（USB 设备）
+  std::string directory = resolved;
+  double speed = ReadUsbSpeed(directory);
+  if (speed == 0) {
+    slash = directory.rfind('/');
+    if (slash != std::string::npos) {
+      speed = ReadUsbSpeed(directory.substr(0, slash));
+    }
+  }
+
+  if (speed == 0) {
+    return 0;
+  }
+  if (speed < 480) {
+    return kUsbFullSpeedBandwidth;
+  }
+  if (speed < 5000) {
+    return kUsbHighSpeedBandwidth;
+  }
+  return kUsbSuperSpeedBandwidth;
+}
+
+uint64_t EstimateRawFrameSize(uint32_t pixel_format, uint32_t width,
+                              uint32_t height) {
+  return GetRawFrameSize(pixel_format, width, height);
+}
+
+bool SelectCaptureMode(const DeviceInfo& info, const CaptureTarget& target,
+                       CaptureMode* mode) {
+  if (!mode) {
+    return false;
+  }
+
+  uint64_t bus_bandwidth = target.bus_bandwidth != 0
+                               ? target.bus_bandwidth
+                               : EstimateBusBandwidth(info);
+
+  bool found = false;
+  Candidate best;
+  Candidate candidate;
+  auto consider = [&](const FormatCapability& cap, uint32_t width,
+                      uint32_t height, const FrameInterval* interval) {
+    if (EvaluateCandidate(cap, width, height, interval, target,
+                          bus_bandwidth, &candidate) &&
+        (!found || candidate < best)) {
+      best = candidate;
+      found = true;
+    }
+  };
+
+  for (const auto& cap : info.format_caps) {
+    // 驱动不支持枚举分辨率时，按目标分辨率尝试（由 S_FMT 调整）
+    if (cap.sizes.empty()) {
+      consider(cap, target.width, target.height, nullptr);
+      continue;
+    }
+    for (const auto& size : cap.sizes) {
+      if (size.intervals.empty()) {
+        consider(cap, size.width, size.height, nullptr);
+        continue;
+      }
+      for (const auto& interval : size.intervals) {
+        consider(cap, size.width, size.height, &interval);
+      }
+    }
+  }
+
+  if (found) {
+    *mode = best.mode;
+  }
+  return found;
+}
+
+bool ApplyCaptureMode(V4L2Device* device, const CaptureMode& mode) {
+  if (!device->SetFormat(mode.width, mode.height, mode.pixel_format)) {
+    return false;
+  }
+
+  if (mode.interval.numerator != 0) {
+    FrameInterval actual;
+    if (!device->SetFrameInterval(mode.interval, &actual)) {
+      fprintf(stderr, "警告: 无法设置帧率 %.2f fps，使用设备默认帧率\n",
+              mode.fps);
+    } else if (actual.numerator != 0 &&
+               static_cast<uint64_t>(actual.numerator) *
+                       mode.interval.denominator !=
+                   static_cast<uint64_t>(mode.interval.numerator) *
+                       actual.denominator) {
+      fprintf(stderr, "警告: 设备调整了帧率，请求 %.2f fps，实际 %.2f fps\n",
+              mode.fps,
+              static_cast<double>(actual.denominator) / actual.numerator);
+    }
+  }
+  return true;
+}
+
+bool ApplyScaleTarget(V4L2Device* device, const ScaleTarget& target,
+                      ScalePlan* plan) {
+  VideoFormat base;
+  if (!device->GetFormat(&base)) {
+    return false;
+  }
+  const uint32_t full_width = base.width;
+  const uint32_t full_height = base.height;
+  const struct v4l2_rect full = {0, 0, full_width, full_height};
+
+  struct v4l2_rect roi = target.roi;
+  if (roi.width == 0 || roi.height == 0) {
+    roi = full;
+  }
+  if (!RectContains(full, roi)) {
+    fprintf(stderr, "感兴趣区域 %ux%u+%d+%d 超出画面 %ux%u\n", roi.width,
+            roi.height, roi.left, roi.top, full_width, full_height);
+    return false;
+  }
+  const uint32_t output_width = target.width ? target.width : roi.width;
+  const uint32_t output_height = target.height ? target.height : roi.height;
+
+  // 当前格式对应传感器上的 original_crop；不支持选择 API 时两者坐标相同
+  struct v4l2_rect original_crop = full;
+  const bool has_selection =
+      device->GetSelection(V4L2_SEL_TGT_CROP, &original_crop) &&
+      original_crop.width > 0 && original_crop.height > 0;
+  const struct v4l2_rect sensor_roi =
+      MapToFrame(roi, original_crop, full_width, full_height);
+  const bool crop_requested = has_selection && !RectEquals(roi, full);
+
+  FrameInterval interval = {0, 0};
+  device->GetFrameInterval(&interval);
+
+  // 驱动先裁剪再缩放到 S_FMT 的分辨率；部分驱动在 S_FMT 时重置裁剪，
+  // 或者在 S_SELECTION 时把格式改为裁剪大小，因此格式之后再设置一次裁剪
+  if (crop_requested) {
+    device->SetSelection(V4L2_SEL_TGT_CROP, sensor_roi);
+  }
+  VideoFormat current;
+  if (device->GetFormat(&current) &&
+      (current.width != output_width || current.height != output_height)) {
+    device->SetFormat(output_width, output_height, base.pixel_format);
+    if (crop_requested) {
+      device->SetSelection(V4L2_SEL_TGT_CROP, sensor_roi);
+    }
+  }
+
+  // 读回驱动实际的格式与采集区域，算出 roi 在缓冲区中的位置
+  struct v4l2_rect crop = original_crop;
+  bool accepted = device->GetFormat(&current) &&
+                  current.pixel_format == base.pixel_format &&
+                  (!has_selection ||
+                   device->GetSelection(V4L2_SEL_TGT_CROP, &crop)) &&
+                  RectContains(crop, sensor_roi);
+  double scale_x = 0;
+  double scale_y = 0;
+  if (accepted) {
+    scale_x = static_cast<double>(current.width) / crop.width;
+    scale_y = static_cast<double>(current.height) / crop.height;
+    // 驱动缩得比需要的更小时画质损失无法弥补
+    accepted = floor(sensor_roi.width * scale_x) >=
+                   std::min(output_width, roi.width) &&
+               floor(sensor_roi.height * scale_y) >=
+                   std::min(output_height, roi.height);
+  }
+  if (!accepted) {
+    fprintf(stderr, "驱动无法完成裁剪与缩放，恢复 %ux%u 由软件处理\n",
+            full_width, full_height);
+    if (!device->SetFormat(full_width, full_height, base.pixel_format) ||
+        !device->GetFormat(&current)) {
+      return false;
+    }
+    if (has_selection) {
+      device->SetSelection(V4L2_SEL_TGT_CROP, original_crop);
+    }
+    crop = original_crop;
+    scale_x = static_cast<double>(current.width) / crop.width;
+    scale_y = static_cast<double>(current.height) / crop.height;
+  }
+
+  FrameInterval actual;
+  if (interval.numerator != 0 && device->GetFrameInterval(&actual) &&
+      static_cast<uint64_t>(actual.numerator) * interval.denominator !=
+          static_cast<uint64_t>(interval.numerator) * actual.denominator) {
+    device->SetFrameInterval(interval);
+  }
+
+  // 软件裁剪区域对齐到偶数，满足 YUV 格式的色度采样
+  uint32_t left = static_cast<uint32_t>(
+      floor((sensor_roi.left - crop.left) * scale_x)) & ~1u;
+  uint32_t top = static_cast<uint32_t>(
+      floor((sensor_roi.top - crop.top) * scale_y)) & ~1u;
+  uint32_t width = static_cast<uint32_t>(floor(sensor_roi.width * scale_x));
+  uint32_t height = static_cast<uint32_t>(floor(sensor_roi.height * scale_y));
+  width = std::min(width, current.width - left) & ~1u;
+  height = std::min(height, current.height - top) & ~1u;
+
+  plan->capture_width = current.width;
+  plan->capture_height = current.height;
+  plan->hardware_crop = has_selection && !RectEquals(crop, original_crop);
+  // 按原格式的像素密度，采集区域不缩放时应输出的分辨率
+  plan->hardware_scale =
+      current.width < static_cast<uint64_t>(crop.width) * full_width /
+                          original_crop.width ||
+      current.height < static_cast<uint64_t>(crop.height) * full_height /
+                           original_crop.height;
+  plan->software_crop.left = static_cast<int32_t>(left);
+  plan->software_crop.top = static_cast<int32_t>(top);
+  plan->software_crop.width = width;
+  plan->software_crop.height = height;
+  plan->output_width = output_width;
+  plan->output_height = output_height;
+  return true;
+}
+
+}  // namespace v4l2_demo
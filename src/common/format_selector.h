@@ -0,0 +1,112 @@
+#ifndef V4L2_DEMO_SRC_COMMON_FORMAT_SELECTOR_H_
+#define V4L2_DEMO_SRC_COMMON_FORMAT_SELECTOR_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "v4l2_utils.h"
+
+namespace v4l2_demo {
+
+// 捕获目标，如 "1080p @ ≥30fps"
+struct CaptureTarget {
+  uint32_t width = 640;   // 期望宽度
+  uint32_t height = 480;  // 期望高度
+  double min_fps = 30;    // 最低帧率
+  // 总线可用带宽（字节/秒），0 表示根据 sysfs 自动估计
+  uint64_t bus_bandwidth = 0;
+  bool allow_compressed = true;  // 非压缩格式放不下时是否允许 MJPEG 等压缩格式
+  // 同等条件下的格式优先级（靠前优先），为空时使用内置顺序
+  std::vector<uint32_t> preferred_formats;
+};
+
+// 选中的捕获模式
+struct CaptureMode {
+  uint32_t pixel_format;   // 像素格式
+  uint32_t width;          // 宽度
+  uint32_t height;         // 高度
+  FrameInterval interval;  // 帧间隔，numerator 为 0 表示驱动未报告（不设置帧率）
+  double fps;              // 帧率，未知时为 0
+  uint64_t bandwidth;      // 非压缩格式所需的总线带宽（字节/秒），压缩格式为 0
+  bool compressed;         // 是否为压缩格式
+};
+
+// 估计设备所在总线的等时传输带宽（字节/秒）
+// 读取 sysfs 中 USB 设备的 speed：USB 2.0 高速约 24.5 MB/s，
+// USB 3.x 约 393 MB/s；非 USB 设备（CSI、vivid 等）返回 0 表示不受限
+// @param info 设备信息（使用其中的 device_path）
+// @return 可用带宽，无法判断或不受限时返回 0
+uint64_t EstimateBusBandwidth(const DeviceInfo& info);
+
+// 估计非压缩格式每帧的字节数
+// @return 压缩或未知格式返回 0
+uint64_t EstimateRawFrameSize(uint32_t pixel_format, uint32_t width,
+                              uint32_t height);
+
+// 根据 format_caps 选择最贴近目标的格式、分辨率与帧率，排序规则依次为：
+// 1. 分辨率：与目标相同 > 大于目标中最小的 > 小于目标中最大的
+// 2. 帧率：满足 min_fps 中最低的 > 不满足时帧率最高的
+// 3. 传输：带宽放得下的非压缩格式 > 压缩格式；放不下的非压缩格式被排除
+// 4. 格式优先级
+// @param info 设备信息（需包含 format_caps）
+// @param target 捕获目标
+// @param mode 输出参数，选中的模式
+// @return 找到可用模式返回 true，否则返回 false
+bool SelectCaptureMode(const DeviceInfo& info, const CaptureTarget& target,
+                       CaptureMode* mode);
+
+// 应用捕获模式：VIDIOC_S_FMT 设置格式与分辨率，VIDIOC_S_PARM 设置帧率
+// 设备不支持设置帧率时只打印警告
+// @param device 已打开的设备
+// @param mode 捕获模式
+// @return 格式设置成功返回 true，失败返回 false
+bool ApplyCaptureMode(V4L2Device* device, const CaptureMode& mode);
+
+// 缩放目标：捕获后需要的画面为 roi 区域缩放到 width × height
+struct ScaleTarget {
+  uint32_t width = 0;   // 输出宽度，0 表示与 roi 相同（只裁剪）
+  uint32_t height = 0;  // 输出高度，0 表示与 roi 相同
+  // 感兴趣区域，坐标为调用时的格式分辨率下的像素，宽或高为 0 表示整个画面
+  struct v4l2_rect roi = {0, 0, 0, 0};
+};
+
+// 缩放方案：驱动完成的部分与软件仍需补做的部分
+struct ScalePlan {
+  uint32_t capture_width;   // 驱动输出的分辨率
+  uint32_t capture_height;
+  bool hardware_crop;       // 驱动通过 VIDIOC_S_SELECTION 完成了裁剪
+  bool hardware_scale;      // 驱动输出的分辨率小于其采集区域
+  // 捕获帧中 roi 所在的区域（缓冲区像素坐标，已对齐到偶数）
+  struct v4l2_rect software_crop;
+  uint32_t output_width;    // 最终输出尺寸
+  uint32_t output_height;
+
+  bool NeedsSoftwareCrop() const {
+    return software_crop.left != 0 || software_crop.top != 0 ||
+           software_crop.width != capture_width ||
+           software_crop.height != capture_height;
+  }
+  bool NeedsSoftwareScale() const {
+    return software_crop.width != output_width ||
+           software_crop.height != output_height;
+  }
+};
+
+// 让驱动尽量完成裁剪与缩放，减少总线与下游处理的数据量：
+// 1. VIDIOC_S_SELECTION(CROP) 在传感器上裁剪 roi
+// 2. VIDIOC_S_FMT 请求输出分辨率（像素格式不变），驱动可缩放时直接输出
+// 3. 读回实际格式与裁剪区域；像素格式改变、裁剪区域没有覆盖 roi 或
+//    分辨率低于需要时恢复原格式，全部交给软件
+// 驱动不支持选择 API 时假设缓冲区总是完整视场；帧率在改变格式后恢复
+// 需在 SetFormat（或 ApplyCaptureMode）之后、分配缓冲区之前调用，
+// 剩余的裁剪与缩放由 CropStage 与 ScaleStage 按 plan 完成
+// @param device 已设置格式的设备
+// @param target 缩放目标
+// @param plan 输出参数，缩放方案
+// @return 成功返回 true；roi 超出画面或读取格式失败返回 false
+bool ApplyScaleTarget(V4L2Device* device, const ScaleTarget& target,
+                      ScalePlan* plan);
+
+}  // namespace v4l2_demo
+
+#endif  // V4L2_DEMO_SRC_COMMON_FORMAT_SELECTOR_H_
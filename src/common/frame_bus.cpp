@@ -0,0 +1,750 @@
+#include "frame_bus.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/dma-buf.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <utility>
+
+namespace v4l2_demo {
+
+namespace {
+
+constexpr uint32_t kBusMagic = 0x56344246;  // "FB4V"
+constexpr uint32_t kBusVersion = 1;
+constexpr size_t kPageSize = 4096;
+constexpr size_t kPlaneAlignment = 64;
+
+// 一次 BeginRead 中因槽位正被覆盖而重试的次数
+constexpr int kMaxReadRetries = 4;
+
+// SCM_RIGHTS 单条消息最多携带的 fd 数（内核 SCM_MAX_FD）
+constexpr size_t kMaxPassedFds = 253;
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free &&
+                  std::atomic<uint64_t>::is_always_lock_free,
+              "跨进程共享的原子变量必须无锁");
+
+// 共享环头部，位于 memfd 起始处
+struct alignas(64) BusHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t mode;          // FrameBusMode
+  uint32_t slot_count;
+  uint64_t slot_size;     // 拷贝模式下每个槽位的数据区大小
+  uint64_t slots_offset;  // BusSlot 数组的偏移
+  uint64_t data_offset;   // 拷贝模式数据区的偏移
+  uint32_t width;
+  uint32_t height;
+  uint32_t pixel_format;
+  uint32_t plane_count;
+  uint32_t bytesperline[VIDEO_MAX_PLANES];
+  uint32_t buffer_count;  // DMABUF 模式下共享的设备缓冲区数量
+  std::atomic<uint64_t> publish_count;  // 已发布的帧数，写完槽位后才递增
+};
+
+// 每个槽位独占缓存行，避免相邻槽位的写入互相干扰
+struct alignas(64) BusSlot {
+  std::atomic<uint32_t> version;  // seqlock 版本号，奇数表示正在写入
+  uint32_t buffer_index;          // DMABUF 模式下的设备缓冲区索引
+  uint64_t frame_id;
+  uint32_t sequence;
+  uint32_t flags;
+  int64_t timestamp_us;
+  uint32_t plane_count;
+  // 拷贝模式为平面在槽位数据区内的偏移，DMABUF 模式为平面内的 data_offset
+  uint32_t plane_offset[VIDEO_MAX_PLANES];
+  uint32_t plane_size[VIDEO_MAX_PLANES];
+};
+
+// 握手消息，随消息传递 memfd（以及 DMABUF 模式下的缓冲区 fd）
+struct BusHello {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t region_size;
+  uint32_t fd_count;
+};
+
+size_t AlignUp(size_t value, size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+BusHeader* Header(void* region) {
+  return static_cast<BusHeader*>(region);
+}
+
+BusSlot* Slots(void* region) {
+  return reinterpret_cast<BusSlot*>(static_cast<uint8_t*>(region) +
+                                    Header(region)->slots_offset);
+}
+
+bool FillSocketAddress(const std::string& path, struct sockaddr_un* addr) {
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(addr->sun_path)) {
+    fprintf(stderr, "套接字路径无效: %s\n", path.c_str());
+    return false;
+  }
+  memcpy(addr->sun_path, path.c_str(), path.size());
+  return true;
+}
+
+}  // namespace
+
+FrameBusPublisher::FrameBusPublisher()
+    : device_(nullptr),
+      listen_fd_(-1),
+      memfd_(-1),
+      region_(nullptr),
+      region_size_(0),
+      slot_size_(0) {
+  memset(&format_, 0, sizeof(format_));
+  memset(&stats_, 0, sizeof(stats_));
+}
+
+FrameBusPublisher::~FrameBusPublisher() {
+  Close();
+}
+
+bool FrameBusPublisher::Init(V4L2Device* device,
+                             const FrameBusOptions& options) {
+  Close();
+  if (!device || !device->IsOpen() || options.slot_count == 0) {
+    return false;
+  }
+  device_ = device;
+  options_ = options;
+  memset(&stats_, 0, sizeof(stats_));
+
+  if (!device_->GetFormat(&format_)) {
+    return false;
+  }
+
+  uint32_t buffer_count = device_->GetBufferCount();
+  if (options_.mode == FrameBusMode::kDmaBuf) {
+    const FrameBuffer* first = device_->GetBuffer(0);
+    if (!first || first->dmabuf_fd < 0) {
+      fprintf(stderr, "DMABUF 模式需要先调用 InitDmaBuf\n");
+      return false;
+    }
+    // 发布者持有 slot_count 个租约，驱动至少还要留两个缓冲区轮转
+    if (buffer_count < options_.slot_count + 2) {
+      fprintf(stderr, "DMABUF 模式需要至少 %u 个设备缓冲区，当前 %u 个\n",
+              options_.slot_count + 2, buffer_count);
+      return false;
+    }
+    if (static_cast<size_t>(buffer_count) * first->plane_count + 1 >
+        kMaxPassedFds) {
+      fprintf(stderr, "DMABUF 数量过多，无法一次传递\n");
+      return false;
+    }
+  }
+
+  // 布局：头部 | 槽位元数据 | 拷贝模式的各槽位数据区（页对齐）
+  size_t slots_offset = AlignUp(sizeof(BusHeader), kPlaneAlignment);
+  size_t data_offset =
+      AlignUp(slots_offset + sizeof(BusSlot) * options_.slot_count, kPageSize);
+  slot_size_ = 0;
+  if (options_.mode == FrameBusMode::kCopy) {
+    for (uint32_t p = 0; p < format_.plane_count; ++p) {
+      slot_size_ += AlignUp(format_.sizeimage[p], kPlaneAlignment);
+    }
+    slot_size_ = AlignUp(slot_size_, kPageSize);
+  }
+  region_size_ = data_offset + slot_size_ * options_.slot_count;
+
+  memfd_ = memfd_create("v4l2_demo_frame_bus", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (memfd_ < 0) {
+    fprintf(stderr, "创建共享内存失败: %s\n", strerror(errno));
+    return false;
+  }
+  if (ftruncate(memfd_, region_size_) < 0) {
+    fprintf(stderr, "设置共享内存大小失败: %s\n", strerror(errno));
+    Close();
+    return false;
+  }
+  region_ = mmap(nullptr, region_size_, PROT_READ | PROT_WRITE, MAP_SHARED,
+                 memfd_, 0);
+  if (region_ == MAP_FAILED) {
+    region_ = nullptr;
+    fprintf(stderr, "映射共享内存失败: %s\n", strerror(errno));
+    Close();
+    return false;
+  }
+
+  // 读者不能改变大小（否则发布者写入时会 SIGBUS），也不能再以可写方式映射
+  int seals = F_SEAL_SHRINK | F_SEAL_GROW;
+#ifdef F_SEAL_FUTURE_WRITE
+  seals |= F_SEAL_FUTURE_WRITE;
+#endif
+  fcntl(memfd_, F_ADD_SEALS, seals | F_SEAL_SEAL);
+
+  BusHeader* header = new (region_) BusHeader();
+  header->magic = kBusMagic;
+  header->version = kBusVersion;
+  header->mode = static_cast<uint32_t>(options_.mode);
+  header->slot_count = options_.slot_count;
+  header->slot_size = slot_size_;
+  header->slots_offset = slots_offset;
+  header->data_offset = data_offset;
+  header->width = format_.width;
+  header->height = format_.height;
+  header->pixel_format = format_.pixel_format;
+  header->plane_count = format_.plane_count;
+  memcpy(header->bytesperline, format_.bytesperline,
+         sizeof(header->bytesperline));
+  header->buffer_count =
+      options_.mode == FrameBusMode::kDmaBuf ? buffer_count : 0;
+  header->publish_count.store(0, std::memory_order_relaxed);
+  BusSlot* slots = Slots(region_);
+  for (uint32_t i = 0; i < options_.slot_count; ++i) {
+    new (&slots[i]) BusSlot();
+  }
+  held_leases_.clear();
+  held_leases_.resize(options_.slot_count);
+
+  struct sockaddr_un addr;
+  if (!FillSocketAddress(options_.socket_path, &addr)) {
+    Close();
+    return false;
+  }
+  listen_fd_ = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                      0);
+  if (listen_fd_ < 0) {
+    fprintf(stderr, "创建套接字失败: %s\n", strerror(errno));
+    Close();
+    return false;
+  }
+  unlink(options_.socket_path.c_str());  // 上次异常退出留下的套接字文件
+  if (bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr),
+           sizeof(addr)) < 0 ||
+      listen(listen_fd_, options_.max_clients) < 0) {
+    fprintf(stderr, "监听 %s 失败: %s\n", options_.socket_path.c_str(),
+            strerror(errno));
+    Close();
+    return false;
+  }
+  return true;
+}
+
+bool FrameBusPublisher::SendHandshake(int client_fd) {
+  std::vector<int> fds;
+  fds.push_back(memfd_);
+  if (options_.mode == FrameBusMode::kDmaBuf) {
+    for (uint32_t i = 0; i < device_->GetBufferCount(); ++i) {
+      const FrameBuffer* buffer = device_->GetBuffer(i);
+      for (uint32_t p = 0; p < buffer->plane_count; ++p) {
+        fds.push_back(buffer->planes[p].dmabuf_fd);
+      }
+    }
+  }
+
+  BusHello hello;
+  memset(&hello, 0, sizeof(hello));
+  hello.magic = kBusMagic;
+  hello.version = kBusVersion;
+  hello.region_size = region_size_;
+  hello.fd_count = fds.size();
+
+  struct iovec iov;
+  iov.iov_base = &hello;
+  iov.iov_len = sizeof(hello);
+
+  std::vector<char> control(CMSG_SPACE(sizeof(int) * fds.size()));
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.data();
+  msg.msg_controllen = control.size();
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+  memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+
+  if (sendmsg(client_fd, &msg, MSG_NOSIGNAL) < 0) {
+    fprintf(stderr, "发送帧总线握手失败: %s\n", strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+void FrameBusPublisher::ProcessEvents() {
+  if (listen_fd_ < 0) {
+    return;
+  }
+  while (true) {
+    int client_fd = accept4(listen_fd_, nullptr, nullptr,
+                            SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (client_fd < 0) {
+      if (errno != EAGAIN && errno != EINTR) {
+        fprintf(stderr, "接受读者连接失败: %s\n", strerror(errno));
+      }
+      return;
+    }
+    if (clients_.size() >= options_.max_clients ||
+        !SendHandshake(client_fd)) {
+      close(client_fd);
+      continue;
+    }
+    clients_.push_back(client_fd);
+    stats_.accepted++;
+  }
+}
+
+void FrameBusPublisher::NotifyClients(uint64_t frame_id) {
+  for (size_t i = 0; i < clients_.size();) {
+    // 读者处理慢导致套接字缓冲区满时跳过通知，读者靠 publish_count 追上
+    if (send(clients_[i], &frame_id, sizeof(frame_id),
+             MSG_DONTWAIT | MSG_NOSIGNAL) < 0 &&
+        errno != EAGAIN) {
+      close(clients_[i]);
+      clients_[i] = clients_.back();
+      clients_.pop_back();
+      continue;
+    }
+    ++i;
+  }
+}
+
+bool FrameBusPublisher::Publish(FrameLease* lease) {
+  FrameLease frame(std::move(*lease));
+  if (!region_ || !frame.IsValid()) {
+    return false;
+  }
+
+  ProcessEvents();
+
+  BusHeader* header = Header(region_);
+  uint64_t frame_id = header->publish_count.load(std::memory_order_relaxed);
+  uint32_t slot_index = frame_id % options_.slot_count;
+  BusSlot& slot = Slots(region_)[slot_index];
+
+  const FrameBuffer* buffer = device_->GetBuffer(frame.index());
+  uint32_t plane_count = std::min(frame.plane_count(),
+                                  static_cast<uint32_t>(VIDEO_MAX_PLANES));
+  if (options_.mode == FrameBusMode::kDmaBuf) {
+    if (!buffer || frame.dmabuf_fd() < 0 ||
+        plane_count > buffer->plane_count) {
+      stats_.dropped++;
+      return false;
+    }
+  } else {
+    size_t total = 0;
+    for (uint32_t p = 0; p < plane_count; ++p) {
+      if (!frame.plane_data(p)) {
+        stats_.dropped++;
+        return false;
+      }
+      total += AlignUp(frame.plane_size(p), kPlaneAlignment);
+    }
+    if (total > slot_size_) {
+      stats_.dropped++;
+      return false;
+    }
+  }
+
+  // seqlock 写端：版本号变为奇数后才能改动槽位
+  uint32_t version = slot.version.load(std::memory_order_relaxed);
+  slot.version.store(version + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  slot.frame_id = frame_id;
+  slot.sequence = frame.sequence();
+  slot.flags = frame.flags();
+  slot.timestamp_us = frame.timestamp_us();
+  slot.plane_count = plane_count;
+  if (options_.mode == FrameBusMode::kDmaBuf) {
+    // 槽位原来引用的缓冲区此时才交还驱动：版本号已是奇数，
+    // 仍在读它的读者在 EndRead 时会发现被覆盖
+    held_leases_[slot_index].Release();
+    slot.buffer_index = frame.index();
+    for (uint32_t p = 0; p < plane_count; ++p) {
+      const uint8_t* start =
+          static_cast<const uint8_t*>(buffer->planes[p].start);
+      const uint8_t* data = static_cast<const uint8_t*>(frame.plane_data(p));
+      slot.plane_offset[p] = (start && data) ? data - start : 0;
+      slot.plane_size[p] = frame.plane_size(p);
+    }
+    held_leases_[slot_index] = std::move(frame);
+  } else {
+    uint8_t* dst = static_cast<uint8_t*>(region_) + header->data_offset +
+                   slot_size_ * slot_index;
+    size_t offset = 0;
+    for (uint32_t p = 0; p < plane_count; ++p) {
+      memcpy(dst + offset, frame.plane_data(p), frame.plane_size(p));
+      slot.plane_offset[p] = offset;
+      slot.plane_size[p] = frame.plane_size(p);
+      offset += AlignUp(frame.plane_size(p), kPlaneAlignment);
+    }
+    frame.Release();  // 数据已拷贝，立即交还驱动
+  }
+
+  slot.version.store(version + 2, std::memory_order_release);
+  header->publish_count.store(frame_id + 1, std::memory_order_release);
+  stats_.published++;
+
+  NotifyClients(frame_id);
+  return true;
+}
+
+void FrameBusPublisher::Close() {
+  for (int fd : clients_) {
+    close(fd);
+  }
+  clients_.clear();
+
+  if (region_) {
+    // 槽位永久标记为正在写入，之后读者不会再读到即将被驱动覆盖的缓冲区
+    BusSlot* slots = Slots(region_);
+    for (uint32_t i = 0; i < options_.slot_count; ++i) {
+      uint32_t version = slots[i].version.load(std::memory_order_relaxed);
+      if (!(version & 1)) {
+        slots[i].version.store(version + 1, std::memory_order_release);
+      }
+    }
+  }
+  held_leases_.clear();
+
+  if (listen_fd_ >= 0) {
+    close(listen_fd_);
+    listen_fd_ = -1;
+    unlink(options_.socket_path.c_str());
+  }
+  if (region_) {
+    munmap(region_, region_size_);
+    region_ = nullptr;
+  }
+  if (memfd_ >= 0) {
+    close(memfd_);
+    memfd_ = -1;
+  }
+}
+
+void FrameBusPublisher::GetStats(FrameBusStats* stats) const {
+  *stats = stats_;
+  stats->clients = clients_.size();
+}
+
+FrameBusReader::FrameBusReader()
+    : socket_fd_(-1),
+      region_(nullptr),
+      region_size_(0),
+      next_frame_id_(0),
+      started_(false) {
+  memset(&stats_, 0, sizeof(stats_));
+}
+
+FrameBusReader::~FrameBusReader() {
+  Close();
+}
+
+bool FrameBusReader::Connect(const std::string& socket_path) {
+  Close();
+
+  struct sockaddr_un addr;
+  if (!FillSocketAddress(socket_path, &addr)) {
+    return false;
+  }
+  socket_fd_ = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (socket_fd_ < 0) {
+    fprintf(stderr, "创建套接字失败: %s\n", strerror(errno));
+    return false;
+  }
+  if (connect(socket_fd_, reinterpret_cast<struct sockaddr*>(&addr),
+              sizeof(addr)) < 0) {
+    fprintf(stderr, "连接 %s 失败: %s\n", socket_path.c_str(),
+            strerror(errno));
+    Close();
+    return false;
+  }
+
+  // 阻塞接收握手消息与 fd
+  BusHello hello;
+  struct iovec iov;
+  iov.iov_base = &hello;
+  iov.iov_len = sizeof(hello);
+  std::vector<char> control(CMSG_SPACE(sizeof(int) * kMaxPassedFds));
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.data();
+  msg.msg_controllen = control.size();
+
+  ssize_t received = recvmsg(socket_fd_, &msg, MSG_CMSG_CLOEXEC);
+  std::vector<int> fds;
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+       cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+      size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      const int* data = reinterpret_cast<const int*>(CMSG_DATA(cmsg));
+      fds.insert(fds.end(), data, data + count);
+    }
+  }
+  auto close_fds = [&fds]() {
+    for (int fd : fds) {
+      close(fd);
+    }
+  };
+  if (received != static_cast<ssize_t>(sizeof(hello)) ||
+      hello.magic != kBusMagic || hello.version != kBusVersion ||
+      fds.empty() || fds.size() != hello.fd_count) {
+    fprintf(stderr, "帧总线握手失败\n");
+    close_fds();
+    Close();
+    return false;
+  }
+
+  region_size_ = hello.region_size;
+  region_ = mmap(nullptr, region_size_, PROT_READ, MAP_SHARED, fds[0], 0);
+  close(fds[0]);
+  if (region_ == MAP_FAILED) {
+    region_ = nullptr;
+    fprintf(stderr, "映射共享内存失败: %s\n", strerror(errno));
+    fds.erase(fds.begin());
+    close_fds();
+    Close();
+    return false;
+  }
+
+  // DMABUF 模式：逐个映射设备缓冲区的平面
+  const BusHeader* header = Header(region_);
+  for (size_t i = 1; i < fds.size(); ++i) {
+    MappedPlane plane;
+    plane.fd = fds[i];
+    off_t length = lseek(plane.fd, 0, SEEK_END);
+    plane.length = length > 0 ? length : 0;
+    plane.start = plane.length > 0 ? mmap(nullptr, plane.length, PROT_READ,
+                                          MAP_SHARED, plane.fd, 0)
+                                   : MAP_FAILED;
+    if (plane.start == MAP_FAILED) {
+      plane.start = nullptr;
+    }
+    planes_.push_back(plane);
+  }
+  if (header->mode == static_cast<uint32_t>(FrameBusMode::kDmaBuf) &&
+      planes_.size() !=
+          static_cast<size_t>(header->buffer_count) * header->plane_count) {
+    fprintf(stderr, "帧总线 DMABUF 数量不匹配\n");
+    Close();
+    return false;
+  }
+
+  next_frame_id_ = 0;
+  started_ = false;
+  memset(&stats_, 0, sizeof(stats_));
+  return true;
+}
+
+void FrameBusReader::Close() {
+  for (auto& plane : planes_) {
+    if (plane.start) {
+      munmap(plane.start, plane.length);
+    }
+    close(plane.fd);
+  }
+  planes_.clear();
+  if (region_) {
+    munmap(region_, region_size_);
+    region_ = nullptr;
+  }
+  if (socket_fd_ >= 0) {
+    close(socket_fd_);
+    socket_fd_ = -1;
+  }
+}
+
+bool FrameBusReader::DrainNotifications() {
+  uint64_t frame_id;
+  while (true) {
+    ssize_t ret = recv(socket_fd_, &frame_id, sizeof(frame_id), MSG_DONTWAIT);
+    if (ret > 0) {
+      continue;
+    }
+    if (ret == 0) {
+      return false;  // 发布者已关闭
+    }
+    return errno == EAGAIN || errno == EINTR;
+  }
+}
+
+bool FrameBusReader::WaitForFrame(int timeout_ms) {
+  if (!region_ || socket_fd_ < 0) {
+    return false;
+  }
+  uint64_t count =
+      Header(region_)->publish_count.load(std::memory_order_acquire);
+  if (started_ && next_frame_id_ < count) {
+    return true;
+  }
+
+  struct pollfd pfd;
+  pfd.fd = socket_fd_;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  int ret;
+  do {
+    ret = poll(&pfd, 1, timeout_ms);
+  } while (ret < 0 && errno == EINTR);
+  if (ret <= 0) {
+    return false;
+  }
+  if (!DrainNotifications()) {
+    fprintf(stderr, "帧总线发布者已断开\n");
+    close(socket_fd_);
+    socket_fd_ = -1;
+    return false;
+  }
+  return true;
+}
+
+void FrameBusReader::SyncBuffer(int buffer_index, uint64_t flags) {
+  if (buffer_index < 0) {
+    return;
+  }
+  uint32_t plane_count = Header(region_)->plane_count;
+  for (uint32_t p = 0; p < plane_count; ++p) {
+    const MappedPlane& plane = planes_[buffer_index * plane_count + p];
+    struct dma_buf_sync sync;
+    sync.flags = flags;
+    ioctl(plane.fd, DMA_BUF_IOCTL_SYNC, &sync);
+  }
+}
+
+bool FrameBusReader::BeginRead(FrameView* view) {
+  if (!region_ || !view) {
+    return false;
+  }
+  if (socket_fd_ >= 0 && !DrainNotifications()) {
+    close(socket_fd_);
+    socket_fd_ = -1;
+  }
+
+  const BusHeader* header = Header(region_);
+  const BusSlot* slots = Slots(region_);
+  bool dmabuf = header->mode == static_cast<uint32_t>(FrameBusMode::kDmaBuf);
+
+  for (int attempt = 0; attempt < kMaxReadRetries; ++attempt) {
+    uint64_t count = header->publish_count.load(std::memory_order_acquire);
+    if (count == 0) {
+      return false;
+    }
+    // 第一次读取从最新一帧开始；落后超过一圈时跳到最新帧
+    if (!started_) {
+      next_frame_id_ = count - 1;
+      started_ = true;
+    }
+    if (next_frame_id_ >= count) {
+      return false;
+    }
+    if (count - next_frame_id_ > header->slot_count) {
+      stats_.overruns += count - 1 - next_frame_id_;
+      next_frame_id_ = count - 1;
+    }
+
+    uint32_t slot_index = next_frame_id_ % header->slot_count;
+    const BusSlot& slot = slots[slot_index];
+    uint32_t version = slot.version.load(std::memory_order_acquire);
+    if (version & 1) {
+      continue;  // 正被下一圈覆盖
+    }
+
+    FrameView result;
+    memset(&result, 0, sizeof(result));
+    result.frame_id = slot.frame_id;
+    result.sequence = slot.sequence;
+    result.flags = slot.flags;
+    result.timestamp_us = slot.timestamp_us;
+    result.width = header->width;
+    result.height = header->height;
+    result.pixel_format = header->pixel_format;
+    result.plane_count = std::min(slot.plane_count, header->plane_count);
+    result.slot_ = slot_index;
+    result.version_ = version;
+    result.buffer_index_ = -1;
+    uint32_t buffer_index = slot.buffer_index;
+    uint32_t plane_offset[VIDEO_MAX_PLANES];
+    memcpy(plane_offset, slot.plane_offset, sizeof(plane_offset));
+    for (uint32_t p = 0; p < result.plane_count; ++p) {
+      result.plane_size[p] = slot.plane_size[p];
+      result.bytesperline[p] = header->bytesperline[p];
+    }
+
+    // 元数据读完后再次确认版本号，保证元数据本身没有被撕裂
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.version.load(std::memory_order_relaxed) != version ||
+        result.frame_id != next_frame_id_) {
+      continue;
+    }
+
+    bool valid = true;
+    if (dmabuf) {
+      if (buffer_index >= header->buffer_count) {
+        valid = false;
+      }
+      for (uint32_t p = 0; valid && p < result.plane_count; ++p) {
+        const MappedPlane& plane =
+            planes_[buffer_index * header->plane_count + p];
+        valid = plane.start &&
+                plane_offset[p] + result.plane_size[p] <= plane.length;
+        if (valid) {
+          result.plane_data[p] =
+              static_cast<const uint8_t*>(plane.start) + plane_offset[p];
+        }
+      }
+      result.buffer_index_ = buffer_index;
+    } else {
+      const uint8_t* base = static_cast<const uint8_t*>(region_) +
+                            header->data_offset +
+                            header->slot_size * slot_index;
+      for (uint32_t p = 0; valid && p < result.plane_count; ++p) {
+        valid = plane_offset[p] + result.plane_size[p] <= header->slot_size;
+        result.plane_data[p] = base + plane_offset[p];
+      }
+    }
+
+    next_frame_id_++;
+    if (!valid) {
+      stats_.torn++;
+      return false;
+    }
+    if (dmabuf) {
+      SyncBuffer(result.buffer_index_, DMA_BUF_SYNC_START | DMA_BUF_SYNC_READ);
+    }
+    *view = result;
+    stats_.frames++;
+    return true;
+  }
+  return false;
+}
+
+bool FrameBusReader::EndRead(const FrameView& view) {
+  if (!region_) {
+    return false;
+  }
+  SyncBuffer(view.buffer_index_, DMA_BUF_SYNC_END | DMA_BUF_SYNC_READ);
+
+  // seqlock 读端：读取期间版本号未变化，数据才有效
+  std::atomic_thread_fence(std::memory_order_acquire);
+  const BusSlot& slot = Slots(region_)[view.slot_];
+  if (slot.version.load(std::memory_order_relaxed) != view.version_) {
+    stats_.torn++;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace v4l2_demo
@@ -0,0 +1,206 @@
+#ifndef V4L2_DEMO_SRC_COMMON_FRAME_BUS_H_
+#define V4L2_DEMO_SRC_COMMON_FRAME_BUS_H_
+
+#include <linux/videodev2.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "v4l2_utils.h"
+
+namespace v4l2_demo {
+
+// 帧总线的数据共享方式
+enum class FrameBusMode {
+  // 发布者把每帧拷贝一次到 memfd 共享内存环，任意数量的读者直接读取，
+  // 适用于任何内存类型；租约在拷贝后立即释放
+  kCopy,
+  // 读者映射设备导出的 DMABUF（需要 InitDmaBuf），共享环中只放元数据，
+  // 像素不经任何拷贝；发布者持有最近 slot_count 帧的租约，
+  // 因此设备缓冲区数量需大于 slot_count + 1
+  kDmaBuf,
+};
+
+// 帧总线发布者配置
+struct FrameBusOptions {
+  std::string socket_path = "/tmp/v4l2_demo_frame_bus.sock";  // Unix 套接字
+  FrameBusMode mode = FrameBusMode::kCopy;
+  uint32_t slot_count = 4;  // 环形槽位数量
+  uint32_t max_clients = 8;
+};
+
+// 帧总线发布者统计
+struct FrameBusStats {
+  uint64_t published;   // 已发布的帧数
+  uint64_t dropped;     // 发布失败（帧过大/无 DMABUF）的帧数
+  uint64_t clients;     // 当前连接的读者数
+  uint64_t accepted;    // 累计接入的读者数
+};
+
+// 读者看到的一帧（指向共享内存或 DMABUF 映射，不拷贝）
+// 在 EndRead 返回 true 之前读到的内容都可能已被覆盖，不能作为结论使用
+struct FrameView {
+  uint64_t frame_id;       // 发布序号，从 0 开始连续递增
+  uint32_t sequence;       // 驱动帧序号
+  uint32_t flags;          // v4l2_buffer.flags
+  int64_t timestamp_us;    // 驱动时间戳
+  uint32_t width;
+  uint32_t height;
+  uint32_t pixel_format;
+  uint32_t plane_count;
+  const void* plane_data[VIDEO_MAX_PLANES];
+  size_t plane_size[VIDEO_MAX_PLANES];
+  uint32_t bytesperline[VIDEO_MAX_PLANES];
+
+  // 第 0 个平面，单内存平面格式即整帧数据
+  const void* data() const { return plane_data[0]; }
+  size_t size() const { return plane_size[0]; }
+
+ private:
+  friend class FrameBusReader;
+  uint32_t slot_;      // 所在槽位
+  uint32_t version_;   // BeginRead 时的槽位 seqlock 版本
+  int buffer_index_;   // DMABUF 模式下的设备缓冲区索引，-1 表示无
+};
+
+// 帧总线读者统计
+struct FrameBusReaderStats {
+  uint64_t frames;    // BeginRead 成功的帧数
+  uint64_t torn;      // EndRead 检测到读取期间被覆盖的帧数
+  uint64_t overruns;  // 读得太慢、被发布者套圈而跳过的帧数
+};
+
+// 共享内存帧总线发布者：一个 V4L2Device 的帧扇出给 N 个进程，不做 N 次拷贝
+// 共享环放在 memfd 中，读者通过 Unix 套接字连接，以 SCM_RIGHTS 取得 memfd
+// （以及 DMABUF 模式下每个缓冲区每个平面的 DMABUF fd）后只读映射
+// 每个槽位带一个 seqlock：写入前版本号变为奇数，写完变为偶数；
+// 读者在读取前后比较版本号判断数据是否被覆盖，发布者从不等待读者
+// 每发布一帧向各读者套接字发送一个非阻塞通知，读者可用 poll/epoll 等待
+// 非线程安全：Publish 与 ProcessEvents 需在同一线程调用
+class FrameBusPublisher {
+ public:
+  FrameBusPublisher();
+  ~FrameBusPublisher();
+
+  FrameBusPublisher(const FrameBusPublisher&) = delete;
+  FrameBusPublisher& operator=(const FrameBusPublisher&) = delete;
+
+  // 创建共享环并开始监听（设备需已设置格式并完成缓冲区初始化）
+  // @param device 捕获设备
+  // @param options 配置
+  // @return 成功返回 true；DMABUF 模式下设备未导出 DMABUF 或缓冲区不足时
+  //         返回 false
+  bool Init(V4L2Device* device, const FrameBusOptions& options);
+
+  // 发布一帧，租约总是被转移走
+  // @param lease 帧租约
+  // @return 成功返回 true，失败返回 false
+  bool Publish(FrameLease* lease);
+
+  // 接入新的读者（非阻塞，Publish 内部也会调用）
+  void ProcessEvents();
+
+  // 断开所有读者，释放持有的租约并删除套接字文件
+  void Close();
+
+  // 获取监听套接字（可读表示有读者连接，用于 poll/epoll）
+  int GetFileDescriptor() const { return listen_fd_; }
+
+  // 获取统计信息
+  void GetStats(FrameBusStats* stats) const;
+
+ private:
+  V4L2Device* device_;
+  FrameBusOptions options_;
+  int listen_fd_;
+  int memfd_;
+  void* region_;          // 共享环映射
+  size_t region_size_;
+  size_t slot_size_;      // 拷贝模式下每个槽位的数据区大小
+  VideoFormat format_;
+  std::vector<int> clients_;
+  std::vector<FrameLease> held_leases_;  // DMABUF 模式下各槽位持有的租约
+  FrameBusStats stats_;
+
+  // 向新读者发送共享环与 DMABUF 的 fd
+  bool SendHandshake(int client_fd);
+
+  // 通知所有读者有新帧，断开已关闭的读者
+  void NotifyClients(uint64_t frame_id);
+};
+
+// 共享内存帧总线读者（在另一个进程中使用）
+// 读取方式与 seqlock 读端一致：
+//   FrameView view;
+//   if (reader.BeginRead(&view)) {
+//     Process(view.data(), view.size());  // 直接读共享内存
+//     if (!reader.EndRead(view)) { /* 读取期间被覆盖，丢弃结果 */ }
+//   }
+// 读得比发布慢时会跳到最新帧，并计入 overruns
+class FrameBusReader {
+ public:
+  FrameBusReader();
+  ~FrameBusReader();
+
+  FrameBusReader(const FrameBusReader&) = delete;
+  FrameBusReader& operator=(const FrameBusReader&) = delete;
+
+  // 连接发布者并映射共享环
+  // @param socket_path 发布者的 Unix 套接字路径
+  // @return 成功返回 true，失败返回 false
+  bool Connect(const std::string& socket_path);
+
+  // 断开连接并解除映射
+  void Close();
+
+  // 等待新帧通知
+  // @param timeout_ms 超时时间（毫秒），-1 表示无限等待
+  // @return 有新帧返回 true；超时、发布者断开或失败返回 false
+  bool WaitForFrame(int timeout_ms);
+
+  // 开始读取下一帧（非阻塞）
+  // @param view 输出参数，帧视图
+  // @return 有可读的帧返回 true，否则返回 false
+  bool BeginRead(FrameView* view);
+
+  // 结束读取
+  // @return 读取期间槽位未被覆盖返回 true；被覆盖返回 false，读到的数据无效
+  bool EndRead(const FrameView& view);
+
+  // 发布者是否仍在连接
+  bool IsConnected() const { return socket_fd_ >= 0; }
+
+  // 获取套接字（可读表示有新帧通知，用于 poll/epoll）
+  int GetFileDescriptor() const { return socket_fd_; }
+
+  // 获取统计信息
+  void GetStats(FrameBusReaderStats* stats) const { *stats = stats_; }
+
+ private:
+  // DMABUF 模式下映射的一个设备缓冲区平面
+  struct MappedPlane {
+    int fd;
+    void* start;
+    size_t length;
+  };
+
+  int socket_fd_;
+  void* region_;
+  size_t region_size_;
+  uint64_t next_frame_id_;  // 下一帧的发布序号
+  bool started_;            // 是否已定位到第一帧
+  std::vector<MappedPlane> planes_;  // 按 缓冲区索引 * 平面数 + 平面 排列
+  FrameBusReaderStats stats_;
+
+  // 读取套接字中的全部通知（非阻塞）
+  // @return 发布者断开时返回 false
+  bool DrainNotifications();
+
+  // DMABUF 读取前后的缓存同步
+  void SyncBuffer(int buffer_index, uint64_t flags);
+};
+
+}  // namespace v4l2_demo
+
+#endif  // V4L2_DEMO_SRC_COMMON_FRAME_BUS_H_
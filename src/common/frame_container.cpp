@@ -0,0 +1,433 @@
+#include "frame_container.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace v4l2_demo {
+
+namespace {
+
+constexpr uint32_t kFileMagic = 0x4334564C;    // "LV4C"
+constexpr uint32_t kRecordMagic = 0x4D524646;  // "FFRM"
+constexpr uint32_t kIndexMagic = 0x58444E49;   // "INDX"
+constexpr uint32_t kContainerVersion = 1;
+
+// 帧记录与帧数据的对齐，便于读者直接在映射上做 SIMD 处理
+constexpr size_t kRecordAlignment = 64;
+
+// 分段文件头
+struct FileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t header_size;  // 第一条帧记录的偏移
+  uint32_t pixel_format;
+  uint32_t width;
+  uint32_t height;
+  uint32_t bytes_per_line;
+  uint32_t segment;
+  int64_t created_time_us;  // 创建时间（CLOCK_REALTIME）
+  uint8_t reserved[24];
+};
+
+// 帧记录头，后面紧跟帧数据（补齐到 kRecordAlignment）
+struct RecordHeader {
+  uint32_t magic;
+  uint32_t size;  // 帧数据大小（不含补齐）
+  int64_t timestamp_us;
+  uint32_t sequence;
+  uint32_t flags;
+  uint8_t reserved[40];
+};
+
+// 索引尾，位于文件最后
+struct IndexFooter {
+  uint32_t magic;
+  uint32_t entry_count;
+  uint64_t index_offset;  // 索引在文件中的偏移
+  uint8_t reserved[16];
+};
+
+static_assert(sizeof(FileHeader) == kRecordAlignment, "文件头须为 64 字节");
+static_assert(sizeof(RecordHeader) == kRecordAlignment, "记录头须为 64 字节");
+static_assert(sizeof(ContainerIndexEntry) == 24, "索引项布局改变");
+
+// 补齐用的零字节
+const uint8_t kPadding[kRecordAlignment] = {};
+
+size_t AlignUp(size_t value, size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+int64_t RealtimeMicros() {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+bool FileExists(const std::string& path) {
+  struct stat st;
+  return stat(path.c_str(), &st) == 0;
+}
+}  // namespace
+
+ContainerWriter::ContainerWriter()
+    : fd_(-1), segment_(0), segments_(0), offset_(0), frames_(0), bytes_(0) {}
+
+ContainerWriter::~ContainerWriter() {
+  Close();
+}
+
+std::string ContainerWriter::SegmentPath(const std::string& path_prefix,
+                                         uint32_t segment) {
+  char suffix[32];
+  snprintf(suffix, sizeof(suffix), "_%04u.v4lc", segment);
+  return path_prefix + suffix;
+}
+
+bool ContainerWriter::Open(const ContainerWriterOptions& options) {
+  Close();
+  options_ = options;
+  frames_ = 0;
+  bytes_ = 0;
+  segments_ = 0;
+
+  // 接着已有分段编号，之前的录制不会被覆盖
+  uint32_t segment = 0;
+  while (FileExists(SegmentPath(options_.path_prefix, segment))) {
+    ++segment;
+  }
+  return OpenSegment(segment);
+}
+
+bool ContainerWriter::OpenSegment(uint32_t segment) {
+  std::string path = SegmentPath(options_.path_prefix, segment);
+  fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+  if (fd_ < 0) {
+    fprintf(stderr, "无法创建录制分段 %s: %s\n", path.c_str(),
+            strerror(errno));
+    return false;
+  }
+
+  FileHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = kFileMagic;
+  header.version = kContainerVersion;
+  header.header_size = sizeof(header);
+  header.pixel_format = options_.pixel_format;
+  header.width = options_.width;
+  header.height = options_.height;
+  header.bytes_per_line = options_.bytes_per_line;
+  header.segment = segment;
+  header.created_time_us = RealtimeMicros();
+
+  struct iovec iov = {&header, sizeof(header)};
+  segment_ = segment;
+  offset_ = 0;
+  index_.clear();
+  if (!WriteAll(&iov, 1, sizeof(header))) {
+    close(fd_);
+    fd_ = -1;
+    return false;
+  }
+  ++segments_;
+
+  // 保留最近 max_segments 个分段
+  if (options_.max_segments > 0 && segment >= options_.max_segments) {
+    std::string old_path =
+        SegmentPath(options_.path_prefix, segment - options_.max_segments);
+    if (unlink(old_path.c_str()) < 0 && errno != ENOENT) {
+      fprintf(stderr, "删除旧分段 %s 失败: %s\n", old_path.c_str(),
+              strerror(errno));
+    }
+  }
+  return true;
+}
+
+bool ContainerWriter::WriteFrame(const void* data, size_t size,
+                                 int64_t timestamp_us, uint32_t sequence,
+                                 uint32_t flags) {
+  if (fd_ < 0 || !data || size > UINT32_MAX) {
+    return false;
+  }
+
+  size_t padded_size = AlignUp(size, kRecordAlignment);
+  uint64_t record_size = sizeof(RecordHeader) + padded_size;
+  uint64_t index_size =
+      (index_.size() + 1) * sizeof(ContainerIndexEntry) + sizeof(IndexFooter);
+  bool segment_full =
+      offset_ + record_size + index_size > options_.max_segment_bytes ||
+      (options_.max_segment_frames > 0 &&
+       index_.size() >= options_.max_segment_frames);
+  // 空分段总是至少写入一帧，单帧超过上限时也不会无限切换
+  if (!index_.empty() && segment_full) {
+    if (!FinishSegment() || !OpenSegment(segment_ + 1)) {
+      return false;
+    }
+  }
+
+  RecordHeader record;
+  memset(&record, 0, sizeof(record));
+  record.magic = kRecordMagic;
+  record.size = size;
+  record.timestamp_us = timestamp_us;
+  record.sequence = sequence;
+  record.flags = flags;
+
+  struct iovec iov[3];
+  iov[0].iov_base = &record;
+  iov[0].iov_len = sizeof(record);
+  iov[1].iov_base = const_cast<void*>(data);
+  iov[1].iov_len = size;
+  iov[2].iov_base = const_cast<uint8_t*>(kPadding);
+  iov[2].iov_len = padded_size - size;
+
+  ContainerIndexEntry entry;
+  entry.offset = offset_;
+  entry.timestamp_us = timestamp_us;
+  entry.sequence = sequence;
+  entry.size = size;
+  if (!WriteAll(iov, 3, record_size)) {
+    return false;
+  }
+  index_.push_back(entry);
+  ++frames_;
+  return true;
+}
+
+bool ContainerWriter::Close() {
+  if (fd_ < 0) {
+    return true;
+  }
+  return FinishSegment();
+}
+
+bool ContainerWriter::FinishSegment() {
+  IndexFooter footer;
+  memset(&footer, 0, sizeof(footer));
+  footer.magic = kIndexMagic;
+  footer.entry_count = index_.size();
+  footer.index_offset = offset_;
+
+  size_t index_bytes = index_.size() * sizeof(ContainerIndexEntry);
+  struct iovec iov[2];
+  iov[0].iov_base = index_.data();
+  iov[0].iov_len = index_bytes;
+  iov[1].iov_base = &footer;
+  iov[1].iov_len = sizeof(footer);
+  bool ok = WriteAll(iov, 2, index_bytes + sizeof(footer));
+
+  if (close(fd_) < 0) {
+    fprintf(stderr, "关闭录制分段 %u 失败: %s\n", segment_, strerror(errno));
+    ok = false;
+  }
+  fd_ = -1;
+  index_.clear();
+  return ok;
+}
+
+bool ContainerWriter::WriteAll(const struct iovec* iov, int iov_count,
+                               size_t total) {
+  // writev 可能只写入一部分，按已写入的字节数跳过前面的 iovec
+  struct iovec local[4];
+  int count = std::min(iov_count, 4);
+  memcpy(local, iov, count * sizeof(struct iovec));
+  struct iovec* current = local;
+  size_t remaining = total;
+  while (remaining > 0) {
+    ssize_t n = writev(fd_, current, count);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fprintf(stderr, "写入录制分段 %u 失败: %s\n", segment_,
+              strerror(errno));
+      return false;
+    }
+    offset_ += n;
+    bytes_ += n;
+    remaining -= n;
+    size_t written = n;
+    while (count > 0 && written >= current->iov_len) {
+      written -= current->iov_len;
+      ++current;
+      --count;
+    }
+    if (count > 0) {
+      current->iov_base = static_cast<uint8_t*>(current->iov_base) + written;
+      current->iov_len -= written;
+    }
+  }
+  return true;
+}
+
+void ContainerWriter::GetStats(ContainerWriterStats* stats) const {
+  stats->frames = frames_;
+  stats->bytes = bytes_;
+  stats->segments = segments_;
+  stats->current_segment = segment_;
+}
+
+ContainerReader::ContainerReader()
+    : map_(nullptr), map_size_(0), frame_count_(0), index_(nullptr) {
+  memset(&info_, 0, sizeof(info_));
+}
+
+ContainerReader::~ContainerReader() {
+  Close();
+}
+
+bool ContainerReader::Open(const std::string& path) {
+  Close();
+
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    fprintf(stderr, "无法打开录制分段 %s: %s\n", path.c_str(),
+            strerror(errno));
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    fprintf(stderr, "获取 %s 大小失败: %s\n", path.c_str(), strerror(errno));
+    close(fd);
+    return false;
+  }
+  if (static_cast<size_t>(st.st_size) < sizeof(FileHeader)) {
+    fprintf(stderr, "%s 不是录制分段（文件过小）\n", path.c_str());
+    close(fd);
+    return false;
+  }
+
+  void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    fprintf(stderr, "映射 %s 失败: %s\n", path.c_str(), strerror(errno));
+    return false;
+  }
+  map_ = static_cast<const uint8_t*>(map);
+  map_size_ = st.st_size;
+
+  const FileHeader* header = reinterpret_cast<const FileHeader*>(map_);
+  if (header->magic != kFileMagic || header->version != kContainerVersion ||
+      header->header_size < sizeof(FileHeader) ||
+      header->header_size > map_size_) {
+    fprintf(stderr, "%s 不是录制分段或版本不支持\n", path.c_str());
+    Close();
+    return false;
+  }
+  info_.pixel_format = header->pixel_format;
+  info_.width = header->width;
+  info_.height = header->height;
+  info_.bytes_per_line = header->bytes_per_line;
+  info_.segment = header->segment;
+
+  info_.indexed = LoadIndex();
+  if (!info_.indexed) {
+    ScanRecords();
+  }
+  return true;
+}
+
+void ContainerReader::Close() {
+  if (map_) {
+    munmap(const_cast<uint8_t*>(map_), map_size_);
+  }
+  map_ = nullptr;
+  map_size_ = 0;
+  frame_count_ = 0;
+  index_ = nullptr;
+  scanned_.clear();
+  memset(&info_, 0, sizeof(info_));
+}
+
+bool ContainerReader::LoadIndex() {
+  if (map_size_ < sizeof(FileHeader) + sizeof(IndexFooter)) {
+    return false;
+  }
+  const IndexFooter* footer = reinterpret_cast<const IndexFooter*>(
+      map_ + map_size_ - sizeof(IndexFooter));
+  // 页脚可能损坏或文件被截断，先检查范围再做加法，避免回绕越界
+  size_t index_space = map_size_ - sizeof(IndexFooter);
+  if (footer->magic != kIndexMagic ||
+      footer->index_offset < sizeof(FileHeader) ||
+      footer->index_offset > index_space ||
+      footer->index_offset % alignof(ContainerIndexEntry) != 0 ||
+      footer->entry_count > (index_space - footer->index_offset) /
+                                sizeof(ContainerIndexEntry)) {
+    return false;
+  }
+  if (footer->index_offset +
+          static_cast<uint64_t>(footer->entry_count) *
+              sizeof(ContainerIndexEntry) !=
+      index_space) {
+    return false;
+  }
+  index_ = reinterpret_cast<const ContainerIndexEntry*>(
+      map_ + footer->index_offset);
+  frame_count_ = footer->entry_count;
+  return true;
+}
+
+void ContainerReader::ScanRecords() {
+  const FileHeader* header = reinterpret_cast<const FileHeader*>(map_);
+  size_t offset = header->header_size;
+  while (offset + sizeof(RecordHeader) <= map_size_) {
+    const RecordHeader* record =
+        reinterpret_cast<const RecordHeader*>(map_ + offset);
+    if (record->magic != kRecordMagic ||
+        record->size > map_size_ - offset - sizeof(RecordHeader)) {
+      break;
+    }
+    ContainerIndexEntry entry;
+    entry.offset = offset;
+    entry.timestamp_us = record->timestamp_us;
+    entry.sequence = record->sequence;
+    entry.size = record->size;
+    scanned_.push_back(entry);
+    offset += sizeof(RecordHeader) + AlignUp(record->size, kRecordAlignment);
+  }
+  index_ = scanned_.data();
+  frame_count_ = scanned_.size();
+}
+
+bool ContainerReader::GetFrame(size_t index, ContainerFrame* frame) const {
+  if (index >= frame_count_) {
+    return false;
+  }
+  const ContainerIndexEntry& entry = index_[index];
+  if (entry.offset > map_size_ ||
+      map_size_ - entry.offset < sizeof(RecordHeader) ||
+      entry.size > map_size_ - entry.offset - sizeof(RecordHeader)) {
+    return false;
+  }
+  const RecordHeader* record =
+      reinterpret_cast<const RecordHeader*>(map_ + entry.offset);
+  if (record->magic != kRecordMagic || record->size != entry.size) {
+    return false;
+  }
+  frame->data = map_ + entry.offset + sizeof(RecordHeader);
+  frame->size = record->size;
+  frame->timestamp_us = record->timestamp_us;
+  frame->sequence = record->sequence;
+  frame->flags = record->flags;
+  return true;
+}
+
+size_t ContainerReader::FindFrame(int64_t timestamp_us) const {
+  const ContainerIndexEntry* end = index_ + frame_count_;
+  const ContainerIndexEntry* it = std::lower_bound(
+      index_, end, timestamp_us,
+      [](const ContainerIndexEntry& entry, int64_t value) {
+        return entry.timestamp_us < value;
+      });
+  return it - index_;
+}
+
+}  // namespace v4l2_demo
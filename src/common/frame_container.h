@@ -0,0 +1,169 @@
+#ifndef V4L2_DEMO_SRC_COMMON_FRAME_CONTAINER_H_
+#define V4L2_DEMO_SRC_COMMON_FRAME_CONTAINER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+#include <string>
+#include <vector>
+
+namespace v4l2_demo {
+
+// 分段录制容器（.v4lc）
+// 每个分段文件的布局：
+//   文件头    像素格式、宽高、行跨度、分段序号
+//   帧记录 * N 记录头（驱动时间戳、帧序号、flags、数据大小）+ 帧数据，
+//             帧数据按 64 字节对齐
+//   索引      每帧一项（记录偏移、时间戳、帧序号、大小）
+//   索引尾    定位索引，位于文件末尾
+// 写入只追加，分段写满后写出索引并切换到下一个分段，旧分段不会被覆盖
+// 读者 mmap 分段后直接使用文件中的索引，按帧号定位为 O(1)；
+// 异常退出时最后一个分段没有索引，读者顺序扫描帧记录重建
+
+// 索引项（即文件中的布局）
+struct ContainerIndexEntry {
+  uint64_t offset;       // 帧记录在分段文件中的偏移
+  int64_t timestamp_us;  // 驱动时间戳
+  uint32_t sequence;     // 驱动帧序号
+  uint32_t size;         // 帧数据大小
+};
+
+// 录制写入器配置
+struct ContainerWriterOptions {
+  // 分段路径前缀，分段文件为 <前缀>_0000.v4lc、<前缀>_0001.v4lc ...
+  std::string path_prefix = "output/capture";
+  uint32_t pixel_format = 0;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t bytes_per_line = 0;  // 压缩格式为 0
+  uint64_t max_segment_bytes = 256ull << 20;  // 单个分段文件的大小上限
+  uint32_t max_segment_frames = 0;  // 单个分段的帧数上限，0 表示不限
+  // 最多保留的分段数，超出时删除最旧的，0 表示不限
+  uint32_t max_segments = 0;
+};
+
+// 录制写入器统计
+struct ContainerWriterStats {
+  uint64_t frames;           // 已写入的帧数
+  uint64_t bytes;            // 已写入的字节数（含记录头与索引）
+  uint32_t segments;         // 已打开过的分段数
+  uint32_t current_segment;  // 当前分段序号
+};
+
+// 录制写入器：把帧追加到分段容器中
+// 非线程安全，通常只在写入线程（如 FrameWriter 的写入线程）中调用
+class ContainerWriter {
+ public:
+  ContainerWriter();
+  ~ContainerWriter();
+
+  ContainerWriter(const ContainerWriter&) = delete;
+  ContainerWriter& operator=(const ContainerWriter&) = delete;
+
+  // 创建第一个分段
+  // @param options 配置
+  // @return 成功返回 true，失败返回 false
+  bool Open(const ContainerWriterOptions& options);
+
+  // 追加一帧，当前分段写满时先切换到新分段
+  // @param data 帧数据（单内存平面格式的整帧）
+  // @param size 帧数据大小
+  // @param timestamp_us 驱动时间戳（微秒）
+  // @param sequence 驱动帧序号
+  // @param flags v4l2_buffer.flags
+  // @return 成功返回 true，失败返回 false
+  bool WriteFrame(const void* data, size_t size, int64_t timestamp_us,
+                  uint32_t sequence, uint32_t flags);
+
+  // 写出当前分段的索引并关闭
+  // @return 成功返回 true，失败返回 false
+  bool Close();
+
+  bool IsOpen() const { return fd_ >= 0; }
+
+  void GetStats(ContainerWriterStats* stats) const;
+
+  // 分段文件路径
+  // @param path_prefix 路径前缀
+  // @param segment 分段序号
+  static std::string SegmentPath(const std::string& path_prefix,
+                                 uint32_t segment);
+
+ private:
+  bool OpenSegment(uint32_t segment);
+  bool FinishSegment();
+  bool WriteAll(const struct iovec* iov, int iov_count, size_t total);
+
+  ContainerWriterOptions options_;
+  int fd_;
+  uint32_t segment_;     // 当前分段序号
+  uint32_t segments_;    // 已打开过的分段数
+  uint64_t offset_;      // 当前分段的写入位置
+  std::vector<ContainerIndexEntry> index_;  // 当前分段的索引
+  uint64_t frames_;
+  uint64_t bytes_;
+};
+
+// 容器中的一帧（指向 mmap 映射，不拷贝，读者关闭前有效）
+struct ContainerFrame {
+  const void* data;
+  size_t size;
+  int64_t timestamp_us;  // 驱动时间戳
+  uint32_t sequence;     // 驱动帧序号
+  uint32_t flags;        // v4l2_buffer.flags
+};
+
+// 分段的格式信息
+struct ContainerInfo {
+  uint32_t pixel_format;
+  uint32_t width;
+  uint32_t height;
+  uint32_t bytes_per_line;
+  uint32_t segment;   // 分段序号
+  bool indexed;       // 是否带有完整索引（false 表示索引由扫描重建）
+};
+
+// 分段读取器：只读 mmap 一个分段文件，按帧号或时间戳随机访问
+class ContainerReader {
+ public:
+  ContainerReader();
+  ~ContainerReader();
+
+  ContainerReader(const ContainerReader&) = delete;
+  ContainerReader& operator=(const ContainerReader&) = delete;
+
+  // 映射并校验分段文件；没有索引时扫描帧记录重建（截断的尾部记录被忽略）
+  // @param path 分段文件路径
+  // @return 成功返回 true，失败返回 false
+  bool Open(const std::string& path);
+
+  void Close();
+
+  const ContainerInfo& info() const { return info_; }
+  size_t GetFrameCount() const { return frame_count_; }
+
+  // 按帧号读取一帧
+  // @param index 帧号（0 起）
+  // @param frame 输出帧
+  // @return 帧号有效返回 true
+  bool GetFrame(size_t index, ContainerFrame* frame) const;
+
+  // 查找时间戳不早于 timestamp_us 的第一帧（二分查找）
+  // @return 帧号，所有帧都更早时返回 GetFrameCount()
+  size_t FindFrame(int64_t timestamp_us) const;
+
+ private:
+  bool LoadIndex();
+  void ScanRecords();
+
+  const uint8_t* map_;
+  size_t map_size_;
+  ContainerInfo info_;
+  size_t frame_count_;
+  const ContainerIndexEntry* index_;  // 文件中的索引或 scanned_
+  std::vector<ContainerIndexEntry> scanned_;  // 扫描重建的索引
+};
+
+}  // namespace v4l2_demo
+
+#endif  // V4L2_DEMO_SRC_COMMON_FRAME_CONTAINER_H_
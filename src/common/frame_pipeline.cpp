@@ -0,0 +1,607 @@
+#include "frame_pipeline.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <utility>
+
+#include "realtime.h"
+
+namespace v4l2_demo {
+
+namespace {
+
+// 阶段每次被调度最多处理的帧数，之后让出线程保证各阶段公平
+constexpr int kMaxBatch = 8;
+
+// Stop 等待管线中剩余帧处理完的最长时间
+constexpr int kDrainTimeoutMs = 2000;
+
+// 当前线程所属的工作线程池及其中的序号，用于把任务提交到本线程队列
+thread_local const void* tls_pool = nullptr;
+thread_local size_t tls_worker_index = 0;
+
+void SignalEventFd(int fd) {
+  uint64_t value = 1;
+  ssize_t ret = write(fd, &value, sizeof(value));
+  (void)ret;
+}
+
+void WaitEventFd(int fd) {
+  uint64_t value;
+  ssize_t ret;
+  do {
+    ret = read(fd, &value, sizeof(value));
+  } while (ret < 0 && errno == EINTR);
+}
+
+void UpdateMax(std::atomic<uint64_t>* target, uint64_t value) {
+  uint64_t current = target->load(std::memory_order_relaxed);
+  while (value > current &&
+         !target->compare_exchange_weak(current, value,
+                                        std::memory_order_relaxed)) {
+  }
+}
+
+}  // namespace
+
+PipelineFrame::PipelineFrame()
+    : width(0),
+      height(0),
+      pixel_format(0),
+      bytesperline(0),
+      sequence(0),
+      flags(0),
+      timestamp_us(0),
+      data_(nullptr),
+      size_(0),
+      refs_(0) {}
+
+uint8_t* PipelineFrame::Allocate(size_t size) {
+  if (buffer_.size() < size) {
+    buffer_.resize(size);
+  }
+  data_ = buffer_.data();
+  size_ = size;
+  return buffer_.data();
+}
+
+bool PipelineFrame::TakeLease(FrameLease* lease) const {
+  if (!lease_.IsValid() || refs_.load(std::memory_order_acquire) != 1) {
+    return false;
+  }
+  *lease = std::move(lease_);
+  data_ = nullptr;
+  size_ = 0;
+  return true;
+}
+
+// 工作窃取线程池：每个工作线程有自己的任务队列，阶段在哪个线程上被调度
+// 就优先进入该线程的队列（刚产出的帧还在该核的缓存中）；
+// 自己的队列为空时从其他线程的队列头部窃取
+class FramePipeline::WorkerPool {
+ public:
+  WorkerPool(FramePipeline* pipeline, size_t count)
+      : pipeline_(pipeline), pending_(0), next_worker_(0), stopping_(false) {
+    for (size_t i = 0; i < count; ++i) {
+      workers_.push_back(std::unique_ptr<Worker>(new Worker()));
+    }
+    for (size_t i = 0; i < count; ++i) {
+      workers_[i]->thread = std::thread(&WorkerPool::WorkerLoop, this, i);
+    }
+  }
+
+  ~WorkerPool() {
+    {
+      std::lock_guard<std::mutex> lock(sleep_mutex_);
+      stopping_ = true;
+    }
+    sleep_cv_.notify_all();
+    for (auto& worker : workers_) {
+      worker->thread.join();
+    }
+  }
+
+  void Submit(Node* node) {
+    size_t target = tls_pool == this
+                        ? tls_worker_index
+                        : next_worker_.fetch_add(1) % workers_.size();
+    {
+      std::lock_guard<std::mutex> lock(workers_[target]->mutex);
+      workers_[target]->tasks.push_back(node);
+    }
+    pending_.fetch_add(1);
+    {
+      // 持锁再通知，避免与正在进入睡眠的线程错过唤醒
+      std::lock_guard<std::mutex> lock(sleep_mutex_);
+    }
+    sleep_cv_.notify_one();
+  }
+
+ private:
+  struct Worker {
+    std::mutex mutex;
+    std::deque<Node*> tasks;
+    std::thread thread;
+  };
+
+  // 先取自己队列尾部（最近提交），再从其他线程队列头部窃取
+  bool TakeTask(size_t self, Node** node) {
+    {
+      Worker& own = *workers_[self];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (!own.tasks.empty()) {
+        *node = own.tasks.back();
+        own.tasks.pop_back();
+        pending_.fetch_sub(1);
+        return true;
+      }
+    }
+    for (size_t i = 1; i < workers_.size(); ++i) {
+      Worker& victim = *workers_[(self + i) % workers_.size()];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.tasks.empty()) {
+        *node = victim.tasks.front();
+        victim.tasks.pop_front();
+        pending_.fetch_sub(1);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void WorkerLoop(size_t self) {
+    tls_pool = this;
+    tls_worker_index = self;
+    while (true) {
+      Node* node;
+      if (TakeTask(self, &node)) {
+        pipeline_->RunNode(node);
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(sleep_mutex_);
+      sleep_cv_.wait(lock, [this]() {
+        return stopping_ || pending_.load() > 0;
+      });
+      if (stopping_ && pending_.load() == 0) {
+        return;
+      }
+    }
+  }
+
+  FramePipeline* pipeline_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::mutex sleep_mutex_;
+  std::condition_variable sleep_cv_;
+  std::atomic<size_t> pending_;      // 已提交、尚未被取走的任务数
+  std::atomic<size_t> next_worker_;  // 外部线程提交时轮流选择
+  bool stopping_;                    // 由 sleep_mutex_ 保护
+};
+
+FramePipeline::FramePipeline(const PipelineOptions& options)
+    : options_(options),
+      running_(false),
+      stopping_(false),
+      threads_running_(false),
+      pushed_(0),
+      source_dropped_(0) {
+  memset(&source_format_, 0, sizeof(source_format_));
+}
+
+FramePipeline::~FramePipeline() {
+  Stop();
+}
+
+int FramePipeline::AddStage(std::unique_ptr<PipelineStage> stage,
+                            int upstream, const StageOptions& options) {
+  if (running_ || !stage || upstream >= static_cast<int>(nodes_.size()) ||
+      upstream < -1) {
+    return -1;
+  }
+
+  std::unique_ptr<Node> node(new Node());
+  node->id = nodes_.size();
+  node->stage = std::move(stage);
+  node->options = options;
+  node->upstream = upstream >= 0 ? nodes_[upstream].get() : nullptr;
+  node->input.reset(new SpscQueue<PipelineFrame*>(
+      std::max<size_t>(options.queue_capacity, 1)));
+  node->scheduled = false;
+  node->blocked = false;
+  node->wakeup_fd = -1;
+  node->processed = 0;
+  node->emitted = 0;
+  node->dropped = 0;
+  node->failed = 0;
+  node->process_time_us = 0;
+  node->max_process_us = 0;
+  node->max_queue_depth = 0;
+  node->last_report_processed = 0;
+  node->last_report_time_us = 0;
+
+  if (node->upstream) {
+    node->upstream->downstream.push_back(node.get());
+  } else {
+    roots_.push_back(node.get());
+  }
+  nodes_.push_back(std::move(node));
+  return nodes_.back()->id;
+}
+
+bool FramePipeline::Start(const VideoFormat& source_format) {
+  if (running_ || nodes_.empty()) {
+    return false;
+  }
+  source_format_ = source_format;
+
+  // 帧池：所有队列装满，再加上每个阶段正在处理的输入与输出
+  size_t pool_size = options_.frame_pool_size;
+  if (pool_size == 0) {
+    pool_size = 2;
+    for (const auto& node : nodes_) {
+      pool_size += node->input->Capacity() + 2;
+    }
+  }
+  frames_.clear();
+  free_frames_.clear();
+  for (size_t i = 0; i < pool_size; ++i) {
+    frames_.push_back(std::unique_ptr<PipelineFrame>(new PipelineFrame()));
+    free_frames_.push_back(frames_.back().get());
+  }
+
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    if (!nodes_[i]->stage->Start()) {
+      fprintf(stderr, "阶段 %s 启动失败\n",
+              nodes_[i]->stage->GetName().c_str());
+      for (size_t j = 0; j < i; ++j) {
+        nodes_[j]->stage->Stop();
+      }
+      return false;
+    }
+  }
+
+  bool use_pool = false;
+  for (const auto& node : nodes_) {
+    use_pool |= node->options.execution == StageExecution::kSharedPool;
+  }
+  if (use_pool) {
+    size_t workers = options_.worker_count;
+    if (workers == 0) {
+      workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    pool_.reset(new WorkerPool(this, workers));
+  }
+
+  pushed_ = 0;
+  source_dropped_ = 0;
+  stopping_ = false;
+  threads_running_ = true;
+  int64_t now = MonotonicMicros();
+  for (auto& node : nodes_) {
+    node->last_report_time_us = now;
+    if (node->options.execution != StageExecution::kDedicatedThread) {
+      continue;
+    }
+    node->wakeup_fd = eventfd(0, EFD_CLOEXEC);
+    if (node->wakeup_fd < 0) {
+      fprintf(stderr, "创建 eventfd 失败: %s\n", strerror(errno));
+      running_ = true;
+      Stop();
+      return false;
+    }
+    node->thread = std::thread(&FramePipeline::DedicatedLoop, this,
+                               node.get());
+  }
+
+  running_ = true;
+  return true;
+}
+
+PipelineFrame* FramePipeline::AcquireFrame() {
+  PipelineFrame* frame;
+  {
+    std::lock_guard<std::mutex> lock(free_mutex_);
+    if (free_frames_.empty()) {
+      return nullptr;
+    }
+    frame = free_frames_.back();
+    free_frames_.pop_back();
+  }
+  frame->data_ = nullptr;
+  frame->size_ = 0;
+  frame->refs_.store(1, std::memory_order_relaxed);
+  return frame;
+}
+
+void FramePipeline::ReleaseFrame(PipelineFrame* frame) {
+  if (frame->refs_.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+    return;
+  }
+  frame->lease_.Release();
+  frame->data_ = nullptr;
+  frame->size_ = 0;
+
+  std::lock_guard<std::mutex> lock(free_mutex_);
+  free_frames_.push_back(frame);
+  if (free_frames_.size() == frames_.size()) {
+    drained_cv_.notify_all();
+  }
+}
+
+bool FramePipeline::Push(FrameLease* lease) {
+  FrameLease source(std::move(*lease));
+  if (!running_ || stopping_.load() || !source.IsValid()) {
+    return false;
+  }
+  pushed_.fetch_add(1, std::memory_order_relaxed);
+
+  PipelineFrame* frame = AcquireFrame();
+  if (!frame) {
+    source_dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  frame->width = source_format_.width;
+  frame->height = source_format_.height;
+  frame->pixel_format = source_format_.pixel_format;
+  frame->bytesperline = source_format_.bytesperline[0];
+  frame->sequence = source.sequence();
+  frame->flags = source.flags();
+  frame->timestamp_us = source.timestamp_us();
+  frame->data_ = source.data();
+  frame->size_ = source.size();
+  frame->lease_ = std::move(source);
+
+  return Dispatch(roots_, frame) > 0;
+}
+
+size_t FramePipeline::Dispatch(const std::vector<Node*>& targets,
+                               PipelineFrame* frame) {
+  if (targets.empty()) {
+    ReleaseFrame(frame);
+    return 0;
+  }
+  frame->refs_.fetch_add(static_cast<int>(targets.size()) - 1,
+                         std::memory_order_relaxed);
+  size_t accepted = 0;
+  for (Node* target : targets) {
+    if (Enqueue(target, frame)) {
+      accepted++;
+    } else {
+      ReleaseFrame(frame);
+    }
+  }
+  return accepted;
+}
+
+void FramePipeline::Schedule(Node* node) {
+  // 与 RunNode 末尾的检查配对：要么这里看到 scheduled 为 false 并调度，
+  // 要么 RunNode 清除 scheduled 后看到新入队的帧
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (node->scheduled.exchange(true)) {
+    return;
+  }
+  if (node->options.execution == StageExecution::kDedicatedThread) {
+    SignalEventFd(node->wakeup_fd);
+  } else {
+    pool_->Submit(node);
+  }
+}
+
+bool FramePipeline::CanEmit(const Node* node) const {
+  for (const Node* child : node->downstream) {
+    if (child->options.overflow_policy == OverflowPolicy::kBlock &&
+        child->input->Size() >= child->input->Capacity()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool FramePipeline::Enqueue(Node* node, PipelineFrame* frame) {
+  while (!node->input->TryPush(frame)) {
+    PipelineFrame* oldest;
+    if (node->options.overflow_policy == OverflowPolicy::kDropOldest) {
+      if (node->input->DropOldest(&oldest)) {
+        node->dropped.fetch_add(1, std::memory_order_relaxed);
+        ReleaseFrame(oldest);
+      }
+      continue;
+    }
+    // kDropNewest；kBlock 时上游已确认有空位，只有源头会走到这里
+    node->dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  size_t depth = node->input->Size();
+  size_t max_depth = node->max_queue_depth.load(std::memory_order_relaxed);
+  while (depth > max_depth &&
+         !node->max_queue_depth.compare_exchange_weak(
+             max_depth, depth, std::memory_order_relaxed)) {
+  }
+  Schedule(node);
+  return true;
+}
+
+void FramePipeline::RunNode(Node* node) {
+  for (int i = 0; i < kMaxBatch; ++i) {
+    // 下游满时暂停；先置 blocked 再复查，避免下游恰好在两者之间取走帧
+    if (!CanEmit(node)) {
+      node->blocked.store(true);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (!CanEmit(node)) {
+        break;
+      }
+      node->blocked.store(false);
+    }
+
+    PipelineFrame* frame;
+    if (!node->input->TryPop(&frame)) {
+      break;
+    }
+    // 腾出了空位，唤醒被本阶段反压的上游
+    if (node->upstream) {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (node->upstream->blocked.exchange(false)) {
+        Schedule(node->upstream);
+      }
+    }
+
+    PipelineFrame* output = nullptr;
+    if (!node->downstream.empty()) {
+      output = AcquireFrame();
+      if (!output) {
+        node->dropped.fetch_add(1, std::memory_order_relaxed);
+        ReleaseFrame(frame);
+        continue;
+      }
+      output->width = frame->width;
+      output->height = frame->height;
+      output->pixel_format = frame->pixel_format;
+      output->bytesperline = frame->bytesperline;
+      output->sequence = frame->sequence;
+      output->flags = frame->flags;
+      output->timestamp_us = frame->timestamp_us;
+    }
+
+    int64_t begin = MonotonicMicros();
+    StageResult result = node->stage->Process(*frame, output);
+    uint64_t elapsed = MonotonicMicros() - begin;
+    node->processed.fetch_add(1, std::memory_order_relaxed);
+    node->process_time_us.fetch_add(elapsed, std::memory_order_relaxed);
+    UpdateMax(&node->max_process_us, elapsed);
+
+    PipelineFrame* emit = nullptr;
+    switch (result) {
+      case StageResult::kForward:
+        emit = frame;
+        frame = nullptr;
+        break;
+      case StageResult::kEmit:
+        emit = output;
+        output = nullptr;
+        break;
+      case StageResult::kConsume:
+        break;
+      case StageResult::kFail:
+        node->failed.fetch_add(1, std::memory_order_relaxed);
+        break;
+    }
+    if (emit && Dispatch(node->downstream, emit) > 0) {
+      node->emitted.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (output) {
+      ReleaseFrame(output);
+    }
+    if (frame) {
+      ReleaseFrame(frame);
+    }
+  }
+
+  node->scheduled.store(false);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  // 运行期间新到的帧：入队方看到 scheduled 为 true 没有调度，这里补上
+  if (!node->blocked.load() && node->input->Size() > 0) {
+    Schedule(node);
+  }
+}
+
+void FramePipeline::DedicatedLoop(Node* node) {
+  SetThreadAffinity(node->options.cpu_core);
+  while (true) {
+    WaitEventFd(node->wakeup_fd);
+    if (!threads_running_.load()) {
+      return;
+    }
+    RunNode(node);
+  }
+}
+
+void FramePipeline::Stop() {
+  if (!running_) {
+    return;
+  }
+  stopping_ = true;
+
+  // 等待管线中的帧全部处理完（归还帧池）
+  {
+    std::unique_lock<std::mutex> lock(free_mutex_);
+    if (!drained_cv_.wait_for(
+            lock, std::chrono::milliseconds(kDrainTimeoutMs),
+            [this]() { return free_frames_.size() == frames_.size(); })) {
+      fprintf(stderr, "警告: 管线在 %d ms 内未处理完，剩余帧将被丢弃\n",
+              kDrainTimeoutMs);
+    }
+  }
+
+  threads_running_ = false;
+  for (auto& node : nodes_) {
+    if (node->wakeup_fd >= 0) {
+      SignalEventFd(node->wakeup_fd);
+      if (node->thread.joinable()) {
+        node->thread.join();
+      }
+      close(node->wakeup_fd);
+      node->wakeup_fd = -1;
+    }
+  }
+  pool_.reset();
+
+  // 超时未处理的帧：归还租约，保证设备可以安全停止
+  for (auto& node : nodes_) {
+    PipelineFrame* frame;
+    while (node->input->TryPop(&frame)) {
+      ReleaseFrame(frame);
+    }
+    node->scheduled = false;
+    node->blocked = false;
+  }
+  for (auto& node : nodes_) {
+    node->stage->Stop();
+  }
+  running_ = false;
+}
+
+void FramePipeline::GetStats(PipelineStats* stats) {
+  stats->pushed = pushed_.load(std::memory_order_relaxed);
+  stats->dropped = source_dropped_.load(std::memory_order_relaxed);
+  stats->stages.clear();
+
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  int64_t now = MonotonicMicros();
+  for (auto& node : nodes_) {
+    StageStats stage;
+    stage.name = node->stage->GetName();
+    stage.processed = node->processed.load(std::memory_order_relaxed);
+    stage.emitted = node->emitted.load(std::memory_order_relaxed);
+    stage.dropped = node->dropped.load(std::memory_order_relaxed);
+    stage.failed = node->failed.load(std::memory_order_relaxed);
+    stage.queue_depth = node->input->Size();
+    stage.queue_capacity = node->input->Capacity();
+    stage.max_queue_depth =
+        node->max_queue_depth.load(std::memory_order_relaxed);
+    stage.avg_process_ms =
+        stage.processed
+            ? node->process_time_us.load(std::memory_order_relaxed) / 1000.0 /
+                  stage.processed
+            : 0.0;
+    stage.max_process_ms =
+        node->max_process_us.load(std::memory_order_relaxed) / 1000.0;
+
+    int64_t elapsed_us = now - node->last_report_time_us;
+    stage.fps = elapsed_us > 0
+                    ? (stage.processed - node->last_report_processed) * 1e6 /
+                          elapsed_us
+                    : 0.0;
+    node->last_report_processed = stage.processed;
+    node->last_report_time_us = now;
+    stats->stages.push_back(stage);
+  }
+}
+
+}  // namespace v4l2_demo
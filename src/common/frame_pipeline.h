@@ -0,0 +1,262 @@
+#ifndef V4L2_DEMO_SRC_COMMON_FRAME_PIPELINE_H_
+#define V4L2_DEMO_SRC_COMMON_FRAME_PIPELINE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "frame_writer.h"
+#include "spsc_queue.h"
+#include "v4l2_utils.h"
+
+namespace v4l2_demo {
+
+// 管线中流动的一帧：源帧持有设备租约（零拷贝），阶段输出的帧使用
+// 池化缓冲区；帧带引用计数，扇出给多个下游时不拷贝
+class PipelineFrame {
+ public:
+  PipelineFrame();
+
+  PipelineFrame(const PipelineFrame&) = delete;
+  PipelineFrame& operator=(const PipelineFrame&) = delete;
+
+  // 帧参数；输出帧在 Process 调用前从输入帧复制，阶段按需修改
+  uint32_t width;
+  uint32_t height;
+  uint32_t pixel_format;
+  uint32_t bytesperline;   // 行跨度，紧密排列或压缩格式为 0
+  uint32_t sequence;       // 驱动帧序号
+  uint32_t flags;          // v4l2_buffer.flags
+  int64_t timestamp_us;    // 驱动时间戳
+
+  const void* data() const { return data_; }
+  size_t size() const { return size_; }
+
+  // 为输出帧分配数据缓冲区（池化复用，只在容量不足时扩容）
+  // @param size 数据大小
+  // @return 可写的缓冲区，同时成为 data()
+  uint8_t* Allocate(size_t size);
+
+  // 是否持有设备租约
+  bool HasLease() const { return lease_.IsValid(); }
+
+  // 取走设备租约，供需要独占租约的 sink（编码器、帧总线）使用
+  // 只有本帧没有被其他阶段共享时才能取走（此时修改不会被其他线程看到，
+  // 因此可在 Process 的只读输入上调用），之后 data() 失效
+  // @param lease 输出参数，租约
+  // @return 成功返回 true；没有租约或被共享时返回 false
+  bool TakeLease(FrameLease* lease) const;
+
+ private:
+  friend class FramePipeline;
+
+  mutable FrameLease lease_;    // 源帧的设备租约
+  std::vector<uint8_t> buffer_; // 输出帧的池化缓冲区
+  mutable const void* data_;
+  mutable size_t size_;
+  std::atomic<int> refs_;       // 持有本帧的阶段数
+};
+
+// 阶段处理结果
+enum class StageResult {
+  kForward,  // 把输入帧原样交给下游（不拷贝）
+  kEmit,     // 把 output 交给下游
+  kConsume,  // 不向下游输出（sink，或过滤掉该帧）
+  kFail,     // 处理失败，计入统计，不向下游输出
+};
+
+// 管线阶段：filter 或 sink
+// 同一阶段的 Process 不会被并发调用（共享线程池模式下可能在不同线程上
+// 依次执行），因此阶段内部无需加锁
+class PipelineStage {
+ public:
+  virtual ~PipelineStage() {}
+
+  // 阶段名称，用于统计输出
+  virtual std::string GetName() const = 0;
+
+  // 管线启动时调用（如打开文件）
+  // @return 成功返回 true，失败时管线不启动
+  virtual bool Start() { return true; }
+
+  // 管线停止、所有帧处理完后调用
+  virtual void Stop() {}
+
+  // 处理一帧
+  // @param input 输入帧，只读；Process 返回后可能被释放
+  // @param output 输出帧（参数已从 input 复制）；阶段没有下游时为 nullptr
+  // @return 见 StageResult
+  virtual StageResult Process(const PipelineFrame& input,
+                              PipelineFrame* output) = 0;
+};
+
+// 阶段的执行方式
+enum class StageExecution {
+  kSharedPool,       // 在管线的工作窃取线程池中执行
+  kDedicatedThread,  // 独占一个线程（适合阻塞 I/O 或需要绑核的阶段）
+};
+
+// 阶段配置
+struct StageOptions {
+  size_t queue_capacity = 4;  // 输入队列容量（向上取整为 2 的幂）
+  // 输入队列满时的处理：kBlock 让上游暂停处理（源头没有上游，直接丢弃新帧）
+  OverflowPolicy overflow_policy = OverflowPolicy::kBlock;
+  StageExecution execution = StageExecution::kSharedPool;
+  int cpu_core = -1;  // 独占线程绑定的 CPU 核，-1 表示不绑定
+};
+
+// 管线配置
+struct PipelineOptions {
+  size_t worker_count = 0;     // 共享线程池的线程数，0 表示 CPU 核数
+  size_t frame_pool_size = 0;  // 帧池大小，0 表示按队列容量自动计算
+};
+
+// 单个阶段的统计
+struct StageStats {
+  std::string name;
+  uint64_t processed;       // 处理的帧数
+  uint64_t emitted;         // 交给下游的帧数
+  uint64_t dropped;         // 因输入队列满或帧池耗尽被丢弃的帧数
+  uint64_t failed;          // Process 返回 kFail 的帧数
+  size_t queue_depth;       // 当前输入队列深度
+  size_t queue_capacity;    // 输入队列容量
+  size_t max_queue_depth;   // 历史最大输入队列深度
+  double avg_process_ms;    // 平均处理耗时
+  double max_process_ms;    // 最大处理耗时
+  double fps;               // 距离上次 GetStats 调用期间的处理帧率
+};
+
+// 管线统计
+struct PipelineStats {
+  uint64_t pushed;   // 送入管线的源帧数
+  uint64_t dropped;  // 帧池耗尽被丢弃的源帧数
+  std::vector<StageStats> stages;  // 按阶段 ID 排列
+};
+
+// 帧处理管线：源（V4L2Device 的帧租约）经过若干 filter 阶段到达 sink
+// 阶段组成一棵树：每个阶段只有一个上游，可以有多个下游（扇出不拷贝）；
+// 阶段之间由有界无锁 SPSC 队列连接，每个阶段同一时刻只在一个线程上运行
+// 反压：下游队列满且策略为 kBlock 时上游暂停，直到下游取走帧后被重新调度；
+// 源帧持有设备租约，管线积压时驱动缓冲区耗尽，由驱动丢帧
+// 用法：
+//   FramePipeline pipeline;
+//   int convert = pipeline.AddStage(std::make_unique<ConvertStage>(...));
+//   pipeline.AddStage(std::make_unique<FileSinkStage>(...), convert);
+//   pipeline.Start(format);
+//   loop.Run(&device, [&](FrameLease* lease) { pipeline.Push(lease); });
+//   pipeline.Stop();
+class FramePipeline {
+ public:
+  explicit FramePipeline(const PipelineOptions& options = PipelineOptions());
+  ~FramePipeline();
+
+  FramePipeline(const FramePipeline&) = delete;
+  FramePipeline& operator=(const FramePipeline&) = delete;
+
+  // 添加阶段（须在 Start 之前）
+  // @param stage 阶段
+  // @param upstream 上游阶段 ID，-1 表示直接接收源帧
+  // @param options 阶段配置
+  // @return 阶段 ID，upstream 无效时返回 -1
+  int AddStage(std::unique_ptr<PipelineStage> stage, int upstream = -1,
+               const StageOptions& options = StageOptions());
+
+  // 启动所有阶段与线程
+  // @param source_format 源帧的格式（V4L2Device::GetFormat）
+  // @return 成功返回 true，失败返回 false
+  bool Start(const VideoFormat& source_format);
+
+  // 送入一帧源数据，租约总是被转移走（只能在一个线程中调用）
+  // @param lease 帧租约
+  // @return 至少被一个阶段接收返回 true，否则返回 false
+  bool Push(FrameLease* lease);
+
+  // 等待已送入的帧全部处理完后停止所有阶段
+  void Stop();
+
+  // 获取统计信息，可在其他线程调用
+  void GetStats(PipelineStats* stats);
+
+ private:
+  class WorkerPool;
+
+  struct Node {
+    int id;
+    std::unique_ptr<PipelineStage> stage;
+    StageOptions options;
+    Node* upstream;
+    std::vector<Node*> downstream;
+    std::unique_ptr<SpscQueue<PipelineFrame*>> input;
+
+    std::atomic<bool> scheduled;  // 已在运行或等待运行
+    std::atomic<bool> blocked;    // 因下游队列满暂停
+    std::thread thread;           // 独占线程模式
+    int wakeup_fd;                // 独占线程模式的唤醒 eventfd
+
+    std::atomic<uint64_t> processed;
+    std::atomic<uint64_t> emitted;
+    std::atomic<uint64_t> dropped;
+    std::atomic<uint64_t> failed;
+    std::atomic<uint64_t> process_time_us;
+    std::atomic<uint64_t> max_process_us;
+    std::atomic<size_t> max_queue_depth;
+
+    // GetStats 计算帧率用
+    uint64_t last_report_processed;
+    int64_t last_report_time_us;
+  };
+
+  PipelineOptions options_;
+  std::vector<std::unique_ptr<Node>> nodes_;
+  std::vector<Node*> roots_;
+  std::unique_ptr<WorkerPool> pool_;
+  VideoFormat source_format_;
+  bool running_;
+  std::atomic<bool> stopping_;         // Stop 已开始，不再接收源帧
+  std::atomic<bool> threads_running_;  // 独占线程继续运行
+  std::mutex stats_mutex_;  // 保护帧率计算的上次采样
+
+  // 帧池
+  std::vector<std::unique_ptr<PipelineFrame>> frames_;
+  std::vector<PipelineFrame*> free_frames_;
+  std::mutex free_mutex_;
+  std::condition_variable drained_cv_;  // 所有帧归还帧池时通知 Stop
+
+  std::atomic<uint64_t> pushed_;
+  std::atomic<uint64_t> source_dropped_;
+
+  // 从帧池取一帧（引用计数为 1），帧池耗尽时返回 nullptr
+  PipelineFrame* AcquireFrame();
+
+  // 释放一个引用，最后一个引用释放时归还租约与帧池
+  void ReleaseFrame(PipelineFrame* frame);
+
+  // 调度阶段执行（已调度时不重复调度）
+  void Schedule(Node* node);
+
+  // 执行阶段：处理输入队列中的帧，直到队列为空、被反压或达到批量上限
+  void RunNode(Node* node);
+  void DedicatedLoop(Node* node);
+
+  // 所有 kBlock 下游都有空位时返回 true
+  bool CanEmit(const Node* node) const;
+
+  // 把帧交给一组阶段，调用者持有的一个引用被转移走
+  // （先分好引用再入队，下游看到的引用计数不会因调用者晚释放而偏大）
+  // @return 接收该帧的阶段数
+  size_t Dispatch(const std::vector<Node*>& targets, PipelineFrame* frame);
+
+  // 把帧放入阶段的输入队列，必要时按溢出策略处理
+  // @return 进入队列返回 true，被丢弃返回 false
+  bool Enqueue(Node* node, PipelineFrame* frame);
+};
+
+}  // namespace v4l2_demo
+
+#endif  // V4L2_DEMO_SRC_COMMON_FRAME_PIPELINE_H_
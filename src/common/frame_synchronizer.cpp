@@ -0,0 +1,164 @@
+#include "frame_synchronizer.h"
+
+#include <utility>
+
+namespace v4l2_demo {
+
+FrameSynchronizer::FrameSynchronizer(const FrameSyncOptions& options,
+                                     FrameSetCallback callback)
+    : options_(options),
+      callback_(std::move(callback)),
+      cameras_(options.camera_count),
+      frames_(0),
+      groups_(0),
+      unmatched_(0),
+      late_(0),
+      overflow_(0),
+      max_spread_us_(0),
+      total_spread_us_(0) {
+  if (options_.max_pending == 0) {
+    options_.max_pending = 1;
+  }
+  for (Pending& pending : cameras_) {
+    pending.leases.reset(new FrameLease[options_.max_pending]);
+    pending.timestamps.reset(new int64_t[options_.max_pending]);
+    pending.head = 0;
+    pending.count = 0;
+    pending.consumed_us = 0;
+    pending.has_consumed = false;
+  }
+  set_.timestamp_us = 0;
+  set_.spread_us = 0;
+  set_.frames.resize(options_.camera_count);
+}
+
+FrameSynchronizer::~FrameSynchronizer() { Clear(); }
+
+bool FrameSynchronizer::Push(int camera_id, FrameLease* lease) {
+  if (camera_id < 0 || static_cast<size_t>(camera_id) >= cameras_.size() ||
+      !lease || !lease->IsValid()) {
+    return false;
+  }
+  frames_.fetch_add(1, std::memory_order_relaxed);
+  int64_t timestamp_us = lease->HasMonotonicTimestamp()
+                             ? lease->timestamp_us()
+                             : lease->dequeue_time_us();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  Pending& pending = cameras_[camera_id];
+
+  // 其他摄像头已经越过了本帧的容差窗口：窗口内的帧都已输出或丢弃，
+  // 本帧不可能再凑成一组
+  for (size_t c = 0; c < cameras_.size(); ++c) {
+    if (c != static_cast<size_t>(camera_id) && cameras_[c].has_consumed &&
+        timestamp_us + options_.tolerance_us < cameras_[c].consumed_us) {
+      late_.fetch_add(1, std::memory_order_relaxed);
+      pending.consumed_us = timestamp_us;
+      pending.has_consumed = true;
+      lease->Release();
+      return false;
+    }
+  }
+
+  if (pending.count == options_.max_pending) {
+    DropHead(&pending);
+    overflow_.fetch_add(1, std::memory_order_relaxed);
+  }
+  size_t slot = (pending.head + pending.count) % options_.max_pending;
+  pending.leases[slot] = std::move(*lease);
+  pending.timestamps[slot] = timestamp_us;
+  ++pending.count;
+
+  Match();
+  return true;
+}
+
+void FrameSynchronizer::DropHead(Pending* pending) {
+  pending->consumed_us = pending->timestamps[pending->head];
+  pending->has_consumed = true;
+  pending->leases[pending->head].Release();
+  pending->head = (pending->head + 1) % options_.max_pending;
+  --pending->count;
+}
+
+void FrameSynchronizer::Match() {
+  if (cameras_.empty()) {
+    return;
+  }
+  while (true) {
+    size_t earliest = 0;
+    int64_t min_us = 0;
+    int64_t max_us = 0;
+    for (size_t c = 0; c < cameras_.size(); ++c) {
+      const Pending& pending = cameras_[c];
+      if (pending.count == 0) {
+        return;
+      }
+      int64_t timestamp_us = pending.timestamps[pending.head];
+      if (c == 0 || timestamp_us < min_us) {
+        min_us = timestamp_us;
+        earliest = c;
+      }
+      if (c == 0 || timestamp_us > max_us) {
+        max_us = timestamp_us;
+      }
+    }
+
+    // 其他队首都晚于最早的队首超过容差，之后的帧只会更晚
+    if (max_us - min_us > options_.tolerance_us) {
+      DropHead(&cameras_[earliest]);
+      unmatched_.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+
+    for (size_t c = 0; c < cameras_.size(); ++c) {
+      Pending& pending = cameras_[c];
+      pending.consumed_us = pending.timestamps[pending.head];
+      pending.has_consumed = true;
+      set_.frames[c] = std::move(pending.leases[pending.head]);
+      pending.head = (pending.head + 1) % options_.max_pending;
+      --pending.count;
+    }
+    set_.timestamp_us = min_us;
+    set_.spread_us = max_us - min_us;
+    groups_.fetch_add(1, std::memory_order_relaxed);
+    total_spread_us_.fetch_add(set_.spread_us, std::memory_order_relaxed);
+    if (set_.spread_us > max_spread_us_.load(std::memory_order_relaxed)) {
+      max_spread_us_.store(set_.spread_us, std::memory_order_relaxed);
+    }
+
+    if (callback_) {
+      callback_(&set_);
+    }
+    for (FrameLease& frame : set_.frames) {
+      frame.Release();
+    }
+  }
+}
+
+void FrameSynchronizer::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (Pending& pending : cameras_) {
+    while (pending.count > 0) {
+      DropHead(&pending);
+    }
+    pending.has_consumed = false;
+  }
+}
+
+void FrameSynchronizer::GetStats(FrameSyncStats* stats) const {
+  stats->frames = frames_.load(std::memory_order_relaxed);
+  stats->groups = groups_.load(std::memory_order_relaxed);
+  stats->unmatched = unmatched_.load(std::memory_order_relaxed);
+  stats->late = late_.load(std::memory_order_relaxed);
+  stats->overflow = overflow_.load(std::memory_order_relaxed);
+  stats->max_spread_us = max_spread_us_.load(std::memory_order_relaxed);
+  stats->avg_spread_us =
+      stats->groups > 0
+          ? static_cast<double>(
+                total_spread_us_.load(std::memory_order_relaxed)) /
+                stats->groups
+          : 0;
+}
+
+}  // namespace v4l2_demo
@@ -0,0 +1,111 @@
+#ifndef V4L2_DEMO_SRC_COMMON_FRAME_SYNCHRONIZER_H_
+#define V4L2_DEMO_SRC_COMMON_FRAME_SYNCHRONIZER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "v4l2_utils.h"
+
+namespace v4l2_demo {
+
+// 帧同步器配置
+struct FrameSyncOptions {
+  size_t camera_count = 2;  // 参与同步的摄像头数量，ID 为 0 到 camera_count-1
+  // 同一组内最早与最晚时间戳之差的上限，应小于半个帧周期，
+  // 否则相邻两帧都可能落在窗口内
+  int64_t tolerance_us = 8000;
+  // 每个摄像头最多持有的待匹配租约数，必须小于该设备的缓冲区数量；
+  // 某个摄像头停止出帧时，其余摄像头的旧帧按此上限被释放
+  size_t max_pending = 2;
+};
+
+// 按时间戳分组的一组帧
+struct FrameSet {
+  int64_t timestamp_us;  // 组内最早的时间戳
+  int64_t spread_us;     // 组内最晚与最早时间戳之差
+  std::vector<FrameLease> frames;  // 按摄像头 ID 排列
+};
+
+// 帧同步统计
+struct FrameSyncStats {
+  uint64_t frames;         // Push 的帧数
+  uint64_t groups;         // 输出的帧组数
+  uint64_t unmatched;      // 容差内没有其他摄像头的帧而被丢弃的帧数
+  uint64_t late;           // 到达时对应的帧组已输出或已放弃的帧数
+  uint64_t overflow;       // 待匹配队列已满被丢弃的帧数（有摄像头停止出帧）
+  int64_t max_spread_us;   // 帧组内时间戳差的最大值
+  double avg_spread_us;    // 帧组内时间戳差的平均值
+};
+
+// 多摄像头帧同步器
+// 按驱动时间戳（CLOCK_MONOTONIC，即 v4l2_buffer.timestamp）把各摄像头的
+// 帧分组：每个摄像头的待匹配帧按到达顺序排队，各队首时间戳之差在容差内
+// 时输出一组；否则最早的队首不可能再与之后的帧匹配，直接释放
+// 只转移租约，不拷贝帧数据；待匹配与输出的帧都占用驱动缓冲区
+// 驱动时间戳不是单调时钟时（如 COPY 类型）改用出队时间
+// Push 可在多个捕获线程调用（内部加锁），帧组回调在持锁时调用
+class FrameSynchronizer {
+ public:
+  // 帧组回调，组内租约在回调返回后释放；
+  // 如需延长持有时间，可在回调中 std::move 转移各个租约
+  using FrameSetCallback = std::function<void(FrameSet* set)>;
+
+  FrameSynchronizer(const FrameSyncOptions& options,
+                    FrameSetCallback callback);
+  ~FrameSynchronizer();
+
+  FrameSynchronizer(const FrameSynchronizer&) = delete;
+  FrameSynchronizer& operator=(const FrameSynchronizer&) = delete;
+
+  // 提交一帧，凑齐一组时在当前线程调用回调
+  // @param camera_id 摄像头 ID
+  // @param lease 帧租约，调用后被转移给同步器
+  // @return 被保留或已输出返回 true，被丢弃返回 false
+  bool Push(int camera_id, FrameLease* lease);
+
+  // 释放所有待匹配的租约（停止视频流前调用）
+  void Clear();
+
+  // 获取统计信息（可在任意线程调用）
+  void GetStats(FrameSyncStats* stats) const;
+
+ private:
+  // 一个摄像头的待匹配帧（定长环，按时间戳递增）
+  struct Pending {
+    std::unique_ptr<FrameLease[]> leases;
+    std::unique_ptr<int64_t[]> timestamps;
+    size_t head;
+    size_t count;
+    int64_t consumed_us;  // 最近一个被输出或丢弃的帧的时间戳
+    bool has_consumed;
+  };
+
+  // 出队并释放某个摄像头最早的待匹配帧
+  void DropHead(Pending* pending);
+
+  // 队列都不为空时尽可能多地输出帧组
+  void Match();
+
+  FrameSyncOptions options_;
+  FrameSetCallback callback_;
+  std::mutex mutex_;
+  std::vector<Pending> cameras_;
+  FrameSet set_;  // 复用的帧组，避免每组分配内存
+
+  std::atomic<uint64_t> frames_;
+  std::atomic<uint64_t> groups_;
+  std::atomic<uint64_t> unmatched_;
+  std::atomic<uint64_t> late_;
+  std::atomic<uint64_t> overflow_;
+  std::atomic<int64_t> max_spread_us_;
+  std::atomic<int64_t> total_spread_us_;
+};
+
+}  // namespace v4l2_demo
+
+#endif  // V4L2_DEMO_SRC_COMMON_FRAME_SYNCHRONIZER_H_
@@ -0,0 +1,405 @@
+#include "frame_writer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <utility>
+
+namespace v4l2_demo {
+
+namespace {
+// 阻塞策略下等待空位的单次超时，超时后重新检查
+constexpr int kSpaceWaitTimeoutMs = 100;
+
+void SignalEventFd(int fd) {
+  uint64_t value = 1;
+  ssize_t ret = write(fd, &value, sizeof(value));
+  (void)ret;
+}
+
+void ClearEventFd(int fd) {
+  uint64_t value;
+  ssize_t ret = read(fd, &value, sizeof(value));
+  (void)ret;
+}
+
+void UpdateMax(std::atomic<uint64_t>* target, uint64_t value) {
+  uint64_t current = target->load(std::memory_order_relaxed);
+  while (value > current &&
+         !target->compare_exchange_weak(current, value,
+                                        std::memory_order_relaxed)) {
+  }
+}
+}  // namespace
+
+FrameWriter::FrameWriter(const FrameWriterOptions& options)
+    : options_(options),
+      jobs_(options.queue_capacity + options.max_batch),
+      pending_(options.queue_capacity),
+      free_(options.queue_capacity + options.max_batch),
+      stopping_(false),
+      work_fd_(-1),
+      space_fd_(-1),
+      submitted_(0),
+      written_(0),
+      dropped_(0),
+      failed_(0),
+      bytes_written_(0),
+      latency_sum_us_(0),
+      max_latency_us_(0),
+      max_queue_depth_(0) {
+  if (options_.max_batch == 0) {
+    options_.max_batch = 1;
+  }
+  for (uint32_t i = 0; i < jobs_.size(); ++i) {
+    jobs_[i].data = nullptr;
+    jobs_[i].size = 0;
+    jobs_[i].container = nullptr;
+    jobs_[i].timestamp_us = 0;
+    jobs_[i].sequence = 0;
+    jobs_[i].flags = 0;
+    jobs_[i].enqueue_time_us = 0;
+    local_free_.push_back(i);
+  }
+}
+
+FrameWriter::~FrameWriter() {
+  Stop();
+  if (work_fd_ >= 0) {
+    close(work_fd_);
+  }
+  if (space_fd_ >= 0) {
+    close(space_fd_);
+  }
+}
+
+bool FrameWriter::Start() {
+  if (thread_.joinable()) {
+    return true;
+  }
+
+  if (work_fd_ < 0) {
+    work_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    space_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (work_fd_ < 0 || space_fd_ < 0) {
+      fprintf(stderr, "创建 eventfd 失败: %s\n", strerror(errno));
+      return false;
+    }
+  }
+
+  stopping_ = false;
+  thread_ = std::thread(&FrameWriter::WriterLoop, this);
+  return true;
+}
+
+void FrameWriter::Stop() {
+  if (!thread_.joinable()) {
+    return;
+  }
+  stopping_ = true;
+  SignalEventFd(work_fd_);
+  thread_.join();
+}
+
+bool FrameWriter::SubmitLease(FrameLease* lease, const std::string& path) {
+  if (!lease || !lease->IsValid()) {
+    return false;
+  }
+
+  int id = AcquireJob();
+  if (id < 0) {
+    lease->Release();
+    return false;
+  }
+
+  WriteJob& job = jobs_[id];
+  if (!AttachLease(&job, lease)) {
+    local_free_.push_back(id);
+    return false;
+  }
+  job.path = path;
+  job.container = nullptr;
+  return EnqueueJob(id);
+}
+
+bool FrameWriter::SubmitLease(FrameLease* lease, ContainerWriter* container) {
+  if (!lease || !lease->IsValid() || !container) {
+    if (lease) {
+      lease->Release();
+    }
+    return false;
+  }
+
+  int id = AcquireJob();
+  if (id < 0) {
+    lease->Release();
+    return false;
+  }
+
+  WriteJob& job = jobs_[id];
+  job.timestamp_us = lease->timestamp_us();
+  job.sequence = lease->sequence();
+  job.flags = lease->flags();
+  if (!AttachLease(&job, lease)) {
+    local_free_.push_back(id);
+    return false;
+  }
+  job.path.clear();
+  job.container = container;
+  return EnqueueJob(id);
+}
+
+bool FrameWriter::AttachLease(WriteJob* job, FrameLease* lease) {
+  if (lease->plane_count() <= 1) {
+    job->lease = std::move(*lease);
+    job->data = job->lease.data();
+    job->size = job->lease.size();
+    return true;
+  }
+
+  // 多内存平面格式（如 NV12M）各平面不连续，按平面顺序拼接到池化缓冲区，
+  // 写出完整的帧后立即归还驱动缓冲区
+  size_t size = 0;
+  for (uint32_t p = 0; p < lease->plane_count(); ++p) {
+    if (!lease->plane_data(p)) {
+      fprintf(stderr, "帧平面 %u 没有 CPU 映射，无法写入\n", p);
+      lease->Release();
+      return false;
+    }
+    size += lease->plane_size(p);
+  }
+  if (job->copy.size() < size) {
+    job->copy.resize(size);
+  }
+  size_t offset = 0;
+  for (uint32_t p = 0; p < lease->plane_count(); ++p) {
+    memcpy(job->copy.data() + offset, lease->plane_data(p),
+           lease->plane_size(p));
+    offset += lease->plane_size(p);
+  }
+  lease->Release();
+  job->data = job->copy.data();
+  job->size = size;
+  return true;
+}
+
+bool FrameWriter::SubmitCopy(const void* data, size_t size,
+                             const std::string& path) {
+  if (!data) {
+    return false;
+  }
+
+  int id = AcquireJob();
+  if (id < 0) {
+    return false;
+  }
+
+  // 池化缓冲区只在第一次或帧变大时扩容
+  WriteJob& job = jobs_[id];
+  if (job.copy.size() < size) {
+    job.copy.resize(size);
+  }
+  memcpy(job.copy.data(), data, size);
+  job.data = job.copy.data();
+  job.size = size;
+  job.path = path;
+  job.container = nullptr;
+  return EnqueueJob(id);
+}
+
+int FrameWriter::AcquireJob() {
+  while (true) {
+    if (!local_free_.empty()) {
+      uint32_t id = local_free_.back();
+      local_free_.pop_back();
+      return id;
+    }
+
+    uint32_t id;
+    if (free_.TryPop(&id)) {
+      return id;
+    }
+
+    // 所有槽位都在队列中或正在写入
+    switch (options_.overflow_policy) {
+      case OverflowPolicy::kDropOldest:
+        if (pending_.DropOldest(&id)) {
+          DiscardJob(id);
+          dropped_.fetch_add(1, std::memory_order_relaxed);
+          continue;
+        }
+        // 队列为空（全部正在写入），只能丢弃新帧
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return -1;
+      case OverflowPolicy::kDropNewest:
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return -1;
+      case OverflowPolicy::kBlock:
+        WaitForSpace();
+        continue;
+    }
+  }
+}
+
+bool FrameWriter::EnqueueJob(uint32_t id) {
+  jobs_[id].enqueue_time_us = MonotonicMicros();
+
+  while (!pending_.TryPush(id)) {
+    uint32_t oldest;
+    switch (options_.overflow_policy) {
+      case OverflowPolicy::kDropOldest:
+        if (pending_.DropOldest(&oldest)) {
+          DiscardJob(oldest);
+          dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+        break;
+      case OverflowPolicy::kDropNewest:
+        DiscardJob(id);
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      case OverflowPolicy::kBlock:
+        WaitForSpace();
+        break;
+    }
+  }
+
+  submitted_.fetch_add(1, std::memory_order_relaxed);
+  size_t depth = pending_.Size();
+  size_t max_depth = max_queue_depth_.load(std::memory_order_relaxed);
+  if (depth > max_depth) {
+    max_queue_depth_.store(depth, std::memory_order_relaxed);
+  }
+  SignalEventFd(work_fd_);
+  return true;
+}
+
+void FrameWriter::DiscardJob(uint32_t id) {
+  jobs_[id].lease.Release();
+  jobs_[id].data = nullptr;
+  jobs_[id].size = 0;
+  local_free_.push_back(id);
+}
+
+void FrameWriter::WaitForSpace() {
+  struct pollfd pfd;
+  pfd.fd = space_fd_;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  if (poll(&pfd, 1, kSpaceWaitTimeoutMs) > 0) {
+    ClearEventFd(space_fd_);
+  }
+}
+
+void FrameWriter::GetStats(FrameWriterStats* stats) const {
+  stats->submitted = submitted_.load(std::memory_order_relaxed);
+  stats->written = written_.load(std::memory_order_relaxed);
+  stats->dropped = dropped_.load(std::memory_order_relaxed);
+  stats->failed = failed_.load(std::memory_order_relaxed);
+  stats->bytes_written = bytes_written_.load(std::memory_order_relaxed);
+  stats->queue_depth = pending_.Size();
+  stats->max_queue_depth = max_queue_depth_.load(std::memory_order_relaxed);
+
+  uint64_t completed = stats->written + stats->failed;
+  stats->avg_latency_ms =
+      completed > 0
+          ? latency_sum_us_.load(std::memory_order_relaxed) / 1000.0 /
+                completed
+          : 0;
+  stats->max_latency_ms =
+      max_latency_us_.load(std::memory_order_relaxed) / 1000.0;
+}
+
+void FrameWriter::WriterLoop() {
+  std::vector<uint32_t> batch;
+  batch.reserve(options_.max_batch);
+
+  while (true) {
+    // 一次唤醒取出一批任务，减少唤醒次数
+    batch.clear();
+    uint32_t id;
+    while (batch.size() < options_.max_batch && pending_.TryPop(&id)) {
+      batch.push_back(id);
+    }
+
+    if (batch.empty()) {
+      if (stopping_) {
+        break;
+      }
+      struct pollfd pfd;
+      pfd.fd = work_fd_;
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+      if (poll(&pfd, 1, -1) > 0) {
+        ClearEventFd(work_fd_);
+      }
+      continue;
+    }
+
+    for (uint32_t job_id : batch) {
+      WriteJob& job = jobs_[job_id];
+      bool ok = job.container
+                    ? job.container->WriteFrame(job.data, job.size,
+                                                job.timestamp_us,
+                                                job.sequence, job.flags)
+                    : WriteJobToFile(&job);
+      if (ok) {
+        written_.fetch_add(1, std::memory_order_relaxed);
+        bytes_written_.fetch_add(job.size, std::memory_order_relaxed);
+      } else {
+        failed_.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      uint64_t latency_us = MonotonicMicros() - job.enqueue_time_us;
+      latency_sum_us_.fetch_add(latency_us, std::memory_order_relaxed);
+      UpdateMax(&max_latency_us_, latency_us);
+
+      // 写完立即归还驱动缓冲区
+      job.lease.Release();
+      job.data = nullptr;
+      job.size = 0;
+      free_.TryPush(job_id);
+    }
+
+    if (options_.overflow_policy == OverflowPolicy::kBlock) {
+      SignalEventFd(space_fd_);
+    }
+  }
+}
+
+bool FrameWriter::WriteJobToFile(WriteJob* job) {
+  int fd = open(job->path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                0644);
+  if (fd < 0) {
+    fprintf(stderr, "无法打开文件 %s 进行写入: %s\n", job->path.c_str(),
+            strerror(errno));
+    return false;
+  }
+
+  const uint8_t* data = static_cast<const uint8_t*>(job->data);
+  size_t remaining = job->size;
+  bool ok = true;
+  while (remaining > 0) {
+    ssize_t n = write(fd, data, remaining);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fprintf(stderr, "写入文件 %s 失败: %s\n", job->path.c_str(),
+              strerror(errno));
+      ok = false;
+      break;
+    }
+    data += n;
+    remaining -= n;
+  }
+
+  close(fd);
+  return ok;
+}
+
+}  // namespace v4l2_demo
@@ -0,0 +1,150 @@
+#ifndef V4L2_DEMO_SRC_COMMON_FRAME_WRITER_H_
+#define V4L2_DEMO_SRC_COMMON_FRAME_WRITER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "frame_container.h"
+#include "spsc_queue.h"
+#include "v4l2_utils.h"
+
+namespace v4l2_demo {
+
+// 写入队列满时的处理策略
+enum class OverflowPolicy {
+  kDropOldest,  // 丢弃队列中最旧的帧，保留新帧
+  kDropNewest,  // 丢弃新提交的帧
+  kBlock,       // 阻塞提交线程直到有空位
+};
+
+// 异步写入器配置
+struct FrameWriterOptions {
+  size_t queue_capacity = 8;  // 队列容量（向上取整为 2 的幂）
+  size_t max_batch = 4;       // 写入线程每次唤醒最多处理的帧数
+  OverflowPolicy overflow_policy = OverflowPolicy::kDropOldest;
+};
+
+// 异步写入器统计
+struct FrameWriterStats {
+  uint64_t submitted;       // 进入队列的帧数（含之后被挤出的最旧帧）
+  uint64_t written;         // 写入成功的帧数
+  uint64_t dropped;         // 因队列满被丢弃的帧数
+  uint64_t failed;          // 写入失败的帧数
+  uint64_t bytes_written;   // 累计写入字节数
+  size_t queue_depth;       // 当前队列深度
+  size_t max_queue_depth;   // 历史最大队列深度
+  double avg_latency_ms;    // 平均延迟（提交到写完）
+  double max_latency_ms;    // 最大延迟
+};
+
+// 异步帧写入器：捕获线程通过无锁 SPSC 队列提交帧，
+// 独立的写入线程负责落盘，磁盘 I/O 不再阻塞捕获线程
+// Submit* 只能在同一个线程（生产者）中调用
+class FrameWriter {
+ public:
+  explicit FrameWriter(const FrameWriterOptions& options = FrameWriterOptions());
+  ~FrameWriter();
+
+  FrameWriter(const FrameWriter&) = delete;
+  FrameWriter& operator=(const FrameWriter&) = delete;
+
+  // 启动写入线程
+  // @return 成功返回 true，失败返回 false
+  bool Start();
+
+  // 写完队列中剩余的帧后停止写入线程
+  void Stop();
+
+  // 提交帧租约（零拷贝），写入完成后租约被释放；多内存平面格式的帧
+  // 各平面拼接拷贝后立即释放租约
+  // 注意：排队中的租约会占用驱动缓冲区，队列容量应小于缓冲区数量
+  // @param lease 帧租约，调用后总是被转移走（被丢弃时立即释放）
+  // @param path 输出文件路径
+  // @return 进入队列返回 true，被丢弃返回 false
+  bool SubmitLease(FrameLease* lease, const std::string& path);
+
+  // 提交帧租约（零拷贝），由写入线程连同驱动时间戳、帧序号追加到录制容器；
+  // 多内存平面格式同上拼接拷贝
+  // @param lease 帧租约，调用后总是被转移走（被丢弃时立即释放）
+  // @param container 已打开的录制写入器，之后只能由写入线程访问，
+  //        须在 Stop 之后才能关闭
+  // @return 进入队列返回 true，被丢弃返回 false
+  bool SubmitLease(FrameLease* lease, ContainerWriter* container);
+
+  // 提交帧数据副本，拷贝到预分配的池化缓冲区后立即返回
+  // @param data 帧数据
+  // @param size 帧数据大小
+  // @param path 输出文件路径
+  // @return 进入队列返回 true，被丢弃返回 false
+  bool SubmitCopy(const void* data, size_t size, const std::string& path);
+
+  // 获取统计信息（可在任意线程调用）
+  void GetStats(FrameWriterStats* stats) const;
+
+ private:
+  // 写入任务，池化复用，稳定后不再分配内存
+  struct WriteJob {
+    FrameLease lease;           // 零拷贝模式持有的租约
+    std::vector<uint8_t> copy;  // 拷贝模式的池化缓冲区
+    const void* data;           // 待写入数据
+    size_t size;                // 待写入大小
+    std::string path;           // 输出文件路径
+    ContainerWriter* container;  // 非空时追加到录制容器而不是写文件
+    int64_t timestamp_us;       // 驱动时间戳（录制容器用）
+    uint32_t sequence;          // 驱动帧序号（录制容器用）
+    uint32_t flags;             // v4l2_buffer.flags（录制容器用）
+    int64_t enqueue_time_us;    // 提交时间
+  };
+
+  // 获取一个空闲任务槽位，必要时按溢出策略处理
+  // @return 成功返回槽位索引，放弃提交返回 -1
+  int AcquireJob();
+
+  // 将租约的数据挂到任务上：单平面帧直接引用驱动缓冲区，
+  // 多内存平面帧拼接拷贝到任务的池化缓冲区后释放租约
+  // @param job 任务槽位
+  // @param lease 帧租约，调用后总是被转移走或释放
+  // @return 成功返回 true，平面无法读取时返回 false
+  bool AttachLease(WriteJob* job, FrameLease* lease);
+
+  // 将填充好的任务入队，必要时按溢出策略处理
+  // @return 进入队列返回 true，被丢弃返回 false
+  bool EnqueueJob(uint32_t id);
+
+  // 丢弃任务：释放租约并放回生产者本地空闲列表
+  void DiscardJob(uint32_t id);
+
+  // 等待写入线程归还槽位（阻塞策略）
+  void WaitForSpace();
+
+  void WriterLoop();
+  bool WriteJobToFile(WriteJob* job);
+
+  FrameWriterOptions options_;
+  std::vector<WriteJob> jobs_;        // 任务池
+  SpscQueue<uint32_t> pending_;       // 生产者 -> 写入线程
+  SpscQueue<uint32_t> free_;          // 写入线程 -> 生产者
+  std::vector<uint32_t> local_free_;  // 生产者本地回收的槽位
+
+  std::thread thread_;
+  std::atomic<bool> stopping_;
+  int work_fd_;   // eventfd：通知写入线程有新任务
+  int space_fd_;  // eventfd：通知生产者有空闲槽位
+
+  std::atomic<uint64_t> submitted_;
+  std::atomic<uint64_t> written_;
+  std::atomic<uint64_t> dropped_;
+  std::atomic<uint64_t> failed_;
+  std::atomic<uint64_t> bytes_written_;
+  std::atomic<uint64_t> latency_sum_us_;
+  std::atomic<uint64_t> max_latency_us_;
+  std::atomic<size_t> max_queue_depth_;
+};
+
+}  // namespace v4l2_demo
+
+#endif  // V4L2_DEMO_SRC_COMMON_FRAME_WRITER_H_
@@ -0,0 +1,316 @@
+#include "jpeg_decoder.h"
+
+#include <linux/videodev2.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <jpeglib.h>
+
+#include "format_converter.h"
+
+namespace v4l2_demo {
+
+namespace {
+
+// 错误处理：libjpeg 默认 error_exit 会调用 exit()，改为 longjmp 回 Decode
+struct ErrorManager {
+  struct jpeg_error_mgr pub;
+  jmp_buf jump;
+  char message[JMSG_LENGTH_MAX];
+};
+
+void HandleErrorExit(j_common_ptr cinfo) {
+  ErrorManager* err = reinterpret_cast<ErrorManager*>(cinfo->err);
+  (*cinfo->err->format_message)(cinfo, err->message);
+  longjmp(err->jump, 1);
+}
+
+// MJPEG 流中常见"Corrupt JPEG data"一类警告，不逐帧打印
+void HandleOutputMessage(j_common_ptr /* cinfo */) {}
+
+// 4:2:0（h2v2）或 4:2:2（h2v1）的 YCbCr 可以走 raw_data_out
+bool IsRawYuvCompatible(const struct jpeg_decompress_struct& cinfo) {
+  if (cinfo.jpeg_color_space != JCS_YCbCr || cinfo.num_components != 3) {
+    return false;
+  }
+  const jpeg_component_info* comp = cinfo.comp_info;
+  return comp[0].h_samp_factor == 2 &&
+         (comp[0].v_samp_factor == 1 || comp[0].v_samp_factor == 2) &&
+         comp[1].h_samp_factor == 1 && comp[1].v_samp_factor == 1 &&
+         comp[2].h_samp_factor == 1 && comp[2].v_samp_factor == 1;
+}
+
+// 写一行色度：I420 写入 U/V 平面，NV12 交织写入 UV 平面
+void StoreChromaRow(uint32_t dst_format, const uint8_t* u, const uint8_t* v,
+                    uint32_t chroma_width, uint8_t* u_plane,
+                    uint8_t* v_plane, uint32_t row) {
+  if (dst_format == V4L2_PIX_FMT_NV12) {
+    uint8_t* out = u_plane + static_cast<size_t>(row) * chroma_width * 2;
+    for (uint32_t x = 0; x < chroma_width; ++x) {
+      out[2 * x] = u[x];
+      out[2 * x + 1] = v[x];
+    }
+  } else {
+    memcpy(u_plane + static_cast<size_t>(row) * chroma_width, u,
+           chroma_width);
+    memcpy(v_plane + static_cast<size_t>(row) * chroma_width, v,
+           chroma_width);
+  }
+}
+
+}  // namespace
+
+struct JpegDecoder::Context {
+  struct jpeg_decompress_struct cinfo;
+  ErrorManager err;
+  uint32_t width;
+  uint32_t height;
+};
+
+JpegDecoder::JpegDecoder() : context_(new Context) {
+  memset(context_, 0, sizeof(*context_));
+  context_->cinfo.err = jpeg_std_error(&context_->err.pub);
+  context_->err.pub.error_exit = HandleErrorExit;
+  context_->err.pub.output_message = HandleOutputMessage;
+  jpeg_create_decompress(&context_->cinfo);
+}
+
+JpegDecoder::~JpegDecoder() {
+  jpeg_destroy_decompress(&context_->cinfo);
+  delete context_;
+}
+
+bool JpegDecoder::IsSupported(uint32_t dst_format) {
+  return dst_format == V4L2_PIX_FMT_NV12 ||
+         dst_format == V4L2_PIX_FMT_YUV420 ||
+         dst_format == V4L2_PIX_FMT_RGB24 || dst_format == V4L2_PIX_FMT_ABGR32;
+}
+
+const char* JpegDecoder::GetLastError() const {
+  return context_->err.message;
+}
+
+bool JpegDecoder::ReadHeader(const void* src, size_t src_size,
+                             uint32_t* width, uint32_t* height) {
+  if (!src || src_size == 0 || !width || !height) {
+    return false;
+  }
+
+  struct jpeg_decompress_struct* cinfo = &context_->cinfo;
+  if (setjmp(context_->err.jump)) {
+    jpeg_abort_decompress(cinfo);
+    return false;
+  }
+
+  jpeg_mem_src(cinfo, static_cast<const unsigned char*>(src), src_size);
+  jpeg_read_header(cinfo, TRUE);
+  *width = cinfo->image_width;
+  *height = cinfo->image_height;
+  jpeg_abort_decompress(cinfo);
+  return true;
+}
+
+bool JpegDecoder::Decode(const void* src, size_t src_size,
+                         uint32_t dst_format, uint32_t width, uint32_t height,
+                         void* dst, size_t dst_size) {
+  context_->err.message[0] = '\0';
+  if (!src || src_size == 0 || !dst || !IsSupported(dst_format) ||
+      dst_size < FormatConverter::GetFrameSize(dst_format, width, height)) {
+    snprintf(context_->err.message, sizeof(context_->err.message),
+             "参数无效或目标缓冲区不足");
+    return false;
+  }
+
+  struct jpeg_decompress_struct* cinfo = &context_->cinfo;
+  if (setjmp(context_->err.jump)) {
+    jpeg_abort_decompress(cinfo);
+    return false;
+  }
+
+  jpeg_mem_src(cinfo, static_cast<const unsigned char*>(src), src_size);
+  jpeg_read_header(cinfo, TRUE);
+  if (cinfo->image_width != width || cinfo->image_height != height) {
+    snprintf(context_->err.message, sizeof(context_->err.message),
+             "尺寸不符: %ux%u，期望 %ux%u", cinfo->image_width,
+             cinfo->image_height, width, height);
+    jpeg_abort_decompress(cinfo);
+    return false;
+  }
+  context_->width = width;
+  context_->height = height;
+
+  bool yuv_output =
+      dst_format == V4L2_PIX_FMT_NV12 || dst_format == V4L2_PIX_FMT_YUV420;
+  uint8_t* out = static_cast<uint8_t*>(dst);
+  if (yuv_output && IsRawYuvCompatible(*cinfo)) {
+    DecodeRawYuv(dst_format, out);
+  } else {
+    DecodeScanlines(dst_format, out);
+  }
+
+  // jpeg_finish_decompress 会校验到 EOI，截断的帧不视为错误
+  jpeg_abort_decompress(cinfo);
+  return true;
+}
+
+bool JpegDecoder::DecodeRawYuv(uint32_t dst_format, uint8_t* dst) {
+  struct jpeg_decompress_struct* cinfo = &context_->cinfo;
+  const uint32_t width = context_->width;
+  const uint32_t height = context_->height;
+  const uint32_t chroma_width = (width + 1) / 2;
+  const uint32_t chroma_height = (height + 1) / 2;
+
+  cinfo->raw_data_out = TRUE;
+  cinfo->out_color_space = JCS_YCbCr;
+  jpeg_start_decompress(cinfo);
+
+  // 每次读取一个 iMCU 行：Y 为 v_samp * 8 行，Cb/Cr 各 8 行
+  const bool h2v2 = cinfo->comp_info[0].v_samp_factor == 2;
+  const uint32_t luma_rows = h2v2 ? 2 * DCTSIZE : DCTSIZE;
+  const size_t luma_stride = cinfo->comp_info[0].width_in_blocks * DCTSIZE;
+  const size_t chroma_stride = cinfo->comp_info[1].width_in_blocks * DCTSIZE;
+
+  // 行宽恰好无填充时 Y 直接解码到目标缓冲区，否则经过行缓冲
+  const bool luma_direct = (luma_stride == width);
+  scratch_.resize(luma_rows * luma_stride + 2 * DCTSIZE * chroma_stride);
+  uint8_t* luma_scratch = scratch_.data();
+  uint8_t* u_scratch = luma_scratch + luma_rows * luma_stride;
+  uint8_t* v_scratch = u_scratch + DCTSIZE * chroma_stride;
+
+  uint8_t* u_plane = dst + static_cast<size_t>(width) * height;
+  uint8_t* v_plane =
+      u_plane + static_cast<size_t>(chroma_width) * chroma_height;
+
+  JSAMPROW y_rows[2 * DCTSIZE];
+  JSAMPROW u_rows[DCTSIZE];
+  JSAMPROW v_rows[DCTSIZE];
+  JSAMPARRAY planes[3] = {y_rows, u_rows, v_rows};
+  for (uint32_t i = 0; i < DCTSIZE; ++i) {
+    u_rows[i] = u_scratch + i * chroma_stride;
+    v_rows[i] = v_scratch + i * chroma_stride;
+  }
+
+  while (cinfo->output_scanline < cinfo->output_height) {
+    const uint32_t base = cinfo->output_scanline;
+    for (uint32_t i = 0; i < luma_rows; ++i) {
+      uint32_t row = base + i;
+      y_rows[i] = (luma_direct && row < height)
+                      ? dst + static_cast<size_t>(row) * width
+                      : luma_scratch + i * luma_stride;
+    }
+
+    if (jpeg_read_raw_data(cinfo, planes, luma_rows) == 0) {
+      break;
+    }
+
+    if (!luma_direct) {
+      for (uint32_t i = 0; i < luma_rows && base + i < height; ++i) {
+        memcpy(dst + static_cast<size_t>(base + i) * width, y_rows[i], width);
+      }
+    }
+
+    if (h2v2) {
+      // 4:2:0：色度行与输出一一对应
+      for (uint32_t i = 0; i < DCTSIZE; ++i) {
+        uint32_t row = base / 2 + i;
+        if (row >= chroma_height) {
+          break;
+        }
+        StoreChromaRow(dst_format, u_rows[i], v_rows[i], chroma_width,
+                       u_plane, v_plane, row);
+      }
+    } else {
+      // 4:2:2：相邻两行色度取平均得到 4:2:0
+      for (uint32_t i = 0; i < DCTSIZE; i += 2) {
+        uint32_t row = (base + i) / 2;
+        if (row >= chroma_height) {
+          break;
+        }
+        for (uint32_t x = 0; x < chroma_width; ++x) {
+          u_rows[i][x] = (u_rows[i][x] + u_rows[i + 1][x] + 1) >> 1;
+          v_rows[i][x] = (v_rows[i][x] + v_rows[i + 1][x] + 1) >> 1;
+        }
+        StoreChromaRow(dst_format, u_rows[i], v_rows[i], chroma_width,
+                       u_plane, v_plane, row);
+      }
+    }
+  }
+  return true;
+}
+
+bool JpegDecoder::DecodeScanlines(uint32_t dst_format, uint8_t* dst) {
+  struct jpeg_decompress_struct* cinfo = &context_->cinfo;
+  const uint32_t width = context_->width;
+  const uint32_t height = context_->height;
+
+  // RGB24 / BGRA 由 libjpeg 直接输出到目标行
+  if (dst_format == V4L2_PIX_FMT_RGB24 || dst_format == V4L2_PIX_FMT_ABGR32) {
+    const size_t bytes_per_pixel = (dst_format == V4L2_PIX_FMT_RGB24) ? 3 : 4;
+    cinfo->out_color_space =
+        (dst_format == V4L2_PIX_FMT_RGB24) ? JCS_RGB : JCS_EXT_BGRA;
+    jpeg_start_decompress(cinfo);
+    while (cinfo->output_scanline < cinfo->output_height) {
+      JSAMPROW row = dst + static_cast<size_t>(cinfo->output_scanline) *
+                               width * bytes_per_pixel;
+      if (jpeg_read_scanlines(cinfo, &row, 1) == 0) {
+        break;
+      }
+    }
+    return true;
+  }
+
+  // 其他采样方式（4:4:4、灰度等）：逐行输出 YCbCr 后按 2x2 下采样色度
+  cinfo->out_color_space =
+      (cinfo->jpeg_color_space == JCS_GRAYSCALE) ? JCS_GRAYSCALE : JCS_YCbCr;
+  jpeg_start_decompress(cinfo);
+  const int components = cinfo->output_components;
+  const uint32_t chroma_width = (width + 1) / 2;
+  const uint32_t chroma_height = (height + 1) / 2;
+  uint8_t* u_plane = dst + static_cast<size_t>(width) * height;
+  uint8_t* v_plane =
+      u_plane + static_cast<size_t>(chroma_width) * chroma_height;
+
+  const size_t row_bytes = static_cast<size_t>(width) * components;
+  scratch_.resize(row_bytes * 2 + chroma_width * 2);
+  uint8_t* rows[2] = {scratch_.data(), scratch_.data() + row_bytes};
+  uint8_t* u_row = rows[1] + row_bytes;
+  uint8_t* v_row = u_row + chroma_width;
+
+  for (uint32_t y = 0; y < height; y += 2) {
+    for (int i = 0; i < 2; ++i) {
+      JSAMPROW row = rows[i];
+      if (cinfo->output_scanline >= cinfo->output_height ||
+          jpeg_read_scanlines(cinfo, &row, 1) == 0) {
+        memcpy(rows[i], rows[0], row_bytes);  // 奇数高度的最后一行
+      }
+    }
+
+    for (int i = 0; i < 2 && y + i < height; ++i) {
+      uint8_t* out = dst + static_cast<size_t>(y + i) * width;
+      for (uint32_t x = 0; x < width; ++x) {
+        out[x] = rows[i][x * components];
+      }
+    }
+
+    for (uint32_t x = 0; x < chroma_width; ++x) {
+      if (components == 1) {
+        u_row[x] = 128;
+        v_row[x] = 128;
+        continue;
+      }
+      uint32_t x1 = (2 * x + 1 < width) ? 2 * x + 1 : 2 * x;
+      const uint8_t* a = rows[0];
+      const uint8_t* b = rows[1];
+      u_row[x] = (a[2 * x * 3 + 1] + a[x1 * 3 + 1] + b[2 * x * 3 + 1] +
+                  b[x1 * 3 + 1] + 2) >> 2;
+      v_row[x] = (a[2 * x * 3 + 2] + a[x1 * 3 + 2] + b[2 * x * 3 + 2] +
+                  b[x1 * 3 + 2] + 2) >> 2;
+    }
+    StoreChromaRow(dst_format, u_row, v_row, chroma_width, u_plane, v_plane,
+                   y / 2);
+  }
+  return true;
+}
+
+}  // namespace v4l2_demo
@@ -0,0 +1,61 @@
+#ifndef V4L2_DEMO_SRC_COMMON_JPEG_DECODER_H_
+#define V4L2_DEMO_SRC_COMMON_JPEG_DECODER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace v4l2_demo {
+
+// 基于 libjpeg(-turbo) 的 JPEG/MJPEG 解码器
+// 输出格式与 FormatConverter 的目标格式一致：NV12、YUV420(I420)、RGB24、
+// ABGR32(BGRA)。YUV 输出走 raw_data_out 直接取出 YCbCr 平面，跳过色彩
+// 转换与上采样；UVC 摄像头省略的 Huffman 表由 libjpeg-turbo 自动补全
+// 解码器复用内部状态，非线程安全，每个线程使用独立实例
+class JpegDecoder {
+ public:
+  JpegDecoder();
+  ~JpegDecoder();
+
+  JpegDecoder(const JpegDecoder&) = delete;
+  JpegDecoder& operator=(const JpegDecoder&) = delete;
+
+  // 检查是否支持解码到指定格式
+  static bool IsSupported(uint32_t dst_format);
+
+  // 解析 JPEG 头获取图像尺寸
+  // @return 成功返回 true，数据不是有效 JPEG 返回 false
+  bool ReadHeader(const void* src, size_t src_size, uint32_t* width,
+                  uint32_t* height);
+
+  // 解码一帧
+  // @param src JPEG 数据
+  // @param src_size JPEG 数据长度
+  // @param dst_format 目标格式，如 V4L2_PIX_FMT_YUV420
+  // @param width 期望宽度，须与 JPEG 一致
+  // @param height 期望高度，须与 JPEG 一致
+  // @param dst 目标缓冲区，大小至少为 FormatConverter::GetFrameSize(...)
+  // @param dst_size 目标缓冲区大小
+  // @return 成功返回 true；数据损坏、尺寸不符或缓冲区不足返回 false
+  bool Decode(const void* src, size_t src_size, uint32_t dst_format,
+              uint32_t width, uint32_t height, void* dst, size_t dst_size);
+
+  // 获取最近一次失败的原因（libjpeg 错误信息）
+  const char* GetLastError() const;
+
+ private:
+  struct Context;
+
+  Context* context_;  // libjpeg 解码状态与错误处理（隐藏 jpeglib.h）
+  std::vector<uint8_t> scratch_;  // 行缓冲
+
+  // raw_data_out：4:2:0/4:2:2 的 YCbCr 平面直接输出为 I420/NV12
+  bool DecodeRawYuv(uint32_t dst_format, uint8_t* dst);
+
+  // 逐行解码：RGB/BGRA，或其他采样方式解码为 YCbCr 后再下采样
+  bool DecodeScanlines(uint32_t dst_format, uint8_t* dst);
+};
+
+}  // namespace v4l2_demo
+
+#endif  // V4L2_DEMO_SRC_COMMON_JPEG_DECODER_H_
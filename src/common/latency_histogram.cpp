@@ -0,0 +1,112 @@
+#include "latency_histogram.h"
+
+#include <stdio.h>
+
+namespace v4l2_demo {
+
+LatencyHistogram::LatencyHistogram() : count_(0), sum_(0), max_(0) {
+  for (auto& bucket : buckets_) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+size_t LatencyHistogram::BucketIndex(uint64_t value) {
+  if (value < static_cast<uint64_t>(kSubBucketHalf * 2)) {
+    return value;
+  }
+  int msb = 63 - __builtin_clzll(value);
+  int shift = msb - (kSubBucketBits - 1);
+  if (shift > kMaxShift) {
+    return kBucketCount - 1;
+  }
+  return static_cast<size_t>(shift) * kSubBucketHalf + (value >> shift);
+}
+
+uint64_t LatencyHistogram::BucketValue(size_t index) {
+  if (index < static_cast<size_t>(kSubBucketHalf * 2)) {
+    return index;
+  }
+  int shift = index / kSubBucketHalf - 1;
+  uint64_t sub = index - static_cast<size_t>(shift) * kSubBucketHalf;
+  // 取桶的中点作为代表值
+  return (sub << shift) + ((1ULL << shift) >> 1);
+}
+
+void LatencyHistogram::Record(uint64_t value_us) {
+  buckets_[BucketIndex(value_us)].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(value_us, std::memory_order_relaxed);
+
+  uint64_t current = max_.load(std::memory_order_relaxed);
+  while (value_us > current &&
+         !max_.compare_exchange_weak(current, value_us,
+                                     std::memory_order_relaxed)) {
+  }
+}
+
+uint64_t LatencyHistogram::Percentile(double percentile) const {
+  uint64_t total = Count();
+  if (total == 0) {
+    return 0;
+  }
+
+  uint64_t target = static_cast<uint64_t>(percentile / 100.0 * total + 0.5);
+  if (target == 0) {
+    target = 1;
+  }
+
+  uint64_t accumulated = 0;
+  for (size_t i = 0; i < kBucketCount; ++i) {
+    accumulated += buckets_[i].load(std::memory_order_relaxed);
+    if (accumulated >= target) {
+      uint64_t value = BucketValue(i);
+      uint64_t max = Max();
+      return value < max ? value : max;
+    }
+  }
+  return Max();
+}
+
+double LatencyHistogram::Mean() const {
+  uint64_t total = Count();
+  return total > 0 ? static_cast<double>(sum_.load(std::memory_order_relaxed)) /
+                         total
+                   : 0;
+}
+
+void LatencyHistogram::Reset() {
+  for (auto& bucket : buckets_) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+  count_.store(0, std::memory_order_relaxed);
+  sum_.store(0, std::memory_order_relaxed);
+  max_.store(0, std::memory_order_relaxed);
+}
+
+void FrameLatencyTracker::Print() const {
+  const struct {
+    const char* name;
+    const LatencyHistogram* histogram;
+  } rows[] = {
+      {"传感器->出队", &sensor_to_dequeue},
+      {"出队->释放", &dequeue_to_release},
+      {"端到端", &end_to_end},
+  };
+
+  printf("延迟统计 (微秒):\n");
+  for (const auto& row : rows) {
+    const LatencyHistogram* h = row.histogram;
+    printf("  %-12s 样本: %-8lu 平均: %-8.1f p50: %-7lu p99: %-7lu "
+           "p999: %-7lu 最大: %lu\n",
+           row.name, h->Count(), h->Mean(), h->Percentile(50),
+           h->Percentile(99), h->Percentile(99.9), h->Max());
+  }
+}
+
+void FrameLatencyTracker::Reset() {
+  sensor_to_dequeue.Reset();
+  dequeue_to_release.Reset();
+  end_to_end.Reset();
+}
+
+}  // namespace v4l2_demo
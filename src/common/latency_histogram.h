@@ -0,0 +1,68 @@
+#ifndef V4L2_DEMO_SRC_COMMON_LATENCY_HISTOGRAM_H_
+#define V4L2_DEMO_SRC_COMMON_LATENCY_HISTOGRAM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+namespace v4l2_demo {
+
+// 无锁对数-线性延迟直方图（HDR 风格）
+// 每个 2 的幂区间再均分为 16 个子桶，相对误差约 3%，
+// 记录与查询都不加锁，可在多个线程中同时 Record
+class LatencyHistogram {
+ public:
+  LatencyHistogram();
+
+  LatencyHistogram(const LatencyHistogram&) = delete;
+  LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+  // 记录一个样本（微秒）
+  void Record(uint64_t value_us);
+
+  // 获取百分位数（微秒），如 Percentile(99.9)
+  // @return 无样本时返回 0
+  uint64_t Percentile(double percentile) const;
+
+  uint64_t Count() const { return count_.load(std::memory_order_relaxed); }
+  uint64_t Max() const { return max_.load(std::memory_order_relaxed); }
+  double Mean() const;
+
+  // 清空所有样本（与 Record 并发时结果为近似值）
+  void Reset();
+
+ private:
+  static constexpr int kSubBucketBits = 5;  // 每个区间 2^(5-1) = 16 个子桶
+  static constexpr int kSubBucketHalf = 1 << (kSubBucketBits - 1);
+  static constexpr int kMaxShift = 40;  // 支持到约 2^44 微秒
+  static constexpr size_t kBucketCount =
+      (kMaxShift + 1) * kSubBucketHalf + kSubBucketHalf * 2;
+
+  static size_t BucketIndex(uint64_t value);
+  static uint64_t BucketValue(size_t index);
+
+  std::atomic<uint64_t> buckets_[kBucketCount];
+  std::atomic<uint64_t> count_;
+  std::atomic<uint64_t> sum_;
+  std::atomic<uint64_t> max_;
+};
+
+// 单帧各阶段的延迟统计
+//   sensor_to_dequeue：驱动时间戳 -> 应用出队
+//   dequeue_to_release：出队 -> 租约释放（应用处理耗时）
+//   end_to_end：驱动时间戳 -> 租约释放
+// 仅当驱动时间戳为 CLOCK_MONOTONIC 时记录与传感器相关的两项
+struct FrameLatencyTracker {
+  LatencyHistogram sensor_to_dequeue;
+  LatencyHistogram dequeue_to_release;
+  LatencyHistogram end_to_end;
+
+  // 打印 p50/p99/p999 报告
+  void Print() const;
+
+  void Reset();
+};
+
+}  // namespace v4l2_demo
+
+#endif  // V4L2_DEMO_SRC_COMMON_LATENCY_HISTOGRAM_H_
@@ -0,0 +1,806 @@
+#include "m2m_encoder_sink.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace v4l2_demo {
+
+namespace {
+
+// 排空编码器时等待最后一个码流包的超时时间
+constexpr int kDrainTimeoutMs = 1000;
+
+// 单平面缓冲区中的一个图像平面
+struct PlaneLayout {
+  size_t offset;     // 相对缓冲区起始的偏移
+  size_t row_bytes;  // 每行有效字节数
+  uint32_t rows;     // 行数
+  size_t stride;     // 行跨度
+};
+
+// 4:2:0 格式中 Y 平面占用的行数（驱动可能将高度对齐到 16 等），
+// 由 sizeimage = stride * plane_height * 3 / 2 反推
+uint32_t PlaneHeight(uint32_t pixel_format, uint32_t height, uint32_t stride,
+                     uint32_t sizeimage) {
+  if ((pixel_format != V4L2_PIX_FMT_NV12 &&
+       pixel_format != V4L2_PIX_FMT_YUV420) ||
+      stride == 0) {
+    return height;
+  }
+  uint32_t plane_height =
+      static_cast<uint32_t>(static_cast<uint64_t>(sizeimage) * 2 / 3 / stride);
+  return std::max(plane_height, height);
+}
+
+// 计算单平面格式的平面布局
+// @return 平面数，不支持的格式返回 0
+int GetPlaneLayout(uint32_t pixel_format, uint32_t width, uint32_t height,
+                   uint32_t stride, uint32_t plane_height,
+                   PlaneLayout planes[3]) {
+  uint32_t chroma_width = (width + 1) / 2;
+  uint32_t chroma_height = (height + 1) / 2;
+  switch (pixel_format) {
+    case V4L2_PIX_FMT_YUYV:
+    case V4L2_PIX_FMT_UYVY:
+      planes[0] = PlaneLayout{0, static_cast<size_t>(width) * 2, height, stride};
+      return 1;
+    case V4L2_PIX_FMT_RGB24:
+      planes[0] = PlaneLayout{0, static_cast<size_t>(width) * 3, height, stride};
+      return 1;
+    case V4L2_PIX_FMT_ABGR32:
+      planes[0] = PlaneLayout{0, static_cast<size_t>(width) * 4, height, stride};
+      return 1;
+    case V4L2_PIX_FMT_NV12:
+      planes[0] = PlaneLayout{0, width, height, stride};
+      planes[1] = PlaneLayout{static_cast<size_t>(stride) * plane_height,
+                              static_cast<size_t>(chroma_width) * 2,
+                              chroma_height, stride};
+      return 2;
+    case V4L2_PIX_FMT_YUV420: {
+      size_t y_size = static_cast<size_t>(stride) * plane_height;
+      size_t chroma_stride = stride / 2;
+      size_t chroma_size = chroma_stride * ((plane_height + 1) / 2);
+      planes[0] = PlaneLayout{0, width, height, stride};
+      planes[1] = PlaneLayout{y_size, chroma_width, chroma_height,
+                              chroma_stride};
+      planes[2] = PlaneLayout{y_size + chroma_size, chroma_width,
+                              chroma_height, chroma_stride};
+      return 3;
+    }
+    default:
+      return 0;
+  }
+}
+
+// 紧密排列（无行填充）时的行跨度
+uint32_t TightStride(uint32_t pixel_format, uint32_t width) {
+  PlaneLayout planes[3];
+  if (GetPlaneLayout(pixel_format, width, 1, 0, 1, planes) == 0) {
+    return 0;
+  }
+  return static_cast<uint32_t>(planes[0].row_bytes);
+}
+
+// 查询节点是否为支持 codec 的 M2M 编码器
+bool IsEncoderFor(const std::string& path, uint32_t codec) {
+  V4L2Device device;
+  if (!device.Open(path)) {
+    return false;
+  }
+
+  DeviceInfo info;
+  if (!device.GetCapabilities(&info)) {
+    return false;
+  }
+
+  uint32_t type;
+  if (info.device_caps & V4L2_CAP_VIDEO_M2M_MPLANE) {
+    type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+  } else if (info.device_caps & V4L2_CAP_VIDEO_M2M) {
+    type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  } else {
+    return false;
+  }
+
+  // 编码器的 CAPTURE 队列输出压缩格式
+  struct v4l2_fmtdesc fmt_desc;
+  memset(&fmt_desc, 0, sizeof(fmt_desc));
+  fmt_desc.type = type;
+  while (ioctl(device.GetFileDescriptor(), VIDIOC_ENUM_FMT, &fmt_desc) == 0) {
+    if (fmt_desc.pixelformat == codec) {
+      return true;
+    }
+    fmt_desc.index++;
+  }
+  return false;
+}
+
+}  // namespace
+
+M2mEncoderSink::M2mEncoderSink()
+    : capture_(nullptr),
+      mplane_(false),
+      streaming_(false),
+      dmabuf_(false),
+      draining_(false),
+      eos_(false),
+      output_fd_(-1),
+      width_(0),
+      height_(0),
+      capture_format_(0),
+      capture_stride_(0),
+      capture_sizeimage_(0),
+      encoder_format_(0),
+      encoder_stride_(0),
+      encoder_sizeimage_(0) {
+  memset(&stats_, 0, sizeof(stats_));
+}
+
+M2mEncoderSink::~M2mEncoderSink() {
+  Close();
+}
+
+std::string M2mEncoderSink::FindEncoder(uint32_t codec) {
+  DIR* dir = opendir("/dev");
+  if (!dir) {
+    return "";
+  }
+
+  std::vector<std::string> paths;
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != nullptr) {
+    if (strncmp(entry->d_name, "video", 5) == 0) {
+      paths.push_back(std::string("/dev/") + entry->d_name);
+    }
+  }
+  closedir(dir);
+
+  std::sort(paths.begin(), paths.end(),
+            [](const std::string& a, const std::string& b) {
+              return a.size() != b.size() ? a.size() < b.size() : a < b;
+            });
+  for (const auto& path : paths) {
+    if (IsEncoderFor(path, codec)) {
+      return path;
+    }
+  }
+  return "";
+}
+
+uint32_t M2mEncoderSink::OutputType() const {
+  return mplane_ ? V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE
+                 : V4L2_BUF_TYPE_VIDEO_OUTPUT;
+}
+
+uint32_t M2mEncoderSink::CaptureType() const {
+  return mplane_ ? V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE
+                 : V4L2_BUF_TYPE_VIDEO_CAPTURE;
+}
+
+bool M2mEncoderSink::Init(V4L2Device* capture,
+                          const M2mEncoderOptions& options) {
+  if (streaming_ || !capture || !capture->IsOpen()) {
+    return false;
+  }
+  capture_ = capture;
+  options_ = options;
+  memset(&stats_, 0, sizeof(stats_));
+  draining_ = false;
+  eos_ = false;
+
+  // 捕获侧格式与行跨度；编码器输入按单内存平面布局处理
+  VideoFormat capture_fmt;
+  if (!capture->GetFormat(&capture_fmt)) {
+    return false;
+  }
+  if (capture_fmt.plane_count > 1) {
+    fprintf(stderr, "编码器不支持多内存平面的捕获格式 %s\n",
+            PixelFormatToString(capture_fmt.pixel_format).c_str());
+    return false;
+  }
+  width_ = capture_fmt.width;
+  height_ = capture_fmt.height;
+  capture_format_ = capture_fmt.pixel_format;
+  capture_stride_ = capture_fmt.bytesperline[0];
+  capture_sizeimage_ = capture_fmt.sizeimage[0];
+
+  std::string path = options_.encoder_path.empty()
+                         ? FindEncoder(options_.codec)
+                         : options_.encoder_path;
+  if (path.empty()) {
+    fprintf(stderr, "未找到支持 %s 的 M2M 编码器\n",
+            PixelFormatToString(options_.codec).c_str());
+    return false;
+  }
+  if (!encoder_.Open(path)) {
+    return false;
+  }
+
+  DeviceInfo info;
+  if (!encoder_.GetCapabilities(&info)) {
+    encoder_.Close();
+    return false;
+  }
+  if (info.device_caps & V4L2_CAP_VIDEO_M2M_MPLANE) {
+    mplane_ = true;
+  } else if (info.device_caps & V4L2_CAP_VIDEO_M2M) {
+    mplane_ = false;
+  } else {
+    fprintf(stderr, "%s 不是 M2M 设备\n", path.c_str());
+    encoder_.Close();
+    return false;
+  }
+
+  // 有状态编码器接口要求先设置 CAPTURE（码流）格式，再设置 OUTPUT（原始帧）格式
+  struct v4l2_format fmt;
+  if (!SetQueueFormat(CaptureType(), options_.codec,
+                      width_ * height_ * 3 / 2, &fmt)) {
+    encoder_.Close();
+    return false;
+  }
+  if (!SetQueueFormat(OutputType(), capture_format_, 0, &fmt)) {
+    encoder_.Close();
+    return false;
+  }
+  if (mplane_) {
+    encoder_format_ = fmt.fmt.pix_mp.pixelformat;
+    encoder_stride_ = fmt.fmt.pix_mp.plane_fmt[0].bytesperline;
+    encoder_sizeimage_ = fmt.fmt.pix_mp.plane_fmt[0].sizeimage;
+  } else {
+    encoder_format_ = fmt.fmt.pix.pixelformat;
+    encoder_stride_ = fmt.fmt.pix.bytesperline;
+    encoder_sizeimage_ = fmt.fmt.pix.sizeimage;
+  }
+  if (encoder_stride_ == 0) {
+    encoder_stride_ = TightStride(encoder_format_, width_);
+  }
+
+  // 编码器不接受捕获格式时，尝试转换为 NV12
+  if (encoder_format_ != capture_format_) {
+    if (!FormatConverter::IsSupported(capture_format_, encoder_format_) &&
+        FormatConverter::IsSupported(capture_format_, V4L2_PIX_FMT_NV12) &&
+        SetQueueFormat(OutputType(), V4L2_PIX_FMT_NV12, 0, &fmt)) {
+      encoder_format_ = mplane_ ? fmt.fmt.pix_mp.pixelformat
+                                : fmt.fmt.pix.pixelformat;
+      encoder_stride_ = mplane_ ? fmt.fmt.pix_mp.plane_fmt[0].bytesperline
+                                : fmt.fmt.pix.bytesperline;
+      encoder_sizeimage_ = mplane_ ? fmt.fmt.pix_mp.plane_fmt[0].sizeimage
+                                   : fmt.fmt.pix.sizeimage;
+    }
+    if (!FormatConverter::IsSupported(capture_format_, encoder_format_) ||
+        capture_stride_ != TightStride(capture_format_, width_)) {
+      fprintf(stderr, "编码器不支持捕获格式 %s（编码器要求 %s）\n",
+              PixelFormatToString(capture_format_).c_str(),
+              PixelFormatToString(encoder_format_).c_str());
+      encoder_.Close();
+      return false;
+    }
+    convert_buffer_.resize(
+        FormatConverter::GetFrameSize(encoder_format_, width_, height_));
+    stats_.converted = true;
+  }
+
+  // 帧率沿用捕获设备的设置，编码器据此分配码率
+  FrameInterval interval;
+  if (capture_->GetFrameInterval(&interval) && interval.numerator != 0) {
+    struct v4l2_streamparm parm;
+    memset(&parm, 0, sizeof(parm));
+    parm.type = OutputType();
+    parm.parm.output.timeperframe.numerator = interval.numerator;
+    parm.parm.output.timeperframe.denominator = interval.denominator;
+    ioctl(encoder_.GetFileDescriptor(), VIDIOC_S_PARM, &parm);
+  }
+
+  SetControl(V4L2_CID_MPEG_VIDEO_BITRATE, options_.bitrate, "码率");
+  SetControl(V4L2_CID_MPEG_VIDEO_GOP_SIZE, options_.gop_size, "GOP");
+  if (options_.codec == V4L2_PIX_FMT_H264) {
+    SetControl(V4L2_CID_MPEG_VIDEO_H264_I_PERIOD, options_.gop_size,
+               "I 帧间隔");
+  }
+  // 每个关键帧前重复 SPS/PPS，分段截取的码流也能独立解码
+  SetControl(V4L2_CID_MPEG_VIDEO_REPEAT_SEQ_HEADER, 1, "重复序列头");
+
+  // 格式与行跨度一致、捕获侧有导出的 DMABUF 时共享缓冲区
+  const FrameBuffer* first = capture_->GetBuffer(0);
+  bool can_share = options_.share_dmabuf && !stats_.converted &&
+                   capture_stride_ == encoder_stride_ && first &&
+                   first->dmabuf_fd >= 0;
+  dmabuf_ = can_share &&
+            SetupBuffers(OutputType(), V4L2_MEMORY_DMABUF,
+                         capture_->GetBufferCount(), &output_buffers_);
+  if (!dmabuf_ &&
+      !SetupBuffers(OutputType(), V4L2_MEMORY_MMAP,
+                    options_.output_buffer_count, &output_buffers_)) {
+    encoder_.Close();
+    return false;
+  }
+  stats_.dmabuf = dmabuf_;
+  held_leases_.clear();
+  held_leases_.resize(output_buffers_.size());
+
+  if (!SetupBuffers(CaptureType(), V4L2_MEMORY_MMAP,
+                    options_.capture_buffer_count, &capture_buffers_)) {
+    Close();
+    return false;
+  }
+  for (uint32_t i = 0; i < capture_buffers_.size(); ++i) {
+    if (!QueueBuffer(CaptureType(), V4L2_MEMORY_MMAP, i, 0, -1,
+                     capture_buffers_[i].length, nullptr)) {
+      Close();
+      return false;
+    }
+  }
+
+  output_fd_ = open(options_.output_path.c_str(),
+                    O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (output_fd_ < 0) {
+    fprintf(stderr, "无法创建码流文件 %s: %s\n", options_.output_path.c_str(),
+            strerror(errno));
+    Close();
+    return false;
+  }
+
+  int fd = encoder_.GetFileDescriptor();
+  enum v4l2_buf_type output_type = static_cast<enum v4l2_buf_type>(OutputType());
+  enum v4l2_buf_type capture_type =
+      static_cast<enum v4l2_buf_type>(CaptureType());
+  if (ioctl(fd, VIDIOC_STREAMON, &output_type) < 0 ||
+      ioctl(fd, VIDIOC_STREAMON, &capture_type) < 0) {
+    fprintf(stderr, "启动编码器失败: %s\n", strerror(errno));
+    streaming_ = true;  // 让 Close 执行 STREAMOFF 清理
+    Close();
+    return false;
+  }
+  streaming_ = true;
+  return true;
+}
+
+bool M2mEncoderSink::SetQueueFormat(uint32_t type, uint32_t pixel_format,
+                                    uint32_t sizeimage,
+                                    struct v4l2_format* result) {
+  struct v4l2_format fmt;
+  memset(&fmt, 0, sizeof(fmt));
+  fmt.type = type;
+  if (mplane_) {
+    fmt.fmt.pix_mp.width = width_;
+    fmt.fmt.pix_mp.height = height_;
+    fmt.fmt.pix_mp.pixelformat = pixel_format;
+    fmt.fmt.pix_mp.field = V4L2_FIELD_NONE;
+    fmt.fmt.pix_mp.num_planes = 1;
+    fmt.fmt.pix_mp.plane_fmt[0].sizeimage = sizeimage;
+  } else {
+    fmt.fmt.pix.width = width_;
+    fmt.fmt.pix.height = height_;
+    fmt.fmt.pix.pixelformat = pixel_format;
+    fmt.fmt.pix.field = V4L2_FIELD_NONE;
+    fmt.fmt.pix.sizeimage = sizeimage;
+  }
+
+  if (ioctl(encoder_.GetFileDescriptor(), VIDIOC_S_FMT, &fmt) < 0) {
+    fprintf(stderr, "设置编码器格式 %s 失败: %s\n",
+            PixelFormatToString(pixel_format).c_str(), strerror(errno));
+    return false;
+  }
+  *result = fmt;
+  return true;
+}
+
+void M2mEncoderSink::SetControl(uint32_t id, int32_t value, const char* name) {
+  struct v4l2_control control;
+  memset(&control, 0, sizeof(control));
+  control.id = id;
+  control.value = value;
+  if (ioctl(encoder_.GetFileDescriptor(), VIDIOC_S_CTRL, &control) < 0) {
+    fprintf(stderr, "警告: 编码器不支持设置%s: %s\n", name, strerror(errno));
+  }
+}
+
+bool M2mEncoderSink::SetupBuffers(uint32_t type, uint32_t memory,
+                                  uint32_t count,
+                                  std::vector<EncoderBuffer>* buffers) {
+  int fd = encoder_.GetFileDescriptor();
+  buffers->clear();
+
+  struct v4l2_requestbuffers req;
+  memset(&req, 0, sizeof(req));
+  req.count = count;
+  req.type = type;
+  req.memory = memory;
+  if (ioctl(fd, VIDIOC_REQBUFS, &req) < 0 || req.count == 0) {
+    fprintf(stderr, "请求编码器缓冲区失败: %s\n", strerror(errno));
+    return false;
+  }
+  // 共享模式按捕获缓冲区索引一一对应，数量必须一致
+  if (memory == V4L2_MEMORY_DMABUF && req.count < count) {
+    req.count = 0;
+    ioctl(fd, VIDIOC_REQBUFS, &req);
+    return false;
+  }
+
+  buffers->resize(req.count);
+  for (uint32_t i = 0; i < req.count; ++i) {
+    EncoderBuffer& buffer = (*buffers)[i];
+    buffer.start = nullptr;
+    buffer.length = 0;
+    buffer.queued = false;
+    if (memory != V4L2_MEMORY_MMAP) {
+      continue;
+    }
+
+    struct v4l2_buffer buf;
+    struct v4l2_plane planes[VIDEO_MAX_PLANES];
+    memset(&buf, 0, sizeof(buf));
+    memset(planes, 0, sizeof(planes));
+    buf.type = type;
+    buf.memory = memory;
+    buf.index = i;
+    if (mplane_) {
+      buf.m.planes = planes;
+      buf.length = VIDEO_MAX_PLANES;
+    }
+    if (ioctl(fd, VIDIOC_QUERYBUF, &buf) < 0) {
+      fprintf(stderr, "查询编码器缓冲区失败: %s\n", strerror(errno));
+      ReleaseBuffers(type, memory, buffers);
+      return false;
+    }
+
+    off_t offset = mplane_ ? planes[0].m.mem_offset : buf.m.offset;
+    buffer.length = mplane_ ? planes[0].length : buf.length;
+    void* start = mmap(nullptr, buffer.length, PROT_READ | PROT_WRITE,
+                       MAP_SHARED, fd, offset);
+    if (start == MAP_FAILED) {
+      fprintf(stderr, "映射编码器缓冲区失败: %s\n", strerror(errno));
+      buffer.length = 0;
+      ReleaseBuffers(type, memory, buffers);
+      return false;
+    }
+    buffer.start = start;
+  }
+  return true;
+}
+
+void M2mEncoderSink::ReleaseBuffers(uint32_t type, uint32_t memory,
+                                    std::vector<EncoderBuffer>* buffers) {
+  for (auto& buffer : *buffers) {
+    if (buffer.start) {
+      munmap(buffer.start, buffer.length);
+    }
+  }
+  buffers->clear();
+
+  struct v4l2_requestbuffers req;
+  memset(&req, 0, sizeof(req));
+  req.count = 0;
+  req.type = type;
+  req.memory = memory;
+  ioctl(encoder_.GetFileDescriptor(), VIDIOC_REQBUFS, &req);
+}
+
+bool M2mEncoderSink::QueueBuffer(uint32_t type, uint32_t memory,
+                                 uint32_t index, uint32_t bytesused,
+                                 int dmabuf_fd, uint32_t length,
+                                 const struct timeval* timestamp) {
+  struct v4l2_buffer buf;
+  struct v4l2_plane planes[VIDEO_MAX_PLANES];
+  memset(&buf, 0, sizeof(buf));
+  memset(planes, 0, sizeof(planes));
+  buf.type = type;
+  buf.memory = memory;
+  buf.index = index;
+  if (timestamp) {
+    buf.timestamp = *timestamp;
+  }
+
+  if (mplane_) {
+    buf.m.planes = planes;
+    buf.length = 1;
+    planes[0].bytesused = bytesused;
+    planes[0].length = length;
+    if (memory == V4L2_MEMORY_DMABUF) {
+      planes[0].m.fd = dmabuf_fd;
+    }
+  } else {
+    buf.bytesused = bytesused;
+    buf.length = length;
+    if (memory == V4L2_MEMORY_DMABUF) {
+      buf.m.fd = dmabuf_fd;
+    }
+  }
+
+  if (ioctl(encoder_.GetFileDescriptor(), VIDIOC_QBUF, &buf) < 0) {
+    fprintf(stderr, "编码器入队失败: %s\n", strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+bool M2mEncoderSink::DequeueBuffer(uint32_t type, uint32_t memory,
+                                   struct v4l2_buffer* buf,
+                                   uint32_t* bytesused,
+                                   uint32_t* data_offset) {
+  struct v4l2_plane planes[VIDEO_MAX_PLANES];
+  memset(buf, 0, sizeof(*buf));
+  memset(planes, 0, sizeof(planes));
+  buf->type = type;
+  buf->memory = memory;
+  if (mplane_) {
+    buf->m.planes = planes;
+    buf->length = VIDEO_MAX_PLANES;
+  }
+
+  if (ioctl(encoder_.GetFileDescriptor(), VIDIOC_DQBUF, buf) < 0) {
+    // EPIPE：排空后最后一个缓冲区已出队
+    if (errno == EPIPE) {
+      eos_ = true;
+    } else if (errno != EAGAIN) {
+      fprintf(stderr, "编码器出队失败: %s\n", strerror(errno));
+    }
+    return false;
+  }
+
+  if (mplane_) {
+    *data_offset = planes[0].data_offset;
+    *bytesused = planes[0].bytesused > *data_offset
+                     ? planes[0].bytesused - *data_offset
+                     : 0;
+    buf->m.planes = nullptr;  // 局部数组即将失效
+  } else {
+    *data_offset = 0;
+    *bytesused = buf->bytesused;
+  }
+  return true;
+}
+
+bool M2mEncoderSink::CopyFrame(const FrameLease& lease, uint8_t* dst,
+                               size_t dst_size) {
+  const uint8_t* src = static_cast<const uint8_t*>(lease.data());
+  uint32_t src_stride = capture_stride_;
+  uint32_t src_sizeimage = capture_sizeimage_;
+  if (!src) {
+    return false;
+  }
+
+  if (encoder_format_ != capture_format_) {
+    if (!converter_.Convert(src, lease.size(), capture_format_, width_,
+                            height_, encoder_format_, convert_buffer_.data(),
+                            convert_buffer_.size())) {
+      return false;
+    }
+    src = convert_buffer_.data();
+    src_stride = TightStride(encoder_format_, width_);
+    src_sizeimage = static_cast<uint32_t>(convert_buffer_.size());
+  } else if (lease.size() < capture_sizeimage_) {
+    return false;  // 不完整的帧
+  }
+
+  PlaneLayout src_planes[3];
+  PlaneLayout dst_planes[3];
+  int count = GetPlaneLayout(
+      encoder_format_, width_, height_, src_stride,
+      PlaneHeight(encoder_format_, height_, src_stride, src_sizeimage),
+      src_planes);
+  if (count == 0 ||
+      GetPlaneLayout(encoder_format_, width_, height_, encoder_stride_,
+                     PlaneHeight(encoder_format_, height_, encoder_stride_,
+                                 encoder_sizeimage_),
+                     dst_planes) != count) {
+    return false;
+  }
+
+  // 行跨度一致且为紧密排列时整块拷贝，否则逐行拷贝
+  const PlaneLayout& last = dst_planes[count - 1];
+  if (last.offset + static_cast<size_t>(last.rows - 1) * last.stride +
+          last.row_bytes > dst_size) {
+    return false;
+  }
+  for (int p = 0; p < count; ++p) {
+    const PlaneLayout& s = src_planes[p];
+    const PlaneLayout& d = dst_planes[p];
+    if (s.stride == d.stride && s.stride == s.row_bytes) {
+      memcpy(dst + d.offset, src + s.offset, s.row_bytes * s.rows);
+      continue;
+    }
+    for (uint32_t row = 0; row < s.rows; ++row) {
+      memcpy(dst + d.offset + row * d.stride, src + s.offset + row * s.stride,
+             s.row_bytes);
+    }
+  }
+  return true;
+}
+
+bool M2mEncoderSink::Submit(FrameLease* lease) {
+  FrameLease frame(std::move(*lease));
+  if (!streaming_ || draining_ || !frame.IsValid()) {
+    return false;
+  }
+
+  // 先回收编码器已处理完的缓冲区
+  ProcessEvents();
+
+  struct timeval timestamp = frame.timestamp();
+  if (dmabuf_) {
+    // 共享模式：编码器缓冲区与捕获缓冲区按索引一一对应
+    uint32_t index = frame.index();
+    const FrameBuffer* source = capture_->GetBuffer(index);
+    if (index >= output_buffers_.size() || !source ||
+        output_buffers_[index].queued || frame.dmabuf_fd() < 0) {
+      stats_.dropped++;
+      return false;
+    }
+    if (!QueueBuffer(OutputType(), V4L2_MEMORY_DMABUF, index, frame.size(),
+                     frame.dmabuf_fd(), source->length, &timestamp)) {
+      stats_.dropped++;
+      return false;
+    }
+    output_buffers_[index].queued = true;
+    stats_.bytes_in += frame.size();
+    held_leases_[index] = std::move(frame);
+    stats_.frames_in++;
+    return true;
+  }
+
+  // 拷贝模式：取一个空闲的编码器输入缓冲区
+  uint32_t index = 0;
+  while (index < output_buffers_.size() && output_buffers_[index].queued) {
+    index++;
+  }
+  if (index == output_buffers_.size()) {
+    stats_.dropped++;
+    return false;
+  }
+
+  EncoderBuffer& buffer = output_buffers_[index];
+  if (!CopyFrame(frame, static_cast<uint8_t*>(buffer.start), buffer.length)) {
+    stats_.dropped++;
+    return false;
+  }
+  frame.Release();  // 数据已拷贝，立即交还驱动
+
+  uint32_t bytesused = std::min<uint32_t>(encoder_sizeimage_, buffer.length);
+  if (!QueueBuffer(OutputType(), V4L2_MEMORY_MMAP, index, bytesused, -1,
+                   buffer.length, &timestamp)) {
+    stats_.dropped++;
+    return false;
+  }
+  buffer.queued = true;
+  stats_.bytes_in += bytesused;
+  stats_.frames_in++;
+  return true;
+}
+
+bool M2mEncoderSink::ProcessEvents() {
+  if (!streaming_) {
+    return false;
+  }
+
+  struct v4l2_buffer buf;
+  uint32_t bytesused;
+  uint32_t data_offset;
+
+  // 码流：写出后重新入队
+  while (!eos_ &&
+         DequeueBuffer(CaptureType(), V4L2_MEMORY_MMAP, &buf, &bytesused,
+                       &data_offset)) {
+    if (buf.index >= capture_buffers_.size()) {
+      continue;
+    }
+    const EncoderBuffer& buffer = capture_buffers_[buf.index];
+    const uint8_t* data =
+        static_cast<const uint8_t*>(buffer.start) + data_offset;
+    if (data_offset + bytesused > buffer.length) {
+      bytesused = 0;
+    }
+
+    size_t written = 0;
+    while (written < bytesused) {
+      ssize_t ret = write(output_fd_, data + written, bytesused - written);
+      if (ret < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        fprintf(stderr, "写入码流失败: %s\n", strerror(errno));
+        return false;
+      }
+      written += ret;
+    }
+
+    if (bytesused > 0) {
+      stats_.frames_out++;
+      stats_.bytes_out += bytesused;
+      if (buf.flags & V4L2_BUF_FLAG_KEYFRAME) {
+        stats_.keyframes++;
+      }
+    }
+
+    if (buf.flags & V4L2_BUF_FLAG_LAST) {
+      eos_ = true;
+      break;
+    }
+    QueueBuffer(CaptureType(), V4L2_MEMORY_MMAP, buf.index, 0, -1,
+                buffer.length, nullptr);
+  }
+
+  // 原始帧：编码器读完后归还（共享模式下释放对应租约）
+  uint32_t memory = dmabuf_ ? V4L2_MEMORY_DMABUF : V4L2_MEMORY_MMAP;
+  while (DequeueBuffer(OutputType(), memory, &buf, &bytesused,
+                       &data_offset)) {
+    if (buf.index < output_buffers_.size()) {
+      output_buffers_[buf.index].queued = false;
+      held_leases_[buf.index].Release();
+    }
+  }
+  return true;
+}
+
+void M2mEncoderSink::Close() {
+  if (streaming_) {
+    int fd = encoder_.GetFileDescriptor();
+
+    // 请求编码器输出剩余码流，直到带 V4L2_BUF_FLAG_LAST 的缓冲区
+    struct v4l2_encoder_cmd cmd;
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.cmd = V4L2_ENC_CMD_STOP;
+    if (stats_.frames_in > 0 && ioctl(fd, VIDIOC_ENCODER_CMD, &cmd) == 0) {
+      draining_ = true;
+      int64_t deadline = MonotonicMicros() + kDrainTimeoutMs * 1000;
+      while (!eos_ && MonotonicMicros() < deadline) {
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, 100) < 0 && errno != EINTR) {
+          break;
+        }
+        if (!ProcessEvents()) {
+          break;
+        }
+      }
+    }
+
+    enum v4l2_buf_type output_type =
+        static_cast<enum v4l2_buf_type>(OutputType());
+    enum v4l2_buf_type capture_type =
+        static_cast<enum v4l2_buf_type>(CaptureType());
+    ioctl(fd, VIDIOC_STREAMOFF, &output_type);
+    ioctl(fd, VIDIOC_STREAMOFF, &capture_type);
+    streaming_ = false;
+  }
+
+  // STREAMOFF 后编码器不再访问共享缓冲区，归还全部租约
+  for (auto& lease : held_leases_) {
+    lease.Release();
+  }
+  held_leases_.clear();
+
+  if (encoder_.IsOpen()) {
+    ReleaseBuffers(OutputType(),
+                   dmabuf_ ? V4L2_MEMORY_DMABUF : V4L2_MEMORY_MMAP,
+                   &output_buffers_);
+    ReleaseBuffers(CaptureType(), V4L2_MEMORY_MMAP, &capture_buffers_);
+    encoder_.Close();
+  }
+
+  if (output_fd_ >= 0) {
+    close(output_fd_);
+    output_fd_ = -1;
+  }
+  capture_ = nullptr;
+  dmabuf_ = false;
+  draining_ = false;
+}
+
+void M2mEncoderSink::GetStats(M2mEncoderStats* stats) const {
+  *stats = stats_;
+}
+
+}  // namespace v4l2_demo
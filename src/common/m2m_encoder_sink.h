@@ -0,0 +1,155 @@
+#ifndef V4L2_DEMO_SRC_COMMON_M2M_ENCODER_SINK_H_
+#define V4L2_DEMO_SRC_COMMON_M2M_ENCODER_SINK_H_
+
+#include <linux/videodev2.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "format_converter.h"
+#include "v4l2_utils.h"
+
+namespace v4l2_demo {
+
+// 硬件编码录制配置
+struct M2mEncoderOptions {
+  std::string encoder_path;  // 编码器节点，为空时自动查找（见 FindEncoder）
+  uint32_t codec = V4L2_PIX_FMT_H264;  // V4L2_PIX_FMT_H264 或 V4L2_PIX_FMT_HEVC
+  uint32_t bitrate = 4000000;          // 目标码率（bit/s）
+  uint32_t gop_size = 30;              // 关键帧间隔（帧）
+  uint32_t output_buffer_count = 4;    // 拷贝模式下编码器输入缓冲区数量
+  uint32_t capture_buffer_count = 4;   // 码流缓冲区数量
+  std::string output_path = "output/capture.h264";  // Annex-B 码流文件
+  bool share_dmabuf = true;  // 捕获侧已导出 DMABUF 时直接共享给编码器
+};
+
+// 硬件编码录制统计
+struct M2mEncoderStats {
+  uint64_t frames_in;    // 送入编码器的帧数
+  uint64_t frames_out;   // 编码器输出的码流包数
+  uint64_t dropped;      // 编码器输入缓冲区用尽时丢弃的帧数
+  uint64_t keyframes;    // 关键帧数
+  uint64_t bytes_in;     // 送入的原始数据字节数
+  uint64_t bytes_out;    // 写出的码流字节数
+  bool dmabuf;           // 是否与捕获侧共享 DMABUF（零拷贝）
+  bool converted;        // 是否经 FormatConverter 转换为编码器支持的格式
+};
+
+// 基于 V4L2 内存到内存（M2M）编码器的录制 sink
+// 编码器节点（如树莓派/瑞芯微的 /dev/video11）由 V4L2Device 打开，
+// OUTPUT 队列输入原始帧、CAPTURE 队列输出码流，支持单平面与 MPLANE 接口
+// - 共享模式：捕获侧 InitDmaBuf 导出的 DMABUF 以 V4L2_MEMORY_DMABUF 直接
+//   入队编码器，CPU 不触碰像素；租约保持到编码器归还该缓冲区
+// - 拷贝模式：格式或行跨度不一致时，拷贝（必要时用 FormatConverter 转换）
+//   到编码器的 MMAP 缓冲区，租约立即释放
+// 码流以 Annex-B 格式写出（可直接用 ffplay 播放或 ffmpeg -c copy 封装为 MP4）
+// 非线程安全：Submit 与 ProcessEvents 需在同一线程调用
+class M2mEncoderSink {
+ public:
+  M2mEncoderSink();
+  ~M2mEncoderSink();
+
+  M2mEncoderSink(const M2mEncoderSink&) = delete;
+  M2mEncoderSink& operator=(const M2mEncoderSink&) = delete;
+
+  // 查找支持指定编码格式的 M2M 编码器节点
+  // @param codec 编码格式，如 V4L2_PIX_FMT_H264
+  // @return 设备路径，未找到返回空字符串
+  static std::string FindEncoder(uint32_t codec);
+
+  // 打开并配置编码器（捕获设备需已设置格式并完成缓冲区初始化）
+  // @param capture 捕获设备
+  // @param options 配置
+  // @return 成功返回 true；没有编码器或格式不被支持时返回 false
+  bool Init(V4L2Device* capture, const M2mEncoderOptions& options);
+
+  // 提交一帧进行编码，租约总是被转移走
+  // @param lease 帧租约
+  // @return 送入编码器返回 true；输入缓冲区用尽（丢帧）或失败返回 false
+  bool Submit(FrameLease* lease);
+
+  // 取回编码器已处理完的缓冲区并写出码流（非阻塞）
+  // @return 成功返回 true，出错返回 false
+  bool ProcessEvents();
+
+  // 发送 V4L2_ENC_CMD_STOP 排空编码器，写完剩余码流后关闭
+  void Close();
+
+  // 获取编码器文件描述符（可读表示有码流可取，用于 poll/epoll）
+  int GetFileDescriptor() const { return encoder_.GetFileDescriptor(); }
+
+  // 获取统计信息
+  void GetStats(M2mEncoderStats* stats) const;
+
+ private:
+  // 编码器一侧的缓冲区
+  struct EncoderBuffer {
+    void* start;     // MMAP 映射地址（共享 DMABUF 时为 nullptr）
+    size_t length;   // 缓冲区长度
+    bool queued;     // 是否已入队给编码器
+  };
+
+  V4L2Device encoder_;
+  V4L2Device* capture_;
+  M2mEncoderOptions options_;
+  bool mplane_;      // 编码器使用 MPLANE 接口
+  bool streaming_;
+  bool dmabuf_;      // OUTPUT 队列以 DMABUF 共享捕获缓冲区
+  bool draining_;    // 已发送 ENC_CMD_STOP
+  bool eos_;         // 已收到 V4L2_BUF_FLAG_LAST
+  int output_fd_;    // 码流文件
+
+  // 帧参数
+  uint32_t width_;
+  uint32_t height_;
+  uint32_t capture_format_;    // 捕获侧像素格式
+  uint32_t capture_stride_;    // 捕获侧行跨度
+  uint32_t capture_sizeimage_;
+  uint32_t encoder_format_;    // 编码器输入像素格式
+  uint32_t encoder_stride_;    // 编码器输入行跨度
+  uint32_t encoder_sizeimage_;
+
+  std::vector<EncoderBuffer> output_buffers_;   // 原始帧输入
+  std::vector<EncoderBuffer> capture_buffers_;  // 码流输出
+  std::vector<FrameLease> held_leases_;         // 共享模式下编码器持有的租约
+  FormatConverter converter_;
+  std::vector<uint8_t> convert_buffer_;
+
+  M2mEncoderStats stats_;
+
+  uint32_t OutputType() const;
+  uint32_t CaptureType() const;
+
+  // 设置队列格式
+  // @param result 输出参数，驱动调整后的格式
+  bool SetQueueFormat(uint32_t type, uint32_t pixel_format,
+                      uint32_t sizeimage, struct v4l2_format* result);
+
+  // 申请并（MMAP 时）映射缓冲区
+  bool SetupBuffers(uint32_t type, uint32_t memory, uint32_t count,
+                    std::vector<EncoderBuffer>* buffers);
+  void ReleaseBuffers(uint32_t type, uint32_t memory,
+                      std::vector<EncoderBuffer>* buffers);
+
+  bool QueueBuffer(uint32_t type, uint32_t memory, uint32_t index,
+                   uint32_t bytesused, int dmabuf_fd, uint32_t length,
+                   const struct timeval* timestamp);
+
+  // 非阻塞出队
+  // @param bytesused 输出参数，有效数据长度
+  // @param data_offset 输出参数，有效数据在缓冲区中的偏移（MPLANE）
+  // @return 有缓冲区出队返回 true；无可用缓冲区或出错返回 false
+  bool DequeueBuffer(uint32_t type, uint32_t memory, struct v4l2_buffer* buf,
+                     uint32_t* bytesused, uint32_t* data_offset);
+
+  // 按编码器的行跨度拷贝（或转换后拷贝）一帧到输入缓冲区
+  bool CopyFrame(const FrameLease& lease, uint8_t* dst, size_t dst_size);
+
+  // 尽力设置编码控制项（码率、GOP 等），不支持时忽略
+  void SetControl(uint32_t id, int32_t value, const char* name);
+};
+
+}  // namespace v4l2_demo
+
+#endif  // V4L2_DEMO_SRC_COMMON_M2M_ENCODER_SINK_H_
@@ -0,0 +1,536 @@
+#include "metrics.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "v4l2_utils.h"
+
+namespace v4l2_demo {
+
+namespace {
+// 抓取请求的最大长度与读取超时，导出线程不会被慢客户端长期占用
+constexpr size_t kMaxRequestSize = 4096;
+constexpr int kRequestTimeoutMs = 200;
+
+const char* TypeName(MetricType type) {
+  switch (type) {
+    case MetricType::kCounter:
+      return "counter";
+    case MetricType::kGauge:
+      return "gauge";
+    case MetricType::kSummary:
+      return "summary";
+  }
+  return "untyped";
+}
+
+// v4l2_frames_total -> v4l2_frames_per_second
+std::string RateName(const std::string& name) {
+  const std::string suffix = "_total";
+  std::string base = name;
+  if (base.size() > suffix.size() &&
+      base.compare(base.size() - suffix.size(), suffix.size(), suffix) == 0) {
+    base.resize(base.size() - suffix.size());
+  }
+  return base + "_per_second";
+}
+
+void AppendFormat(std::string* out, const char* format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+void AppendFormat(std::string* out, const char* format, ...) {
+  char buffer[512];
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  if (n > 0) {
+    out->append(buffer, std::min<size_t>(n, sizeof(buffer) - 1));
+  }
+}
+
+// 一行 Prometheus 样本：name{labels,extra} value
+void AppendSample(std::string* out, const std::string& name,
+                  const std::string& labels, const char* extra_label,
+                  double value) {
+  out->append(name);
+  if (!labels.empty() || extra_label) {
+    out->append("{");
+    out->append(labels);
+    if (!labels.empty() && extra_label) {
+      out->append(",");
+    }
+    if (extra_label) {
+      out->append(extra_label);
+    }
+    out->append("}");
+  }
+  AppendFormat(out, " %.17g\n", value);
+}
+
+void AppendJsonString(std::string* out, const std::string& value) {
+  out->append("\"");
+  for (unsigned char c : value) {
+    if (c == '"' || c == '\\') {
+      out->append("\\");
+      out->push_back(c);
+    } else if (c < 0x20) {
+      AppendFormat(out, "\\u%04x", c);
+    } else {
+      out->push_back(c);
+    }
+  }
+  out->append("\"");
+}
+
+bool StartsWith(const std::string& value, const char* prefix) {
+  return value.compare(0, strlen(prefix), prefix) == 0;
+}
+
+bool SendAll(int fd, const std::string& data) {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    sent += n;
+  }
+  return true;
+}
+}  // namespace
+
+uint64_t Counter::Value() const {
+  uint64_t sum = 0;
+  for (const Shard& shard : shards_) {
+    sum += shard.value.load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+std::unique_ptr<MetricsRegistry::Metric> MetricsRegistry::NewMetric(
+    const std::string& name, const std::string& help,
+    const std::string& labels, MetricType type) {
+  std::unique_ptr<Metric> metric(new Metric());
+  metric->name = name;
+  metric->help = help;
+  metric->labels = labels;
+  metric->type = type;
+  return metric;
+}
+
+void MetricsRegistry::AddMetric(std::unique_ptr<Metric> metric) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  metrics_.push_back(std::move(metric));
+}
+
+Counter* MetricsRegistry::AddCounter(const std::string& name,
+                                     const std::string& help,
+                                     const std::string& labels,
+                                     double window_seconds) {
+  std::unique_ptr<Metric> metric =
+      NewMetric(name, help, labels, MetricType::kCounter);
+  metric->counter.reset(new Counter());
+  metric->window_us = static_cast<int64_t>(window_seconds * 1e6);
+  Counter* counter = metric->counter.get();
+  AddMetric(std::move(metric));
+  return counter;
+}
+
+Gauge* MetricsRegistry::AddGauge(const std::string& name,
+                                 const std::string& help,
+                                 const std::string& labels) {
+  std::unique_ptr<Metric> metric =
+      NewMetric(name, help, labels, MetricType::kGauge);
+  metric->gauge.reset(new Gauge());
+  Gauge* gauge = metric->gauge.get();
+  AddMetric(std::move(metric));
+  return gauge;
+}
+
+LatencyHistogram* MetricsRegistry::AddHistogram(const std::string& name,
+                                                const std::string& help,
+                                                const std::string& labels) {
+  std::unique_ptr<Metric> metric =
+      NewMetric(name, help, labels, MetricType::kSummary);
+  metric->owned_histogram.reset(new LatencyHistogram());
+  LatencyHistogram* histogram = metric->owned_histogram.get();
+  metric->histogram = histogram;
+  AddMetric(std::move(metric));
+  return histogram;
+}
+
+void MetricsRegistry::AddExternalHistogram(const std::string& name,
+                                           const std::string& help,
+                                           const LatencyHistogram* histogram,
+                                           const std::string& labels) {
+  std::unique_ptr<Metric> metric =
+      NewMetric(name, help, labels, MetricType::kSummary);
+  metric->histogram = histogram;
+  AddMetric(std::move(metric));
+}
+
+void MetricsRegistry::AddCallback(const std::string& name,
+                                  const std::string& help, MetricType type,
+                                  std::function<double()> callback,
+                                  const std::string& labels,
+                                  double window_seconds) {
+  std::unique_ptr<Metric> metric = NewMetric(name, help, labels, type);
+  metric->callback = std::move(callback);
+  if (type == MetricType::kCounter) {
+    metric->window_us = static_cast<int64_t>(window_seconds * 1e6);
+  }
+  AddMetric(std::move(metric));
+}
+
+double MetricsRegistry::ReadValue(const Metric& metric) {
+  if (metric.callback) {
+    return metric.callback();
+  }
+  if (metric.counter) {
+    return static_cast<double>(metric.counter->Value());
+  }
+  if (metric.gauge) {
+    return static_cast<double>(metric.gauge->Value());
+  }
+  return 0;
+}
+
+double MetricsRegistry::ComputeRate(const Metric& metric) {
+  if (metric.samples.size() < 2) {
+    return 0;
+  }
+  const auto& first = metric.samples.front();
+  const auto& last = metric.samples.back();
+  int64_t elapsed_us = last.first - first.first;
+  return elapsed_us > 0 ? (last.second - first.second) * 1e6 / elapsed_us : 0;
+}
+
+void MetricsRegistry::Sample() {
+  int64_t now = MonotonicMicros();
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& metric : metrics_) {
+    if (metric->window_us <= 0) {
+      continue;
+    }
+    metric->samples.emplace_back(now, ReadValue(*metric));
+    // 保留覆盖整个时间窗的样本：最早的样本不晚于 now - window
+    while (metric->samples.size() > 2 &&
+           metric->samples[1].first <= now - metric->window_us) {
+      metric->samples.pop_front();
+    }
+  }
+}
+
+double MetricsRegistry::GetRate(const std::string& name,
+                                const std::string& labels) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& metric : metrics_) {
+    if (metric->name == name && metric->labels == labels) {
+      return ComputeRate(*metric);
+    }
+  }
+  return 0;
+}
+
+void MetricsRegistry::WritePrometheus(std::string* out) {
+  out->clear();
+  std::lock_guard<std::mutex> lock(mutex_);
+  // 同名指标（不同标签）须连续输出，HELP/TYPE 只写一次
+  std::vector<bool> written(metrics_.size(), false);
+  for (size_t i = 0; i < metrics_.size(); ++i) {
+    if (written[i]) {
+      continue;
+    }
+    const std::string& name = metrics_[i]->name;
+    AppendFormat(out, "# HELP %s %s\n# TYPE %s %s\n", name.c_str(),
+                 metrics_[i]->help.c_str(), name.c_str(),
+                 TypeName(metrics_[i]->type));
+    for (size_t j = i; j < metrics_.size(); ++j) {
+      const Metric& metric = *metrics_[j];
+      if (written[j] || metric.name != name) {
+        continue;
+      }
+      written[j] = true;
+      if (metric.type != MetricType::kSummary) {
+        AppendSample(out, name, metric.labels, nullptr, ReadValue(metric));
+        continue;
+      }
+      const LatencyHistogram& histogram = *metric.histogram;
+      AppendSample(out, name, metric.labels, "quantile=\"0.5\"",
+                   histogram.Percentile(50));
+      AppendSample(out, name, metric.labels, "quantile=\"0.99\"",
+                   histogram.Percentile(99));
+      AppendSample(out, name, metric.labels, "quantile=\"0.999\"",
+                   histogram.Percentile(99.9));
+      AppendSample(out, name + "_sum", metric.labels, nullptr,
+                   histogram.Mean() * histogram.Count());
+      AppendSample(out, name + "_count", metric.labels, nullptr,
+                   histogram.Count());
+    }
+  }
+
+  // 派生指标：时间窗速率与直方图最大值，同样按名称分组输出
+  struct Derived {
+    std::string name;
+    const std::string* labels;
+    double value;
+  };
+  std::vector<Derived> derived;
+  for (const auto& metric : metrics_) {
+    if (metric->window_us > 0) {
+      derived.push_back(
+          {RateName(metric->name), &metric->labels, ComputeRate(*metric)});
+    } else if (metric->type == MetricType::kSummary) {
+      derived.push_back({metric->name + "_max", &metric->labels,
+                         static_cast<double>(metric->histogram->Max())});
+    }
+  }
+  std::vector<bool> derived_written(derived.size(), false);
+  for (size_t i = 0; i < derived.size(); ++i) {
+    if (derived_written[i]) {
+      continue;
+    }
+    AppendFormat(out, "# TYPE %s gauge\n", derived[i].name.c_str());
+    for (size_t j = i; j < derived.size(); ++j) {
+      if (!derived_written[j] && derived[j].name == derived[i].name) {
+        derived_written[j] = true;
+        AppendSample(out, derived[j].name, *derived[j].labels, nullptr,
+                     derived[j].value);
+      }
+    }
+  }
+}
+
+void MetricsRegistry::WriteJson(std::string* out) {
+  out->clear();
+  AppendFormat(out, "{\"timestamp_us\": %ld, \"metrics\": [",
+               static_cast<long>(MonotonicMicros()));
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (size_t i = 0; i < metrics_.size(); ++i) {
+    const Metric& metric = *metrics_[i];
+    out->append(i ? ",\n  {\"name\": " : "\n  {\"name\": ");
+    AppendJsonString(out, metric.name);
+    if (!metric.labels.empty()) {
+      out->append(", \"labels\": ");
+      AppendJsonString(out, metric.labels);
+    }
+    AppendFormat(out, ", \"type\": \"%s\"", TypeName(metric.type));
+    if (metric.type == MetricType::kSummary) {
+      const LatencyHistogram& histogram = *metric.histogram;
+      AppendFormat(out,
+                   ", \"count\": %lu, \"mean\": %.2f, \"p50\": %lu, "
+                   "\"p99\": %lu, \"p999\": %lu, \"max\": %lu}",
+                   histogram.Count(), histogram.Mean(),
+                   histogram.Percentile(50), histogram.Percentile(99),
+                   histogram.Percentile(99.9), histogram.Max());
+      continue;
+    }
+    AppendFormat(out, ", \"value\": %.17g", ReadValue(metric));
+    if (metric.window_us > 0) {
+      AppendFormat(out, ", \"rate\": %.3f, \"window_s\": %.3g",
+                   ComputeRate(metric), metric.window_us / 1e6);
+    }
+    out->append("}");
+  }
+  out->append(metrics_.empty() ? "]}\n" : "\n]}\n");
+}
+
+MetricsExporter::MetricsExporter()
+    : registry_(nullptr), listen_fd_(-1), wakeup_fd_(-1) {}
+
+MetricsExporter::~MetricsExporter() {
+  Stop();
+}
+
+bool MetricsExporter::Start(MetricsRegistry* registry,
+                            const MetricsExporterOptions& options) {
+  if (thread_.joinable()) {
+    return false;
+  }
+  registry_ = registry;
+  options_ = options;
+  if (options_.interval_ms <= 0) {
+    options_.interval_ms = 1000;
+  }
+
+  wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wakeup_fd_ < 0) {
+    fprintf(stderr, "创建 eventfd 失败: %s\n", strerror(errno));
+    return false;
+  }
+
+  if (options_.http_port > 0) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(options_.http_port);
+    if (inet_pton(AF_INET, options_.bind_address.c_str(), &addr.sin_addr) !=
+        1) {
+      fprintf(stderr, "无效的监听地址: %s\n", options_.bind_address.c_str());
+      Stop();
+      return false;
+    }
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int reuse = 1;
+    if (listen_fd_ < 0 ||
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse,
+                   sizeof(reuse)) < 0 ||
+        bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr),
+             sizeof(addr)) < 0 ||
+        listen(listen_fd_, 8) < 0) {
+      fprintf(stderr, "监听指标端口 %d 失败: %s\n", options_.http_port,
+              strerror(errno));
+      Stop();
+      return false;
+    }
+  }
+
+  thread_ = std::thread(&MetricsExporter::ExportLoop, this);
+  return true;
+}
+
+void MetricsExporter::Stop() {
+  if (thread_.joinable()) {
+    uint64_t value = 1;
+    ssize_t ret = write(wakeup_fd_, &value, sizeof(value));
+    (void)ret;
+    thread_.join();
+    WriteJsonFile();
+  }
+  if (listen_fd_ >= 0) {
+    close(listen_fd_);
+    listen_fd_ = -1;
+  }
+  if (wakeup_fd_ >= 0) {
+    close(wakeup_fd_);
+    wakeup_fd_ = -1;
+  }
+}
+
+void MetricsExporter::ExportLoop() {
+  int64_t next_tick_us = MonotonicMicros() + options_.interval_ms * 1000LL;
+  while (true) {
+    int64_t now = MonotonicMicros();
+    if (now >= next_tick_us) {
+      registry_->Sample();
+      WriteJsonFile();
+      if (options_.report_callback) {
+        options_.report_callback();
+      }
+      next_tick_us += options_.interval_ms * 1000LL;
+      if (next_tick_us <= now) {
+        next_tick_us = now + options_.interval_ms * 1000LL;
+      }
+      continue;
+    }
+
+    struct pollfd fds[2];
+    fds[0].fd = wakeup_fd_;
+    fds[0].events = POLLIN;
+    fds[1].fd = listen_fd_;
+    fds[1].events = POLLIN;
+    int timeout_ms = static_cast<int>((next_tick_us - now + 999) / 1000);
+    int ret = poll(fds, listen_fd_ >= 0 ? 2 : 1, timeout_ms);
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fprintf(stderr, "指标导出线程 poll 失败: %s\n", strerror(errno));
+      return;
+    }
+    if (fds[0].revents & POLLIN) {
+      return;
+    }
+    if (listen_fd_ >= 0 && (fds[1].revents & POLLIN)) {
+      int client_fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+      if (client_fd >= 0) {
+        ServeClient(client_fd);
+        close(client_fd);
+      }
+    }
+  }
+}
+
+void MetricsExporter::WriteJsonFile() {
+  if (options_.json_path.empty()) {
+    return;
+  }
+  std::string json;
+  registry_->WriteJson(&json);
+
+  std::string temp_path = options_.json_path + ".tmp";
+  FILE* file = fopen(temp_path.c_str(), "w");
+  if (!file) {
+    fprintf(stderr, "无法打开文件 %s 进行写入: %s\n", temp_path.c_str(),
+            strerror(errno));
+    return;
+  }
+  bool ok = fwrite(json.data(), 1, json.size(), file) == json.size();
+  ok = fclose(file) == 0 && ok;
+  if (!ok || rename(temp_path.c_str(), options_.json_path.c_str()) != 0) {
+    fprintf(stderr, "写入文件 %s 失败: %s\n", options_.json_path.c_str(),
+            strerror(errno));
+    unlink(temp_path.c_str());
+  }
+}
+
+void MetricsExporter::ServeClient(int client_fd) {
+  // 读取请求头（只关心请求行）
+  std::string request;
+  char buffer[1024];
+  while (request.size() < kMaxRequestSize &&
+         request.find("\r\n\r\n") == std::string::npos) {
+    struct pollfd pfd;
+    pfd.fd = client_fd;
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, kRequestTimeoutMs) <= 0) {
+      return;
+    }
+    ssize_t n = recv(client_fd, buffer, sizeof(buffer), 0);
+    if (n <= 0) {
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    request.append(buffer, n);
+  }
+
+  std::string body;
+  const char* status = "200 OK";
+  const char* content_type = "text/plain; version=0.0.4; charset=utf-8";
+  if (StartsWith(request, "GET /metrics ") || StartsWith(request, "GET / ")) {
+    registry_->WritePrometheus(&body);
+  } else if (StartsWith(request, "GET /metrics.json ")) {
+    registry_->WriteJson(&body);
+    content_type = "application/json";
+  } else {
+    status = "404 Not Found";
+    body = "not found\n";
+  }
+
+  std::string response;
+  AppendFormat(&response,
+               "HTTP/1.0 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n"
+               "Connection: close\r\n\r\n",
+               status, content_type, body.size());
+  response.append(body);
+  SendAll(client_fd, response);
+}
+
+}  // namespace v4l2_demo
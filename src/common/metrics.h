@@ -0,0 +1,205 @@
+#ifndef V4L2_DEMO_SRC_COMMON_METRICS_H_
+#define V4L2_DEMO_SRC_COMMON_METRICS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "latency_histogram.h"
+
+namespace v4l2_demo {
+
+// 分片计数器：每个线程写自己的缓存行，热路径上只有一次无竞争的
+// relaxed 原子加，读取（导出时）再把所有分片求和
+class Counter {
+ public:
+  Counter() {}
+
+  Counter(const Counter&) = delete;
+  Counter& operator=(const Counter&) = delete;
+
+  void Add(uint64_t delta = 1) {
+    shards_[ThreadShard()].value.fetch_add(delta, std::memory_order_relaxed);
+  }
+
+  // 所有分片之和
+  uint64_t Value() const;
+
+ private:
+  static constexpr size_t kShardCount = 16;
+
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> value{0};
+  };
+
+  // 线程首次使用时轮流分配分片，超过 kShardCount 个线程时共享分片
+  static size_t ThreadShard() {
+    static std::atomic<size_t> next_shard{0};
+    thread_local size_t shard = next_shard.fetch_add(1) % kShardCount;
+    return shard;
+  }
+
+  Shard shards_[kShardCount];
+};
+
+// 瞬时值（如队列深度、当前分辨率）
+class Gauge {
+ public:
+  Gauge() : value_(0) {}
+
+  Gauge(const Gauge&) = delete;
+  Gauge& operator=(const Gauge&) = delete;
+
+  void Set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+  void Add(int64_t delta) {
+    value_.fetch_add(delta, std::memory_order_relaxed);
+  }
+  int64_t Value() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<int64_t> value_;
+};
+
+// 指标类型
+enum class MetricType {
+  kCounter,  // 单调递增
+  kGauge,    // 瞬时值
+  kSummary,  // 延迟分布（p50/p99/p999、总和、计数）
+};
+
+// 指标注册表
+// 注册（Add*）与导出加锁，应在启动阶段完成注册；返回的指针在注册表
+// 生命周期内有效，热路径上直接使用，不经过注册表
+// 指标名遵循 Prometheus 约定（如 v4l2_frames_total），labels 为
+// Prometheus 标签文本（如 device="/dev/video0"），可为空
+class MetricsRegistry {
+ public:
+  MetricsRegistry() {}
+
+  MetricsRegistry(const MetricsRegistry&) = delete;
+  MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+  // 注册计数器
+  // @param window_seconds 大于 0 时额外导出该时间窗内的每秒速率
+  //        （<名称去掉 _total>_per_second），用于观察近期的帧率与卡顿
+  Counter* AddCounter(const std::string& name, const std::string& help,
+                      const std::string& labels = "",
+                      double window_seconds = 0);
+
+  Gauge* AddGauge(const std::string& name, const std::string& help,
+                  const std::string& labels = "");
+
+  // 注册由注册表持有的延迟直方图（微秒）
+  LatencyHistogram* AddHistogram(const std::string& name,
+                                 const std::string& help,
+                                 const std::string& labels = "");
+
+  // 注册外部持有的延迟直方图（如 FrameLatencyTracker 中的各项），
+  // histogram 须比注册表活得更久
+  void AddExternalHistogram(const std::string& name, const std::string& help,
+                            const LatencyHistogram* histogram,
+                            const std::string& labels = "");
+
+  // 注册导出时才求值的指标（如 FrameWriter::GetStats 中的队列深度），
+  // 回调在导出线程中执行，须线程安全
+  // @param type kCounter 或 kGauge
+  void AddCallback(const std::string& name, const std::string& help,
+                   MetricType type, std::function<double()> callback,
+                   const std::string& labels = "",
+                   double window_seconds = 0);
+
+  // 为带时间窗的计数器采样一次，由导出线程周期调用
+  void Sample();
+
+  // 读取带时间窗计数器的当前速率
+  // @return 未注册或没有足够样本时返回 0
+  double GetRate(const std::string& name, const std::string& labels = "");
+
+  // 输出 Prometheus 文本格式（text/plain; version=0.0.4）
+  void WritePrometheus(std::string* out);
+
+  // 输出 JSON 格式
+  void WriteJson(std::string* out);
+
+ private:
+  struct Metric {
+    std::string name;
+    std::string help;
+    std::string labels;
+    MetricType type;
+    std::unique_ptr<Counter> counter;
+    std::unique_ptr<Gauge> gauge;
+    std::unique_ptr<LatencyHistogram> owned_histogram;
+    const LatencyHistogram* histogram = nullptr;
+    std::function<double()> callback;
+
+    // 速率时间窗与样本（时间 微秒, 值）
+    int64_t window_us = 0;
+    std::deque<std::pair<int64_t, double>> samples;
+  };
+
+  static std::unique_ptr<Metric> NewMetric(const std::string& name,
+                                           const std::string& help,
+                                           const std::string& labels,
+                                           MetricType type);
+  void AddMetric(std::unique_ptr<Metric> metric);
+  static double ReadValue(const Metric& metric);
+  static double ComputeRate(const Metric& metric);
+
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<Metric>> metrics_;
+};
+
+// 指标导出器配置
+struct MetricsExporterOptions {
+  int http_port = 0;  // Prometheus 抓取端口（GET /metrics），0 表示不监听
+  std::string bind_address = "0.0.0.0";
+  std::string json_path;  // 周期写入的 JSON 文件，为空表示不写
+  int interval_ms = 1000;  // 采样与写 JSON 的周期
+  // 每个周期在导出线程中调用（采样之后），可用于打印状态行等
+  std::function<void()> report_callback;
+};
+
+// 指标导出线程：周期采样、写 JSON（先写临时文件再 rename，读者不会看到
+// 半个文件），并以最简 HTTP/1.0 服务响应 Prometheus 抓取
+// 所有系统调用都在导出线程中，捕获线程只更新内存中的计数器
+class MetricsExporter {
+ public:
+  MetricsExporter();
+  ~MetricsExporter();
+
+  MetricsExporter(const MetricsExporter&) = delete;
+  MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+  // 启动导出线程
+  // @param registry 指标注册表，须比导出器活得更久
+  // @param options 配置
+  // @return 成功返回 true；端口监听失败返回 false
+  bool Start(MetricsRegistry* registry, const MetricsExporterOptions& options);
+
+  // 停止导出线程（停止前写最后一次 JSON）
+  void Stop();
+
+ private:
+  MetricsRegistry* registry_;
+  MetricsExporterOptions options_;
+  int listen_fd_;
+  int wakeup_fd_;
+  std::thread thread_;
+
+  void ExportLoop();
+  void WriteJsonFile();
+  void ServeClient(int client_fd);
+};
+
+}  // namespace v4l2_demo
+
+#endif  // V4L2_DEMO_SRC_COMMON_METRICS_H_
@@ -0,0 +1,239 @@
+#include "mjpeg_decode_stage.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "format_converter.h"
+#include "jpeg_decoder.h"
+
+namespace v4l2_demo {
+
+MjpegDecodeStage::MjpegDecodeStage(const MjpegDecodeOptions& options)
+    : options_(options),
+      output_size_(0),
+      next_submit_(0),
+      next_decode_(0),
+      next_deliver_(0),
+      delivering_(false),
+      stopping_(false),
+      running_(false),
+      decoded_(0),
+      failed_(0),
+      dropped_(0),
+      total_decode_us_(0),
+      max_decode_us_(0) {}
+
+MjpegDecodeStage::~MjpegDecodeStage() {
+  Stop();
+}
+
+bool MjpegDecodeStage::Start(const OutputCallback& callback) {
+  if (running_ || !callback ||
+      !JpegDecoder::IsSupported(options_.output_format)) {
+    return false;
+  }
+
+  output_size_ = FormatConverter::GetFrameSize(
+      options_.output_format, options_.width, options_.height);
+  if (output_size_ == 0) {
+    fprintf(stderr, "MJPEG 解码尺寸无效: %ux%u\n", options_.width,
+            options_.height);
+    return false;
+  }
+
+  size_t worker_count = options_.worker_count;
+  if (worker_count == 0) {
+    worker_count = std::thread::hardware_concurrency();
+    if (worker_count == 0) {
+      worker_count = 1;
+    }
+  }
+  size_t pool_size =
+      options_.pool_size != 0 ? options_.pool_size : worker_count + 2;
+  size_t max_input_size =
+      options_.max_input_size != 0
+          ? options_.max_input_size
+          : static_cast<size_t>(options_.width) * options_.height * 2;
+
+  // 预分配全部槽位并预先触碰页面，运行期间不再分配内存
+  slots_.clear();
+  slots_.resize(pool_size);
+  for (auto& slot : slots_) {
+    slot.input.assign(max_input_size, 0);
+    slot.output.assign(output_size_, 0);
+    slot.input_size = 0;
+    slot.state = SlotState::kFree;
+  }
+
+  callback_ = callback;
+  next_submit_ = 0;
+  next_decode_ = 0;
+  next_deliver_ = 0;
+  delivering_ = false;
+  stopping_ = false;
+  running_ = true;
+  for (size_t i = 0; i < worker_count; ++i) {
+    workers_.emplace_back(&MjpegDecodeStage::WorkerLoop, this);
+  }
+  return true;
+}
+
+void MjpegDecodeStage::Stop() {
+  if (!running_) {
+    return;
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    space_cv_.wait(lock, [this] { return next_deliver_ == next_submit_; });
+    stopping_ = true;
+  }
+  work_cv_.notify_all();
+
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+  workers_.clear();
+  running_ = false;
+}
+
+bool MjpegDecodeStage::Submit(const FrameLease& lease) {
+  if (!lease.IsValid()) {
+    return false;
+  }
+  return Submit(lease.data(), lease.size(), lease.sequence(),
+                lease.timestamp_us());
+}
+
+bool MjpegDecodeStage::Submit(const void* data, size_t size,
+                              uint32_t sequence, int64_t timestamp_us) {
+  if (!running_ || !data || size == 0) {
+    return false;
+  }
+
+  uint64_t ticket;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (next_submit_ - next_deliver_ >= slots_.size()) {
+      if (!options_.block_when_full) {
+        dropped_++;
+        return false;
+      }
+      space_cv_.wait(lock, [this] {
+        return next_submit_ - next_deliver_ < slots_.size();
+      });
+    }
+    ticket = next_submit_;
+  }
+
+  // 单生产者：该槽位的上一帧已输出，拷贝期间不会被其他线程访问
+  Slot& slot = slots_[ticket % slots_.size()];
+  bool fits = size <= slot.input.size();
+  if (fits) {
+    memcpy(slot.input.data(), data, size);
+  }
+  slot.input_size = fits ? size : 0;
+  slot.sequence = sequence;
+  slot.timestamp_us = timestamp_us;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    slot.state = SlotState::kQueued;
+    next_submit_++;
+  }
+  work_cv_.notify_one();
+  return true;
+}
+
+void MjpegDecodeStage::WorkerLoop() {
+  JpegDecoder decoder;
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    work_cv_.wait(lock, [this] {
+      return stopping_ || next_decode_ < next_submit_;
+    });
+    if (next_decode_ >= next_submit_) {
+      break;  // stopping_ 且没有剩余帧
+    }
+
+    Slot& slot = slots_[next_decode_ % slots_.size()];
+    next_decode_++;
+    slot.state = SlotState::kDecoding;
+    lock.unlock();
+
+    int64_t start_us = MonotonicMicros();
+    bool ok = slot.input_size != 0 &&
+              decoder.Decode(slot.input.data(), slot.input_size,
+                             options_.output_format, options_.width,
+                             options_.height, slot.output.data(),
+                             slot.output.size());
+    int64_t elapsed_us = MonotonicMicros() - start_us;
+
+    lock.lock();
+    if (ok) {
+      decoded_++;
+      total_decode_us_ += elapsed_us;
+      if (elapsed_us > max_decode_us_) {
+        max_decode_us_ = elapsed_us;
+      }
+    } else {
+      // 只打印第一次失败，避免损坏的流刷屏
+      if (failed_++ == 0) {
+        fprintf(stderr, "MJPEG 解码失败（帧 %u）: %s\n", slot.sequence,
+                slot.input_size == 0 ? "帧过大" : decoder.GetLastError());
+      }
+    }
+    slot.state = ok ? SlotState::kDone : SlotState::kFailed;
+    DeliverInOrder(&lock);
+  }
+}
+
+void MjpegDecodeStage::DeliverInOrder(std::unique_lock<std::mutex>* lock) {
+  // 已有线程在输出时由它继续输出本线程完成的帧，保证回调串行且有序
+  if (delivering_) {
+    return;
+  }
+  delivering_ = true;
+
+  while (next_deliver_ < next_submit_) {
+    Slot& slot = slots_[next_deliver_ % slots_.size()];
+    if (slot.state != SlotState::kDone && slot.state != SlotState::kFailed) {
+      break;
+    }
+
+    if (slot.state == SlotState::kDone) {
+      DecodedFrame frame;
+      frame.data = slot.output.data();
+      frame.size = output_size_;
+      frame.width = options_.width;
+      frame.height = options_.height;
+      frame.pixel_format = options_.output_format;
+      frame.sequence = slot.sequence;
+      frame.timestamp_us = slot.timestamp_us;
+
+      lock->unlock();
+      callback_(frame);
+      lock->lock();
+    }
+
+    slot.state = SlotState::kFree;
+    next_deliver_++;
+    space_cv_.notify_all();
+  }
+
+  delivering_ = false;
+}
+
+void MjpegDecodeStage::GetStats(MjpegDecodeStats* stats) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats->submitted = next_submit_;
+  stats->decoded = decoded_;
+  stats->failed = failed_;
+  stats->dropped = dropped_;
+  stats->avg_decode_ms =
+      decoded_ > 0 ? total_decode_us_ / 1000.0 / decoded_ : 0;
+  stats->max_decode_ms = max_decode_us_ / 1000.0;
+}
+
+}  // namespace v4l2_demo
@@ -0,0 +1,141 @@
+#ifndef V4L2_DEMO_SRC_COMMON_MJPEG_DECODE_STAGE_H_
+#define V4L2_DEMO_SRC_COMMON_MJPEG_DECODE_STAGE_H_
+
+#include <linux/videodev2.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "v4l2_utils.h"
+
+namespace v4l2_demo {
+
+// MJPEG 解码阶段配置
+struct MjpegDecodeOptions {
+  uint32_t width = 0;   // 帧宽度（与 VIDIOC_S_FMT 的结果一致）
+  uint32_t height = 0;  // 帧高度
+  uint32_t output_format = V4L2_PIX_FMT_YUV420;  // 见 JpegDecoder::IsSupported
+  size_t worker_count = 0;    // 解码线程数，0 表示 CPU 核数
+  size_t pool_size = 0;       // 解码槽位数，0 表示 worker_count + 2
+  size_t max_input_size = 0;  // 单帧 JPEG 最大字节数，0 表示 width * height * 2
+  bool block_when_full = false;  // 槽位用尽时阻塞提交线程，否则丢弃新帧
+};
+
+// 解码完成的帧，data 仅在输出回调期间有效
+struct DecodedFrame {
+  const uint8_t* data;    // 解码后的数据
+  size_t size;            // 数据长度
+  uint32_t width;
+  uint32_t height;
+  uint32_t pixel_format;  // 即 MjpegDecodeOptions::output_format
+  uint32_t sequence;      // 驱动帧序号
+  int64_t timestamp_us;   // 驱动时间戳（微秒）
+};
+
+// MJPEG 解码阶段统计
+struct MjpegDecodeStats {
+  uint64_t submitted;     // 进入解码的帧数
+  uint64_t decoded;       // 解码成功的帧数
+  uint64_t failed;        // 解码失败的帧数（数据损坏、尺寸不符等）
+  uint64_t dropped;       // 因槽位用尽被丢弃的帧数
+  double avg_decode_ms;   // 平均单帧解码耗时
+  double max_decode_ms;   // 最大单帧解码耗时
+};
+
+// 多线程 MJPEG 解码阶段
+// - 槽位（压缩输入 + 解码输出缓冲区）在 Start 时一次性预分配并循环复用
+// - 多个工作线程并行解码不同的帧，每个线程持有独立的 JpegDecoder
+// - 输出回调严格按提交顺序串行执行，不会并发
+// - 提交时拷贝压缩数据（通常只有几百 KB），租约可立即归还驱动
+// Submit 只能在同一个线程（生产者）中调用
+class MjpegDecodeStage {
+ public:
+  // 输出回调，在解码线程中执行
+  using OutputCallback = std::function<void(const DecodedFrame& frame)>;
+
+  explicit MjpegDecodeStage(const MjpegDecodeOptions& options);
+  ~MjpegDecodeStage();
+
+  MjpegDecodeStage(const MjpegDecodeStage&) = delete;
+  MjpegDecodeStage& operator=(const MjpegDecodeStage&) = delete;
+
+  // 预分配缓冲区并启动解码线程
+  // @param callback 输出回调
+  // @return 成功返回 true，参数无效返回 false
+  bool Start(const OutputCallback& callback);
+
+  // 解码并输出所有已提交的帧后停止解码线程
+  void Stop();
+
+  // 提交一帧 MJPEG 数据（拷贝到槽位）
+  // @param lease 帧租约，调用返回后即可释放
+  // @return 进入解码返回 true，被丢弃返回 false
+  bool Submit(const FrameLease& lease);
+
+  // 提交一帧 MJPEG 数据（拷贝到槽位）
+  // @param data JPEG 数据
+  // @param size JPEG 数据长度
+  // @param sequence 帧序号
+  // @param timestamp_us 时间戳（微秒）
+  // @return 进入解码返回 true，被丢弃返回 false
+  bool Submit(const void* data, size_t size, uint32_t sequence,
+              int64_t timestamp_us);
+
+  // 获取统计信息（可在任意线程调用）
+  void GetStats(MjpegDecodeStats* stats) const;
+
+ private:
+  enum class SlotState {
+    kFree,      // 空闲
+    kQueued,    // 等待解码
+    kDecoding,  // 解码中
+    kDone,      // 解码成功，等待按序输出
+    kFailed,    // 解码失败，按序跳过
+  };
+
+  // 解码槽位，第 N 个提交的帧使用 slots_[N % slots_.size()]
+  struct Slot {
+    std::vector<uint8_t> input;
+    size_t input_size;
+    std::vector<uint8_t> output;
+    uint32_t sequence;
+    int64_t timestamp_us;
+    SlotState state;
+  };
+
+  void WorkerLoop();
+
+  // 按提交顺序输出已完成的槽位，调用时须持有 mutex_
+  void DeliverInOrder(std::unique_lock<std::mutex>* lock);
+
+  MjpegDecodeOptions options_;
+  OutputCallback callback_;
+  size_t output_size_;
+  std::vector<Slot> slots_;
+  std::vector<std::thread> workers_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable work_cv_;   // 有新帧待解码或需要退出
+  std::condition_variable space_cv_;  // 有槽位被释放
+  uint64_t next_submit_;   // 下一个提交的帧编号
+  uint64_t next_decode_;   // 下一个待领取解码的帧编号
+  uint64_t next_deliver_;  // 下一个待输出的帧编号
+  bool delivering_;        // 是否有线程正在执行输出回调
+  bool stopping_;
+  bool running_;
+
+  // 统计（受 mutex_ 保护）
+  uint64_t decoded_;
+  uint64_t failed_;
+  uint64_t dropped_;
+  int64_t total_decode_us_;
+  int64_t max_decode_us_;
+};
+
+}  // namespace v4l2_demo
+
+#endif  // V4L2_DEMO_SRC_COMMON_MJPEG_DECODE_STAGE_H_
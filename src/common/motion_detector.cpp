@@ -0,0 +1,266 @@
+#include "motion_detector.h"
+
+#include <linux/videodev2.h>
+#include <stdlib.h>
+
+#include <algorithm>
+
+#include "pixel_format_traits.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define V4L2_DEMO_HAVE_SSE2 1
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#define V4L2_DEMO_HAVE_NEON 1
+#endif
+
+namespace v4l2_demo {
+
+namespace {
+
+// 把一行中 blocks 个块（每块 block_size 个亮度样本，8 的倍数）的亮度和
+// 累加到 sums；亮度的偏移与步长来自 PixelFormatTraits，按格式各实例化
+// 一份；SSE2 是 x86-64 的基线指令集，无需运行时检测
+template <typename Format>
+void AccumulateBlockSums(const uint8_t* row, uint32_t block_size,
+                         uint32_t blocks, uint32_t* sums) {
+  constexpr uint32_t kOffset = Format::kYOffset;
+  constexpr uint32_t kStep = Format::kYStep;
+  static_assert(kStep == 1 || (kStep == 2 && kOffset < 2),
+                "亮度需紧密排列或隔字节排列");
+  const uint32_t block_bytes = block_size * kStep;
+#if defined(V4L2_DEMO_HAVE_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  for (uint32_t b = 0; b < blocks; ++b) {
+    const uint8_t* p = row + b * block_bytes;
+    __m128i acc = zero;
+    if constexpr (kStep == 2) {
+      // 每 16 字节 8 个亮度：取出偶数（YUYV）或奇数（UYVY）字节后 psadbw
+      for (uint32_t i = 0; i < block_bytes; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        v = kOffset ? _mm_srli_epi16(v, 8)
+                    : _mm_and_si128(v, _mm_set1_epi16(0x00FF));
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(v, zero));
+      }
+    } else {
+      uint32_t i = 0;
+      for (; i + 16 <= block_bytes; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(v, zero));
+      }
+      if (i < block_bytes) {
+        __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p + i));
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(v, zero));
+      }
+    }
+    sums[b] += static_cast<uint32_t>(_mm_cvtsi128_si32(acc)) +
+               static_cast<uint32_t>(
+                   _mm_cvtsi128_si32(_mm_unpackhi_epi64(acc, acc)));
+  }
+#elif defined(V4L2_DEMO_HAVE_NEON)
+  for (uint32_t b = 0; b < blocks; ++b) {
+    const uint8_t* p = row + b * block_bytes;
+    uint32x2_t acc = vdup_n_u32(0);
+    for (uint32_t i = 0; i < block_bytes; i += 8 * kStep) {
+      uint8x8_t y;
+      if constexpr (kStep == 2) {
+        y = vld2_u8(p + i).val[kOffset];
+      } else {
+        y = vld1_u8(p + i);
+      }
+      acc = vpadal_u16(acc, vpaddl_u8(y));
+    }
+    sums[b] += vget_lane_u32(acc, 0) + vget_lane_u32(acc, 1);
+  }
+#else
+  for (uint32_t b = 0; b < blocks; ++b) {
+    const uint8_t* p = row + b * block_bytes + kOffset;
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < block_size; ++i) {
+      sum += p[i * kStep];
+    }
+    sums[b] += sum;
+  }
+#endif
+}
+
+using AccumulateBlockSumsFn = void (*)(const uint8_t* row,
+                                       uint32_t block_size, uint32_t blocks,
+                                       uint32_t* sums);
+
+// 可分析的格式，以 VIDIOC_G_FMT 返回的 pixelformat 为键
+struct LumaFormat {
+  uint32_t fourcc;
+  uint32_t step;  // 相邻亮度样本的字节间距
+  AccumulateBlockSumsFn accumulate;
+};
+
+template <uint32_t kFourcc>
+constexpr LumaFormat MakeLumaFormat() {
+  using Format = PixelFormatTraits<kFourcc>;
+  return {kFourcc, Format::kYStep, AccumulateBlockSums<Format>};
+}
+
+constexpr LumaFormat kLumaFormats[] = {
+    MakeLumaFormat<V4L2_PIX_FMT_YUYV>(),
+    MakeLumaFormat<V4L2_PIX_FMT_UYVY>(),
+    MakeLumaFormat<V4L2_PIX_FMT_NV12>(),
+    MakeLumaFormat<V4L2_PIX_FMT_YUV420>(),
+    MakeLumaFormat<V4L2_PIX_FMT_GREY>(),
+    MakeLumaFormat<V4L2_PIX_FMT_NV21>(),
+    MakeLumaFormat<V4L2_PIX_FMT_YVYU>(),
+    MakeLumaFormat<V4L2_PIX_FMT_VYUY>(),
+    MakeLumaFormat<V4L2_PIX_FMT_NV16>(),
+    MakeLumaFormat<V4L2_PIX_FMT_YVU420>(),
+};
+
+const LumaFormat* FindLumaFormat(uint32_t pixel_format) {
+  for (const LumaFormat& format : kLumaFormats) {
+    if (format.fourcc == pixel_format) {
+      return &format;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+MotionDetector::MotionDetector(const MotionDetectorOptions& options)
+    : options_(options),
+      hold_us_(static_cast<int64_t>(options.hold_seconds * 1e6)),
+      keyframe_us_(static_cast<int64_t>(options.keyframe_seconds * 1e6)),
+      pixel_format_(0),
+      width_(0),
+      height_(0),
+      has_reference_(false),
+      last_motion_us_(0),
+      last_pass_us_(0),
+      frames_(0),
+      passed_(0),
+      motion_frames_(0),
+      last_score_(0) {
+  options_.block_size = std::max(8u, options_.block_size / 8 * 8);
+  options_.row_step = std::max(1u, options_.row_step);
+}
+
+bool MotionDetector::IsSupported(uint32_t pixel_format) {
+  return FindLumaFormat(pixel_format) != nullptr;
+}
+
+void MotionDetector::Reset() {
+  has_reference_ = false;
+}
+
+bool MotionDetector::ComputeBlockMeans(const uint8_t* data, size_t size,
+                                       uint32_t pixel_format, uint32_t width,
+                                       uint32_t height,
+                                       uint32_t bytesperline) {
+  const LumaFormat* format = FindLumaFormat(pixel_format);
+  if (!data || !format) {
+    return false;
+  }
+  const uint32_t block = options_.block_size;
+  const uint32_t blocks_x = width / block;
+  const uint32_t blocks_y = height / block;
+  const size_t stride = bytesperline ? bytesperline
+                                     : static_cast<size_t>(width) *
+                                           format->step;
+  if (blocks_x == 0 || blocks_y == 0 ||
+      size < stride * (height - 1) +
+                 static_cast<size_t>(width) * format->step) {
+    return false;
+  }
+
+  if (pixel_format != pixel_format_ || width != width_ || height != height_) {
+    pixel_format_ = pixel_format;
+    width_ = width;
+    height_ = height;
+    sums_.resize(static_cast<size_t>(blocks_x) * blocks_y);
+    means_.resize(sums_.size());
+    reference_.resize(sums_.size());
+    has_reference_ = false;
+  }
+
+  // 只用完整的块，右侧与底部不足一块的像素被忽略
+  std::fill(sums_.begin(), sums_.end(), 0);
+  const uint32_t rows_per_block = (block + options_.row_step - 1) /
+                                  options_.row_step;
+  const uint32_t samples = block * rows_per_block;
+  for (uint32_t by = 0; by < blocks_y; ++by) {
+    uint32_t* sums = &sums_[static_cast<size_t>(by) * blocks_x];
+    for (uint32_t y = by * block; y < (by + 1) * block;
+         y += options_.row_step) {
+      format->accumulate(data + y * stride, block, blocks_x, sums);
+    }
+  }
+  for (size_t i = 0; i < sums_.size(); ++i) {
+    means_[i] = static_cast<uint8_t>((sums_[i] + samples / 2) / samples);
+  }
+  return true;
+}
+
+MotionResult MotionDetector::Process(const void* data, size_t size,
+                                     uint32_t pixel_format, uint32_t width,
+                                     uint32_t height, uint32_t bytesperline,
+                                     int64_t timestamp_us) {
+  MotionResult result;
+  result.score = 1;
+  result.changed_blocks = 0;
+  result.motion = true;
+  result.pass = true;
+  if (!ComputeBlockMeans(static_cast<const uint8_t*>(data), size,
+                         pixel_format, width, height, bytesperline)) {
+    return Finish(result);
+  }
+
+  if (has_reference_) {
+    uint32_t changed = 0;
+    for (size_t i = 0; i < means_.size(); ++i) {
+      if (static_cast<uint32_t>(abs(means_[i] - reference_[i])) >
+          options_.block_threshold) {
+        ++changed;
+      }
+    }
+    result.changed_blocks = changed;
+    result.score = static_cast<double>(changed) / means_.size();
+    result.motion = result.score >= options_.score_threshold;
+  } else {
+    result.changed_blocks = static_cast<uint32_t>(means_.size());
+  }
+
+  if (result.motion) {
+    reference_.swap(means_);
+    has_reference_ = true;
+    last_motion_us_ = timestamp_us;
+  }
+  result.pass = result.motion || timestamp_us - last_motion_us_ < hold_us_ ||
+                (keyframe_us_ > 0 &&
+                 timestamp_us - last_pass_us_ >= keyframe_us_);
+  if (result.pass) {
+    last_pass_us_ = timestamp_us;
+  }
+  return Finish(result);
+}
+
+MotionResult MotionDetector::Finish(const MotionResult& result) {
+  frames_.fetch_add(1, std::memory_order_relaxed);
+  if (result.pass) {
+    passed_.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (result.motion) {
+    motion_frames_.fetch_add(1, std::memory_order_relaxed);
+  }
+  last_score_.store(result.score, std::memory_order_relaxed);
+  return result;
+}
+
+void MotionDetector::GetStats(MotionStats* stats) const {
+  stats->frames = frames_.load(std::memory_order_relaxed);
+  stats->passed = passed_.load(std::memory_order_relaxed);
+  stats->skipped = stats->frames - stats->passed;
+  stats->motion_frames = motion_frames_.load(std::memory_order_relaxed);
+  stats->last_score = last_score_.load(std::memory_order_relaxed);
+}
+
+}  // namespace v4l2_demo
@@ -0,0 +1,111 @@
+#ifndef V4L2_DEMO_SRC_COMMON_MOTION_DETECTOR_H_
+#define V4L2_DEMO_SRC_COMMON_MOTION_DETECTOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+namespace v4l2_demo {
+
+// 运动检测配置
+struct MotionDetectorOptions {
+  uint32_t block_size = 16;  // 块边长（像素，8 的倍数）
+  uint32_t row_step = 2;     // 块内每隔几行采样一行，减少读取的数据量
+  // 块平均亮度与参考帧相差超过该值视为变化（抑制传感器噪声）
+  uint32_t block_threshold = 12;
+  // 变化块的比例达到该值视为有运动
+  double score_threshold = 0.01;
+  // 最后一次运动之后继续放行的时长，保留动作结束的过程
+  double hold_seconds = 2;
+  // 画面静止时至少每隔多久放行一帧，0 表示静止时完全不放行
+  double keyframe_seconds = 0;
+};
+
+// 单帧检测结果
+struct MotionResult {
+  double score;             // 变化块的比例（0-1），无法分析的帧为 1
+  uint32_t changed_blocks;  // 变化的块数
+  bool motion;              // 是否检测到运动
+  bool pass;                // 是否应该保存/编码该帧（运动、保持期或关键帧）
+};
+
+// 运动检测统计
+struct MotionStats {
+  uint64_t frames;         // 检测的帧数
+  uint64_t passed;         // 放行的帧数
+  uint64_t skipped;        // 被跳过的帧数
+  uint64_t motion_frames;  // 检测到运动的帧数
+  double last_score;       // 最近一帧的变化比例
+};
+
+// 基于亮度块差分的运动检测器
+// 直接从捕获缓冲区读取亮度（YUYV/UYVY/YVYU/VYUY 的 Y 字节，GREY 与
+// NV12/NV21/NV16/YUV420/YVU420 的 Y 平面），按块求平均亮度得到降采样的
+// 亮度图，与参考图逐块比较。
+// 块求和使用 SIMD（x86 SSE2 的 psadbw，ARM NEON 的成对累加）
+// 判定为运动时当前亮度图成为新的参考，缓慢的光照变化累积到阈值后
+// 才会触发一次
+// 非线程安全：Process 只能在一个线程调用，GetStats 可在任意线程调用
+class MotionDetector {
+ public:
+  explicit MotionDetector(
+      const MotionDetectorOptions& options = MotionDetectorOptions());
+
+  MotionDetector(const MotionDetector&) = delete;
+  MotionDetector& operator=(const MotionDetector&) = delete;
+
+  // 检查是否能分析该格式（压缩格式的帧总是放行）
+  static bool IsSupported(uint32_t pixel_format);
+
+  // 检测一帧；格式或分辨率变化时自动丢弃参考帧
+  // @param data 帧数据，为 nullptr 时（如仅导出 DMABUF）帧直接放行
+  // @param size 帧数据大小
+  // @param pixel_format 像素格式
+  // @param width 宽度
+  // @param height 高度
+  // @param bytesperline 行跨度（字节），0 表示紧密排列
+  // @param timestamp_us 单调时钟时间（微秒），用于保持期与关键帧间隔
+  // @return 检测结果
+  MotionResult Process(const void* data, size_t size, uint32_t pixel_format,
+                       uint32_t width, uint32_t height, uint32_t bytesperline,
+                       int64_t timestamp_us);
+
+  // 丢弃参考帧，下一帧视为运动
+  void Reset();
+
+  void GetStats(MotionStats* stats) const;
+
+ private:
+  // 计算各块的平均亮度，结果写入 means_
+  // @return 帧可以分析返回 true
+  bool ComputeBlockMeans(const uint8_t* data, size_t size,
+                         uint32_t pixel_format, uint32_t width,
+                         uint32_t height, uint32_t bytesperline);
+
+  // 更新统计并返回结果
+  MotionResult Finish(const MotionResult& result);
+
+  MotionDetectorOptions options_;
+  int64_t hold_us_;
+  int64_t keyframe_us_;
+
+  uint32_t pixel_format_;  // 参考帧的格式与分辨率
+  uint32_t width_;
+  uint32_t height_;
+  std::vector<uint32_t> sums_;      // 各块的亮度和
+  std::vector<uint8_t> means_;      // 当前帧的块平均亮度
+  std::vector<uint8_t> reference_;  // 参考帧的块平均亮度
+  bool has_reference_;
+  int64_t last_motion_us_;
+  int64_t last_pass_us_;
+
+  std::atomic<uint64_t> frames_;
+  std::atomic<uint64_t> passed_;
+  std::atomic<uint64_t> motion_frames_;
+  std::atomic<double> last_score_;
+};
+
+}  // namespace v4l2_demo
+
+#endif  // V4L2_DEMO_SRC_COMMON_MOTION_DETECTOR_H_
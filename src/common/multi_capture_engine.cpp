@@ -0,0 +1,294 @@
+#include "multi_capture_engine.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "realtime.h"
+
+namespace v4l2_demo {
+
+namespace {
+// 缓冲区全部被下游持有时，重新检查设备的间隔
+constexpr int kStarvedRetryMs = 1;
+
+// 单次 epoll_wait 最多返回的事件数
+constexpr int kMaxEvents = 16;
+
+// epoll 事件的 data.u32 标识：0 为退出事件，摄像头为 ID + 1
+constexpr uint32_t kWakeupTag = 0;
+}  // namespace
+
+MultiCaptureEngine::MultiCaptureEngine(const CaptureEngineOptions& options)
+    : options_(options), wakeup_fd_(-1), running_(false) {}
+
+MultiCaptureEngine::~MultiCaptureEngine() {
+  Stop();
+  if (wakeup_fd_ >= 0) {
+    close(wakeup_fd_);
+  }
+}
+
+int MultiCaptureEngine::AddCamera(const CameraConfig& config,
+                                  FrameCallback callback) {
+  if (running_) {
+    fprintf(stderr, "捕获已启动，无法添加摄像头\n");
+    return -1;
+  }
+
+  std::unique_ptr<Camera> camera(new Camera());
+  camera->id = cameras_.size();
+  camera->config = config;
+  camera->callback = std::move(callback);
+  camera->starved = false;
+  camera->frames = 0;
+  camera->last_report_frames = 0;
+  camera->last_report_time_us = 0;
+
+  if (!camera->device.Open(config.device_path)) {
+    return -1;
+  }
+  camera->device.SetPrefaultBuffers(config.prefault_buffers);
+  if (!camera->device.SetFormat(config.width, config.height,
+                                config.pixel_format)) {
+    return -1;
+  }
+  if (!camera->device.InitMemoryMapping(config.buffer_count)) {
+    return -1;
+  }
+
+  cameras_.push_back(std::move(camera));
+  return cameras_.back()->id;
+}
+
+bool MultiCaptureEngine::Start(bool thread_per_camera) {
+  if (running_ || cameras_.empty()) {
+    return false;
+  }
+
+  if (wakeup_fd_ < 0) {
+    wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeup_fd_ < 0) {
+      fprintf(stderr, "创建 eventfd 失败: %s\n", strerror(errno));
+      return false;
+    }
+  } else {
+    // 清除上一次运行遗留的退出事件
+    uint64_t value;
+    ssize_t ret = read(wakeup_fd_, &value, sizeof(value));
+    (void)ret;
+  }
+
+  // 启动时报告实时调度/内存锁定缺少的权限，失败时仍以普通优先级运行
+  int max_priority = thread_per_camera ? 0 : options_.reactor_sched_priority;
+  for (const auto& camera : cameras_) {
+    if (thread_per_camera) {
+      max_priority = std::max(max_priority, camera->config.sched_priority);
+    }
+  }
+  if (max_priority > 0 || options_.lock_memory) {
+    CheckRealtimePermissions(max_priority, options_.lock_memory);
+  }
+  // 缓冲区已全部映射，锁定后捕获期间不会因换出而缺页
+  if (options_.lock_memory && LockProcessMemory()) {
+    printf("已锁定进程内存（mlockall）\n");
+  }
+
+  int64_t now = MonotonicMicros();
+  for (auto& camera : cameras_) {
+    if (!camera->device.StartStreaming()) {
+      fprintf(stderr, "启动 %s 视频流失败\n",
+              camera->config.device_path.c_str());
+      for (auto& started : cameras_) {
+        started->device.StopStreaming();
+      }
+      return false;
+    }
+    camera->starved = false;
+    camera->last_report_frames = camera->frames.load();
+    camera->last_report_time_us = now;
+  }
+
+  running_ = true;
+  if (thread_per_camera) {
+    for (auto& camera : cameras_) {
+      std::vector<Camera*> group(1, camera.get());
+      threads_.emplace_back(&MultiCaptureEngine::ReactorLoop, this, group,
+                            camera->config.cpu_core,
+                            camera->config.sched_priority);
+    }
+  } else {
+    std::vector<Camera*> group;
+    for (auto& camera : cameras_) {
+      group.push_back(camera.get());
+    }
+    threads_.emplace_back(&MultiCaptureEngine::ReactorLoop, this, group,
+                          options_.reactor_cpu_core,
+                          options_.reactor_sched_priority);
+  }
+
+  return true;
+}
+
+void MultiCaptureEngine::RequestStop() {
+  if (wakeup_fd_ < 0) {
+    return;
+  }
+  // 不读取 eventfd，使其保持可读，所有反应器线程都能看到退出事件
+  uint64_t value = 1;
+  ssize_t ret = write(wakeup_fd_, &value, sizeof(value));
+  (void)ret;
+}
+
+void MultiCaptureEngine::Stop() {
+  if (!running_) {
+    return;
+  }
+
+  RequestStop();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+  threads_.clear();
+
+  for (auto& camera : cameras_) {
+    camera->device.StopStreaming();
+  }
+  running_ = false;
+}
+
+void MultiCaptureEngine::GetStats(std::vector<CameraStats>* stats) {
+  stats->clear();
+
+  int64_t now = MonotonicMicros();
+  for (auto& camera : cameras_) {
+    CameraStats item;
+    item.device_path = camera->config.device_path;
+    item.frames = camera->frames.load();
+    DropStats drops;
+    camera->device.GetDropStats(&drops);
+    item.dropped = drops.dropped;
+    item.error_frames = drops.error_frames;
+    item.short_frames = drops.short_frames;
+
+    int64_t elapsed_us = now - camera->last_report_time_us;
+    item.fps = (elapsed_us > 0)
+                   ? (item.frames - camera->last_report_frames) * 1e6 /
+                         elapsed_us
+                   : 0;
+    camera->last_report_frames = item.frames;
+    camera->last_report_time_us = now;
+
+    stats->push_back(item);
+  }
+}
+
+V4L2Device* MultiCaptureEngine::GetDevice(int camera_id) {
+  if (camera_id < 0 || camera_id >= static_cast<int>(cameras_.size())) {
+    return nullptr;
+  }
+  return &cameras_[camera_id]->device;
+}
+
+void MultiCaptureEngine::ReactorLoop(std::vector<Camera*> cameras,
+                                     int cpu_core, int sched_priority) {
+  SetThreadAffinity(cpu_core);
+  SetThreadRealtimePriority(sched_priority);
+
+  int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd < 0) {
+    fprintf(stderr, "创建 epoll 失败: %s\n", strerror(errno));
+    return;
+  }
+
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.u32 = kWakeupTag;
+  epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wakeup_fd_, &ev);
+
+  for (Camera* camera : cameras) {
+    ev.data.u32 = camera->id + 1;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD,
+                  camera->device.GetFileDescriptor(), &ev) < 0) {
+      fprintf(stderr, "注册 %s 失败: %s\n",
+              camera->config.device_path.c_str(), strerror(errno));
+    }
+  }
+
+  bool running = true;
+  while (running) {
+    // 有设备处于缓冲区耗尽状态时，定时检查下游是否已归还缓冲区
+    bool any_starved = false;
+    for (Camera* camera : cameras) {
+      if (!camera->starved) {
+        continue;
+      }
+      if (camera->device.GetLeasedBufferCount() <
+          camera->device.GetBufferCount()) {
+        ev.data.u32 = camera->id + 1;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, camera->device.GetFileDescriptor(),
+                  &ev);
+        camera->starved = false;
+      } else {
+        any_starved = true;
+      }
+    }
+
+    struct epoll_event events[kMaxEvents];
+    int n = epoll_wait(epoll_fd, events, kMaxEvents,
+                       any_starved ? kStarvedRetryMs : -1);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fprintf(stderr, "epoll_wait 失败: %s\n", strerror(errno));
+      break;
+    }
+
+    for (int i = 0; i < n; ++i) {
+      if (events[i].data.u32 == kWakeupTag) {
+        running = false;
+        break;
+      }
+
+      Camera* camera = cameras_[events[i].data.u32 - 1].get();
+      if (events[i].events & EPOLLERR) {
+        // EPOLLERR 是电平触发的，必须移出 epoll 以免空转
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, camera->device.GetFileDescriptor(),
+                  nullptr);
+        if (camera->device.GetLeasedBufferCount() >=
+            camera->device.GetBufferCount()) {
+          camera->starved = true;
+        } else {
+          fprintf(stderr, "设备 %s 出错，停止该设备的捕获\n",
+                  camera->config.device_path.c_str());
+        }
+        continue;
+      }
+
+      DrainCamera(camera);
+    }
+  }
+
+  close(epoll_fd);
+}
+
+void MultiCaptureEngine::DrainCamera(Camera* camera) {
+  FrameLease lease;
+  while (camera->device.DequeueFrame(&lease)) {
+    camera->frames.fetch_add(1, std::memory_order_relaxed);
+
+    if (camera->callback) {
+      camera->callback(camera->id, &lease);
+    }
+    lease.Release();
+  }
+}
+
+}  // namespace v4l2_demo
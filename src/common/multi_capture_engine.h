@@ -0,0 +1,123 @@
+#ifndef V4L2_DEMO_SRC_COMMON_MULTI_CAPTURE_ENGINE_H_
+#define V4L2_DEMO_SRC_COMMON_MULTI_CAPTURE_ENGINE_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "v4l2_utils.h"
+
+namespace v4l2_demo {
+
+// 单个摄像头的捕获配置
+struct CameraConfig {
+  std::string device_path;    // 设备路径，如 /dev/video0
+  uint32_t width = 640;       // 视频宽度
+  uint32_t height = 480;      // 视频高度
+  uint32_t pixel_format = V4L2_PIX_FMT_YUYV;  // 像素格式
+  uint32_t buffer_count = 4;  // 内存映射缓冲区数量
+  int cpu_core = -1;          // 独立线程模式下绑定的 CPU 核，-1 表示不绑定
+  int sched_priority = 0;     // 独立线程模式下的 SCHED_FIFO 优先级（1-99），
+                              // 0 表示不修改
+  bool prefault_buffers = false;  // 映射缓冲区时预先建立页表
+};
+
+// 捕获引擎配置
+struct CaptureEngineOptions {
+  bool lock_memory = false;        // Start 时 mlockall 锁定进程内存
+  int reactor_cpu_core = -1;       // 单反应器模式下绑定的 CPU 核
+  int reactor_sched_priority = 0;  // 单反应器模式下的 SCHED_FIFO 优先级
+};
+
+// 单个摄像头的运行统计
+struct CameraStats {
+  std::string device_path;  // 设备路径
+  uint64_t frames;          // 累计帧数
+  uint64_t dropped;         // 累计丢帧数（根据 sequence 间隔推断）
+  uint64_t error_frames;    // 带错误标志的帧数
+  uint64_t short_frames;    // 数据不完整的帧数
+  double fps;               // 距离上次 GetStats 调用期间的帧率
+};
+
+// 多摄像头捕获引擎
+// 默认由单个 epoll 反应器线程服务所有设备；也可让每个摄像头
+// 运行在独立线程（各自的 epoll）上并绑定到指定 CPU 核
+// 捕获线程可设为 SCHED_FIFO，避免被写入、推理等线程抢占导致丢帧；
+// 权限不足时 Start 打印原因并继续以普通优先级运行
+class MultiCaptureEngine {
+ public:
+  // 帧回调，lease 在回调返回后自动释放
+  // 独立线程模式下不同摄像头的回调可能并发执行
+  using FrameCallback = std::function<void(int camera_id, FrameLease* lease)>;
+
+  explicit MultiCaptureEngine(
+      const CaptureEngineOptions& options = CaptureEngineOptions());
+  ~MultiCaptureEngine();
+
+  MultiCaptureEngine(const MultiCaptureEngine&) = delete;
+  MultiCaptureEngine& operator=(const MultiCaptureEngine&) = delete;
+
+  // 添加摄像头：打开设备、设置格式并初始化内存映射
+  // @param config 摄像头配置
+  // @param callback 该摄像头的帧回调
+  // @return 成功返回摄像头 ID（从 0 开始），失败返回 -1
+  int AddCamera(const CameraConfig& config, FrameCallback callback);
+
+  // 启动所有摄像头的视频流与捕获线程
+  // @param thread_per_camera true 为每个摄像头一个线程，false 为单反应器
+  // @return 成功返回 true，失败返回 false
+  bool Start(bool thread_per_camera = false);
+
+  // 请求所有捕获线程退出，可在信号处理函数中调用
+  void RequestStop();
+
+  // 停止捕获：请求退出、等待线程结束并停止视频流
+  void Stop();
+
+  // 获取每个摄像头的统计信息
+  // @param stats 输出参数，按摄像头 ID 排列
+  void GetStats(std::vector<CameraStats>* stats);
+
+  // 获取摄像头设备
+  // @return 摄像头 ID 无效时返回 nullptr
+  V4L2Device* GetDevice(int camera_id);
+
+  // 获取摄像头数量
+  size_t GetCameraCount() const { return cameras_.size(); }
+
+ private:
+  struct Camera {
+    int id;
+    CameraConfig config;
+    V4L2Device device;
+    FrameCallback callback;
+    bool starved;  // 缓冲区全部被持有，暂时从 epoll 中移除
+
+    std::atomic<uint64_t> frames;
+
+    // GetStats 计算帧率用
+    uint64_t last_report_frames;
+    int64_t last_report_time_us;
+  };
+
+  CaptureEngineOptions options_;
+  std::vector<std::unique_ptr<Camera>> cameras_;
+  std::vector<std::thread> threads_;
+  int wakeup_fd_;  // 所有反应器共享的退出 eventfd
+  bool running_;
+
+  // 反应器主循环：在一个 epoll 实例上服务给定的若干摄像头
+  void ReactorLoop(std::vector<Camera*> cameras, int cpu_core,
+                   int sched_priority);
+
+  // 处理一个摄像头上所有已就绪的帧
+  void DrainCamera(Camera* camera);
+};
+
+}  // namespace v4l2_demo
+
+#endif  // V4L2_DEMO_SRC_COMMON_MULTI_CAPTURE_ENGINE_H_
@@ -0,0 +1,77 @@
+#include "parallel_converter.h"
+
+#include <unistd.h>
+
+namespace v4l2_demo {
+
+namespace {
+// 无法获取 L2 大小时使用的默认值
+constexpr size_t kDefaultL2CacheSize = 256 * 1024;
+
+size_t DetectL2CacheSize() {
+#ifdef _SC_LEVEL2_CACHE_SIZE
+  long size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+  if (size > 0) {
+    return static_cast<size_t>(size);
+  }
+#endif
+  return kDefaultL2CacheSize;
+}
+}  // namespace
+
+ParallelConverter::ParallelConverter(ThreadPool* pool, ConverterIsa isa)
+    : pool_(pool), converter_(isa), l2_cache_size_(DetectL2CacheSize()) {}
+
+uint32_t ParallelConverter::GetBandRows(uint32_t width, uint32_t height,
+                                        uint32_t dst_format) const {
+  // 每行的源字节数 + 目标字节数
+  size_t row_bytes = static_cast<size_t>(width) * 2 +
+                     FormatConverter::GetFrameSize(dst_format, width, 2) / 2;
+  if (row_bytes == 0) {
+    return height;
+  }
+
+  // 行带数据占用一半 L2，留出空间给其他数据
+  size_t rows = (l2_cache_size_ / 2) / row_bytes;
+  rows &= ~static_cast<size_t>(1);
+  if (rows < 2) {
+    rows = 2;
+  }
+  return rows < height ? static_cast<uint32_t>(rows) : height;
+}
+
+bool ParallelConverter::Convert(const void* src, size_t src_size,
+                                uint32_t src_format, uint32_t width,
+                                uint32_t height, uint32_t dst_format,
+                                void* dst, size_t dst_size) const {
+  if (!src || !dst || width == 0 || height == 0 || (width & 1) != 0 ||
+      !FormatConverter::IsSupported(src_format, dst_format)) {
+    return false;
+  }
+  if (src_size < FormatConverter::GetFrameSize(src_format, width, height) ||
+      dst_size < FormatConverter::GetFrameSize(dst_format, width, height)) {
+    return false;
+  }
+  if (!pool_) {
+    return converter_.Convert(src, src_size, src_format, width, height,
+                              dst_format, dst, dst_size);
+  }
+
+  const uint32_t band_rows = GetBandRows(width, height, dst_format);
+  const size_t band_count = (height + band_rows - 1) / band_rows;
+  const uint8_t* src_bytes = static_cast<const uint8_t*>(src);
+  uint8_t* dst_bytes = static_cast<uint8_t*>(dst);
+
+  pool_->ParallelFor(band_count, [&](size_t band) {
+    uint32_t row_begin = band * band_rows;
+    uint32_t row_end = row_begin + band_rows;
+    if (row_end > height) {
+      row_end = height;
+    }
+    converter_.ConvertRows(src_bytes, src_format, width, height, dst_format,
+                           dst_bytes, row_begin, row_end);
+  });
+  return true;
+}
+
+}  // namespace v4l2_demo
@@ -0,0 +1,42 @@
+#ifndef V4L2_DEMO_SRC_COMMON_PARALLEL_CONVERTER_H_
+#define V4L2_DEMO_SRC_COMMON_PARALLEL_CONVERTER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "format_converter.h"
+#include "thread_pool.h"
+
+namespace v4l2_demo {
+
+// 多线程分带格式转换
+// 将一帧按行切分为若干行带，交给持久线程池并行转换。行带高度由 L2
+// 缓存大小决定，使单个行带的源与目标数据能留在 L2 中。各行带写入互不
+// 重叠的区域，结果与单线程转换逐位一致
+class ParallelConverter {
+ public:
+  // @param pool 线程池（由调用者持有，可与其他模块共享）
+  // @param isa 转换内核指令集
+  explicit ParallelConverter(ThreadPool* pool,
+                             ConverterIsa isa = ConverterIsa::kAuto);
+
+  // 转换一整帧，参数含义与 FormatConverter::Convert 相同
+  bool Convert(const void* src, size_t src_size, uint32_t src_format,
+               uint32_t width, uint32_t height, uint32_t dst_format,
+               void* dst, size_t dst_size) const;
+
+  // 计算行带高度（偶数行）
+  uint32_t GetBandRows(uint32_t width, uint32_t height,
+                       uint32_t dst_format) const;
+
+  const FormatConverter& GetConverter() const { return converter_; }
+
+ private:
+  ThreadPool* pool_;
+  FormatConverter converter_;
+  size_t l2_cache_size_;
+};
+
+}  // namespace v4l2_demo
+
+#endif  // V4L2_DEMO_SRC_COMMON_PARALLEL_CONVERTER_H_
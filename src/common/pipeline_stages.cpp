@@ -0,0 +1,343 @@
+#include "pipeline_stages.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/videodev2.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <utility>
+
+#include "frame_bus.h"
+#include "m2m_encoder_sink.h"
+#include "pixel_format_traits.h"
+
+namespace v4l2_demo {
+
+namespace {
+
+// 单平面格式每像素字节数，其他格式返回 0
+uint32_t PackedBytesPerPixel(uint32_t pixel_format) {
+  const PixelFormatInfo* info = FindPixelFormatInfo(pixel_format);
+  return info && info->layout == PlaneLayout::kPacked ? info->bytes_per_pixel
+                                                      : 0;
+}
+
+// 按行复制一个平面的矩形区域
+// @return 源区域超出 src_size 时返回 false
+bool CopyRect(const uint8_t* src, size_t src_size, size_t src_offset,
+              uint32_t src_stride, uint32_t x_bytes, uint32_t y,
+              uint32_t width_bytes, uint32_t rows, uint8_t* dst) {
+  if (rows == 0) {
+    return true;
+  }
+  size_t last = src_offset + static_cast<size_t>(y + rows - 1) * src_stride +
+                x_bytes + width_bytes;
+  if (last > src_size) {
+    return false;
+  }
+  const uint8_t* row = src + src_offset +
+                       static_cast<size_t>(y) * src_stride + x_bytes;
+  for (uint32_t i = 0; i < rows; ++i) {
+    memcpy(dst, row, width_bytes);
+    row += src_stride;
+    dst += width_bytes;
+  }
+  return true;
+}
+
+}  // namespace
+
+ConvertStage::ConvertStage(uint32_t dst_format) : dst_format_(dst_format) {}
+
+std::string ConvertStage::GetName() const {
+  return "convert->" + PixelFormatToString(dst_format_);
+}
+
+StageResult ConvertStage::Process(const PipelineFrame& input,
+                                  PipelineFrame* output) {
+  if (input.pixel_format == dst_format_) {
+    return StageResult::kForward;
+  }
+  if (!output) {
+    return StageResult::kConsume;
+  }
+  if (input.bytesperline != 0 && input.bytesperline != input.width * 2) {
+    return StageResult::kFail;
+  }
+
+  size_t dst_size =
+      FormatConverter::GetFrameSize(dst_format_, input.width, input.height);
+  if (dst_size == 0) {
+    return StageResult::kFail;
+  }
+  uint8_t* dst = output->Allocate(dst_size);
+  if (!converter_.Convert(input.data(), input.size(), input.pixel_format,
+                          input.width, input.height, dst_format_, dst,
+                          dst_size)) {
+    return StageResult::kFail;
+  }
+  output->pixel_format = dst_format_;
+  output->bytesperline = 0;
+  return StageResult::kEmit;
+}
+
+CropStage::CropStage(uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+    : x_(x), y_(y), width_(width), height_(height) {}
+
+std::string CropStage::GetName() const {
+  return "crop " + std::to_string(width_) + "x" + std::to_string(height_);
+}
+
+StageResult CropStage::Process(const PipelineFrame& input,
+                               PipelineFrame* output) {
+  if (!output) {
+    return StageResult::kConsume;
+  }
+  if (width_ == 0 || height_ == 0 || x_ + width_ > input.width ||
+      y_ + height_ > input.height) {
+    return StageResult::kFail;
+  }
+
+  const uint8_t* src = static_cast<const uint8_t*>(input.data());
+  uint32_t format = input.pixel_format;
+  uint32_t bpp = PackedBytesPerPixel(format);
+  bool ok = false;
+
+  if (bpp != 0) {
+    // 4:2:2 的两个像素共享一组色度，不能从中间切开
+    if (FindPixelFormatInfo(format)->chroma_shift_x != 0 &&
+        (x_ % 2 != 0 || width_ % 2 != 0)) {
+      return StageResult::kFail;
+    }
+    uint32_t stride = input.bytesperline ? input.bytesperline
+                                         : input.width * bpp;
+    uint8_t* dst = output->Allocate(static_cast<size_t>(width_) * height_ *
+                                    bpp);
+    ok = CopyRect(src, input.size(), 0, stride, x_ * bpp, y_, width_ * bpp,
+                  height_, dst);
+  } else if (format == V4L2_PIX_FMT_NV12 || format == V4L2_PIX_FMT_YUV420) {
+    if (x_ % 2 != 0 || y_ % 2 != 0 || width_ % 2 != 0 || height_ % 2 != 0) {
+      return StageResult::kFail;
+    }
+    uint32_t stride = input.bytesperline ? input.bytesperline : input.width;
+    size_t luma_size = static_cast<size_t>(stride) * input.height;
+    size_t dst_luma = static_cast<size_t>(width_) * height_;
+    uint8_t* dst = output->Allocate(dst_luma * 3 / 2);
+    ok = CopyRect(src, input.size(), 0, stride, x_, y_, width_, height_, dst);
+    if (ok && format == V4L2_PIX_FMT_NV12) {
+      // 交错的 UV 平面：字节偏移与宽度同 Y 平面，行数减半
+      ok = CopyRect(src, input.size(), luma_size, stride, x_, y_ / 2, width_,
+                    height_ / 2, dst + dst_luma);
+    } else if (ok) {
+      uint32_t chroma_stride = stride / 2;
+      size_t chroma_size = static_cast<size_t>(chroma_stride) *
+                           (input.height / 2);
+      size_t dst_chroma = dst_luma / 4;
+      ok = CopyRect(src, input.size(), luma_size, chroma_stride, x_ / 2,
+                    y_ / 2, width_ / 2, height_ / 2, dst + dst_luma) &&
+           CopyRect(src, input.size(), luma_size + chroma_size, chroma_stride,
+                    x_ / 2, y_ / 2, width_ / 2, height_ / 2,
+                    dst + dst_luma + dst_chroma);
+    }
+  }
+
+  if (!ok) {
+    return StageResult::kFail;
+  }
+  output->width = width_;
+  output->height = height_;
+  output->bytesperline = 0;
+  return StageResult::kEmit;
+}
+
+ScaleStage::ScaleStage(uint32_t width, uint32_t height, ScaleFilter filter)
+    : width_(width), height_(height), filter_(filter) {}
+
+std::string ScaleStage::GetName() const {
+  return std::string(filter_ == ScaleFilter::kBox ? "box " : "bilinear ") +
+         std::to_string(width_) + "x" + std::to_string(height_);
+}
+
+StageResult ScaleStage::Process(const PipelineFrame& input,
+                                PipelineFrame* output) {
+  if (input.width == width_ && input.height == height_) {
+    return StageResult::kForward;
+  }
+  if (!output) {
+    return StageResult::kConsume;
+  }
+
+  // 缩放支持的格式多于转换的目标格式，帧大小取自像素格式表
+  size_t dst_size = GetRawFrameSize(input.pixel_format, width_, height_);
+  if (dst_size == 0) {
+    return StageResult::kFail;
+  }
+  uint8_t* dst = output->Allocate(dst_size);
+  if (!converter_.Scale(input.data(), input.size(), input.pixel_format,
+                        input.width, input.height, input.bytesperline, width_,
+                        height_, filter_, dst, dst_size)) {
+    return StageResult::kFail;
+  }
+  output->width = width_;
+  output->height = height_;
+  output->bytesperline = 0;
+  return StageResult::kEmit;
+}
+
+MotionGateStage::MotionGateStage(const MotionDetectorOptions& options)
+    : detector_(options) {}
+
+std::string MotionGateStage::GetName() const {
+  return "motion gate";
+}
+
+bool MotionGateStage::Start() {
+  detector_.Reset();
+  return true;
+}
+
+StageResult MotionGateStage::Process(const PipelineFrame& input,
+                                     PipelineFrame* /* output */) {
+  MotionResult result = detector_.Process(
+      input.data(), input.size(), input.pixel_format, input.width,
+      input.height, input.bytesperline, MonotonicMicros());
+  return result.pass ? StageResult::kForward : StageResult::kConsume;
+}
+
+#ifdef V4L2_DEMO_HAVE_JPEG
+JpegDecodeStage::JpegDecodeStage(uint32_t dst_format)
+    : dst_format_(dst_format) {}
+
+std::string JpegDecodeStage::GetName() const {
+  return "jpeg->" + PixelFormatToString(dst_format_);
+}
+
+StageResult JpegDecodeStage::Process(const PipelineFrame& input,
+                                     PipelineFrame* output) {
+  if (!output) {
+    return StageResult::kConsume;
+  }
+  if (input.pixel_format != V4L2_PIX_FMT_MJPEG &&
+      input.pixel_format != V4L2_PIX_FMT_JPEG) {
+    return StageResult::kFail;
+  }
+  size_t dst_size =
+      FormatConverter::GetFrameSize(dst_format_, input.width, input.height);
+  if (dst_size == 0) {
+    return StageResult::kFail;
+  }
+  uint8_t* dst = output->Allocate(dst_size);
+  if (!decoder_.Decode(input.data(), input.size(), dst_format_, input.width,
+                       input.height, dst, dst_size)) {
+    return StageResult::kFail;
+  }
+  output->pixel_format = dst_format_;
+  output->bytesperline = 0;
+  return StageResult::kEmit;
+}
+#endif  // V4L2_DEMO_HAVE_JPEG
+
+FileSinkStage::FileSinkStage(const FileSinkOptions& options)
+    : options_(options), frame_count_(0), file_count_(0) {
+  if (options_.every_n == 0) {
+    options_.every_n = 1;
+  }
+}
+
+std::string FileSinkStage::GetName() const {
+  return "file " + options_.path_pattern;
+}
+
+bool FileSinkStage::Start() {
+  frame_count_ = 0;
+  file_count_ = 0;
+  return true;
+}
+
+StageResult FileSinkStage::Process(const PipelineFrame& input,
+                                   PipelineFrame* /* output */) {
+  if (frame_count_++ % options_.every_n != 0 ||
+      (options_.max_files != 0 && file_count_ >= options_.max_files)) {
+    return StageResult::kConsume;
+  }
+
+  char path[512];
+  snprintf(path, sizeof(path), options_.path_pattern.c_str(), file_count_);
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    fprintf(stderr, "无法打开文件 %s 进行写入: %s\n", path, strerror(errno));
+    return StageResult::kFail;
+  }
+
+  const uint8_t* data = static_cast<const uint8_t*>(input.data());
+  size_t remaining = input.size();
+  bool ok = true;
+  while (remaining > 0) {
+    ssize_t n = write(fd, data, remaining);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fprintf(stderr, "写入文件 %s 失败: %s\n", path, strerror(errno));
+      ok = false;
+      break;
+    }
+    data += n;
+    remaining -= n;
+  }
+  close(fd);
+
+  if (!ok) {
+    return StageResult::kFail;
+  }
+  file_count_++;
+  return StageResult::kConsume;
+}
+
+FrameBusSinkStage::FrameBusSinkStage(FrameBusPublisher* publisher)
+    : publisher_(publisher) {}
+
+std::string FrameBusSinkStage::GetName() const {
+  return "frame bus";
+}
+
+StageResult FrameBusSinkStage::Process(const PipelineFrame& input,
+                                       PipelineFrame* /* output */) {
+  FrameLease lease;
+  if (!input.TakeLease(&lease)) {
+    return StageResult::kFail;
+  }
+  return publisher_->Publish(&lease) ? StageResult::kConsume
+                                     : StageResult::kFail;
+}
+
+EncoderSinkStage::EncoderSinkStage(M2mEncoderSink* encoder)
+    : encoder_(encoder) {}
+
+std::string EncoderSinkStage::GetName() const {
+  return "encoder";
+}
+
+StageResult EncoderSinkStage::Process(const PipelineFrame& input,
+                                      PipelineFrame* /* output */) {
+  FrameLease lease;
+  if (!input.TakeLease(&lease)) {
+    return StageResult::kFail;
+  }
+  bool submitted = encoder_->Submit(&lease);
+  // 顺带取回已编码的码流，归还编码器占用的捕获缓冲区
+  encoder_->ProcessEvents();
+  return submitted ? StageResult::kConsume : StageResult::kFail;
+}
+
+CallbackStage::CallbackStage(const std::string& name, Callback callback)
+    : name_(name), callback_(std::move(callback)) {}
+
+StageResult CallbackStage::Process(const PipelineFrame& input,
+                                   PipelineFrame* output) {
+  return callback_(input, output);
+}
+
+}  // namespace v4l2_demo
@@ -0,0 +1,189 @@
+#ifndef V4L2_DEMO_SRC_COMMON_PIPELINE_STAGES_H_
+#define V4L2_DEMO_SRC_COMMON_PIPELINE_STAGES_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <string>
+
+#include "format_converter.h"
+#include "frame_pipeline.h"
+#include "motion_detector.h"
+
+#ifdef V4L2_DEMO_HAVE_JPEG
+#include "jpeg_decoder.h"
+#endif
+
+namespace v4l2_demo {
+
+class FrameBusPublisher;
+class M2mEncoderSink;
+
+// 格式转换阶段：把 YUYV/UYVY 等源格式转换为 dst_format
+// 输入已是目标格式时原样转发；输入必须紧密排列（行跨度为 width * 2）
+class ConvertStage : public PipelineStage {
+ public:
+  explicit ConvertStage(uint32_t dst_format);
+
+  std::string GetName() const override;
+  StageResult Process(const PipelineFrame& input,
+                      PipelineFrame* output) override;
+
+ private:
+  uint32_t dst_format_;
+  FormatConverter converter_;
+};
+
+// 裁剪阶段：输出 [x, x + width) × [y, y + height) 区域，结果紧密排列
+// 支持 YUYV、UYVY、GREY、RGB24、ABGR32、NV12、YUV420；
+// YUV 格式的 x 与宽度须为偶数，4:2:0 格式的 y 与高度也须为偶数
+// 区域超出输入帧时返回 kFail
+class CropStage : public PipelineStage {
+ public:
+  CropStage(uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+
+  std::string GetName() const override;
+  StageResult Process(const PipelineFrame& input,
+                      PipelineFrame* output) override;
+
+ private:
+  uint32_t x_;
+  uint32_t y_;
+  uint32_t width_;
+  uint32_t height_;
+};
+
+// 缩放阶段：把 FormatConverter::IsScaleSupported 的格式（YUYV、UYVY、
+// YVYU、VYUY、GREY、NV12、NV21、NV16）缩放到 width × height，格式不变，
+// 结果紧密排列；输入已是目标尺寸时原样转发
+// 常接在 CropStage 之后，补做驱动没有完成的部分（见 ApplyScaleTarget）
+class ScaleStage : public PipelineStage {
+ public:
+  ScaleStage(uint32_t width, uint32_t height,
+             ScaleFilter filter = ScaleFilter::kBilinear);
+
+  std::string GetName() const override;
+  StageResult Process(const PipelineFrame& input,
+                      PipelineFrame* output) override;
+
+ private:
+  uint32_t width_;
+  uint32_t height_;
+  ScaleFilter filter_;
+  FormatConverter converter_;
+};
+
+// 运动门控阶段：画面有变化（或处于保持期、到达关键帧间隔）时原样转发，
+// 否则吞掉该帧；接在文件、编码器等 sink 之前，跳过静止画面
+// 每帧的变化比例通过 GetStats 读取
+class MotionGateStage : public PipelineStage {
+ public:
+  explicit MotionGateStage(
+      const MotionDetectorOptions& options = MotionDetectorOptions());
+
+  std::string GetName() const override;
+  bool Start() override;
+  StageResult Process(const PipelineFrame& input,
+                      PipelineFrame* output) override;
+
+  // 可在任意线程调用
+  void GetStats(MotionStats* stats) const { detector_.GetStats(stats); }
+
+ private:
+  MotionDetector detector_;
+};
+
+#ifdef V4L2_DEMO_HAVE_JPEG
+// MJPEG 解码阶段（单个解码器；需要多核并行解码时以多个管线分支或
+// MjpegDecodeStage 实现）
+class JpegDecodeStage : public PipelineStage {
+ public:
+  // @param dst_format 见 JpegDecoder::IsSupported
+  explicit JpegDecodeStage(uint32_t dst_format);
+
+  std::string GetName() const override;
+  StageResult Process(const PipelineFrame& input,
+                      PipelineFrame* output) override;
+
+ private:
+  uint32_t dst_format_;
+  JpegDecoder decoder_;
+};
+#endif  // V4L2_DEMO_HAVE_JPEG
+
+// 文件 sink 配置
+struct FileSinkOptions {
+  // 文件名模板，%03d 等格式占位符替换为已写文件的序号
+  std::string path_pattern = "output/frame_%03d.raw";
+  uint32_t every_n = 1;     // 每 N 帧写一帧
+  uint32_t max_files = 20;  // 最多写入的文件数，0 表示不限制
+};
+
+// 文件 sink：同步写文件，应以 StageExecution::kDedicatedThread 运行，
+// 避免阻塞 I/O 占用共享线程池
+class FileSinkStage : public PipelineStage {
+ public:
+  explicit FileSinkStage(const FileSinkOptions& options = FileSinkOptions());
+
+  std::string GetName() const override;
+  bool Start() override;
+  StageResult Process(const PipelineFrame& input,
+                      PipelineFrame* output) override;
+
+ private:
+  FileSinkOptions options_;
+  uint64_t frame_count_;
+  uint32_t file_count_;
+};
+
+// 帧总线 sink：把源帧发布到 FrameBusPublisher
+// 需要独占设备租约，因此只能直接接在源头，且该帧不能同时交给其他阶段
+// 发布者只能由本阶段使用（FrameBusPublisher 非线程安全）
+class FrameBusSinkStage : public PipelineStage {
+ public:
+  explicit FrameBusSinkStage(FrameBusPublisher* publisher);
+
+  std::string GetName() const override;
+  StageResult Process(const PipelineFrame& input,
+                      PipelineFrame* output) override;
+
+ private:
+  FrameBusPublisher* publisher_;
+};
+
+// 编码器 sink：把源帧提交给 M2mEncoderSink 并取回码流
+// 与 FrameBusSinkStage 相同，需要独占设备租约；Stop 时不关闭编码器，
+// 由调用者在管线停止后调用 M2mEncoderSink::Close 排空
+class EncoderSinkStage : public PipelineStage {
+ public:
+  explicit EncoderSinkStage(M2mEncoderSink* encoder);
+
+  std::string GetName() const override;
+  StageResult Process(const PipelineFrame& input,
+                      PipelineFrame* output) override;
+
+ private:
+  M2mEncoderSink* encoder_;
+};
+
+// 回调阶段：以函数实现简单的 filter/sink（如统计、打印、分析）
+class CallbackStage : public PipelineStage {
+ public:
+  using Callback =
+      std::function<StageResult(const PipelineFrame& input,
+                                PipelineFrame* output)>;
+
+  CallbackStage(const std::string& name, Callback callback);
+
+  std::string GetName() const override { return name_; }
+  StageResult Process(const PipelineFrame& input,
+                      PipelineFrame* output) override;
+
+ private:
+  std::string name_;
+  Callback callback_;
+};
+
+}  // namespace v4l2_demo
+
+#endif  // V4L2_DEMO_SRC_COMMON_PIPELINE_STAGES_H_
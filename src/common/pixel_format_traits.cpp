@@ -0,0 +1,42 @@
+#include "pixel_format_traits.h"
+
+namespace v4l2_demo {
+
+namespace {
+constexpr PixelFormatInfo kFormats[] = {
+    MakePixelFormatInfo<PixelFormatTraits<V4L2_PIX_FMT_YUYV>>(),
+    MakePixelFormatInfo<PixelFormatTraits<V4L2_PIX_FMT_UYVY>>(),
+    MakePixelFormatInfo<PixelFormatTraits<V4L2_PIX_FMT_NV12>>(),
+    MakePixelFormatInfo<PixelFormatTraits<V4L2_PIX_FMT_YUV420>>(),
+    MakePixelFormatInfo<PixelFormatTraits<V4L2_PIX_FMT_GREY>>(),
+    MakePixelFormatInfo<PixelFormatTraits<V4L2_PIX_FMT_YVYU>>(),
+    MakePixelFormatInfo<PixelFormatTraits<V4L2_PIX_FMT_VYUY>>(),
+    MakePixelFormatInfo<PixelFormatTraits<V4L2_PIX_FMT_NV21>>(),
+    MakePixelFormatInfo<PixelFormatTraits<V4L2_PIX_FMT_NV16>>(),
+    MakePixelFormatInfo<PixelFormatTraits<V4L2_PIX_FMT_YVU420>>(),
+    MakePixelFormatInfo<PixelFormatTraits<V4L2_PIX_FMT_RGB565>>(),
+    MakePixelFormatInfo<PixelFormatTraits<V4L2_PIX_FMT_RGB24>>(),
+    MakePixelFormatInfo<PixelFormatTraits<V4L2_PIX_FMT_BGR24>>(),
+    MakePixelFormatInfo<PixelFormatTraits<V4L2_PIX_FMT_ABGR32>>(),
+    MakePixelFormatInfo<PixelFormatTraits<V4L2_PIX_FMT_XBGR32>>(),
+    MakePixelFormatInfo<PixelFormatTraits<V4L2_PIX_FMT_ARGB32>>(),
+    MakePixelFormatInfo<PixelFormatTraits<V4L2_PIX_FMT_XRGB32>>(),
+};
+}  // namespace
+
+const PixelFormatInfo* FindPixelFormatInfo(uint32_t fourcc) {
+  // 常见的捕获格式排在前面，线性查找即可
+  for (const PixelFormatInfo& info : kFormats) {
+    if (info.fourcc == fourcc) {
+      return &info;
+    }
+  }
+  return nullptr;
+}
+
+size_t GetRawFrameSize(uint32_t fourcc, uint32_t width, uint32_t height) {
+  const PixelFormatInfo* info = FindPixelFormatInfo(fourcc);
+  return info ? info->frame_size(width, height) : 0;
+}
+
+}  // namespace v4l2_demo
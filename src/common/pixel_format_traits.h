@@ -0,0 +1,195 @@
+#ifndef V4L2_DEMO_SRC_COMMON_PIXEL_FORMAT_TRAITS_H_
+#define V4L2_DEMO_SRC_COMMON_PIXEL_FORMAT_TRAITS_H_
+
+#include <linux/videodev2.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace v4l2_demo {
+
+// 像素格式的平面布局
+enum class PlaneLayout {
+  kPacked,      // 单平面，分量交错（YUYV、GREY、RGB24 等）
+  kSemiPlanar,  // Y 平面 + 交错的 UV 平面（NV12 等）
+  kPlanar,      // Y、U、V 各一个平面（YUV420 等）
+};
+
+// 像素格式的编译期描述，按 FOURCC 特化
+// 内核以其为模板参数，分量偏移与步长都是常量，内层循环不再按格式分支；
+// 未特化的格式在模板中使用时编译失败
+//
+// 所有格式都有：
+//   kFourcc、kLayout、kPlanes
+//   kBytesPerPixel            平面 0 每像素字节数
+//   kChromaShiftX/Y           色度水平/垂直下采样（右移位数，无色度为 0）
+//   kYuv                      是否为 YUV 格式
+//   FrameSize(width, height)  紧密排列时一帧的字节数，色度尺寸向上取整
+// YUV 格式另有：
+//   kYOffset、kYStep          第 i 个亮度样本位于平面 0 行内 kYOffset + i * kYStep
+// 打包 4:2:2 与半平面格式另有：
+//   kUOffset、kVOffset、kChromaStep
+//                             第 i 个 U/V 样本位于所在平面行内
+//                             kUOffset/kVOffset + i * kChromaStep
+template <uint32_t kFourccValue>
+struct PixelFormatTraits;
+
+namespace internal {
+
+template <uint32_t kFourccValue, PlaneLayout kLayoutValue,
+          uint32_t kBytesPerPixelValue, uint32_t kShiftX, uint32_t kShiftY,
+          bool kYuvValue>
+struct PixelFormatBase {
+  static constexpr uint32_t kFourcc = kFourccValue;
+  static constexpr PlaneLayout kLayout = kLayoutValue;
+  static constexpr uint32_t kPlanes =
+      kLayoutValue == PlaneLayout::kPacked       ? 1
+      : kLayoutValue == PlaneLayout::kSemiPlanar ? 2
+                                                 : 3;
+  static constexpr uint32_t kBytesPerPixel = kBytesPerPixelValue;
+  static constexpr uint32_t kChromaShiftX = kShiftX;
+  static constexpr uint32_t kChromaShiftY = kShiftY;
+  static constexpr bool kYuv = kYuvValue;
+
+  static constexpr size_t FrameSize(uint32_t width, uint32_t height) {
+    size_t pixels = static_cast<size_t>(width) * height;
+    if (kLayout == PlaneLayout::kPacked) {
+      return pixels * kBytesPerPixel;
+    }
+    // 两个色度分量各占 chroma 字节，无论交错还是分平面
+    size_t chroma =
+        static_cast<size_t>((width + (1u << kShiftX) - 1) >> kShiftX) *
+        ((height + (1u << kShiftY) - 1) >> kShiftY);
+    return pixels + chroma * 2;
+  }
+};
+
+// 打包 4:2:2：每两个像素 4 字节，Y 偏移为 0 或 1
+template <uint32_t kFourccValue, uint32_t kY, uint32_t kU, uint32_t kV>
+struct PackedYuv422
+    : PixelFormatBase<kFourccValue, PlaneLayout::kPacked, 2, 1, 0, true> {
+  static constexpr uint32_t kYOffset = kY;
+  static constexpr uint32_t kYStep = 2;
+  static constexpr uint32_t kUOffset = kU;
+  static constexpr uint32_t kVOffset = kV;
+  static constexpr uint32_t kChromaStep = 4;
+};
+
+// Y 平面 + 交错 UV 平面，水平 2 倍下采样
+template <uint32_t kFourccValue, uint32_t kShiftY, uint32_t kU, uint32_t kV>
+struct SemiPlanarYuv : PixelFormatBase<kFourccValue, PlaneLayout::kSemiPlanar,
+                                       1, 1, kShiftY, true> {
+  static constexpr uint32_t kYOffset = 0;
+  static constexpr uint32_t kYStep = 1;
+  static constexpr uint32_t kUOffset = kU;
+  static constexpr uint32_t kVOffset = kV;
+  static constexpr uint32_t kChromaStep = 2;
+};
+
+// Y、U、V 三平面 4:2:0
+template <uint32_t kFourccValue>
+struct PlanarYuv420
+    : PixelFormatBase<kFourccValue, PlaneLayout::kPlanar, 1, 1, 1, true> {
+  static constexpr uint32_t kYOffset = 0;
+  static constexpr uint32_t kYStep = 1;
+};
+
+// 打包 RGB（无亮度分量）
+template <uint32_t kFourccValue, uint32_t kBytes>
+struct PackedRgb
+    : PixelFormatBase<kFourccValue, PlaneLayout::kPacked, kBytes, 0, 0,
+                      false> {};
+
+}  // namespace internal
+
+template <>
+struct PixelFormatTraits<V4L2_PIX_FMT_GREY>
+    : internal::PixelFormatBase<V4L2_PIX_FMT_GREY, PlaneLayout::kPacked, 1, 0,
+                                0, true> {
+  static constexpr uint32_t kYOffset = 0;
+  static constexpr uint32_t kYStep = 1;
+};
+
+template <>
+struct PixelFormatTraits<V4L2_PIX_FMT_YUYV>
+    : internal::PackedYuv422<V4L2_PIX_FMT_YUYV, 0, 1, 3> {};
+template <>
+struct PixelFormatTraits<V4L2_PIX_FMT_UYVY>
+    : internal::PackedYuv422<V4L2_PIX_FMT_UYVY, 1, 0, 2> {};
+template <>
+struct PixelFormatTraits<V4L2_PIX_FMT_YVYU>
+    : internal::PackedYuv422<V4L2_PIX_FMT_YVYU, 0, 3, 1> {};
+template <>
+struct PixelFormatTraits<V4L2_PIX_FMT_VYUY>
+    : internal::PackedYuv422<V4L2_PIX_FMT_VYUY, 1, 2, 0> {};
+
+template <>
+struct PixelFormatTraits<V4L2_PIX_FMT_NV12>
+    : internal::SemiPlanarYuv<V4L2_PIX_FMT_NV12, 1, 0, 1> {};
+template <>
+struct PixelFormatTraits<V4L2_PIX_FMT_NV21>
+    : internal::SemiPlanarYuv<V4L2_PIX_FMT_NV21, 1, 1, 0> {};
+template <>
+struct PixelFormatTraits<V4L2_PIX_FMT_NV16>
+    : internal::SemiPlanarYuv<V4L2_PIX_FMT_NV16, 0, 0, 1> {};
+
+template <>
+struct PixelFormatTraits<V4L2_PIX_FMT_YUV420>
+    : internal::PlanarYuv420<V4L2_PIX_FMT_YUV420> {};
+template <>
+struct PixelFormatTraits<V4L2_PIX_FMT_YVU420>
+    : internal::PlanarYuv420<V4L2_PIX_FMT_YVU420> {};
+
+template <>
+struct PixelFormatTraits<V4L2_PIX_FMT_RGB565>
+    : internal::PackedRgb<V4L2_PIX_FMT_RGB565, 2> {};
+template <>
+struct PixelFormatTraits<V4L2_PIX_FMT_RGB24>
+    : internal::PackedRgb<V4L2_PIX_FMT_RGB24, 3> {};
+template <>
+struct PixelFormatTraits<V4L2_PIX_FMT_BGR24>
+    : internal::PackedRgb<V4L2_PIX_FMT_BGR24, 3> {};
+template <>
+struct PixelFormatTraits<V4L2_PIX_FMT_ABGR32>
+    : internal::PackedRgb<V4L2_PIX_FMT_ABGR32, 4> {};
+template <>
+struct PixelFormatTraits<V4L2_PIX_FMT_XBGR32>
+    : internal::PackedRgb<V4L2_PIX_FMT_XBGR32, 4> {};
+template <>
+struct PixelFormatTraits<V4L2_PIX_FMT_ARGB32>
+    : internal::PackedRgb<V4L2_PIX_FMT_ARGB32, 4> {};
+template <>
+struct PixelFormatTraits<V4L2_PIX_FMT_XRGB32>
+    : internal::PackedRgb<V4L2_PIX_FMT_XRGB32, 4> {};
+
+// 运行时的像素格式描述，字段与 PixelFormatTraits 对应
+struct PixelFormatInfo {
+  uint32_t fourcc;
+  PlaneLayout layout;
+  uint32_t planes;
+  uint32_t bytes_per_pixel;
+  uint32_t chroma_shift_x;
+  uint32_t chroma_shift_y;
+  bool yuv;
+  size_t (*frame_size)(uint32_t width, uint32_t height);
+};
+
+// 由编译期描述生成运行时描述
+template <typename Traits>
+constexpr PixelFormatInfo MakePixelFormatInfo() {
+  return {Traits::kFourcc,        Traits::kLayout,        Traits::kPlanes,
+          Traits::kBytesPerPixel, Traits::kChromaShiftX, Traits::kChromaShiftY,
+          Traits::kYuv,           &Traits::FrameSize};
+}
+
+// 按 FOURCC（VIDIOC_G_FMT 返回的 pixelformat）查找有 PixelFormatTraits
+// 特化的未压缩格式
+// @return 压缩格式或未知格式返回 nullptr
+const PixelFormatInfo* FindPixelFormatInfo(uint32_t fourcc);
+
+// 紧密排列时一帧的字节数
+// @return 压缩格式或未知格式返回 0
+size_t GetRawFrameSize(uint32_t fourcc, uint32_t width, uint32_t height);
+
+}  // namespace v4l2_demo
+
+#endif  // V4L2_DEMO_SRC_COMMON_PIXEL_FORMAT_TRAITS_H_
@@ -0,0 +1,334 @@
+#include "pretrigger_recorder.h"
+
+#include <errno.h>
+#include <math.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace v4l2_demo {
+
+namespace {
+// 写入队列中的事件标记（槽位索引之外的值）
+constexpr uint32_t kEventStart = UINT32_MAX;
+constexpr uint32_t kEventEnd = UINT32_MAX - 1;
+
+// 槽位数据按缓存行对齐
+constexpr size_t kSlotAlignment = 64;
+
+// 时间窗内的帧数 + 1（当前帧）+ 刷盘余量
+size_t ComputeSlotCount(const PreTriggerOptions& options) {
+  double frames = ceil(options.pre_trigger_seconds * options.fps);
+  return static_cast<size_t>(frames > 0 ? frames : 0) + 1 +
+         options.extra_slots;
+}
+
+void SignalEventFd(int fd) {
+  uint64_t value = 1;
+  ssize_t ret = write(fd, &value, sizeof(value));
+  (void)ret;
+}
+
+void ClearEventFd(int fd) {
+  uint64_t value;
+  ssize_t ret = read(fd, &value, sizeof(value));
+  (void)ret;
+}
+}  // namespace
+
+PreTriggerRecorder::PreTriggerRecorder(const PreTriggerOptions& options)
+    : options_(options),
+      pre_trigger_us_(static_cast<int64_t>(options.pre_trigger_seconds * 1e6)),
+      post_trigger_us_(
+          static_cast<int64_t>(options.post_trigger_seconds * 1e6)),
+      slot_size_((options.max_frame_size + kSlotAlignment - 1) /
+                 kSlotAlignment * kSlotAlignment),
+      slots_(ComputeSlotCount(options)),
+      // 每帧最多伴随一个开始和一个结束标记
+      pending_(ComputeSlotCount(options) * 2 + 2),
+      free_(ComputeSlotCount(options)),
+      history_(ComputeSlotCount(options)),
+      history_head_(0),
+      history_count_(0),
+      recording_(false),
+      end_pending_(false),
+      record_until_us_(0),
+      trigger_requested_(false),
+      stopping_(false),
+      work_fd_(-1),
+      frames_(0),
+      dropped_(0),
+      oversized_(0),
+      events_(0),
+      events_saved_(0),
+      frames_saved_(0),
+      write_failures_(0),
+      buffered_(0),
+      recording_flag_(false) {}
+
+PreTriggerRecorder::~PreTriggerRecorder() {
+  Stop();
+  if (work_fd_ >= 0) {
+    close(work_fd_);
+  }
+}
+
+bool PreTriggerRecorder::Start() {
+  if (thread_.joinable()) {
+    return true;
+  }
+  if (slot_size_ == 0) {
+    fprintf(stderr, "预触发录制器未设置 max_frame_size\n");
+    return false;
+  }
+
+  if (arena_.empty()) {
+    // 一次性分配并写零，之后捕获路径上不会缺页或分配内存
+    arena_.assign(slot_size_ * slots_.size() + kSlotAlignment, 0);
+    uintptr_t base = reinterpret_cast<uintptr_t>(arena_.data());
+    size_t padding = (kSlotAlignment - base % kSlotAlignment) % kSlotAlignment;
+    uint8_t* aligned = arena_.data() + padding;
+    local_free_.reserve(slots_.size());
+    for (uint32_t i = 0; i < slots_.size(); ++i) {
+      memset(&slots_[i], 0, sizeof(Slot));
+      slots_[i].data = aligned + i * slot_size_;
+      local_free_.push_back(i);
+    }
+  }
+
+  if (work_fd_ < 0) {
+    work_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (work_fd_ < 0) {
+      fprintf(stderr, "创建 eventfd 失败: %s\n", strerror(errno));
+      return false;
+    }
+  }
+
+  stopping_ = false;
+  thread_ = std::thread(&PreTriggerRecorder::WriterLoop, this);
+  return true;
+}
+
+void PreTriggerRecorder::Stop() {
+  if (!thread_.joinable()) {
+    return;
+  }
+  // 进行中的事件在写入线程退出前关闭容器
+  recording_ = false;
+  recording_flag_.store(false, std::memory_order_relaxed);
+  stopping_ = true;
+  SignalEventFd(work_fd_);
+  thread_.join();
+}
+
+bool PreTriggerRecorder::Push(const FrameLease& lease) {
+  if (!lease.IsValid() || !thread_.joinable()) {
+    return false;
+  }
+  frames_.fetch_add(1, std::memory_order_relaxed);
+  int64_t now_us = lease.dequeue_time_us();
+
+  if (end_pending_) {
+    EndEvent();
+  }
+  if (trigger_requested_.exchange(false, std::memory_order_acquire)) {
+    if (recording_) {
+      record_until_us_ = now_us + post_trigger_us_;
+    } else if (!end_pending_ && BeginEvent(now_us)) {
+      record_until_us_ = now_us + post_trigger_us_;
+    }
+  }
+
+  // 多内存平面格式（如 NV12M）按平面顺序拼接，保存完整的帧
+  size_t frame_size = 0;
+  for (uint32_t p = 0; p < lease.plane_count(); ++p) {
+    frame_size += lease.plane_size(p);
+  }
+
+  bool kept = false;
+  int id = -1;
+  if (frame_size > slot_size_) {
+    oversized_.fetch_add(1, std::memory_order_relaxed);
+  } else if ((id = AcquireSlot()) < 0) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    Slot& slot = slots_[id];
+    size_t offset = 0;
+    for (uint32_t p = 0; p < lease.plane_count(); ++p) {
+      memcpy(slot.data + offset, lease.plane_data(p), lease.plane_size(p));
+      offset += lease.plane_size(p);
+    }
+    slot.size = frame_size;
+    slot.timestamp_us = lease.timestamp_us();
+    slot.dequeue_us = now_us;
+    slot.sequence = lease.sequence();
+    slot.flags = lease.flags();
+    kept = true;
+
+    if (recording_) {
+      Submit(id);
+    } else {
+      history_[(history_head_ + history_count_) % history_.size()] = id;
+      ++history_count_;
+    }
+  }
+
+  if (recording_) {
+    if (now_us >= record_until_us_) {
+      recording_ = false;
+      EndEvent();
+    }
+  } else {
+    // 丢掉时间窗以外的历史帧
+    int64_t window_start_us = now_us - pre_trigger_us_;
+    while (history_count_ > 0 &&
+           slots_[history_[history_head_]].dequeue_us < window_start_us) {
+      local_free_.push_back(history_[history_head_]);
+      history_head_ = (history_head_ + 1) % history_.size();
+      --history_count_;
+    }
+  }
+  buffered_.store(history_count_, std::memory_order_relaxed);
+  recording_flag_.store(recording_, std::memory_order_relaxed);
+  return kept;
+}
+
+int PreTriggerRecorder::AcquireSlot() {
+  if (!local_free_.empty()) {
+    uint32_t id = local_free_.back();
+    local_free_.pop_back();
+    return id;
+  }
+  uint32_t id;
+  if (free_.TryPop(&id)) {
+    return id;
+  }
+  // 未录制时覆盖最旧的历史帧（槽位数按时间窗计算，帧率高于预计时窗口变短）
+  if (!recording_ && history_count_ > 0) {
+    id = history_[history_head_];
+    history_head_ = (history_head_ + 1) % history_.size();
+    --history_count_;
+    return id;
+  }
+  return -1;
+}
+
+bool PreTriggerRecorder::BeginEvent(int64_t now_us) {
+  if (!Submit(kEventStart)) {
+    return false;
+  }
+  events_.fetch_add(1, std::memory_order_relaxed);
+  recording_ = true;
+
+  // 时间窗内的历史帧按顺序交给写入线程，更早的直接回收
+  int64_t window_start_us = now_us - pre_trigger_us_;
+  while (history_count_ > 0) {
+    uint32_t id = history_[history_head_];
+    history_head_ = (history_head_ + 1) % history_.size();
+    --history_count_;
+    if (slots_[id].dequeue_us >= window_start_us) {
+      Submit(id);
+    } else {
+      local_free_.push_back(id);
+    }
+  }
+  return true;
+}
+
+void PreTriggerRecorder::EndEvent() {
+  end_pending_ = !Submit(kEventEnd);
+}
+
+bool PreTriggerRecorder::Submit(uint32_t id) {
+  if (!pending_.TryPush(id)) {
+    return false;
+  }
+  SignalEventFd(work_fd_);
+  return true;
+}
+
+void PreTriggerRecorder::GetStats(PreTriggerStats* stats) const {
+  stats->frames = frames_.load(std::memory_order_relaxed);
+  stats->dropped = dropped_.load(std::memory_order_relaxed);
+  stats->oversized = oversized_.load(std::memory_order_relaxed);
+  stats->events = events_.load(std::memory_order_relaxed);
+  stats->events_saved = events_saved_.load(std::memory_order_relaxed);
+  stats->frames_saved = frames_saved_.load(std::memory_order_relaxed);
+  stats->write_failures = write_failures_.load(std::memory_order_relaxed);
+  stats->buffered = buffered_.load(std::memory_order_relaxed);
+  stats->slot_count = slots_.size();
+  stats->recording = recording_flag_.load(std::memory_order_relaxed);
+}
+
+bool PreTriggerRecorder::OpenEventContainer(ContainerWriter* writer) {
+  // 以触发时的本地时间命名，<prefix>_20240101_120000_0000.v4lc
+  char suffix[32];
+  time_t now = time(nullptr);
+  struct tm local;
+  localtime_r(&now, &local);
+  strftime(suffix, sizeof(suffix), "_%Y%m%d_%H%M%S", &local);
+
+  ContainerWriterOptions container_options = options_.container;
+  container_options.path_prefix += suffix;
+  if (!writer->Open(container_options)) {
+    return false;
+  }
+  ContainerWriterStats stats;
+  writer->GetStats(&stats);
+  printf("\n预触发录制: 写入 %s\n",
+         ContainerWriter::SegmentPath(container_options.path_prefix,
+                                      stats.current_segment)
+             .c_str());
+  return true;
+}
+
+void PreTriggerRecorder::WriterLoop() {
+  ContainerWriter writer;
+  while (true) {
+    uint32_t id;
+    if (!pending_.TryPop(&id)) {
+      if (stopping_) {
+        break;
+      }
+      struct pollfd pfd;
+      pfd.fd = work_fd_;
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+      if (poll(&pfd, 1, -1) > 0) {
+        ClearEventFd(work_fd_);
+      }
+      continue;
+    }
+
+    if (id == kEventStart || id == kEventEnd) {
+      if (writer.IsOpen()) {
+        writer.Close();
+        events_saved_.fetch_add(1, std::memory_order_relaxed);
+      }
+      if (id == kEventStart && !OpenEventContainer(&writer)) {
+        fprintf(stderr, "预触发录制: 无法创建录制文件，本次事件的帧被丢弃\n");
+      }
+      continue;
+    }
+
+    Slot& slot = slots_[id];
+    if (writer.IsOpen() &&
+        writer.WriteFrame(slot.data, slot.size, slot.timestamp_us,
+                          slot.sequence, slot.flags)) {
+      frames_saved_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      write_failures_.fetch_add(1, std::memory_order_relaxed);
+    }
+    free_.TryPush(id);
+  }
+
+  if (writer.IsOpen()) {
+    writer.Close();
+    events_saved_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+}  // namespace v4l2_demo
@@ -0,0 +1,142 @@
+#ifndef V4L2_DEMO_SRC_COMMON_PRETRIGGER_RECORDER_H_
+#define V4L2_DEMO_SRC_COMMON_PRETRIGGER_RECORDER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "frame_container.h"
+#include "spsc_queue.h"
+#include "v4l2_utils.h"
+
+namespace v4l2_demo {
+
+// 预触发录制器配置
+struct PreTriggerOptions {
+  double pre_trigger_seconds = 5;   // 触发前保留在内存中的时长
+  double post_trigger_seconds = 5;  // 触发后继续录制的时长
+  double fps = 30;                  // 预计帧率，用于计算槽位数
+  size_t max_frame_size = 0;        // 槽位大小（通常取 sizeimage），必须设置
+  // 刷盘期间额外可用的槽位，写入线程跟不上时新帧被丢弃
+  uint32_t extra_slots = 8;
+  // 每次事件写入一个录制容器，路径前缀为 <prefix>_<本地时间>，
+  // 其中的 path_prefix 作为目录与名称前缀，格式字段由调用者填写
+  ContainerWriterOptions container;
+};
+
+// 预触发录制器统计
+struct PreTriggerStats {
+  uint64_t frames;          // Push 的帧数
+  uint64_t dropped;         // 没有空闲槽位被丢弃的帧数
+  uint64_t oversized;       // 超过槽位大小被丢弃的帧数
+  uint64_t events;          // 触发的事件数
+  uint64_t events_saved;    // 已写完的事件数
+  uint64_t frames_saved;    // 已写入容器的帧数
+  uint64_t write_failures;  // 写入失败的帧数
+  size_t buffered;          // 当前保留在内存中的帧数
+  size_t slot_count;        // 槽位总数
+  bool recording;           // 是否处于事件录制中
+};
+
+// 预触发环形录制器
+// 最近 pre_trigger_seconds 秒的帧拷贝在预分配的槽位环中，平时没有任何
+// 磁盘 I/O；Trigger 后把触发前的窗口和之后 post_trigger_seconds 秒的帧
+// 交给写入线程追加到录制容器。录制中再次触发会延长录制
+// 槽位在 Start 时一次性分配并写零（建立页表），之后不再分配内存
+// Push/Stop 只能在同一个线程（捕获线程）调用，Trigger 可在任意线程
+// （包括信号处理函数）调用
+class PreTriggerRecorder {
+ public:
+  explicit PreTriggerRecorder(const PreTriggerOptions& options);
+  ~PreTriggerRecorder();
+
+  PreTriggerRecorder(const PreTriggerRecorder&) = delete;
+  PreTriggerRecorder& operator=(const PreTriggerRecorder&) = delete;
+
+  // 分配槽位并启动写入线程
+  // @return 成功返回 true，失败返回 false
+  bool Start();
+
+  // 写完进行中的事件后停止写入线程
+  void Stop();
+
+  // 拷贝一帧到环中，租约可立即释放
+  // @param lease 帧租约
+  // @return 帧被保留返回 true，被丢弃返回 false
+  bool Push(const FrameLease& lease);
+
+  // 请求触发事件，在下一次 Push 时生效（无锁，异步信号安全）
+  void Trigger() { trigger_requested_.store(true, std::memory_order_release); }
+
+  // 获取统计信息（可在任意线程调用）
+  void GetStats(PreTriggerStats* stats) const;
+
+ private:
+  // 帧槽位，数据位于 arena_ 中
+  struct Slot {
+    uint8_t* data;
+    size_t size;
+    int64_t timestamp_us;   // 驱动时间戳
+    int64_t dequeue_us;     // 出队时间，用于计算时间窗
+    uint32_t sequence;
+    uint32_t flags;
+  };
+
+  // 取得一个空闲槽位，未录制时回收环中最旧的帧
+  // @return 槽位索引，没有可用槽位返回 -1
+  int AcquireSlot();
+
+  // 开始事件：把时间窗内的历史帧交给写入线程
+  // @return 成功返回 true，写入队列已满返回 false
+  bool BeginEvent(int64_t now_us);
+
+  // 结束事件，写入队列已满时在下一次 Push 重试
+  void EndEvent();
+
+  // 交给写入线程（槽位索引或事件标记），队列容量保证槽位总能入队
+  bool Submit(uint32_t id);
+
+  void WriterLoop();
+  bool OpenEventContainer(ContainerWriter* writer);
+
+  PreTriggerOptions options_;
+  int64_t pre_trigger_us_;
+  int64_t post_trigger_us_;
+  size_t slot_size_;
+
+  std::vector<uint8_t> arena_;        // 所有槽位的数据区
+  std::vector<Slot> slots_;
+  SpscQueue<uint32_t> pending_;       // 捕获线程 -> 写入线程
+  SpscQueue<uint32_t> free_;          // 写入线程 -> 捕获线程
+  std::vector<uint32_t> local_free_;  // 捕获线程本地空闲槽位
+
+  // 触发前的历史帧（捕获线程独占的定长环，按时间顺序）
+  std::vector<uint32_t> history_;
+  size_t history_head_;   // 最旧一帧的位置
+  size_t history_count_;
+
+  bool recording_;           // 捕获线程：是否处于事件录制
+  bool end_pending_;         // 事件结束标记尚未入队
+  int64_t record_until_us_;  // 录制截止的出队时间
+
+  std::atomic<bool> trigger_requested_;
+  std::thread thread_;
+  std::atomic<bool> stopping_;
+  int work_fd_;  // eventfd：通知写入线程有新帧
+
+  std::atomic<uint64_t> frames_;
+  std::atomic<uint64_t> dropped_;
+  std::atomic<uint64_t> oversized_;
+  std::atomic<uint64_t> events_;
+  std::atomic<uint64_t> events_saved_;
+  std::atomic<uint64_t> frames_saved_;
+  std::atomic<uint64_t> write_failures_;
+  std::atomic<size_t> buffered_;
+  std::atomic<bool> recording_flag_;
+};
+
+}  // namespace v4l2_demo
+
+#endif  // V4L2_DEMO_SRC_COMMON_PRETRIGGER_RECORDER_H_
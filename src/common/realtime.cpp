@@ -0,0 +1,145 @@
+#include "realtime.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace v4l2_demo {
+
+namespace {
+// linux/capability.h 中的能力位
+constexpr int kCapIpcLock = 14;
+constexpr int kCapSysNice = 23;
+
+// 从 /proc/self/status 的 CapEff 判断当前进程是否具有某项能力
+bool HasCapability(int capability) {
+  FILE* file = fopen("/proc/self/status", "r");
+  if (!file) {
+    return false;
+  }
+  char line[256];
+  unsigned long long effective = 0;
+  while (fgets(line, sizeof(line), file)) {
+    if (sscanf(line, "CapEff: %llx", &effective) == 1) {
+      break;
+    }
+  }
+  fclose(file);
+  return (effective >> capability) & 1;
+}
+
+void PrintPriorityHint(int priority) {
+  fprintf(stderr,
+          "  提示: 需要 root、CAP_SYS_NICE（sudo setcap cap_sys_nice+ep <程序>）"
+          "或 RLIMIT_RTPRIO >= %d（/etc/security/limits.conf 中的 rtprio）\n",
+          priority);
+}
+
+void PrintMemlockHint() {
+  fprintf(stderr,
+          "  提示: 需要 root、CAP_IPC_LOCK（sudo setcap cap_ipc_lock+ep <程序>）"
+          "或足够大的 RLIMIT_MEMLOCK（ulimit -l unlimited）\n");
+}
+}  // namespace
+
+bool CheckRealtimePermissions(int sched_priority, bool lock_memory) {
+  bool ok = true;
+  bool privileged = geteuid() == 0;
+
+  if (sched_priority > 0) {
+    int max_priority = sched_get_priority_max(SCHED_FIFO);
+    struct rlimit limit;
+    bool rlimit_ok = getrlimit(RLIMIT_RTPRIO, &limit) == 0 &&
+                     (limit.rlim_cur == RLIM_INFINITY ||
+                      limit.rlim_cur >= static_cast<rlim_t>(sched_priority));
+    if (sched_priority > max_priority) {
+      fprintf(stderr, "警告: SCHED_FIFO 优先级 %d 超出范围（最大 %d）\n",
+              sched_priority, max_priority);
+      ok = false;
+    } else if (!privileged && !HasCapability(kCapSysNice) && !rlimit_ok) {
+      fprintf(stderr, "警告: 没有设置 SCHED_FIFO 优先级 %d 的权限"
+              "（RLIMIT_RTPRIO = %lu）\n",
+              sched_priority, static_cast<unsigned long>(limit.rlim_cur));
+      PrintPriorityHint(sched_priority);
+      ok = false;
+    }
+  }
+
+  if (lock_memory && !privileged && !HasCapability(kCapIpcLock)) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_MEMLOCK, &limit) == 0 &&
+        limit.rlim_cur != RLIM_INFINITY) {
+      fprintf(stderr, "警告: RLIMIT_MEMLOCK 只有 %lu KB，mlockall 可能失败\n",
+              static_cast<unsigned long>(limit.rlim_cur / 1024));
+      PrintMemlockHint();
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+bool SetThreadRealtimePriority(int priority) {
+  if (priority <= 0) {
+    return true;
+  }
+  struct sched_param param;
+  memset(&param, 0, sizeof(param));
+  param.sched_priority = priority;
+  int ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+  if (ret != 0) {
+    fprintf(stderr, "设置 SCHED_FIFO 优先级 %d 失败: %s\n", priority,
+            strerror(ret));
+    if (ret == EPERM) {
+      PrintPriorityHint(priority);
+    }
+    return false;
+  }
+  return true;
+}
+
+bool SetThreadAffinity(int cpu_core) {
+  if (cpu_core < 0) {
+    return true;
+  }
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  CPU_SET(cpu_core, &cpuset);
+  int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+  if (ret != 0) {
+    fprintf(stderr, "绑定 CPU %d 失败: %s\n", cpu_core, strerror(ret));
+    return false;
+  }
+  return true;
+}
+
+bool LockProcessMemory() {
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+    int error = errno;
+    fprintf(stderr, "mlockall 失败: %s\n", strerror(error));
+    if (error == EPERM || error == ENOMEM) {
+      PrintMemlockHint();
+    }
+    return false;
+  }
+  return true;
+}
+
+void PrefaultMemory(const void* start, size_t length) {
+  if (!start || length == 0) {
+    return;
+  }
+  size_t page_size = sysconf(_SC_PAGESIZE);
+  const volatile uint8_t* data = static_cast<const volatile uint8_t*>(start);
+  for (size_t offset = 0; offset < length; offset += page_size) {
+    (void)data[offset];
+  }
+  (void)data[length - 1];
+}
+
+}  // namespace v4l2_demo
@@ -0,0 +1,38 @@
+#ifndef V4L2_DEMO_SRC_COMMON_REALTIME_H_
+#define V4L2_DEMO_SRC_COMMON_REALTIME_H_
+
+#include <stddef.h>
+
+namespace v4l2_demo {
+
+// 实时调度与内存锁定工具，用于让捕获线程不被写入、推理等线程抢占，
+// 出队延迟不受缺页影响。权限不足时打印原因与解决办法后返回 false，
+// 调用者可以继续以普通优先级运行
+
+// 启动时检查所需权限，逐项打印缺少的权限及解决办法
+// @param sched_priority 计划使用的 SCHED_FIFO 优先级，0 表示不检查
+// @param lock_memory 是否计划调用 mlockall
+// @return 所需权限都具备返回 true
+bool CheckRealtimePermissions(int sched_priority, bool lock_memory);
+
+// 把当前线程设置为 SCHED_FIFO
+// @param priority 优先级（1-99），0 表示不修改
+// @return 成功或无需修改返回 true，失败返回 false
+bool SetThreadRealtimePriority(int priority);
+
+// 将当前线程绑定到指定 CPU 核
+// @param cpu_core CPU 核编号，-1 表示不绑定
+// @return 成功或无需绑定返回 true，失败返回 false
+bool SetThreadAffinity(int cpu_core);
+
+// mlockall(MCL_CURRENT | MCL_FUTURE)：锁定已映射与之后映射的全部内存
+// （缓冲池、线程栈、堆），避免换出与缺页带来的延迟抖动
+// @return 成功返回 true，失败返回 false
+bool LockProcessMemory();
+
+// 逐页读取一段内存，提前建立页表项（缓冲区首次被访问时不再缺页）
+void PrefaultMemory(const void* start, size_t length);
+
+}  // namespace v4l2_demo
+
+#endif  // V4L2_DEMO_SRC_COMMON_REALTIME_H_
@@ -0,0 +1,687 @@
+#include "rtp_sink.h"
+
+#include <errno.h>
+#include <linux/errqueue.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <random>
+#include <utility>
+
+#include "pixel_format_traits.h"
+
+// 较旧的 C 库头文件缺少的定义（内核 4.14 起支持 MSG_ZEROCOPY，
+// 5.0 起支持 UDP；UDP_SEGMENT 自 4.18 起）
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+namespace v4l2_demo {
+
+namespace {
+
+// RTP 固定头 12 字节 + 扩展序号 2 字节 + 一个行头 6 字节
+constexpr size_t kPacketHeaderSize = 20;
+
+// UDP GSO 一次最多切分 64 个包（UDP_MAX_SEGMENTS），总长不超过 64 KB
+constexpr uint32_t kMaxBatchPackets = 64;
+constexpr size_t kMaxBatchBytes = 65000;
+constexpr size_t kMaxPacketSize = 9000;
+
+// 零拷贝时每个 iovec 至少占一个页片段，一个 skb 最多 MAX_SKB_FRAGS（默认
+// 17）个，超出时 sendmsg 返回 EMSGSIZE；批次按此上限起步，失败时再减半
+constexpr uint32_t kMaxZerocopyBatchPackets = 8;
+
+// RFC 4175 行号与像素偏移各 15 位
+constexpr uint32_t kMaxDimension = 32767;
+
+// 零拷贝通知占满 optmem 时（ENOBUFS）每次等待的时间与次数，之后退回拷贝
+constexpr int64_t kNoBufsWaitUs = 1000;
+constexpr int kMaxNoBufsRetries = 20;
+
+// 停止时等待在途零拷贝完成的时间
+constexpr int64_t kDrainTimeoutUs = 1000000;
+
+// 相邻帧时间戳之差超过该值时不作为帧间隔（丢帧或重启）
+constexpr int64_t kMaxFrameIntervalUs = 1000000;
+
+// RTP 时钟频率
+constexpr uint64_t kRtpClockRate = 90000;
+
+void PutBe16(uint8_t* p, uint32_t value) {
+  p[0] = static_cast<uint8_t>(value >> 8);
+  p[1] = static_cast<uint8_t>(value);
+}
+
+void PutBe32(uint8_t* p, uint32_t value) {
+  PutBe16(p, value >> 16);
+  PutBe16(p + 2, value);
+}
+
+// RFC 4175 的 sampling 参数
+// @return 不支持的格式返回 nullptr
+const char* GetSampling(uint32_t pixel_format) {
+  switch (pixel_format) {
+    case V4L2_PIX_FMT_UYVY:
+      return "YCbCr-4:2:2";
+    case V4L2_PIX_FMT_RGB24:
+      return "RGB";
+    case V4L2_PIX_FMT_BGR24:
+      return "BGR";
+    case V4L2_PIX_FMT_ABGR32:  // 内存中为 B、G、R、A
+      return "BGRA";
+    default:
+      return nullptr;
+  }
+}
+
+// 选择每包的像素字节数：整行放得下时一包一行；否则优先选能整除行长的
+// 分段，使每行的包等长、GSO 批次不被行尾短包打断
+uint32_t ChooseChunkBytes(uint32_t line_bytes, uint32_t pgroup_bytes,
+                          size_t packet_size) {
+  uint32_t max_data =
+      static_cast<uint32_t>(packet_size - kPacketHeaderSize) / pgroup_bytes *
+      pgroup_bytes;
+  if (line_bytes <= max_data) {
+    return line_bytes;
+  }
+  for (uint32_t chunk = max_data; chunk >= max_data / 2;
+       chunk -= pgroup_bytes) {
+    if (line_bytes % chunk == 0) {
+      return chunk;
+    }
+  }
+  return max_data;
+}
+}  // namespace
+
+RtpSink::RtpSink()
+    : ipv6_(false),
+      width_(0),
+      height_(0),
+      stride_(0),
+      line_bytes_(0),
+      pgroup_bytes_(0),
+      pgroup_pixels_(0),
+      chunk_bytes_(0),
+      packets_per_frame_(0),
+      sampling_(nullptr),
+      socket_fd_(-1),
+      wakeup_fd_(-1),
+      batch_packets_(1),
+      stop_(false),
+      zerocopy_batch_packets_(1),
+      next_id_(0),
+      sequence_(0),
+      timestamp_base_(0),
+      last_frame_us_(0),
+      frame_interval_us_(0),
+      last_errno_(0),
+      frames_(0),
+      dropped_(0),
+      packets_(0),
+      bytes_(0),
+      sends_(0),
+      send_errors_(0),
+      zerocopy_sends_(0),
+      zerocopy_copied_(0),
+      in_flight_(0),
+      zerocopy_active_(false),
+      gso_active_(false) {}
+
+RtpSink::~RtpSink() { Close(); }
+
+bool RtpSink::Init(const VideoFormat& format, const RtpSinkOptions& options) {
+  Close();
+  options_ = options;
+  if (options_.max_frames == 0) {
+    options_.max_frames = 1;
+  }
+
+  sampling_ = GetSampling(format.pixel_format);
+  const PixelFormatInfo* info = FindPixelFormatInfo(format.pixel_format);
+  if (!sampling_ || !info) {
+    fprintf(stderr, "RTP 发送不支持格式 %s（支持 UYVY、RGB24、BGR24、ABGR32）\n",
+            PixelFormatToString(format.pixel_format).c_str());
+    return false;
+  }
+  pgroup_pixels_ = 1u << info->chroma_shift_x;
+  pgroup_bytes_ = info->bytes_per_pixel << info->chroma_shift_x;
+  if (format.width == 0 || format.height == 0 ||
+      format.width > kMaxDimension || format.height > kMaxDimension ||
+      format.width % pgroup_pixels_ != 0) {
+    fprintf(stderr, "RTP 发送不支持分辨率 %ux%u\n", format.width,
+            format.height);
+    return false;
+  }
+  if (options_.packet_size < kPacketHeaderSize + pgroup_bytes_ ||
+      options_.packet_size > kMaxPacketSize) {
+    fprintf(stderr, "RTP 包长 %zu 无效\n", options_.packet_size);
+    return false;
+  }
+
+  width_ = format.width;
+  height_ = format.height;
+  line_bytes_ = width_ * info->bytes_per_pixel;
+  stride_ = std::max(format.bytesperline[0], line_bytes_);
+  chunk_bytes_ = ChooseChunkBytes(line_bytes_, pgroup_bytes_,
+                                  options_.packet_size);
+  packets_per_frame_ =
+      height_ * ((line_bytes_ + chunk_bytes_ - 1) / chunk_bytes_);
+  size_t batch_limit = kMaxBatchBytes / (kPacketHeaderSize + chunk_bytes_);
+  batch_packets_ = static_cast<uint32_t>(std::max<size_t>(
+      1, std::min<size_t>(kMaxBatchPackets, batch_limit)));
+
+  std::random_device random;
+  if (options_.ssrc == 0) {
+    options_.ssrc = random();
+  }
+  sequence_ = random() & 0xFFFF;
+  timestamp_base_ = random();
+  next_id_ = 0;
+  last_frame_us_ = 0;
+  frame_interval_us_ = 0;
+  last_errno_ = 0;
+
+  wakeup_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (wakeup_fd_ < 0) {
+    fprintf(stderr, "创建 eventfd 失败: %s\n", strerror(errno));
+    return false;
+  }
+  if (!OpenSocket()) {
+    Close();
+    return false;
+  }
+
+  slots_.clear();
+  slots_.resize(options_.max_frames);
+  for (Slot& slot : slots_) {
+    slot.state = SlotState::kFree;
+    slot.headers.resize(static_cast<size_t>(packets_per_frame_) *
+                        kPacketHeaderSize);
+    slot.first_id = 0;
+    slot.sends = 0;
+    slot.completed = 0;
+  }
+  iov_.resize(static_cast<size_t>(batch_packets_) * 2);
+  zerocopy_batch_packets_ = std::min(batch_packets_, kMaxZerocopyBatchPackets);
+
+  stop_.store(false);
+  thread_ = std::thread(&RtpSink::Run, this);
+  return true;
+}
+
+bool RtpSink::OpenSocket() {
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_DGRAM;
+  hints.ai_protocol = IPPROTO_UDP;
+  std::string port = std::to_string(options_.port);
+  struct addrinfo* result = nullptr;
+  int ret = getaddrinfo(options_.host.c_str(), port.c_str(), &hints, &result);
+  if (ret != 0) {
+    fprintf(stderr, "解析地址 %s 失败: %s\n", options_.host.c_str(),
+            gai_strerror(ret));
+    return false;
+  }
+
+  for (struct addrinfo* ai = result; ai; ai = ai->ai_next) {
+    int fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC,
+                    ai->ai_protocol);
+    if (fd < 0) {
+      continue;
+    }
+    // 已连接的套接字发送时不再逐包查路由
+    if (connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+      close(fd);
+      continue;
+    }
+    char address[NI_MAXHOST];
+    if (getnameinfo(ai->ai_addr, ai->ai_addrlen, address, sizeof(address),
+                    nullptr, 0, NI_NUMERICHOST) != 0) {
+      snprintf(address, sizeof(address), "%s", options_.host.c_str());
+    }
+    address_ = address;
+    ipv6_ = ai->ai_family == AF_INET6;
+    socket_fd_ = fd;
+    break;
+  }
+  freeaddrinfo(result);
+  if (socket_fd_ < 0) {
+    fprintf(stderr, "连接 %s:%u 失败: %s\n", options_.host.c_str(),
+            options_.port, strerror(errno));
+    return false;
+  }
+
+  int one = 1;
+  zerocopy_active_.store(
+      options_.zerocopy && setsockopt(socket_fd_, SOL_SOCKET, SO_ZEROCOPY,
+                                      &one, sizeof(one)) == 0);
+  if (options_.zerocopy && !zerocopy_active_.load()) {
+    fprintf(stderr, "启用 SO_ZEROCOPY 失败: %s，使用拷贝发送\n",
+            strerror(errno));
+  }
+  // 设置后每次 sendmsg 的负载按包长切分，单包发送不受影响
+  int segment = static_cast<int>(kPacketHeaderSize + chunk_bytes_);
+  gso_active_.store(batch_packets_ > 1 && options_.gso &&
+                    setsockopt(socket_fd_, SOL_UDP, UDP_SEGMENT, &segment,
+                               sizeof(segment)) == 0);
+  if (batch_packets_ > 1 && options_.gso && !gso_active_.load()) {
+    fprintf(stderr, "启用 UDP GSO 失败: %s，逐包发送\n", strerror(errno));
+  }
+  return true;
+}
+
+bool RtpSink::Submit(FrameLease* lease) {
+  if (!lease || !lease->IsValid()) {
+    return false;
+  }
+  size_t frame_bytes =
+      static_cast<size_t>(stride_) * (height_ - 1) + line_bytes_;
+  if (socket_fd_ < 0 || !lease->data() || lease->size() < frame_bytes) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    lease->Release();
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t index = 0;
+    while (index < slots_.size() && slots_[index].state != SlotState::kFree) {
+      ++index;
+    }
+    if (index == slots_.size()) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      lease->Release();
+      return false;
+    }
+    slots_[index].lease = std::move(*lease);
+    slots_[index].state = SlotState::kQueued;
+    queue_.push_back(index);
+  }
+  uint64_t value = 1;
+  ssize_t ret = write(wakeup_fd_, &value, sizeof(value));
+  (void)ret;
+  return true;
+}
+
+void RtpSink::Run() {
+  while (!stop_.load()) {
+    ReapCompletions();
+    Slot* slot = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!queue_.empty()) {
+        slot = &slots_[queue_.front()];
+        queue_.pop_front();
+        slot->state = SlotState::kSending;
+      }
+    }
+    if (slot) {
+      SendFrame(slot);
+    } else {
+      Wait(-1);
+    }
+  }
+
+  // 在途帧的页仍被内核引用，完成通知到达前不能交还驱动
+  int64_t deadline_us = MonotonicMicros() + kDrainTimeoutUs;
+  while (in_flight_.load() > 0) {
+    int64_t now_us = MonotonicMicros();
+    if (now_us >= deadline_us) {
+      fprintf(stderr, "等待零拷贝完成超时，%u 帧未确认\n", in_flight_.load());
+      break;
+    }
+    Wait(deadline_us - now_us);
+    ReapCompletions();
+  }
+}
+
+void RtpSink::SendFrame(Slot* slot) {
+  const uint8_t* data = static_cast<const uint8_t*>(slot->lease.data());
+  int64_t timestamp_us = slot->lease.HasMonotonicTimestamp()
+                             ? slot->lease.timestamp_us()
+                             : slot->lease.dequeue_time_us();
+  int64_t delta_us = timestamp_us - last_frame_us_;
+  if (last_frame_us_ != 0 && delta_us > 0 && delta_us < kMaxFrameIntervalUs) {
+    frame_interval_us_ = delta_us;
+  }
+  last_frame_us_ = timestamp_us;
+  uint32_t rtp_timestamp = timestamp_base_ + static_cast<uint32_t>(
+      static_cast<uint64_t>(timestamp_us) * kRtpClockRate / 1000000);
+
+  // 已有帧排队说明发送落后于捕获，本帧不再等待
+  bool paced = options_.pacing_fraction > 0 && frame_interval_us_ > 0;
+  if (paced) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    paced = queue_.empty();
+  }
+  int64_t start_us = MonotonicMicros();
+  int64_t span_us =
+      static_cast<int64_t>(frame_interval_us_ * options_.pacing_fraction);
+
+  slot->first_id = next_id_;
+  slot->sends = 0;
+  slot->completed = 0;
+  uint8_t* header = slot->headers.data();
+  uint32_t index = 0;        // 帧内包序号
+  uint32_t batch = 0;        // 当前批次的包数
+  uint32_t batch_first = 0;  // 当前批次第一个包的序号
+  size_t batch_bytes = 0;
+  for (uint32_t y = 0; y < height_ && !stop_.load(); ++y) {
+    const uint8_t* line = data + static_cast<size_t>(y) * stride_;
+    for (uint32_t offset = 0; offset < line_bytes_; offset += chunk_bytes_) {
+      uint32_t length = std::min(chunk_bytes_, line_bytes_ - offset);
+      bool last = y + 1 == height_ && offset + length == line_bytes_;
+      header[0] = 0x80;  // V=2
+      header[1] = static_cast<uint8_t>((last ? 0x80 : 0) |
+                                       (options_.payload_type & 0x7F));
+      PutBe16(header + 2, sequence_);
+      PutBe32(header + 4, rtp_timestamp);
+      PutBe32(header + 8, options_.ssrc);
+      PutBe16(header + 12, sequence_ >> 16);
+      PutBe16(header + 14, length);
+      PutBe16(header + 16, y);  // F=0（逐行）
+      PutBe16(header + 18, offset / pgroup_bytes_ * pgroup_pixels_);  // C=0
+      ++sequence_;
+
+      if (batch == 0) {
+        batch_first = index;
+      }
+      iov_[batch * 2].iov_base = header;
+      iov_[batch * 2].iov_len = kPacketHeaderSize;
+      iov_[batch * 2 + 1].iov_base = const_cast<uint8_t*>(line + offset);
+      iov_[batch * 2 + 1].iov_len = length;
+      header += kPacketHeaderSize;
+      batch_bytes += kPacketHeaderSize + length;
+      ++batch;
+      ++index;
+
+      // 短包只能是 GSO 批次的最后一个
+      uint32_t limit = !gso_active_.load()      ? 1
+                       : zerocopy_active_.load() ? zerocopy_batch_packets_
+                                                 : batch_packets_;
+      if (batch < limit && length == chunk_bytes_ && !last) {
+        continue;
+      }
+      if (paced) {
+        int64_t deadline_us =
+            start_us + span_us * batch_first / packets_per_frame_;
+        int64_t now_us;
+        while (!stop_.load() && (now_us = MonotonicMicros()) < deadline_us) {
+          Wait(deadline_us - now_us);
+        }
+      }
+      SendBatch(slot, iov_.data(), batch, batch_bytes);
+      batch = 0;
+      batch_bytes = 0;
+    }
+  }
+  frames_.fetch_add(1, std::memory_order_relaxed);
+
+  if (slot->sends == 0) {
+    slot->lease.Release();
+    std::lock_guard<std::mutex> lock(mutex_);
+    slot->state = SlotState::kFree;
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  slot->state = SlotState::kAwaiting;
+  in_flight_.fetch_add(1);
+  ReleaseDone();
+}
+
+void RtpSink::SendBatch(Slot* slot, struct iovec* iov, uint32_t packets,
+                        size_t bytes) {
+  bool zerocopy = zerocopy_active_.load();
+  int retries = 0;
+  while (true) {
+    if (SendOnce(iov, packets * 2, zerocopy)) {
+      sends_.fetch_add(1, std::memory_order_relaxed);
+      packets_.fetch_add(packets, std::memory_order_relaxed);
+      bytes_.fetch_add(bytes, std::memory_order_relaxed);
+      if (zerocopy) {
+        // 每次成功的 MSG_ZEROCOPY 调用占用一个递增的通知编号
+        ++slot->sends;
+        ++next_id_;
+        zerocopy_sends_.fetch_add(1, std::memory_order_relaxed);
+      }
+      return;
+    }
+    int error = errno;
+    if (error == EINTR) {
+      continue;
+    }
+    if (error == ENOBUFS && zerocopy) {
+      // 未确认的通知占满了 optmem，等待完成后重试，仍失败则本次拷贝发送
+      if (++retries <= kMaxNoBufsRetries) {
+        Wait(kNoBufsWaitUs);
+        ReapCompletions();
+      } else {
+        zerocopy = false;
+      }
+      continue;
+    }
+    if (error == EIO && packets > 1 && gso_active_.load()) {
+      // 出口网卡不支持校验和卸载时内核拒绝 GSO
+      fprintf(stderr, "UDP GSO 发送失败: %s，改为逐包发送\n", strerror(error));
+      int zero = 0;
+      setsockopt(socket_fd_, SOL_UDP, UDP_SEGMENT, &zero, sizeof(zero));
+      gso_active_.store(false);
+      for (uint32_t i = 0; i < packets; ++i) {
+        SendBatch(slot, iov + i * 2, 1,
+                  iov[i * 2].iov_len + iov[i * 2 + 1].iov_len);
+      }
+      return;
+    }
+    if (error == EMSGSIZE && packets > 1) {
+      // 页片段超出上限，拆成两半重发，之后的批次按减半后的包数提交
+      uint32_t half = packets / 2;
+      if (zerocopy) {
+        zerocopy_batch_packets_ = std::min(zerocopy_batch_packets_, half);
+      }
+      size_t half_bytes = 0;
+      for (uint32_t i = 0; i < half * 2; ++i) {
+        half_bytes += iov[i].iov_len;
+      }
+      SendBatch(slot, iov, half, half_bytes);
+      SendBatch(slot, iov + half * 2, packets - half, bytes - half_bytes);
+      return;
+    }
+    if (zerocopy &&
+        (error == EFAULT || error == EINVAL || error == EOPNOTSUPP)) {
+      fprintf(stderr, "MSG_ZEROCOPY 发送失败: %s，改为拷贝发送\n",
+              strerror(error));
+      zerocopy_active_.store(false);
+      zerocopy = false;
+      continue;
+    }
+    // 接收端未启动时 ICMP 端口不可达使下一次发送返回 ECONNREFUSED，
+    // 只计数并在错误变化时打印
+    send_errors_.fetch_add(1, std::memory_order_relaxed);
+    if (error != last_errno_) {
+      fprintf(stderr, "RTP 发送失败: %s\n", strerror(error));
+      last_errno_ = error;
+    }
+    return;
+  }
+}
+
+bool RtpSink::SendOnce(struct iovec* iov, uint32_t iov_count, bool zerocopy) {
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = iov_count;
+  return sendmsg(socket_fd_, &msg, zerocopy ? MSG_ZEROCOPY : 0) >= 0;
+}
+
+void RtpSink::Wait(int64_t timeout_us) {
+  // 零拷贝完成通知与 ICMP 错误都以 POLLERR 报告，无需请求
+  struct pollfd fds[2] = {{wakeup_fd_, POLLIN, 0}, {socket_fd_, 0, 0}};
+  struct timespec timeout;
+  timeout.tv_sec = timeout_us / 1000000;
+  timeout.tv_nsec = timeout_us % 1000000 * 1000;
+  if (ppoll(fds, 2, timeout_us >= 0 ? &timeout : nullptr, nullptr) <= 0) {
+    return;
+  }
+  if (fds[0].revents & POLLIN) {
+    uint64_t value;
+    ssize_t ret = read(wakeup_fd_, &value, sizeof(value));
+    (void)ret;
+  }
+  if (fds[1].revents & POLLERR) {
+    ReapCompletions();
+    // 清除 ICMP 错误，否则 POLLERR 持续置位
+    int error = 0;
+    socklen_t length = sizeof(error);
+    getsockopt(socket_fd_, SOL_SOCKET, SO_ERROR, &error, &length);
+  }
+}
+
+void RtpSink::ReapCompletions() {
+  if (!zerocopy_active_.load() && in_flight_.load() == 0) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  while (true) {
+    char control[128];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (recvmsg(socket_fd_, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+      break;  // EAGAIN：队列已空
+    }
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (!(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) &&
+          !(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) {
+        continue;
+      }
+      struct sock_extended_err err;
+      memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+      if (err.ee_origin != SO_EE_ORIGIN_ZEROCOPY || err.ee_errno != 0) {
+        continue;
+      }
+      // 一条通知覆盖编号区间 [ee_info, ee_data]
+      if (err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+        zerocopy_copied_.fetch_add(err.ee_data - err.ee_info + 1,
+                                   std::memory_order_relaxed);
+      }
+      OnCompleted(err.ee_info, err.ee_data);
+    }
+  }
+  ReleaseDone();
+}
+
+void RtpSink::OnCompleted(uint32_t lo, uint32_t hi) {
+  for (Slot& slot : slots_) {
+    if ((slot.state != SlotState::kSending &&
+         slot.state != SlotState::kAwaiting) ||
+        slot.sends == 0) {
+      continue;
+    }
+    // 编号会回绕，按相对槽位第一个编号的有符号差值求交集
+    int64_t begin = std::max<int64_t>(
+        0, static_cast<int32_t>(lo - slot.first_id));
+    int64_t end = std::min<int64_t>(
+        slot.sends - 1, static_cast<int32_t>(hi - slot.first_id));
+    if (begin <= end) {
+      slot.completed += static_cast<uint32_t>(end - begin + 1);
+    }
+  }
+}
+
+void RtpSink::ReleaseDone() {
+  for (Slot& slot : slots_) {
+    if (slot.state == SlotState::kAwaiting && slot.completed >= slot.sends) {
+      slot.lease.Release();
+      slot.state = SlotState::kFree;
+      in_flight_.fetch_sub(1);
+    }
+  }
+}
+
+void RtpSink::Close() {
+  if (thread_.joinable()) {
+    stop_.store(true);
+    uint64_t value = 1;
+    ssize_t ret = write(wakeup_fd_, &value, sizeof(value));
+    (void)ret;
+    thread_.join();
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (Slot& slot : slots_) {
+      slot.lease.Release();
+      slot.state = SlotState::kFree;
+    }
+    queue_.clear();
+  }
+  in_flight_.store(0);
+  if (socket_fd_ >= 0) {
+    close(socket_fd_);
+    socket_fd_ = -1;
+  }
+  if (wakeup_fd_ >= 0) {
+    close(wakeup_fd_);
+    wakeup_fd_ = -1;
+  }
+}
+
+std::string RtpSink::GetSdp() const {
+  const char* family = ipv6_ ? "IP6" : "IP4";
+  char sdp[512];
+  snprintf(sdp, sizeof(sdp),
+           "v=0\r\n"
+           "o=- %u 0 IN %s %s\r\n"
+           "s=v4l2_demo\r\n"
+           "c=IN %s %s\r\n"
+           "t=0 0\r\n"
+           "m=video %u RTP/AVP %u\r\n"
+           "a=rtpmap:%u raw/90000\r\n"
+           "a=fmtp:%u sampling=%s; width=%u; height=%u; depth=8; "
+           "colorimetry=BT601-5\r\n",
+           options_.ssrc, family, address_.c_str(), family, address_.c_str(),
+           options_.port, options_.payload_type, options_.payload_type,
+           options_.payload_type, sampling_ ? sampling_ : "", width_, height_);
+  return sdp;
+}
+
+void RtpSink::GetStats(RtpSinkStats* stats) const {
+  stats->frames = frames_.load(std::memory_order_relaxed);
+  stats->dropped = dropped_.load(std::memory_order_relaxed);
+  stats->packets = packets_.load(std::memory_order_relaxed);
+  stats->bytes = bytes_.load(std::memory_order_relaxed);
+  stats->sends = sends_.load(std::memory_order_relaxed);
+  stats->send_errors = send_errors_.load(std::memory_order_relaxed);
+  stats->zerocopy_sends = zerocopy_sends_.load(std::memory_order_relaxed);
+  stats->zerocopy_copied = zerocopy_copied_.load(std::memory_order_relaxed);
+  stats->in_flight = in_flight_.load(std::memory_order_relaxed);
+  stats->zerocopy = zerocopy_active_.load(std::memory_order_relaxed);
+  stats->gso = gso_active_.load(std::memory_order_relaxed);
+}
+
+}  // namespace v4l2_demo
@@ -0,0 +1,172 @@
+#ifndef V4L2_DEMO_SRC_COMMON_RTP_SINK_H_
+#define V4L2_DEMO_SRC_COMMON_RTP_SINK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "v4l2_utils.h"
+
+namespace v4l2_demo {
+
+// RTP 发送配置
+struct RtpSinkOptions {
+  std::string host;             // 接收端地址（IPv4/IPv6 或主机名）
+  uint16_t port = 5004;         // 接收端 UDP 端口
+  uint8_t payload_type = 96;    // 动态负载类型
+  uint32_t ssrc = 0;            // 0 表示随机生成
+  size_t packet_size = 1400;    // RTP 包（含 RTP 与负载头）的最大字节数
+  uint32_t max_frames = 3;      // 同时持有的帧数（排队 + 发送中 + 等待零拷贝
+                                // 完成），必须小于设备缓冲区数量
+  bool zerocopy = true;         // 使用 MSG_ZEROCOPY，内核不支持时退回拷贝
+  bool gso = true;              // 使用 UDP GSO 一次提交多个包
+  double pacing_fraction = 0.8;  // 一帧的包均匀分布在帧间隔的这一比例内，
+                                 // 0 表示不做节奏控制
+};
+
+// RTP 发送统计
+struct RtpSinkStats {
+  uint64_t frames;           // 发送完成的帧数
+  uint64_t dropped;          // 队列已满而丢弃的帧数
+  uint64_t packets;          // 发送的 RTP 包数
+  uint64_t bytes;            // 发送的字节数（含 RTP 与负载头）
+  uint64_t sends;            // sendmsg 调用次数（GSO 时一次多个包）
+  uint64_t send_errors;      // 失败的 sendmsg 调用数（如接收端未启动）
+  uint64_t zerocopy_sends;   // 以 MSG_ZEROCOPY 提交的调用数
+  uint64_t zerocopy_copied;  // 内核回退为拷贝的调用数（如发往回环地址）
+  uint32_t in_flight;        // 等待零拷贝完成通知的帧数
+  bool zerocopy;             // 当前是否使用 MSG_ZEROCOPY
+  bool gso;                  // 当前是否使用 UDP GSO
+};
+
+// RFC 4175 非压缩视频 RTP 发送器
+// - 每个包只携带一行中的一段像素，包头之后直接引用租约中的像素数据，
+//   sendmsg 以 iovec 组合包头与像素，不拷贝到中间缓冲区
+// - MSG_ZEROCOPY：内核直接引用租约所在的页，等错误队列上的完成通知
+//   覆盖该帧的全部调用后才释放租约，缓冲区才交还驱动
+// - UDP GSO（UDP_SEGMENT）：等长的连续包一次提交，内核按包长切分
+// - 节奏控制：按相邻帧的驱动时间戳估计帧间隔，一帧的包在间隔内均匀发出，
+//   避免整帧突发挤满交换机缓冲区
+// - 支持的格式（RFC 4175 sampling）：UYVY（YCbCr-4:2:2）、RGB24（RGB）、
+//   BGR24（BGR）、ABGR32（BGRA）；YUYV 的字节顺序不符合 RFC 4175
+// 发送在内部线程完成，Submit 可在捕获线程调用且不阻塞
+class RtpSink {
+ public:
+  RtpSink();
+  ~RtpSink();
+
+  RtpSink(const RtpSink&) = delete;
+  RtpSink& operator=(const RtpSink&) = delete;
+
+  // 创建套接字并启动发送线程
+  // @param format 捕获格式（V4L2Device::GetFormat 的结果，含行跨度）
+  // @param options 配置
+  // @return 成功返回 true，格式不支持或地址无法解析时返回 false
+  bool Init(const VideoFormat& format, const RtpSinkOptions& options);
+
+  // 提交一帧，租约被转移，发送完成（零拷贝时为内核完成通知）后释放
+  // @return 已排队返回 true；持有的帧数已达 max_frames 时丢弃并返回 false
+  bool Submit(FrameLease* lease);
+
+  // 停止发送线程：丢弃排队的帧，等待在途的零拷贝完成后释放所有租约
+  void Close();
+
+  // 接收端使用的 SDP 描述（如 ffplay -protocol_whitelist file,udp,rtp x.sdp）
+  std::string GetSdp() const;
+
+  // 获取统计信息（可在任意线程调用）
+  void GetStats(RtpSinkStats* stats) const;
+
+ private:
+  enum class SlotState { kFree, kQueued, kSending, kAwaiting };
+
+  // 一帧的发送状态；包头在零拷贝完成前被内核引用，每个槽位独占一块
+  struct Slot {
+    FrameLease lease;
+    SlotState state;
+    std::vector<uint8_t> headers;
+    uint32_t first_id;   // 第一个 MSG_ZEROCOPY 调用的通知编号
+    uint32_t sends;      // MSG_ZEROCOPY 调用数
+    uint32_t completed;  // 已收到完成通知的调用数
+  };
+
+  bool OpenSocket();
+  void Run();
+  void SendFrame(Slot* slot);
+
+  // 以一次 sendmsg 提交连续的包（每包两个 iovec：包头与像素），
+  // 按错误类型重试、关闭 GSO 或退回拷贝
+  // @param packets 包数，大于 1 时依赖 UDP GSO 切分
+  // @param bytes 总字节数
+  void SendBatch(Slot* slot, struct iovec* iov, uint32_t packets,
+                 size_t bytes);
+  bool SendOnce(struct iovec* iov, uint32_t iov_count, bool zerocopy);
+
+  // 等待新帧、完成通知或超时
+  // @param timeout_us 超时（微秒），负数表示一直等待
+  void Wait(int64_t timeout_us);
+
+  // 读取错误队列上的零拷贝完成通知，释放已完成的帧
+  void ReapCompletions();
+
+  // 把通知编号区间 [lo, hi] 计入对应槽位（持锁调用）
+  void OnCompleted(uint32_t lo, uint32_t hi);
+
+  // 释放完成通知已覆盖全部调用的帧（持锁调用）
+  void ReleaseDone();
+
+  RtpSinkOptions options_;
+  std::string address_;  // 解析后的数字地址（用于 SDP）
+  bool ipv6_;
+  uint32_t width_;
+  uint32_t height_;
+  uint32_t stride_;
+  uint32_t line_bytes_;
+  uint32_t pgroup_bytes_;   // RFC 4175 像素组：pgroup_bytes_ 字节
+  uint32_t pgroup_pixels_;  // 含 pgroup_pixels_ 个像素
+  uint32_t chunk_bytes_;    // 除行尾外每个包的像素字节数
+  uint32_t packets_per_frame_;
+  const char* sampling_;
+
+  int socket_fd_;
+  int wakeup_fd_;
+  uint32_t batch_packets_;  // 每次 sendmsg 最多提交的包数
+  std::thread thread_;
+  std::atomic<bool> stop_;
+
+  std::mutex mutex_;              // 保护 slots_ 的状态与 queue_
+  std::vector<Slot> slots_;
+  std::deque<uint32_t> queue_;    // 待发送的槽位
+
+  // 以下只在发送线程访问
+  std::vector<struct iovec> iov_;
+  uint32_t zerocopy_batch_packets_;  // 零拷贝时每次最多提交的包数
+  uint32_t next_id_;     // 下一个 MSG_ZEROCOPY 调用的通知编号
+  uint32_t sequence_;    // 扩展序号（低 16 位在 RTP 头，高 16 位在负载头）
+  uint32_t timestamp_base_;
+  int64_t last_frame_us_;
+  int64_t frame_interval_us_;
+  int last_errno_;
+
+  std::atomic<uint64_t> frames_;
+  std::atomic<uint64_t> dropped_;
+  std::atomic<uint64_t> packets_;
+  std::atomic<uint64_t> bytes_;
+  std::atomic<uint64_t> sends_;
+  std::atomic<uint64_t> send_errors_;
+  std::atomic<uint64_t> zerocopy_sends_;
+  std::atomic<uint64_t> zerocopy_copied_;
+  std::atomic<uint32_t> in_flight_;
+  std::atomic<bool> zerocopy_active_;
+  std::atomic<bool> gso_active_;
+};
+
+}  // namespace v4l2_demo
+
+#endif  // V4L2_DEMO_SRC_COMMON_RTP_SINK_H_
@@ -0,0 +1,100 @@
+#ifndef V4L2_DEMO_SRC_COMMON_SPSC_QUEUE_H_
+#define V4L2_DEMO_SRC_COMMON_SPSC_QUEUE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <type_traits>
+#include <vector>
+
+namespace v4l2_demo {
+
+// 有界无锁单生产者/单消费者环形队列
+// 元素必须可平凡拷贝（通常是对象池中的槽位索引），这样出队可以用
+// CAS 推进读指针：消费者正常出队，生产者也可以通过 DropOldest
+// 从队头丢弃元素，两者不会重复取得同一个元素
+template <typename T>
+class SpscQueue {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "SpscQueue 元素必须可平凡拷贝");
+
+ public:
+  // @param capacity 队列容量（向上取整为 2 的幂）
+  explicit SpscQueue(size_t capacity)
+      : mask_(RoundUpPowerOfTwo(capacity) - 1),
+        slots_(mask_ + 1),
+        head_(0),
+        tail_(0) {}
+
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue& operator=(const SpscQueue&) = delete;
+
+  // 入队（仅生产者线程调用）
+  // @return 成功返回 true，队列已满返回 false
+  bool TryPush(const T& value) {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    uint64_t tail = tail_.load(std::memory_order_acquire);
+    if (head - tail > mask_) {
+      return false;
+    }
+    slots_[head & mask_].store(value, std::memory_order_relaxed);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // 出队（仅消费者线程调用）
+  // @return 成功返回 true，队列为空返回 false
+  bool TryPop(T* value) { return PopFront(value); }
+
+  // 丢弃队头最旧的元素（仅生产者线程调用，用于丢弃最旧策略）
+  // @param value 输出参数，被丢弃的元素
+  // @return 成功返回 true，队列为空返回 false
+  bool DropOldest(T* value) { return PopFront(value); }
+
+  // 当前元素数量（近似值，仅用于统计）
+  size_t Size() const {
+    uint64_t head = head_.load(std::memory_order_acquire);
+    uint64_t tail = tail_.load(std::memory_order_acquire);
+    return head - tail;
+  }
+
+  size_t Capacity() const { return mask_ + 1; }
+
+ private:
+  static size_t RoundUpPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+      result <<= 1;
+    }
+    return result;
+  }
+
+  bool PopFront(T* value) {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    while (true) {
+      uint64_t head = head_.load(std::memory_order_acquire);
+      if (tail == head) {
+        return false;
+      }
+      // 先读取槽位，再用 CAS 认领；CAS 成功前生产者不会覆盖该槽位
+      T candidate = slots_[tail & mask_].load(std::memory_order_relaxed);
+      if (tail_.compare_exchange_weak(tail, tail + 1,
+                                      std::memory_order_acq_rel,
+                                      std::memory_order_relaxed)) {
+        *value = candidate;
+        return true;
+      }
+    }
+  }
+
+  const size_t mask_;
+  // 槽位为原子类型：DropOldest 与 TryPop 竞争时读到的旧值会被 CAS 丢弃
+  std::vector<std::atomic<T>> slots_;
+  // 读写指针分别独占缓存行，避免生产者与消费者伪共享
+  alignas(64) std::atomic<uint64_t> head_;  // 下一个写入位置
+  alignas(64) std::atomic<uint64_t> tail_;  // 下一个读取位置
+};
+
+}  // namespace v4l2_demo
+
+#endif  // V4L2_DEMO_SRC_COMMON_SPSC_QUEUE_H_
@@ -0,0 +1,99 @@
+#include "thread_pool.h"
+
+namespace v4l2_demo {
+
+ThreadPool::ThreadPool(size_t num_threads)
+    : generation_(0),
+      stopping_(false),
+      fn_(nullptr),
+      context_(nullptr),
+      task_count_(0),
+      next_task_(0),
+      active_workers_(0) {
+  if (num_threads == 0) {
+    unsigned cores = std::thread::hardware_concurrency();
+    num_threads = (cores > 1) ? cores - 1 : 0;
+  }
+  workers_.reserve(num_threads);
+  for (size_t i = 0; i < num_threads; ++i) {
+    workers_.emplace_back(&ThreadPool::WorkerLoop, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  start_cv_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPool::ParallelFor(size_t task_count,
+                             void (*fn)(void* context, size_t index),
+                             void* context) {
+  if (task_count == 0) {
+    return;
+  }
+
+  // 只有一个任务或没有工作线程时直接在调用线程执行
+  if (task_count == 1 || workers_.empty()) {
+    for (size_t i = 0; i < task_count; ++i) {
+      fn(context, i);
+    }
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fn_ = fn;
+    context_ = context;
+    task_count_ = task_count;
+    next_task_.store(0, std::memory_order_relaxed);
+    active_workers_ = workers_.size();
+    generation_++;
+  }
+  start_cv_.notify_all();
+
+  RunTasks();
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_cv_.wait(lock, [this] { return active_workers_ == 0; });
+}
+
+void ThreadPool::RunTasks() {
+  while (true) {
+    size_t index = next_task_.fetch_add(1, std::memory_order_relaxed);
+    if (index >= task_count_) {
+      break;
+    }
+    fn_(context_, index);
+  }
+}
+
+void ThreadPool::WorkerLoop() {
+  uint64_t seen_generation = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_cv_.wait(lock, [&] {
+        return stopping_ || generation_ != seen_generation;
+      });
+      if (stopping_) {
+        return;
+      }
+      seen_generation = generation_;
+    }
+
+    RunTasks();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--active_workers_ == 0) {
+      done_cv_.notify_one();
+    }
+  }
+}
+
+}  // namespace v4l2_demo
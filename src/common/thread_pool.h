@@ -0,0 +1,70 @@
+#ifndef V4L2_DEMO_SRC_COMMON_THREAD_POOL_H_
+#define V4L2_DEMO_SRC_COMMON_THREAD_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace v4l2_demo {
+
+// 持久线程池：线程在构造时创建并一直复用，ParallelFor 不创建线程、
+// 不分配内存。调用线程也参与执行任务
+// ParallelFor 不可重入，同一时刻只能有一个调用者
+class ThreadPool {
+ public:
+  // @param num_threads 工作线程数（不含调用线程），0 表示 CPU 核数 - 1
+  explicit ThreadPool(size_t num_threads = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // 并行执行 task_count 个任务，阻塞直到全部完成
+  // @param task_count 任务数
+  // @param fn 任务函数，参数为上下文与任务序号
+  // @param context 传给 fn 的上下文
+  void ParallelFor(size_t task_count, void (*fn)(void* context, size_t index),
+                   void* context);
+
+  // 以可调用对象执行 ParallelFor，func 原样引用，不会被拷贝
+  template <typename Func>
+  void ParallelFor(size_t task_count, const Func& func) {
+    ParallelFor(
+        task_count,
+        [](void* context, size_t index) {
+          (*static_cast<const Func*>(context))(index);
+        },
+        const_cast<Func*>(&func));
+  }
+
+  // 参与执行的线程总数（工作线程 + 调用线程）
+  size_t GetConcurrency() const { return workers_.size() + 1; }
+
+ private:
+  void WorkerLoop();
+
+  // 领取并执行任务，直到没有剩余任务
+  void RunTasks();
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable start_cv_;
+  std::condition_variable done_cv_;
+  uint64_t generation_;  // 每次 ParallelFor 递增，唤醒工作线程
+  bool stopping_;
+
+  // 当前任务批次
+  void (*fn_)(void*, size_t);
+  void* context_;
+  size_t task_count_;
+  std::atomic<size_t> next_task_;
+  size_t active_workers_;  // 尚未完成本批次的工作线程数
+};
+
+}  // namespace v4l2_demo
+
+#endif  // V4L2_DEMO_SRC_COMMON_THREAD_POOL_H_
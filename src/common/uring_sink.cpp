@@ -0,0 +1,503 @@
+#include "uring_sink.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <utility>
+
+namespace v4l2_demo {
+
+namespace {
+// O_DIRECT 要求偏移、长度和内存地址按逻辑块对齐，这里统一按页对齐
+constexpr size_t kDirectIoAlignment = 4096;
+
+size_t AlignUp(size_t value, size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+int IoUringSetup(unsigned entries, struct io_uring_params* params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int IoUringEnter(int fd, unsigned to_submit, unsigned min_complete,
+                 unsigned flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit,
+                                  min_complete, flags, nullptr, 0));
+}
+
+int IoUringRegister(int fd, unsigned opcode, const void* arg,
+                    unsigned nr_args) {
+  return static_cast<int>(
+      syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+unsigned LoadAcquire(const unsigned* p) {
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+void StoreRelease(unsigned* p, unsigned value) {
+  __atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+}  // namespace
+
+UringSink::UringSink()
+    : device_(nullptr),
+      slot_size_(0),
+      fixed_buffers_(false),
+      direct_io_(false),
+      ring_fd_(-1),
+      event_fd_(-1),
+      sq_ptr_(MAP_FAILED),
+      sq_map_size_(0),
+      cq_ptr_(MAP_FAILED),
+      cq_map_size_(0),
+      sqes_(nullptr),
+      sqes_map_size_(0),
+      sq_head_(nullptr),
+      sq_tail_(nullptr),
+      sq_mask_(nullptr),
+      sq_array_(nullptr),
+      cq_head_(nullptr),
+      cq_tail_(nullptr),
+      cq_mask_(nullptr),
+      cqes_(nullptr),
+      first_segment_id_(0),
+      current_segment_id_(0),
+      frames_in_segment_(0),
+      submitted_(0),
+      completed_(0),
+      failed_(0),
+      bytes_written_(0),
+      segment_count_(0) {}
+
+UringSink::~UringSink() {
+  Close();
+}
+
+bool UringSink::Init(V4L2Device* device, const UringSinkOptions& options) {
+  if (!device || device->GetBufferCount() == 0) {
+    fprintf(stderr, "io_uring 存储需要已完成内存映射的设备\n");
+    return false;
+  }
+
+  Close();
+  device_ = device;
+  options_ = options;
+  if (options_.queue_depth == 0) {
+    options_.queue_depth = 1;
+  }
+  if (options_.frames_per_segment == 0) {
+    options_.frames_per_segment = 1;
+  }
+  direct_io_ = options_.direct_io;
+
+  // 槽位大小取所有缓冲区长度的最大值并按页对齐
+  slot_size_ = 0;
+  for (uint32_t i = 0; i < device->GetBufferCount(); ++i) {
+    if (!device->GetBuffer(i)->start) {
+      fprintf(stderr, "缓冲区 %u 无法被 CPU 访问，不能用于 io_uring 存储\n",
+              i);
+      return false;
+    }
+    // 每帧以一次写入从驱动缓冲区落盘，多内存平面（如 NV12M）的帧无法写完整
+    if (device->GetBuffer(i)->plane_count > 1) {
+      fprintf(stderr, "io_uring 存储不支持多内存平面的捕获格式\n");
+      return false;
+    }
+    size_t length = AlignUp(device->GetBuffer(i)->length, kDirectIoAlignment);
+    if (length > slot_size_) {
+      slot_size_ = length;
+    }
+  }
+
+  if (!SetupRing(options_.queue_depth)) {
+    Close();
+    return false;
+  }
+
+  fixed_buffers_ = RegisterBuffers();
+
+  // 可选：注册完成通知 eventfd，便于接入 epoll
+  event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (event_fd_ >= 0 &&
+      IoUringRegister(ring_fd_, IORING_REGISTER_EVENTFD, &event_fd_, 1) < 0) {
+    close(event_fd_);
+    event_fd_ = -1;
+  }
+
+  in_flight_.clear();
+  in_flight_.resize(options_.queue_depth);
+  free_slots_.clear();
+  for (uint32_t i = 0; i < options_.queue_depth; ++i) {
+    free_slots_.push_back(options_.queue_depth - 1 - i);
+  }
+
+  frames_in_segment_ = 0;
+  if (!OpenNextSegment()) {
+    Close();
+    return false;
+  }
+
+  return true;
+}
+
+bool UringSink::SetupRing(uint32_t entries) {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+
+  ring_fd_ = IoUringSetup(entries, &params);
+  if (ring_fd_ < 0) {
+    fprintf(stderr, "io_uring_setup 失败: %s\n", strerror(errno));
+    return false;
+  }
+
+  sq_map_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_map_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_mmap && cq_map_size_ > sq_map_size_) {
+    sq_map_size_ = cq_map_size_;
+  }
+
+  sq_ptr_ = mmap(nullptr, sq_map_size_, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (sq_ptr_ == MAP_FAILED) {
+    fprintf(stderr, "映射 io_uring SQ 失败: %s\n", strerror(errno));
+    return false;
+  }
+
+  if (single_mmap) {
+    cq_ptr_ = sq_ptr_;
+  } else {
+    cq_ptr_ = mmap(nullptr, cq_map_size_, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+    if (cq_ptr_ == MAP_FAILED) {
+      fprintf(stderr, "映射 io_uring CQ 失败: %s\n", strerror(errno));
+      return false;
+    }
+  }
+
+  sqes_map_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  void* sqes = mmap(nullptr, sqes_map_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    fprintf(stderr, "映射 io_uring SQE 失败: %s\n", strerror(errno));
+    return false;
+  }
+  sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+
+  char* sq = static_cast<char*>(sq_ptr_);
+  sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  sq_mask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+  char* cq = static_cast<char*>(cq_ptr_);
+  cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  cq_mask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+
+  return true;
+}
+
+bool UringSink::RegisterBuffers() {
+  // USERPTR 模式下租约可能持有换出的备用缓冲区，与驱动索引不一一对应
+  if (device_->GetMemoryType() == V4L2_MEMORY_USERPTR) {
+    return false;
+  }
+
+  // 以缓冲区索引作为固定缓冲区索引，写入时无需逐次映射用户内存
+  std::vector<struct iovec> iovecs(device_->GetBufferCount());
+  for (uint32_t i = 0; i < iovecs.size(); ++i) {
+    const FrameBuffer* buffer = device_->GetBuffer(i);
+    iovecs[i].iov_base = buffer->start;
+    iovecs[i].iov_len = AlignUp(buffer->length, kDirectIoAlignment);
+  }
+
+  if (IoUringRegister(ring_fd_, IORING_REGISTER_BUFFERS, iovecs.data(),
+                      iovecs.size()) < 0) {
+    // 部分驱动的缓冲区（VM_PFNMAP）无法被固定，退回普通写入
+    fprintf(stderr, "注册固定缓冲区失败，使用普通写入: %s\n",
+            strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+bool UringSink::OpenNextSegment() {
+  if (!segments_.empty()) {
+    Segment& current = segments_.back();
+    current.full = true;
+    if (current.in_flight == 0) {
+      OnSegmentWriteDone(current_segment_id_);
+    }
+    current_segment_id_++;
+  }
+
+  char name[64];
+  snprintf(name, sizeof(name), "_%06u.raw", segment_count_);
+  std::string path = options_.directory + "/" + options_.prefix + name;
+
+  int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+  int fd = open(path.c_str(), flags | (direct_io_ ? O_DIRECT : 0), 0644);
+  if (fd < 0 && direct_io_ && errno == EINVAL) {
+    // tmpfs 等文件系统不支持 O_DIRECT
+    fprintf(stderr, "%s 不支持 O_DIRECT，改用缓冲写入\n", path.c_str());
+    direct_io_ = false;
+    fd = open(path.c_str(), flags, 0644);
+  }
+  if (fd < 0) {
+    fprintf(stderr, "无法创建分段文件 %s: %s\n", path.c_str(),
+            strerror(errno));
+    return false;
+  }
+
+  // 预分配整个分段，避免写入过程中的块分配与元数据更新
+  off_t total = static_cast<off_t>(slot_size_) * options_.frames_per_segment;
+  int ret = fallocate(fd, 0, 0, total);
+  if (ret != 0) {
+    fprintf(stderr, "预分配 %s 失败: %s\n", path.c_str(), strerror(errno));
+  }
+
+  Segment segment;
+  segment.fd = fd;
+  segment.in_flight = 0;
+  segment.full = false;
+  if (segments_.empty()) {
+    first_segment_id_ = current_segment_id_;
+  }
+  segments_.push_back(segment);
+  segment_count_++;
+  frames_in_segment_ = 0;
+  return true;
+}
+
+UringSink::Segment* UringSink::FindSegment(uint64_t segment_id) {
+  if (segment_id < first_segment_id_ ||
+      segment_id - first_segment_id_ >= segments_.size()) {
+    return nullptr;
+  }
+  return &segments_[segment_id - first_segment_id_];
+}
+
+void UringSink::OnSegmentWriteDone(uint64_t segment_id) {
+  Segment* segment = FindSegment(segment_id);
+  if (!segment || !segment->full || segment->in_flight > 0 ||
+      segment->fd < 0) {
+    return;
+  }
+
+  close(segment->fd);
+  segment->fd = -1;
+  // 分段按顺序关闭后从队头移除，segments_ 的大小保持有界
+  while (!segments_.empty() && segments_.front().fd < 0) {
+    segments_.pop_front();
+    first_segment_id_++;
+  }
+}
+
+bool UringSink::Submit(FrameLease* lease) {
+  if (ring_fd_ < 0 || !lease || !lease->IsValid()) {
+    return false;
+  }
+  if (lease->plane_count() > 1) {
+    fprintf(stderr, "io_uring 存储不支持多内存平面的帧（%u 个平面）\n",
+            lease->plane_count());
+    lease->Release();
+    return false;
+  }
+
+  if (free_slots_.empty() && ReapCompletions(true) < 0) {
+    lease->Release();
+    return false;
+  }
+
+  if (frames_in_segment_ >= options_.frames_per_segment &&
+      !OpenNextSegment()) {
+    lease->Release();
+    return false;
+  }
+
+  Segment* segment = &segments_.back();
+  size_t length = AlignUp(lease->size(), kDirectIoAlignment);
+  if (length > slot_size_) {
+    length = slot_size_;
+  }
+
+  uint32_t slot = free_slots_.back();
+  free_slots_.pop_back();
+
+  unsigned tail = *sq_tail_;
+  unsigned index = tail & *sq_mask_;
+  struct io_uring_sqe* sqe = &sqes_[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = fixed_buffers_ ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+  sqe->fd = segment->fd;
+  sqe->addr = reinterpret_cast<uint64_t>(lease->data());
+  sqe->len = length;
+  sqe->off = static_cast<uint64_t>(frames_in_segment_) * slot_size_;
+  sqe->buf_index = fixed_buffers_ ? lease->index() : 0;
+  sqe->user_data = slot;
+  sq_array_[index] = index;
+  StoreRelease(sq_tail_, tail + 1);
+
+  InFlight& entry = in_flight_[slot];
+  entry.lease = std::move(*lease);
+  entry.segment_id = current_segment_id_;
+  entry.length = length;
+  segment->in_flight++;
+  frames_in_segment_++;
+
+  if (IoUringEnter(ring_fd_, 1, 0, 0) < 0) {
+    fprintf(stderr, "io_uring_enter 失败: %s\n", strerror(errno));
+    // 提交失败时撤回 SQE
+    StoreRelease(sq_tail_, tail);
+    segment->in_flight--;
+    frames_in_segment_--;
+    entry.lease.Release();
+    free_slots_.push_back(slot);
+    failed_++;
+    return false;
+  }
+
+  submitted_++;
+  // 顺便收割已经完成的写入，尽早归还驱动缓冲区
+  ReapCompletions(false);
+  return true;
+}
+
+int UringSink::ReapCompletions(bool wait_for_one) {
+  if (ring_fd_ < 0) {
+    return -1;
+  }
+
+  if (event_fd_ >= 0) {
+    uint64_t value;
+    ssize_t ret = read(event_fd_, &value, sizeof(value));
+    (void)ret;
+  }
+
+  int reaped = 0;
+  while (true) {
+    unsigned head = *cq_head_;
+    unsigned tail = LoadAcquire(cq_tail_);
+    if (head == tail) {
+      if (wait_for_one && reaped == 0 && free_slots_.size() < in_flight_.size()) {
+        if (IoUringEnter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0 &&
+            errno != EINTR) {
+          fprintf(stderr, "等待 io_uring 完成失败: %s\n", strerror(errno));
+          return -1;
+        }
+        continue;
+      }
+      break;
+    }
+
+    struct io_uring_cqe* cqe = &cqes_[head & *cq_mask_];
+    uint32_t slot = static_cast<uint32_t>(cqe->user_data);
+    int res = cqe->res;
+    StoreRelease(cq_head_, head + 1);
+
+    if (slot >= in_flight_.size()) {
+      continue;
+    }
+
+    InFlight& entry = in_flight_[slot];
+    if (res < 0) {
+      fprintf(stderr, "io_uring 写入失败: %s\n", strerror(-res));
+      failed_++;
+    } else if (static_cast<size_t>(res) != entry.length) {
+      // 短写（如预分配分段中途 ENOSPC）留下不完整的槽位，按失败计
+      fprintf(stderr, "io_uring 写入不完整: %d/%zu 字节\n", res,
+              entry.length);
+      failed_++;
+      bytes_written_ += res;
+    } else {
+      completed_++;
+      bytes_written_ += res;
+    }
+
+    // 写入完成后才将缓冲区交还驱动
+    entry.lease.Release();
+    Segment* segment = FindSegment(entry.segment_id);
+    if (segment) {
+      segment->in_flight--;
+    }
+    OnSegmentWriteDone(entry.segment_id);
+    free_slots_.push_back(slot);
+    reaped++;
+  }
+
+  return reaped;
+}
+
+void UringSink::Close() {
+  if (ring_fd_ >= 0) {
+    while (free_slots_.size() < in_flight_.size()) {
+      if (ReapCompletions(true) < 0) {
+        break;
+      }
+    }
+  }
+
+  // 最后一个分段未写满，截掉预分配的多余部分
+  if (!segments_.empty() && segments_.back().fd >= 0 &&
+      !segments_.back().full) {
+    off_t used = static_cast<off_t>(slot_size_) * frames_in_segment_;
+    if (ftruncate(segments_.back().fd, used) != 0) {
+      fprintf(stderr, "截断分段文件失败: %s\n", strerror(errno));
+    }
+  }
+
+  for (auto& segment : segments_) {
+    if (segment.fd >= 0) {
+      close(segment.fd);
+    }
+  }
+  segments_.clear();
+  in_flight_.clear();
+  free_slots_.clear();
+
+  if (sqes_) {
+    munmap(sqes_, sqes_map_size_);
+    sqes_ = nullptr;
+  }
+  if (cq_ptr_ != MAP_FAILED && cq_ptr_ != sq_ptr_) {
+    munmap(cq_ptr_, cq_map_size_);
+  }
+  cq_ptr_ = MAP_FAILED;
+  if (sq_ptr_ != MAP_FAILED) {
+    munmap(sq_ptr_, sq_map_size_);
+    sq_ptr_ = MAP_FAILED;
+  }
+  if (event_fd_ >= 0) {
+    close(event_fd_);
+    event_fd_ = -1;
+  }
+  if (ring_fd_ >= 0) {
+    close(ring_fd_);
+    ring_fd_ = -1;
+  }
+}
+
+void UringSink::GetStats(UringSinkStats* stats) const {
+  stats->submitted = submitted_;
+  stats->completed = completed_;
+  stats->failed = failed_;
+  stats->bytes_written = bytes_written_;
+  stats->in_flight = in_flight_.size() - free_slots_.size();
+  stats->segments = segment_count_;
+  stats->fixed_buffers = fixed_buffers_;
+  stats->direct_io = direct_io_;
+}
+
+}  // namespace v4l2_demo
@@ -0,0 +1,139 @@
+#ifndef V4L2_DEMO_SRC_COMMON_URING_SINK_H_
+#define V4L2_DEMO_SRC_COMMON_URING_SINK_H_
+
+#include <linux/io_uring.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "v4l2_utils.h"
+
+namespace v4l2_demo {
+
+// io_uring 存储配置
+struct UringSinkOptions {
+  std::string directory = "output";  // 分段文件目录
+  std::string prefix = "segment";    // 分段文件名前缀
+  uint32_t frames_per_segment = 300;  // 每个分段文件的帧数
+  uint32_t queue_depth = 16;  // 最大在途写入数（同时也是 SQ 深度）
+  bool direct_io = true;      // 使用 O_DIRECT 绕过页缓存
+};
+
+// io_uring 存储统计
+struct UringSinkStats {
+  uint64_t submitted;      // 已提交的写入数
+  uint64_t completed;      // 成功完成的写入数
+  uint64_t failed;         // 失败的写入数（含短写）
+  uint64_t bytes_written;  // 累计写入字节数（含对齐填充）
+  uint32_t in_flight;      // 当前在途写入数
+  uint32_t segments;       // 已创建的分段文件数
+  bool fixed_buffers;      // 是否使用了注册缓冲区
+  bool direct_io;          // 是否使用了 O_DIRECT
+};
+
+// 基于 io_uring 的连续录制存储
+// - 将设备的内存映射缓冲区注册为 io_uring 固定缓冲区，直接写出无拷贝
+// - 写入预先 fallocate 的分段文件，每帧占用固定大小的对齐槽位，
+//   第 N 帧位于 (N % frames_per_segment) * GetSlotSize() 处
+// - 租约一直保持到写入完成，完成后自动重新入队给驱动
+// - 不支持多内存平面的捕获格式（如 NV12M），Init 时拒绝
+// 非线程安全：Submit 与 ReapCompletions 需在同一线程调用
+class UringSink {
+ public:
+  UringSink();
+  ~UringSink();
+
+  UringSink(const UringSink&) = delete;
+  UringSink& operator=(const UringSink&) = delete;
+
+  // 初始化 io_uring 并注册设备缓冲区（设备需已完成 InitMemoryMapping）
+  // @param device 捕获设备
+  // @param options 配置
+  // @return 成功返回 true；内核不支持 io_uring 等情况返回 false
+  bool Init(V4L2Device* device, const UringSinkOptions& options);
+
+  // 提交一帧写入，租约被转移并在写入完成后释放
+  // 在途写入已满时会先阻塞等待一个完成
+  // @return 成功提交返回 true，失败返回 false（租约被立即释放）
+  bool Submit(FrameLease* lease);
+
+  // 收割已完成的写入并释放对应的租约
+  // @param wait_for_one 为 true 时至少等待一个完成
+  // @return 收割的完成数，出错返回 -1
+  int ReapCompletions(bool wait_for_one);
+
+  // 等待所有在途写入完成并关闭文件与 io_uring
+  void Close();
+
+  // 获取用于 epoll 的完成通知 eventfd（未启用时返回 -1）
+  int GetCompletionFd() const { return event_fd_; }
+
+  // 每帧在分段文件中占用的槽位大小（按页对齐）
+  size_t GetSlotSize() const { return slot_size_; }
+
+  void GetStats(UringSinkStats* stats) const;
+
+ private:
+  // 分段文件
+  struct Segment {
+    int fd;
+    uint32_t in_flight;  // 该分段上的在途写入数
+    bool full;           // 已写满，等在途写入完成后关闭
+  };
+
+  // 在途写入
+  struct InFlight {
+    FrameLease lease;
+    uint64_t segment_id;
+    size_t length;
+  };
+
+  bool SetupRing(uint32_t entries);
+  bool RegisterBuffers();
+  bool OpenNextSegment();
+  void OnSegmentWriteDone(uint64_t segment_id);
+  Segment* FindSegment(uint64_t segment_id);
+
+  V4L2Device* device_;
+  UringSinkOptions options_;
+  size_t slot_size_;
+  bool fixed_buffers_;
+  bool direct_io_;
+
+  // io_uring 环形队列
+  int ring_fd_;
+  int event_fd_;
+  void* sq_ptr_;
+  size_t sq_map_size_;
+  void* cq_ptr_;
+  size_t cq_map_size_;
+  struct io_uring_sqe* sqes_;
+  size_t sqes_map_size_;
+  unsigned* sq_head_;
+  unsigned* sq_tail_;
+  unsigned* sq_mask_;
+  unsigned* sq_array_;
+  unsigned* cq_head_;
+  unsigned* cq_tail_;
+  unsigned* cq_mask_;
+  struct io_uring_cqe* cqes_;
+
+  std::vector<InFlight> in_flight_;
+  std::vector<uint32_t> free_slots_;
+  std::deque<Segment> segments_;  // 未关闭的分段
+  uint64_t first_segment_id_;     // segments_.front() 的分段编号
+  uint64_t current_segment_id_;
+  uint32_t frames_in_segment_;
+
+  uint64_t submitted_;
+  uint64_t completed_;
+  uint64_t failed_;
+  uint64_t bytes_written_;
+  uint32_t segment_count_;
+};
+
+}  // namespace v4l2_demo
+
+#endif  // V4L2_DEMO_SRC_COMMON_URING_SINK_H_
@@ -1,17 +1,142 @@
 #include "v4l2_utils.h"
 
+#include "device_discovery.h"
+#include "latency_histogram.h"
+#include "realtime.h"
+
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <linux/dma-buf.h>
+#include <poll.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <time.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <thread>
+#include <utility>
+
 namespace v4l2_demo {
 
-V4L2Device::V4L2Device() : fd_(-1), streaming_(false) {}
+FrameLease::FrameLease() {
+  Reset();
+}
+
+FrameLease::~FrameLease() {
+  Release();
+}
+
+FrameLease::FrameLease(FrameLease&& other) noexcept {
+  Reset();
+  *this = std::move(other);
+}
+
+FrameLease& FrameLease::operator=(FrameLease&& other) noexcept {
+  if (this != &other) {
+    if (IsValid()) {
+      Release();
+    }
+    device_ = other.device_;
+    data_ = other.data_;
+    bytesused_ = other.bytesused_;
+    plane_count_ = other.plane_count_;
+    memcpy(plane_data_, other.plane_data_, sizeof(plane_data_));
+    memcpy(plane_size_, other.plane_size_, sizeof(plane_size_));
+    index_ = other.index_;
+    sequence_ = other.sequence_;
+    flags_ = other.flags_;
+    timestamp_ = other.timestamp_;
+    dmabuf_fd_ = other.dmabuf_fd_;
+    detached_buffer_ = other.detached_buffer_;
+    dequeue_time_us_ = other.dequeue_time_us_;
+    other.Reset();
+  }
+  return *this;
+}
+
+bool FrameLease::Release() {
+  if (!IsValid()) {
+    return true;
+  }
+
+  V4L2Device* device = device_;
+  uint32_t index = index_;
+  void* detached_buffer = detached_buffer_;
+
+  FrameLatencyTracker* tracker = device->latency_tracker_;
+  if (tracker) {
+    int64_t now = MonotonicMicros();
+    tracker->dequeue_to_release.Record(now - dequeue_time_us_);
+    if (HasMonotonicTimestamp()) {
+      int64_t latency = now - timestamp_us();
+      tracker->end_to_end.Record(latency > 0 ? latency : 0);
+    }
+  }
+  Reset();
+
+  if (detached_buffer) {
+    // 驱动侧已换入备用缓冲区，这里只需归还内存
+    device->ReturnSpareBuffer(detached_buffer);
+    return true;
+  }
+
+  device->leased_buffers_.fetch_sub(1);
+  device->EndCpuAccess(index);
+  return device->QueueBuffer(index);
+}
+
+void FrameLease::Reset() {
+  device_ = nullptr;
+  data_ = nullptr;
+  bytesused_ = 0;
+  plane_count_ = 0;
+  memset(plane_data_, 0, sizeof(plane_data_));
+  memset(plane_size_, 0, sizeof(plane_size_));
+  index_ = 0;
+  sequence_ = 0;
+  flags_ = 0;
+  timestamp_.tv_sec = 0;
+  timestamp_.tv_usec = 0;
+  dmabuf_fd_ = -1;
+  detached_buffer_ = nullptr;
+  dequeue_time_us_ = 0;
+}
+
+bool FrameLease::HasMonotonicTimestamp() const {
+  return (flags_ & V4L2_BUF_FLAG_TIMESTAMP_MASK) ==
+         V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC;
+}
+
+V4L2Device::V4L2Device()
+    : fd_(-1),
+      buf_type_(V4L2_BUF_TYPE_VIDEO_CAPTURE),
+      streaming_(false),
+      memory_(V4L2_MEMORY_MMAP),
+      prefault_buffers_(false),
+      last_error_(0),
+      format_width_(0),
+      format_height_(0),
+      format_pixel_format_(0),
+      frame_interval_{0, 0},
+      requested_buffer_count_(0),
+      exported_dmabuf_(false),
+      has_restore_state_(false),
+      restore_buffer_count_(0),
+      restore_dmabuf_(false),
+      restore_streaming_(false),
+      latency_tracker_(nullptr),
+      leased_buffers_(0),
+      expected_frame_size_(0),
+      has_sequence_(false),
+      last_sequence_(0),
+      frames_(0),
+      dropped_frames_(0),
+      error_frames_(0),
+      short_frames_(0) {}
 
 V4L2Device::~V4L2Device() {
   Close();
@@ -19,6 +144,9 @@ V4L2Device::~V4L2Device() {
 
 bool V4L2Device::Open(const std::string& device_path) {
   if (IsOpen()) {
+    if (device_path == device_path_) {
+      return true;
+    }
     Close();
   }
 
@@ -28,15 +156,41 @@ bool V4L2Device::Open(const std::string& device_path) {
             strerror(errno));
     return false;
   }
+  if (device_path != device_path_) {
+    // 换了设备，之前保存的配置不再适用
+    format_pixel_format_ = 0;
+    frame_interval_.numerator = 0;
+  }
+  device_path_ = device_path;
+  last_error_ = 0;
+
+  // 只提供多平面接口的捕获节点使用多平面 API；同时支持两者时沿用单平面 API
+  buf_type_ = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  struct v4l2_capability cap;
+  memset(&cap, 0, sizeof(cap));
+  if (ioctl(fd_, VIDIOC_QUERYCAP, &cap) == 0) {
+    uint32_t caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS)
+                        ? cap.device_caps
+                        : cap.capabilities;
+    if ((caps & V4L2_CAP_VIDEO_CAPTURE_MPLANE) &&
+        !(caps & V4L2_CAP_VIDEO_CAPTURE)) {
+      buf_type_ = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    }
+  }
 
   return true;
 }
 
 void V4L2Device::Close() {
+  has_restore_state_ = false;
+  CloseDevice();
+}
+
+void V4L2Device::CloseDevice() {
   if (streaming_) {
-    StopStreaming();
+    StreamOff();
   }
-  CleanupMemoryMapping();
+  ReleaseBuffers();
 
   if (fd_ >= 0) {
     close(fd_);
@@ -52,16 +206,25 @@ bool V4L2Device::QueryCapabilities(struct v4l2_capability* cap) {
   return true;
 }
 
-bool V4L2Device::QueryFormats(std::vector<uint32_t>* formats) {
+bool V4L2Device::QueryFormats(std::vector<uint32_t>* formats,
+                              std::vector<FormatCapability>* format_caps) {
   formats->clear();
+  format_caps->clear();
 
   struct v4l2_fmtdesc fmt_desc;
   memset(&fmt_desc, 0, sizeof(fmt_desc));
-  fmt_desc.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  fmt_desc.type = buf_type_;
   fmt_desc.index = 0;
 
   while (ioctl(fd_, VIDIOC_ENUM_FMT, &fmt_desc) == 0) {
     formats->push_back(fmt_desc.pixelformat);
+
+    FormatCapability cap;
+    cap.pixel_format = fmt_desc.pixelformat;
+    cap.compressed = (fmt_desc.flags & V4L2_FMT_FLAG_COMPRESSED) != 0;
+    EnumFrameSizes(fmt_desc.pixelformat, &cap.sizes);
+    format_caps->push_back(cap);
+
     fmt_desc.index++;
   }
 
@@ -69,6 +232,13 @@ bool V4L2Device::QueryFormats(std::vector<uint32_t>* formats) {
 }
 
 bool V4L2Device::GetDeviceInfo(DeviceInfo* info) {
+  if (!GetCapabilities(info)) {
+    return false;
+  }
+  return QueryFormats(&info->formats, &info->format_caps);
+}
+
+bool V4L2Device::GetCapabilities(DeviceInfo* info) {
   if (!IsOpen() || !info) {
     return false;
   }
@@ -84,8 +254,11 @@ bool V4L2Device::GetDeviceInfo(DeviceInfo* info) {
   info->card_name = reinterpret_cast<const char*>(cap.card);
   info->bus_info = reinterpret_cast<const char*>(cap.bus_info);
   info->capabilities = cap.capabilities;
-
-  return QueryFormats(&info->formats);
+  info->device_caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS)
+                          ? cap.device_caps
+                          : cap.capabilities;
+  info->driver_version = cap.version;
+  return true;
 }
 
 bool V4L2Device::SetFormat(uint32_t width, uint32_t height,
@@ -94,13 +267,28 @@ bool V4L2Device::SetFormat(uint32_t width, uint32_t height,
     return false;
   }
 
+  if (FormatMatches(width, height, pixel_format)) {
+    format_width_ = width;
+    format_height_ = height;
+    format_pixel_format_ = pixel_format;
+    return true;
+  }
+
+  // 场序交给驱动决定：逐行设备返回 V4L2_FIELD_NONE
   struct v4l2_format fmt;
   memset(&fmt, 0, sizeof(fmt));
-  fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-  fmt.fmt.pix.width = width;
-  fmt.fmt.pix.height = height;
-  fmt.fmt.pix.pixelformat = pixel_format;
-  fmt.fmt.pix.field = V4L2_FIELD_INTERLACED;
+  fmt.type = buf_type_;
+  if (IsMultiPlanar()) {
+    fmt.fmt.pix_mp.width = width;
+    fmt.fmt.pix_mp.height = height;
+    fmt.fmt.pix_mp.pixelformat = pixel_format;
+    fmt.fmt.pix_mp.field = V4L2_FIELD_ANY;
+  } else {
+    fmt.fmt.pix.width = width;
+    fmt.fmt.pix.height = height;
+    fmt.fmt.pix.pixelformat = pixel_format;
+    fmt.fmt.pix.field = V4L2_FIELD_ANY;
+  }
 
   if (ioctl(fd_, VIDIOC_S_FMT, &fmt) < 0) {
     fprintf(stderr, "设置视频格式失败: %s\n", strerror(errno));
@@ -108,124 +296,753 @@ bool V4L2Device::SetFormat(uint32_t width, uint32_t height,
   }
 
   // 检查实际设置的格式（设备可能会调整格式）
-  if (fmt.fmt.pix.pixelformat != pixel_format) {
+  uint32_t actual_format = IsMultiPlanar() ? fmt.fmt.pix_mp.pixelformat
+                                           : fmt.fmt.pix.pixelformat;
+  if (actual_format != pixel_format) {
     // 不返回错误，允许设备调整格式，由调用者决定是否接受
     // 这里只打印警告
     fprintf(stderr, "警告: 设备调整了像素格式，请求: %s, 实际: %s\n",
             PixelFormatToString(pixel_format).c_str(),
-            PixelFormatToString(fmt.fmt.pix.pixelformat).c_str());
+            PixelFormatToString(actual_format).c_str());
   }
 
+  format_width_ = width;
+  format_height_ = height;
+  format_pixel_format_ = pixel_format;
   return true;
 }
 
+bool V4L2Device::FormatMatches(uint32_t width, uint32_t height,
+                               uint32_t pixel_format) {
+  struct v4l2_format fmt;
+  memset(&fmt, 0, sizeof(fmt));
+  fmt.type = buf_type_;
+  if (ioctl(fd_, VIDIOC_G_FMT, &fmt) < 0) {
+    return false;
+  }
+  if (IsMultiPlanar()) {
+    return fmt.fmt.pix_mp.width == width && fmt.fmt.pix_mp.height == height &&
+           fmt.fmt.pix_mp.pixelformat == pixel_format;
+  }
+  return fmt.fmt.pix.width == width && fmt.fmt.pix.height == height &&
+         fmt.fmt.pix.pixelformat == pixel_format;
+}
+
 bool V4L2Device::GetFormat(uint32_t* width, uint32_t* height,
                            uint32_t* pixel_format) {
-  if (!IsOpen() || !width || !height || !pixel_format) {
+  if (!width || !height || !pixel_format) {
+    return false;
+  }
+
+  VideoFormat format;
+  if (!GetFormat(&format)) {
+    return false;
+  }
+
+  *width = format.width;
+  *height = format.height;
+  *pixel_format = format.pixel_format;
+
+  return true;
+}
+
+bool V4L2Device::GetFormat(VideoFormat* format) {
+  if (!IsOpen() || !format) {
     return false;
   }
 
   struct v4l2_format fmt;
   memset(&fmt, 0, sizeof(fmt));
-  fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  fmt.type = buf_type_;
 
   if (ioctl(fd_, VIDIOC_G_FMT, &fmt) < 0) {
     fprintf(stderr, "获取视频格式失败: %s\n", strerror(errno));
     return false;
   }
 
-  *width = fmt.fmt.pix.width;
-  *height = fmt.fmt.pix.height;
-  *pixel_format = fmt.fmt.pix.pixelformat;
+  memset(format, 0, sizeof(*format));
+  if (IsMultiPlanar()) {
+    const struct v4l2_pix_format_mplane& pix = fmt.fmt.pix_mp;
+    format->width = pix.width;
+    format->height = pix.height;
+    format->pixel_format = pix.pixelformat;
+    format->field = pix.field;
+    format->plane_count =
+        std::min<uint32_t>(std::max<uint32_t>(pix.num_planes, 1),
+                           VIDEO_MAX_PLANES);
+    for (uint32_t p = 0; p < format->plane_count; ++p) {
+      format->bytesperline[p] = pix.plane_fmt[p].bytesperline;
+      format->sizeimage[p] = pix.plane_fmt[p].sizeimage;
+    }
+  } else {
+    format->width = fmt.fmt.pix.width;
+    format->height = fmt.fmt.pix.height;
+    format->pixel_format = fmt.fmt.pix.pixelformat;
+    format->field = fmt.fmt.pix.field;
+    format->plane_count = 1;
+    format->bytesperline[0] = fmt.fmt.pix.bytesperline;
+    format->sizeimage[0] = fmt.fmt.pix.sizeimage;
+  }
 
   return true;
 }
 
-bool V4L2Device::InitMemoryMapping(uint32_t buffer_count) {
-  if (!IsOpen()) {
+bool V4L2Device::CheckSinglePlane() {
+  if (!IsMultiPlanar()) {
+    return true;
+  }
+  VideoFormat format;
+  if (!GetFormat(&format)) {
     return false;
   }
+  if (format.plane_count > 1) {
+    fprintf(stderr, "格式 %s 有 %u 个内存平面，只能使用 InitMemoryMapping\n",
+            PixelFormatToString(format.pixel_format).c_str(),
+            format.plane_count);
+    return false;
+  }
+  return true;
+}
 
-  CleanupMemoryMapping();
-
+uint32_t V4L2Device::RequestBuffers(uint32_t buffer_count, uint32_t memory) {
   struct v4l2_requestbuffers req;
   memset(&req, 0, sizeof(req));
   req.count = buffer_count;
-  req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-  req.memory = V4L2_MEMORY_MMAP;
+  req.type = buf_type_;
+  req.memory = memory;
 
   if (ioctl(fd_, VIDIOC_REQBUFS, &req) < 0) {
     fprintf(stderr, "请求缓冲区失败: %s\n", strerror(errno));
-    return false;
+    return 0;
   }
 
   if (req.count < 2) {
     fprintf(stderr, "缓冲区数量不足\n");
+    return 0;
+  }
+
+  memory_ = memory;
+  return req.count;
+}
+
+namespace {
+
+// 驱动报告连续/步进范围时，从这些常用分辨率和帧率中挑选范围内的值
+constexpr uint32_t kCommonSizes[][2] = {
+    {320, 240},   {640, 480},   {800, 600},   {1280, 720},
+    {1280, 960},  {1920, 1080}, {2560, 1440}, {3840, 2160},
+};
+constexpr uint32_t kCommonFps[] = {120, 60, 50, 30, 25, 24, 15, 10, 5};
+
+bool InStepRange(uint32_t value, uint32_t min, uint32_t max, uint32_t step) {
+  return value >= min && value <= max &&
+         (step <= 1 || (value - min) % step == 0);
+}
+
+// 按帧率从高到低（即帧间隔从小到大）排序
+bool IntervalLess(const FrameInterval& a, const FrameInterval& b) {
+  return static_cast<uint64_t>(a.numerator) * b.denominator <
+         static_cast<uint64_t>(b.numerator) * a.denominator;
+}
+
+// 初始化为无平面的空缓冲区
+void InitFrameBuffer(FrameBuffer* buffer, uint32_t index) {
+  memset(buffer, 0, sizeof(*buffer));
+  buffer->index = index;
+  buffer->dmabuf_fd = -1;
+  for (auto& plane : buffer->planes) {
+    plane.dmabuf_fd = -1;
+  }
+}
+
+// 设置单内存平面缓冲区，start/length/dmabuf_fd 与 planes[0] 保持一致
+void SetPrimaryPlane(FrameBuffer* buffer, void* start, size_t length,
+                     int dmabuf_fd) {
+  buffer->plane_count = 1;
+  buffer->planes[0].start = start;
+  buffer->planes[0].length = length;
+  buffer->planes[0].dmabuf_fd = dmabuf_fd;
+  buffer->start = start;
+  buffer->length = length;
+  buffer->dmabuf_fd = dmabuf_fd;
+}
+
+}  // namespace
+
+bool V4L2Device::EnumFrameSizes(uint32_t pixel_format,
+                                std::vector<FrameSize>* sizes) {
+  if (!IsOpen() || !sizes) {
+    return false;
+  }
+  sizes->clear();
+
+  struct v4l2_frmsizeenum frmsize;
+  memset(&frmsize, 0, sizeof(frmsize));
+  frmsize.pixel_format = pixel_format;
+  frmsize.index = 0;
+
+  while (ioctl(fd_, VIDIOC_ENUM_FRAMESIZES, &frmsize) == 0) {
+    if (frmsize.type == V4L2_FRMSIZE_TYPE_DISCRETE) {
+      FrameSize size;
+      size.width = frmsize.discrete.width;
+      size.height = frmsize.discrete.height;
+      sizes->push_back(size);
+      frmsize.index++;
+      continue;
+    }
+
+    // 连续/步进范围只有一项，展开为范围内的常用分辨率加最大分辨率
+    const struct v4l2_frmsize_stepwise& range = frmsize.stepwise;
+    for (const auto& common : kCommonSizes) {
+      if (InStepRange(common[0], range.min_width, range.max_width,
+                      range.step_width) &&
+          InStepRange(common[1], range.min_height, range.max_height,
+                      range.step_height)) {
+        sizes->push_back(FrameSize{common[0], common[1], {}});
+      }
+    }
+    if (sizes->empty() || sizes->back().width != range.max_width ||
+        sizes->back().height != range.max_height) {
+      sizes->push_back(FrameSize{range.max_width, range.max_height, {}});
+    }
+    break;
+  }
+
+  for (auto& size : *sizes) {
+    EnumFrameIntervals(pixel_format, size.width, size.height,
+                       &size.intervals);
+  }
+  return !sizes->empty();
+}
+
+bool V4L2Device::EnumFrameIntervals(uint32_t pixel_format, uint32_t width,
+                                    uint32_t height,
+                                    std::vector<FrameInterval>* intervals) {
+  if (!IsOpen() || !intervals) {
+    return false;
+  }
+  intervals->clear();
+
+  struct v4l2_frmivalenum frmival;
+  memset(&frmival, 0, sizeof(frmival));
+  frmival.pixel_format = pixel_format;
+  frmival.width = width;
+  frmival.height = height;
+  frmival.index = 0;
+
+  while (ioctl(fd_, VIDIOC_ENUM_FRAMEINTERVALS, &frmival) == 0) {
+    if (frmival.type == V4L2_FRMIVAL_TYPE_DISCRETE) {
+      intervals->push_back(
+          FrameInterval{frmival.discrete.numerator,
+                        frmival.discrete.denominator});
+      frmival.index++;
+      continue;
+    }
+
+    // 连续/步进范围：取范围内的常用帧率，以及最高帧率（最小间隔）
+    FrameInterval fastest{frmival.stepwise.min.numerator,
+                          frmival.stepwise.min.denominator};
+    FrameInterval slowest{frmival.stepwise.max.numerator,
+                          frmival.stepwise.max.denominator};
+    intervals->push_back(fastest);
+    for (uint32_t fps : kCommonFps) {
+      FrameInterval interval{1, fps};
+      if (IntervalLess(fastest, interval) && !IntervalLess(slowest, interval)) {
+        intervals->push_back(interval);
+      }
+    }
+    break;
+  }
+
+  std::sort(intervals->begin(), intervals->end(), IntervalLess);
+  return !intervals->empty();
+}
+
+bool V4L2Device::SetFrameInterval(const FrameInterval& interval,
+                                  FrameInterval* actual) {
+  if (!IsOpen() || interval.numerator == 0 || interval.denominator == 0) {
+    return false;
+  }
+
+  struct v4l2_streamparm parm;
+  memset(&parm, 0, sizeof(parm));
+  parm.type = buf_type_;
+  if (ioctl(fd_, VIDIOC_G_PARM, &parm) < 0 ||
+      !(parm.parm.capture.capability & V4L2_CAP_TIMEPERFRAME)) {
+    fprintf(stderr, "设备不支持设置帧率\n");
+    return false;
+  }
+
+  parm.parm.capture.timeperframe.numerator = interval.numerator;
+  parm.parm.capture.timeperframe.denominator = interval.denominator;
+  if (ioctl(fd_, VIDIOC_S_PARM, &parm) < 0) {
+    fprintf(stderr, "设置帧率失败: %s\n", strerror(errno));
+    return false;
+  }
+
+  frame_interval_.numerator = parm.parm.capture.timeperframe.numerator;
+  frame_interval_.denominator = parm.parm.capture.timeperframe.denominator;
+  if (actual) {
+    *actual = frame_interval_;
+  }
+  return true;
+}
+
+bool V4L2Device::GetFrameInterval(FrameInterval* interval) {
+  if (!IsOpen() || !interval) {
+    return false;
+  }
+
+  struct v4l2_streamparm parm;
+  memset(&parm, 0, sizeof(parm));
+  parm.type = buf_type_;
+  if (ioctl(fd_, VIDIOC_G_PARM, &parm) < 0) {
+    fprintf(stderr, "获取帧率失败: %s\n", strerror(errno));
+    return false;
+  }
+
+  interval->numerator = parm.parm.capture.timeperframe.numerator;
+  interval->denominator = parm.parm.capture.timeperframe.denominator;
+  return true;
+}
+
+bool V4L2Device::QueryControls(std::vector<ControlInfo>* controls) {
+  if (!IsOpen() || !controls) {
+    return false;
+  }
+  controls->clear();
+
+  struct v4l2_query_ext_ctrl query;
+  memset(&query, 0, sizeof(query));
+  query.id = V4L2_CTRL_FLAG_NEXT_CTRL | V4L2_CTRL_FLAG_NEXT_COMPOUND;
+  while (ioctl(fd_, VIDIOC_QUERY_EXT_CTRL, &query) == 0) {
+    bool usable = !(query.flags & (V4L2_CTRL_FLAG_DISABLED |
+                                   V4L2_CTRL_FLAG_HAS_PAYLOAD)) &&
+                  query.type != V4L2_CTRL_TYPE_CTRL_CLASS &&
+                  query.type != V4L2_CTRL_TYPE_STRING;
+    if (usable) {
+      ControlInfo info;
+      info.id = query.id;
+      info.type = query.type;
+      info.name = query.name;
+      info.minimum = query.minimum;
+      info.maximum = query.maximum;
+      info.step = query.step;
+      info.default_value = query.default_value;
+      info.flags = query.flags;
+      if (query.type == V4L2_CTRL_TYPE_MENU ||
+          query.type == V4L2_CTRL_TYPE_INTEGER_MENU) {
+        // 菜单索引可以不连续，驱动对不存在的索引返回 EINVAL
+        for (int64_t i = query.minimum; i <= query.maximum; ++i) {
+          struct v4l2_querymenu item;
+          memset(&item, 0, sizeof(item));
+          item.id = query.id;
+          item.index = static_cast<uint32_t>(i);
+          if (ioctl(fd_, VIDIOC_QUERYMENU, &item) < 0) {
+            continue;
+          }
+          info.menu.push_back(ControlMenuItem{
+              i, query.type == V4L2_CTRL_TYPE_MENU
+                     ? std::string(reinterpret_cast<const char*>(item.name))
+                     : std::to_string(static_cast<int64_t>(item.value))});
+        }
+      }
+      controls->push_back(info);
+    }
+    query.id |= V4L2_CTRL_FLAG_NEXT_CTRL | V4L2_CTRL_FLAG_NEXT_COMPOUND;
+  }
+
+  if (errno != EINVAL) {
+    fprintf(stderr, "查询控制项失败: %s\n", strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+bool V4L2Device::GetControls(struct v4l2_ext_control* controls,
+                             uint32_t count) {
+  if (!IsOpen() || !controls || count == 0) {
+    return false;
+  }
+
+  struct v4l2_ext_controls ext;
+  memset(&ext, 0, sizeof(ext));
+  ext.which = V4L2_CTRL_WHICH_CUR_VAL;
+  ext.count = count;
+  ext.controls = controls;
+  if (ioctl(fd_, VIDIOC_G_EXT_CTRLS, &ext) < 0) {
+    fprintf(stderr, "读取控制项失败: %s\n", strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+bool V4L2Device::SetControls(struct v4l2_ext_control* controls,
+                             uint32_t count, uint32_t* error_index) {
+  if (!IsOpen() || !controls || count == 0) {
+    return false;
+  }
+
+  // which = CUR_VAL 允许同一批中混合不同控制类
+  struct v4l2_ext_controls ext;
+  memset(&ext, 0, sizeof(ext));
+  ext.which = V4L2_CTRL_WHICH_CUR_VAL;
+  ext.count = count;
+  ext.controls = controls;
+  if (ioctl(fd_, VIDIOC_S_EXT_CTRLS, &ext) < 0) {
+    fprintf(stderr, "设置控制项失败: %s\n", strerror(errno));
+    if (error_index) {
+      *error_index = ext.error_idx;
+    }
+    return false;
+  }
+  return true;
+}
+
+// 选择 API 对多平面队列使用单平面类型（老内核只接受单平面类型，
+// 4.13 之后两者等价）
+bool V4L2Device::SetSelection(uint32_t target, const struct v4l2_rect& rect,
+                              struct v4l2_rect* actual) {
+  if (!IsOpen()) {
+    return false;
+  }
+
+  struct v4l2_selection selection;
+  memset(&selection, 0, sizeof(selection));
+  selection.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  selection.target = target;
+  selection.r = rect;
+  if (ioctl(fd_, VIDIOC_S_SELECTION, &selection) < 0) {
+    if (errno != ENOTTY && errno != EINVAL && errno != ENODATA) {
+      fprintf(stderr, "设置选择区域失败: %s\n", strerror(errno));
+    }
+    return false;
+  }
+
+  if (actual) {
+    *actual = selection.r;
+  }
+  return true;
+}
+
+bool V4L2Device::GetSelection(uint32_t target, struct v4l2_rect* rect) {
+  if (!IsOpen() || !rect) {
+    return false;
+  }
+
+  struct v4l2_selection selection;
+  memset(&selection, 0, sizeof(selection));
+  selection.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  selection.target = target;
+  if (ioctl(fd_, VIDIOC_G_SELECTION, &selection) < 0) {
+    if (errno != ENOTTY && errno != EINVAL && errno != ENODATA) {
+      fprintf(stderr, "获取选择区域失败: %s\n", strerror(errno));
+    }
+    return false;
+  }
+
+  *rect = selection.r;
+  return true;
+}
+
+bool V4L2Device::CanReuseBuffers(uint32_t buffer_count) {
+  if (memory_ != V4L2_MEMORY_MMAP || buffers_.empty() || streaming_ ||
+      buffer_count != requested_buffer_count_ || leased_buffers_.load() > 0) {
+    return false;
+  }
+
+  // 格式改变后 sizeimage 或平面数可能变化，已映射的缓冲区不再适用
+  VideoFormat format;
+  if (!GetFormat(&format)) {
+    return false;
+  }
+  for (const FrameBuffer& buffer : buffers_) {
+    if (buffer.plane_count != format.plane_count) {
+      return false;
+    }
+    for (uint32_t p = 0; p < buffer.plane_count; ++p) {
+      if (buffer.planes[p].length < format.sizeimage[p]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool V4L2Device::InitMemoryMapping(uint32_t buffer_count) {
+  if (!IsOpen()) {
     return false;
   }
+  if (!exported_dmabuf_ && CanReuseBuffers(buffer_count)) {
+    return true;
+  }
 
-  buffers_.resize(req.count);
+  ReleaseBuffers();
+
+  uint32_t count = RequestBuffers(buffer_count, V4L2_MEMORY_MMAP);
+  if (count == 0) {
+    return false;
+  }
+
+  buffers_.resize(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    InitFrameBuffer(&buffers_[i], i);
+  }
 
-  // 映射每个缓冲区
-  for (uint32_t i = 0; i < req.count; ++i) {
+  // 映射每个缓冲区；多平面 API 下每个平面有独立的偏移，逐平面映射
+  for (uint32_t i = 0; i < count; ++i) {
+    struct v4l2_plane planes[VIDEO_MAX_PLANES];
     struct v4l2_buffer buf;
     memset(&buf, 0, sizeof(buf));
-    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.type = buf_type_;
     buf.memory = V4L2_MEMORY_MMAP;
     buf.index = i;
+    if (IsMultiPlanar()) {
+      memset(planes, 0, sizeof(planes));
+      buf.m.planes = planes;
+      buf.length = VIDEO_MAX_PLANES;
+    }
 
     if (ioctl(fd_, VIDIOC_QUERYBUF, &buf) < 0) {
       fprintf(stderr, "查询缓冲区 %u 失败: %s\n", i, strerror(errno));
-      CleanupMemoryMapping();
+      ReleaseBuffers();
       return false;
     }
 
-    buffers_[i].length = buf.length;
-    buffers_[i].index = i;
-    buffers_[i].start =
-        mmap(nullptr, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd_,
-             buf.m.offset);
+    FrameBuffer& buffer = buffers_[i];
+    buffer.plane_count = IsMultiPlanar() ? buf.length : 1;
+    for (uint32_t p = 0; p < buffer.plane_count; ++p) {
+      size_t length = IsMultiPlanar() ? planes[p].length : buf.length;
+      off_t offset = IsMultiPlanar() ? planes[p].m.mem_offset : buf.m.offset;
+      int flags = MAP_SHARED | (prefault_buffers_ ? MAP_POPULATE : 0);
+      void* start =
+          mmap(nullptr, length, PROT_READ | PROT_WRITE, flags, fd_, offset);
+      if (start == MAP_FAILED) {
+        fprintf(stderr, "映射缓冲区 %u 平面 %u 失败: %s\n", i, p,
+                strerror(errno));
+        ReleaseBuffers();
+        return false;
+      }
+      buffer.planes[p].start = start;
+      buffer.planes[p].length = length;
+      if (prefault_buffers_) {
+        PrefaultMemory(start, length);
+      }
+    }
+    buffer.start = buffer.planes[0].start;
+    buffer.length = buffer.planes[0].length;
+  }
 
-    if (buffers_[i].start == MAP_FAILED) {
-      fprintf(stderr, "映射缓冲区 %u 失败: %s\n", i, strerror(errno));
-      CleanupMemoryMapping();
-      return false;
+  requested_buffer_count_ = buffer_count;
+  return true;
+}
+
+bool V4L2Device::InitDmaBuf(uint32_t buffer_count) {
+  if (exported_dmabuf_ && CanReuseBuffers(buffer_count)) {
+    return true;
+  }
+  // 可复用的未导出映射直接在其上导出
+  if (!InitMemoryMapping(buffer_count)) {
+    return false;
+  }
+
+  // 将每个内存映射缓冲区的每个平面导出为 DMABUF
+  for (uint32_t i = 0; i < buffers_.size(); ++i) {
+    FrameBuffer& buffer = buffers_[i];
+    for (uint32_t p = 0; p < buffer.plane_count; ++p) {
+      struct v4l2_exportbuffer expbuf;
+      memset(&expbuf, 0, sizeof(expbuf));
+      expbuf.type = buf_type_;
+      expbuf.index = i;
+      expbuf.plane = p;
+      expbuf.flags = O_RDWR | O_CLOEXEC;
+
+      if (ioctl(fd_, VIDIOC_EXPBUF, &expbuf) < 0) {
+        fprintf(stderr, "导出缓冲区 %u 为 DMABUF 失败: %s\n", i,
+                strerror(errno));
+        ReleaseBuffers();
+        return false;
+      }
+      buffer.planes[p].dmabuf_fd = expbuf.fd;
     }
+    buffer.dmabuf_fd = buffer.planes[0].dmabuf_fd;
+  }
+
+  exported_dmabuf_ = true;
+  return true;
+}
+
+bool V4L2Device::ImportDmaBuf(const std::vector<int>& dmabuf_fds,
+                              size_t length) {
+  if (!IsOpen() || dmabuf_fds.empty()) {
+    return false;
+  }
+
+  ReleaseBuffers();
+  if (!CheckSinglePlane()) {
+    return false;
+  }
+
+  uint32_t count = RequestBuffers(dmabuf_fds.size(), V4L2_MEMORY_DMABUF);
+  if (count == 0) {
+    return false;
+  }
+  if (count > dmabuf_fds.size()) {
+    fprintf(stderr, "驱动要求 %u 个缓冲区，但只提供了 %zu 个 DMABUF\n",
+            count, dmabuf_fds.size());
+    ReleaseBuffers();
+    return false;
+  }
+
+  buffers_.resize(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    // 尝试映射供 CPU 访问；部分导出者不支持 mmap，此时只能零拷贝转交
+    void* start = mmap(nullptr, length, PROT_READ, MAP_SHARED,
+                       dmabuf_fds[i], 0);
+    InitFrameBuffer(&buffers_[i], i);
+    SetPrimaryPlane(&buffers_[i], start == MAP_FAILED ? nullptr : start,
+                    length, dmabuf_fds[i]);
   }
 
   return true;
 }
 
+bool V4L2Device::InitUserPtr(const std::vector<void*>& buffers, size_t length,
+                             uint32_t driver_buffer_count) {
+  if (!IsOpen() || buffers.empty() || driver_buffer_count == 0) {
+    return false;
+  }
+
+  ReleaseBuffers();
+
+  if (!CheckSinglePlane()) {
+    return false;
+  }
+  if (driver_buffer_count > buffers.size()) {
+    driver_buffer_count = buffers.size();
+  }
+  uint32_t count = RequestBuffers(driver_buffer_count, V4L2_MEMORY_USERPTR);
+  if (count == 0) {
+    return false;
+  }
+  if (count > buffers.size()) {
+    fprintf(stderr, "驱动要求 %u 个缓冲区，但只提供了 %zu 个\n", count,
+            buffers.size());
+    ReleaseBuffers();
+    return false;
+  }
+
+  buffers_.resize(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    InitFrameBuffer(&buffers_[i], i);
+    SetPrimaryPlane(&buffers_[i], buffers[i], length, -1);
+  }
+
+  std::lock_guard<std::mutex> lock(spare_mutex_);
+  spare_buffers_.assign(buffers.begin() + count, buffers.end());
+  return true;
+}
+
+void V4L2Device::ReturnSpareBuffer(void* buffer) {
+  std::lock_guard<std::mutex> lock(spare_mutex_);
+  spare_buffers_.push_back(buffer);
+}
+
 void V4L2Device::CleanupMemoryMapping() {
+  restore_buffer_count_ = 0;
+  ReleaseBuffers();
+}
+
+void V4L2Device::ReleaseBuffers() {
+  if (leased_buffers_.load() > 0) {
+    fprintf(stderr, "警告: 仍有 %u 个缓冲区被租约持有，映射即将失效\n",
+            leased_buffers_.load());
+  }
   for (auto& buffer : buffers_) {
-    if (buffer.start && buffer.start != MAP_FAILED) {
-      munmap(buffer.start, buffer.length);
+    for (uint32_t p = 0; p < buffer.plane_count; ++p) {
+      FramePlane& plane = buffer.planes[p];
+      // USERPTR 的内存归调用者所有，不能 munmap
+      if (memory_ != V4L2_MEMORY_USERPTR && plane.start &&
+          plane.start != MAP_FAILED) {
+        munmap(plane.start, plane.length);
+      }
+      // 导出的 DMABUF 由本设备持有；导入的 DMABUF 归调用者所有
+      if (memory_ == V4L2_MEMORY_MMAP && plane.dmabuf_fd >= 0) {
+        close(plane.dmabuf_fd);
+      }
     }
   }
+  // 释放驱动侧的缓冲区，之后才能设置不同的格式（仍被 mmap 的缓冲区由
+  // 驱动延后释放）
+  if (!buffers_.empty() && fd_ >= 0 && !streaming_) {
+    struct v4l2_requestbuffers req;
+    memset(&req, 0, sizeof(req));
+    req.type = buf_type_;
+    req.memory = memory_;
+    ioctl(fd_, VIDIOC_REQBUFS, &req);
+  }
   buffers_.clear();
+  requested_buffer_count_ = 0;
+  exported_dmabuf_ = false;
+
+  std::lock_guard<std::mutex> lock(spare_mutex_);
+  spare_buffers_.clear();
+}
+
+void V4L2Device::BeginCpuAccess(uint32_t index) {
+  if (memory_ != V4L2_MEMORY_DMABUF || index >= buffers_.size() ||
+      !buffers_[index].start) {
+    return;
+  }
+  struct dma_buf_sync sync;
+  sync.flags = DMA_BUF_SYNC_START | DMA_BUF_SYNC_READ;
+  ioctl(buffers_[index].dmabuf_fd, DMA_BUF_IOCTL_SYNC, &sync);
+}
+
+void V4L2Device::EndCpuAccess(uint32_t index) {
+  if (memory_ != V4L2_MEMORY_DMABUF || index >= buffers_.size() ||
+      !buffers_[index].start) {
+    return;
+  }
+  struct dma_buf_sync sync;
+  sync.flags = DMA_BUF_SYNC_END | DMA_BUF_SYNC_READ;
+  ioctl(buffers_[index].dmabuf_fd, DMA_BUF_IOCTL_SYNC, &sync);
 }
 
 bool V4L2Device::StartStreaming() {
+  frames_ = 0;
+  dropped_frames_ = 0;
+  error_frames_ = 0;
+  short_frames_ = 0;
+  return StreamOn();
+}
+
+bool V4L2Device::StreamOn() {
   if (!IsOpen() || buffers_.empty()) {
     return false;
   }
 
   // 将所有缓冲区入队
   for (uint32_t i = 0; i < buffers_.size(); ++i) {
-    struct v4l2_buffer buf;
-    memset(&buf, 0, sizeof(buf));
-    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    buf.memory = V4L2_MEMORY_MMAP;
-    buf.index = i;
-
-    if (ioctl(fd_, VIDIOC_QBUF, &buf) < 0) {
-      fprintf(stderr, "缓冲区 %u 入队失败: %s\n", i, strerror(errno));
+    if (!QueueBuffer(i)) {
       return false;
     }
   }
 
+  // 记录期望的帧大小（各平面之和），压缩格式（bytesperline 为 0）的帧长
+  // 可变，不检查
+  VideoFormat format;
+  expected_frame_size_ = 0;
+  if (GetFormat(&format) && format.bytesperline[0] != 0) {
+    for (uint32_t p = 0; p < format.plane_count; ++p) {
+      expected_frame_size_ += format.sizeimage[p];
+    }
+  }
+  has_sequence_ = false;
+  last_error_ = 0;
+
   // 开始流式传输
-  enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  enum v4l2_buf_type type = static_cast<enum v4l2_buf_type>(buf_type_);
   if (ioctl(fd_, VIDIOC_STREAMON, &type) < 0) {
     fprintf(stderr, "启动流式传输失败: %s\n", strerror(errno));
     return false;
@@ -236,11 +1053,16 @@ bool V4L2Device::StartStreaming() {
 }
 
 bool V4L2Device::StopStreaming() {
+  restore_streaming_ = false;
+  return StreamOff();
+}
+
+bool V4L2Device::StreamOff() {
   if (!streaming_) {
     return true;
   }
 
-  enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  enum v4l2_buf_type type = static_cast<enum v4l2_buf_type>(buf_type_);
   if (ioctl(fd_, VIDIOC_STREAMOFF, &type) < 0) {
     fprintf(stderr, "停止流式传输失败: %s\n", strerror(errno));
     return false;
@@ -250,15 +1072,136 @@ bool V4L2Device::StopStreaming() {
   return true;
 }
 
-bool V4L2Device::ReadFrame(void** frame_data, size_t* frame_size) {
+bool V4L2Device::RestartStreaming() {
+  if (!IsOpen() || buffers_.empty()) {
+    return false;
+  }
+  if (leased_buffers_.load() > 0) {
+    fprintf(stderr, "仍有 %u 个缓冲区被租约持有，无法重启视频流\n",
+            leased_buffers_.load());
+    return false;
+  }
+
+  // 不论当前是否在流式传输都 STREAMOFF：租约在出错后释放时缓冲区可能已
+  // 入队，STREAMOFF 把所有缓冲区收回，之后才能全部重新入队
+  enum v4l2_buf_type type = static_cast<enum v4l2_buf_type>(buf_type_);
+  if (ioctl(fd_, VIDIOC_STREAMOFF, &type) < 0) {
+    fprintf(stderr, "停止流式传输失败: %s\n", strerror(errno));
+    return false;
+  }
+  streaming_ = false;
+  if (!StreamOn()) {
+    return false;
+  }
+  has_restore_state_ = false;
+  return true;
+}
+
+void V4L2Device::SaveRestoreState() {
+  restore_buffer_count_ = buffers_.empty() ? 0 : requested_buffer_count_;
+  restore_dmabuf_ = exported_dmabuf_;
+  restore_streaming_ = streaming_;
+  has_restore_state_ = true;
+}
+
+bool V4L2Device::Reopen() {
+  if (device_path_.empty()) {
+    return false;
+  }
+  if (leased_buffers_.load() > 0) {
+    fprintf(stderr, "仍有 %u 个缓冲区被租约持有，无法重新打开设备\n",
+            leased_buffers_.load());
+    return false;
+  }
+  if (!buffers_.empty() && memory_ != V4L2_MEMORY_MMAP) {
+    fprintf(stderr, "USERPTR/导入 DMABUF 的缓冲区需要由调用者重新提供\n");
+    return false;
+  }
+
+  // 关闭设备会清除缓冲区与流状态；上一次失败的尝试已经清除过，
+  // 因此恢复目标只取自保存的状态，不取自当前成员
+  if (!has_restore_state_) {
+    SaveRestoreState();
+  }
+  std::string path = device_path_;
+  uint32_t width = format_width_;
+  uint32_t height = format_height_;
+  uint32_t pixel_format = format_pixel_format_;
+  FrameInterval interval = frame_interval_;
+
+  // 设备已断开时 STREAMOFF 必然失败，直接放弃流状态
+  streaming_ = false;
+  CloseDevice();
+  if (!Open(path)) {
+    return false;
+  }
+  if (pixel_format != 0 && !SetFormat(width, height, pixel_format)) {
+    return false;
+  }
+  if (interval.numerator != 0) {
+    SetFrameInterval(interval);
+  }
+  if (restore_buffer_count_ > 0 &&
+      !(restore_dmabuf_ ? InitDmaBuf(restore_buffer_count_)
+                        : InitMemoryMapping(restore_buffer_count_))) {
+    return false;
+  }
+  if (restore_streaming_ && !StreamOn()) {
+    return false;
+  }
+  has_restore_state_ = false;
+  return true;
+}
+
+bool V4L2Device::WaitForFrame(int timeout_ms) {
+  if (!IsOpen() || !streaming_) {
+    return false;
+  }
+
+  struct pollfd pfd;
+  pfd.fd = fd_;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+
+  int ret;
+  do {
+    ret = poll(&pfd, 1, timeout_ms);
+  } while (ret < 0 && errno == EINTR);
+
+  if (ret < 0) {
+    fprintf(stderr, "等待帧失败: %s\n", strerror(errno));
+    return false;
+  }
+  if (ret == 0) {
+    return false;  // 超时
+  }
+  if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+    return false;
+  }
+  return (pfd.revents & POLLIN) != 0;
+}
+
+bool V4L2Device::DequeueFrame(FrameLease* lease) {
+  if (!lease) {
+    return false;
+  }
+  lease->Release();
+  last_error_ = 0;
+
   if (!IsOpen() || !streaming_) {
     return false;
   }
 
+  struct v4l2_plane planes[VIDEO_MAX_PLANES];
   struct v4l2_buffer buf;
   memset(&buf, 0, sizeof(buf));
-  buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-  buf.memory = V4L2_MEMORY_MMAP;
+  buf.type = buf_type_;
+  buf.memory = memory_;
+  if (IsMultiPlanar()) {
+    memset(planes, 0, sizeof(planes));
+    buf.m.planes = planes;
+    buf.length = VIDEO_MAX_PLANES;
+  }
 
   // 从队列中取出一个已填充的缓冲区
   if (ioctl(fd_, VIDIOC_DQBUF, &buf) < 0) {
@@ -266,6 +1209,7 @@ bool V4L2Device::ReadFrame(void** frame_data, size_t* frame_size) {
       // 没有可用的帧，非阻塞模式正常情况
       return false;
     }
+    last_error_ = errno;
     fprintf(stderr, "出队缓冲区失败: %s\n", strerror(errno));
     return false;
   }
@@ -275,28 +1219,156 @@ bool V4L2Device::ReadFrame(void** frame_data, size_t* frame_size) {
     return false;
   }
 
-  *frame_data = buffers_[buf.index].start;
-  *frame_size = buf.bytesused;
-
-  // 将缓冲区重新入队
-  if (ioctl(fd_, VIDIOC_QBUF, &buf) < 0) {
-    fprintf(stderr, "重新入队缓冲区失败: %s\n", strerror(errno));
-    return false;
+  // USERPTR 模式下有备用缓冲区时立即换入并重新入队，租约持有的
+  // 是被换出的内存，驱动侧始终保持满额缓冲区
+  if (memory_ == V4L2_MEMORY_USERPTR) {
+    void* filled = reinterpret_cast<void*>(
+        IsMultiPlanar() ? planes[0].m.userptr : buf.m.userptr);
+    void* spare = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(spare_mutex_);
+      if (!spare_buffers_.empty()) {
+        spare = spare_buffers_.back();
+        spare_buffers_.pop_back();
+      }
+    }
+    if (spare) {
+      FrameBuffer& buffer = buffers_[buf.index];
+      SetPrimaryPlane(&buffer, spare, buffer.length, -1);
+      if (QueueBuffer(buf.index)) {
+        FillLease(lease, buf, filled);
+        lease->detached_buffer_ = filled;
+        return true;
+      }
+      // 换入失败，恢复原缓冲区，按普通租约处理
+      SetPrimaryPlane(&buffer, filled, buffer.length, -1);
+      ReturnSpareBuffer(spare);
+    }
   }
 
+  // 缓冲区保持出队状态，由租约释放时重新入队
+  BeginCpuAccess(buf.index);
+  FillLease(lease, buf, buffers_[buf.index].start);
+  lease->dmabuf_fd_ = buffers_[buf.index].dmabuf_fd;
+  leased_buffers_.fetch_add(1);
+
   return true;
 }
 
+void V4L2Device::FillLease(FrameLease* lease, const struct v4l2_buffer& buf,
+                           const void* data) {
+  lease->device_ = this;
+  size_t total_bytes = 0;
+  if (IsMultiPlanar()) {
+    // 多平面：每个平面的有效数据从 data_offset 开始，bytesused 包含偏移
+    const FrameBuffer& buffer = buffers_[buf.index];
+    lease->plane_count_ = std::min(buf.length, buffer.plane_count);
+    for (uint32_t p = 0; p < lease->plane_count_; ++p) {
+      const struct v4l2_plane& plane = buf.m.planes[p];
+      const uint8_t* start = static_cast<const uint8_t*>(
+          p == 0 ? data : buffer.planes[p].start);
+      uint32_t offset = std::min(plane.data_offset, plane.bytesused);
+      lease->plane_data_[p] = start ? start + offset : nullptr;
+      lease->plane_size_[p] = plane.bytesused - offset;
+      total_bytes += lease->plane_size_[p];
+    }
+  } else {
+    lease->plane_count_ = 1;
+    lease->plane_data_[0] = data;
+    lease->plane_size_[0] = buf.bytesused;
+    total_bytes = buf.bytesused;
+  }
+  lease->data_ = lease->plane_data_[0];
+  lease->bytesused_ = lease->plane_size_[0];
+  lease->index_ = buf.index;
+  lease->sequence_ = buf.sequence;
+  lease->flags_ = buf.flags;
+  lease->timestamp_ = buf.timestamp;
+  lease->dequeue_time_us_ = MonotonicMicros();
+  TrackDrops(buf, total_bytes);
+
+  if (latency_tracker_ && lease->HasMonotonicTimestamp()) {
+    int64_t latency = lease->dequeue_time_us_ - lease->timestamp_us();
+    latency_tracker_->sensor_to_dequeue.Record(latency > 0 ? latency : 0);
+  }
+}
+
+void V4L2Device::TrackDrops(const struct v4l2_buffer& buf, size_t bytesused) {
+  frames_.fetch_add(1, std::memory_order_relaxed);
+
+  // 序号为 32 位无符号数，回绕后差值仍然正确
+  if (has_sequence_) {
+    uint32_t gap = buf.sequence - last_sequence_;
+    if (gap > 1) {
+      dropped_frames_.fetch_add(gap - 1, std::memory_order_relaxed);
+      if (drop_callback_) {
+        drop_callback_(DropEvent{DropReason::kSequenceGap, buf.sequence,
+                                 gap - 1, static_cast<uint32_t>(bytesused)});
+      }
+    }
+  }
+  has_sequence_ = true;
+  last_sequence_ = buf.sequence;
+
+  if (buf.flags & V4L2_BUF_FLAG_ERROR) {
+    error_frames_.fetch_add(1, std::memory_order_relaxed);
+    if (drop_callback_) {
+      drop_callback_(DropEvent{DropReason::kBufferError, buf.sequence, 1,
+                               static_cast<uint32_t>(bytesused)});
+    }
+  }
+
+  if (expected_frame_size_ != 0 && bytesused < expected_frame_size_) {
+    short_frames_.fetch_add(1, std::memory_order_relaxed);
+    if (drop_callback_) {
+      drop_callback_(DropEvent{DropReason::kShortFrame, buf.sequence, 1,
+                               static_cast<uint32_t>(bytesused)});
+    }
+  }
+}
+
+void V4L2Device::GetDropStats(DropStats* stats) const {
+  if (!stats) {
+    return;
+  }
+  stats->frames = frames_.load(std::memory_order_relaxed);
+  stats->dropped = dropped_frames_.load(std::memory_order_relaxed);
+  stats->error_frames = error_frames_.load(std::memory_order_relaxed);
+  stats->short_frames = short_frames_.load(std::memory_order_relaxed);
+}
+
 bool V4L2Device::QueueBuffer(uint32_t index) {
   if (index >= buffers_.size()) {
     return false;
   }
 
+  const FrameBuffer& buffer = buffers_[index];
+  struct v4l2_plane planes[VIDEO_MAX_PLANES];
   struct v4l2_buffer buf;
   memset(&buf, 0, sizeof(buf));
-  buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-  buf.memory = V4L2_MEMORY_MMAP;
+  buf.type = buf_type_;
+  buf.memory = memory_;
   buf.index = index;
+  if (IsMultiPlanar()) {
+    memset(planes, 0, sizeof(planes));
+    for (uint32_t p = 0; p < buffer.plane_count; ++p) {
+      if (memory_ == V4L2_MEMORY_DMABUF) {
+        planes[p].m.fd = buffer.planes[p].dmabuf_fd;
+      } else if (memory_ == V4L2_MEMORY_USERPTR) {
+        planes[p].m.userptr =
+            reinterpret_cast<unsigned long>(buffer.planes[p].start);
+      }
+      planes[p].length = buffer.planes[p].length;
+    }
+    buf.m.planes = planes;
+    buf.length = buffer.plane_count;
+  } else if (memory_ == V4L2_MEMORY_DMABUF) {
+    buf.m.fd = buffers_[index].dmabuf_fd;
+    buf.length = buffers_[index].length;
+  } else if (memory_ == V4L2_MEMORY_USERPTR) {
+    buf.m.userptr = reinterpret_cast<unsigned long>(buffers_[index].start);
+    buf.length = buffers_[index].length;
+  }
 
   if (ioctl(fd_, VIDIOC_QBUF, &buf) < 0) {
     fprintf(stderr, "缓冲区 %u 入队失败: %s\n", index, strerror(errno));
@@ -306,7 +1378,55 @@ bool V4L2Device::QueueBuffer(uint32_t index) {
   return true;
 }
 
-int FindVideoDevices(std::vector<DeviceInfo>* devices) {
+namespace {
+
+// 同时探测的最大节点数；探测耗时主要是 USB 往返而非 CPU，与核数无关
+constexpr size_t kMaxProbeThreads = 8;
+
+// 按节点编号排序：video2 排在 video10 之前
+bool VideoNodeLess(const std::string& a, const std::string& b) {
+  if (a.size() != b.size()) {
+    return a.size() < b.size();
+  }
+  return a < b;
+}
+
+}  // namespace
+
+bool ProbeVideoDevice(const std::string& device_path, DeviceInfoCache* cache,
+                      DeviceInfo* info) {
+  V4L2Device device;
+  if (!device.Open(device_path)) {
+    return false;
+  }
+
+  info->device_path = device_path;
+  info->formats.clear();
+  if (!device.GetCapabilities(info)) {
+    return false;
+  }
+
+  // 只保留支持视频捕获的节点，元数据等节点无需枚举格式
+  if (!(info->device_caps &
+        (V4L2_CAP_VIDEO_CAPTURE | V4L2_CAP_VIDEO_CAPTURE_MPLANE))) {
+    return false;
+  }
+
+  if (cache && cache->Lookup(info)) {
+    return true;
+  }
+
+  if (!device.GetDeviceInfo(info)) {
+    return false;
+  }
+  if (cache) {
+    cache->Insert(*info);
+  }
+  return true;
+}
+
+int FindVideoDevices(std::vector<DeviceInfo>* devices,
+                     DeviceInfoCache* cache) {
   devices->clear();
 
   const char* dev_dir = "/dev";
@@ -315,30 +1435,52 @@ int FindVideoDevices(std::vector<DeviceInfo>* devices) {
     return 0;
   }
 
+  std::vector<std::string> paths;
   struct dirent* entry;
   while ((entry = readdir(dir)) != nullptr) {
     if (strncmp(entry->d_name, "video", 5) == 0) {
-      std::string device_path = std::string(dev_dir) + "/" + entry->d_name;
-
-      V4L2Device device;
-      if (device.Open(device_path)) {
-        DeviceInfo info;
-        info.device_path = device_path;
-        if (device.GetDeviceInfo(&info)) {
-          // 只添加支持视频捕获的设备
-          if (info.capabilities & V4L2_CAP_VIDEO_CAPTURE) {
-            devices->push_back(info);
-          }
-        }
-        device.Close();
-      }
+      paths.push_back(std::string(dev_dir) + "/" + entry->d_name);
     }
   }
-
   closedir(dir);
+  std::sort(paths.begin(), paths.end(), VideoNodeLess);
+
+  // 每个节点的 open + QUERYCAP + ENUM_FMT 相互独立，并行探测；
+  // 结果按下标写入，保持节点顺序
+  std::vector<DeviceInfo> infos(paths.size());
+  std::vector<char> found(paths.size(), 0);
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    size_t i;
+    while ((i = next.fetch_add(1)) < paths.size()) {
+      found[i] = ProbeVideoDevice(paths[i], cache, &infos[i]);
+    }
+  };
+
+  size_t thread_count = std::min(paths.size(), kMaxProbeThreads);
+  std::vector<std::thread> threads;
+  for (size_t t = 1; t < thread_count; ++t) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (size_t i = 0; i < paths.size(); ++i) {
+    if (found[i]) {
+      devices->push_back(std::move(infos[i]));
+    }
+  }
   return devices->size();
 }
 
+int64_t MonotonicMicros() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
 std::string PixelFormatToString(uint32_t pixel_format) {
   char format[5];
   format[0] = (pixel_format) & 0xFF;
@@ -3,26 +3,199 @@
 
 #include <linux/videodev2.h>
 #include <stdint.h>
+#include <sys/time.h>
+#include <atomic>
+#include <functional>
+#include <mutex>
 #include <string>
 #include <vector>
 
 namespace v4l2_demo {
 
+// 帧间隔：每帧 numerator / denominator 秒，帧率为 denominator / numerator
+struct FrameInterval {
+  uint32_t numerator;
+  uint32_t denominator;
+};
+
+// 某个像素格式下支持的分辨率及其帧间隔（VIDIOC_ENUM_FRAMESIZES/INTERVALS）
+// 驱动报告连续或步进范围时，展开为范围内的常用值
+struct FrameSize {
+  uint32_t width;
+  uint32_t height;
+  std::vector<FrameInterval> intervals;  // 按帧率从高到低排序，可能为空
+};
+
+// 像素格式能力
+struct FormatCapability {
+  uint32_t pixel_format;          // 像素格式
+  bool compressed;                // 是否为压缩格式（V4L2_FMT_FLAG_COMPRESSED）
+  std::vector<FrameSize> sizes;   // 支持的分辨率，驱动不支持枚举时为空
+};
+
 // V4L2 设备信息结构体
 struct DeviceInfo {
   std::string device_path;      // 设备路径，如 /dev/video0
   std::string driver_name;      // 驱动名称
   std::string card_name;        // 设备名称
   std::string bus_info;         // 总线信息
-  uint32_t capabilities;        // 设备能力
+  uint32_t capabilities;        // 设备能力（整个物理设备）
+  uint32_t device_caps;         // 当前节点的能力（驱动未提供时同 capabilities）
+  uint32_t driver_version;      // 驱动版本（KERNEL_VERSION 编码）
   std::vector<uint32_t> formats; // 支持的像素格式列表
+  std::vector<FormatCapability> format_caps;  // 各格式的分辨率与帧间隔
+};
+
+// 菜单型控制项的一项（VIDIOC_QUERYMENU）
+struct ControlMenuItem {
+  int64_t index;     // 菜单索引，即控制值
+  std::string name;  // 菜单名称；整数菜单为对应的数值
+};
+
+// 控制项信息（VIDIOC_QUERY_EXT_CTRL）
+struct ControlInfo {
+  uint32_t id;                        // 控制 ID，如 V4L2_CID_EXPOSURE_ABSOLUTE
+  uint32_t type;                      // V4L2_CTRL_TYPE_*
+  std::string name;                   // 驱动给出的名称，如 "Exposure Time, Absolute"
+  int64_t minimum;
+  int64_t maximum;
+  uint64_t step;
+  int64_t default_value;
+  uint32_t flags;                     // V4L2_CTRL_FLAG_*
+  std::vector<ControlMenuItem> menu;  // 菜单项，非菜单类型为空
+};
+
+// 当前视频格式（VIDIOC_G_FMT）
+// 单平面 API 及单内存平面格式（如多平面 API 下的 NV12）plane_count 为 1；
+// NV12M 等每个平面使用独立缓冲区的格式为 2~3
+struct VideoFormat {
+  uint32_t width;
+  uint32_t height;
+  uint32_t pixel_format;
+  uint32_t field;
+  uint32_t plane_count;
+  uint32_t bytesperline[VIDEO_MAX_PLANES];  // 各平面行跨度，压缩格式为 0
+  uint32_t sizeimage[VIDEO_MAX_PLANES];     // 各平面缓冲区大小
+};
+
+// 多平面缓冲区中的一个平面
+struct FramePlane {
+  void* start;    // 平面起始地址，无法映射时为 nullptr
+  size_t length;  // 平面长度
+  int dmabuf_fd;  // 平面的 DMABUF 文件描述符，未使用 DMABUF 时为 -1
 };
 
 // 帧缓冲区信息
+// start/length/dmabuf_fd 描述第 0 个平面，与 planes[0] 相同
 struct FrameBuffer {
-  void* start;        // 缓冲区起始地址
+  void* start;        // 缓冲区起始地址（DMABUF 导入且无法映射时为 nullptr）
   size_t length;      // 缓冲区长度
   uint32_t index;     // 缓冲区索引
+  int dmabuf_fd;      // DMABUF 文件描述符，未使用 DMABUF 时为 -1
+  uint32_t plane_count;                 // 平面数，单平面 API 时为 1
+  FramePlane planes[VIDEO_MAX_PLANES];  // 各平面（多平面 API 逐平面映射）
+};
+
+// 丢帧/坏帧统计（自 StartStreaming 起累计）
+struct DropStats {
+  uint64_t frames;         // 出队的帧数
+  uint64_t dropped;        // 根据 sequence 间隔推断的丢帧数
+  uint64_t error_frames;   // 带 V4L2_BUF_FLAG_ERROR 的帧数
+  uint64_t short_frames;   // bytesused 小于 sizeimage 的帧数（仅非压缩格式）
+};
+
+// 丢帧事件类型
+enum class DropReason {
+  kSequenceGap,  // 驱动帧序号不连续，count 为丢失的帧数
+  kBufferError,  // 缓冲区带 V4L2_BUF_FLAG_ERROR，数据可能已损坏
+  kShortFrame,   // bytesused 小于期望的帧大小
+};
+
+// 丢帧事件
+struct DropEvent {
+  DropReason reason;
+  uint32_t sequence;   // 触发事件的帧序号
+  uint32_t count;      // kSequenceGap 时为丢失的帧数，其他为 1
+  uint32_t bytesused;  // 触发事件的帧的有效数据长度
+};
+
+class DeviceInfoCache;
+class V4L2Device;
+struct FrameLatencyTracker;
+
+// 帧租约：持有一个已出队的内存映射缓冲区，析构时自动重新入队
+// 租约有效期间缓冲区不会被驱动覆盖，调用者可以直接读取，无需拷贝
+// 注意：必须在设备 StopStreaming/CleanupMemoryMapping 之前释放所有租约
+class FrameLease {
+ public:
+  FrameLease();
+  ~FrameLease();
+
+  FrameLease(const FrameLease&) = delete;
+  FrameLease& operator=(const FrameLease&) = delete;
+  FrameLease(FrameLease&& other) noexcept;
+  FrameLease& operator=(FrameLease&& other) noexcept;
+
+  // 检查租约是否持有缓冲区
+  // @return 持有返回 true，否则返回 false
+  bool IsValid() const { return device_ != nullptr; }
+
+  // 释放租约，将缓冲区重新入队交还驱动
+  // @return 成功返回 true，失败返回 false（空租约直接返回 true）
+  bool Release();
+
+  // 第 0 个平面的数据；单内存平面格式即整帧数据
+  const void* data() const { return data_; }
+  size_t size() const { return bytesused_; }
+  uint32_t index() const { return index_; }
+  uint32_t sequence() const { return sequence_; }
+  uint32_t flags() const { return flags_; }
+  const struct timeval& timestamp() const { return timestamp_; }
+  int dmabuf_fd() const { return dmabuf_fd_; }
+
+  // 驱动时间戳（微秒）
+  int64_t timestamp_us() const {
+    return static_cast<int64_t>(timestamp_.tv_sec) * 1000000 +
+           timestamp_.tv_usec;
+  }
+
+  // 出队时刻的 CLOCK_MONOTONIC 时间（微秒）
+  int64_t dequeue_time_us() const { return dequeue_time_us_; }
+
+  // 驱动时间戳是否为 CLOCK_MONOTONIC（可与 MonotonicMicros 直接比较）
+  bool HasMonotonicTimestamp() const;
+
+  // 平面数（见 VideoFormat::plane_count）
+  uint32_t plane_count() const { return plane_count_; }
+
+  // 第 plane 个平面的有效数据（已跳过驱动的 data_offset）
+  // @return 平面无效或无法被 CPU 访问时返回 nullptr
+  const void* plane_data(uint32_t plane) const {
+    return plane < plane_count_ ? plane_data_[plane] : nullptr;
+  }
+  size_t plane_size(uint32_t plane) const {
+    return plane < plane_count_ ? plane_size_[plane] : 0;
+  }
+
+ private:
+  friend class V4L2Device;
+
+  V4L2Device* device_;      // 所属设备，nullptr 表示空租约
+  const void* data_;        // 第 0 个平面的有效数据
+  size_t bytesused_;        // 第 0 个平面的有效数据长度
+  uint32_t plane_count_;    // 平面数
+  const void* plane_data_[VIDEO_MAX_PLANES];
+  size_t plane_size_[VIDEO_MAX_PLANES];
+  uint32_t index_;          // 缓冲区索引
+  uint32_t sequence_;       // 驱动帧序号
+  uint32_t flags_;          // v4l2_buffer.flags
+  struct timeval timestamp_;  // 驱动时间戳
+  int dmabuf_fd_;           // 缓冲区的 DMABUF fd，-1 表示无
+  void* detached_buffer_;   // USERPTR 模式下已换入备用缓冲区时为被换出的内存，
+                            // 此时 index 不再被占用；否则为 nullptr
+  int64_t dequeue_time_us_;  // 出队时刻
+
+  void Reset();
 };
 
 // V4L2 设备封装类
@@ -31,7 +204,10 @@ class V4L2Device {
   V4L2Device();
   ~V4L2Device();
 
-  // 打开设备
+  V4L2Device(const V4L2Device&) = delete;
+  V4L2Device& operator=(const V4L2Device&) = delete;
+
+  // 打开设备；已打开同一路径时直接返回，保留已设置的格式与缓冲区
   // @param device_path 设备路径，如 "/dev/video0"
   // @return 成功返回 true，失败返回 false
   bool Open(const std::string& device_path);
@@ -43,12 +219,32 @@ class V4L2Device {
   // @return 已打开返回 true，否则返回 false
   bool IsOpen() const { return fd_ >= 0; }
 
+  // 检查是否正在流式传输
+  bool IsStreaming() const { return streaming_; }
+
   // 获取设备信息
   // @param info 输出参数，设备信息
   // @return 成功返回 true，失败返回 false
   bool GetDeviceInfo(DeviceInfo* info);
 
-  // 设置视频格式
+  // 获取设备能力信息（只执行 VIDIOC_QUERYCAP，不枚举格式）
+  // @param info 输出参数，formats 之外的设备信息
+  // @return 成功返回 true，失败返回 false
+  bool GetCapabilities(DeviceInfo* info);
+
+  // 是否使用多平面 API（V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE）
+  // 打开时根据节点能力自动选择：只提供多平面接口的节点（多数 SoC 的 ISP）
+  // 使用多平面 API，其余使用单平面 API
+  bool IsMultiPlanar() const {
+    return buf_type_ == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+  }
+
+  // 获取捕获队列的缓冲区类型，如 V4L2_BUF_TYPE_VIDEO_CAPTURE
+  uint32_t GetBufferType() const { return buf_type_; }
+
+  // 设置视频格式（场序由驱动决定，逐行设备通常为 V4L2_FIELD_NONE）
+  // 当前格式已经一致时不发起 VIDIOC_S_FMT（UVC 设备每次 S_FMT 都要与
+  // 摄像头协商，且已分配缓冲区时驱动会返回 EBUSY）
   // @param width 视频宽度
   // @param height 视频高度
   // @param pixel_format 像素格式，如 V4L2_PIX_FMT_UYVY
@@ -62,14 +258,118 @@ class V4L2Device {
   // @return 成功返回 true，失败返回 false
   bool GetFormat(uint32_t* width, uint32_t* height, uint32_t* pixel_format);
 
+  // 获取当前视频格式，包括各平面的行跨度与大小
+  // @param format 输出参数，视频格式
+  // @return 成功返回 true，失败返回 false
+  bool GetFormat(VideoFormat* format);
+
+  // 枚举指定像素格式支持的分辨率及各分辨率的帧间隔
+  // @param pixel_format 像素格式
+  // @param sizes 输出参数，分辨率列表
+  // @return 成功返回 true；驱动不支持 VIDIOC_ENUM_FRAMESIZES 时返回 false
+  bool EnumFrameSizes(uint32_t pixel_format, std::vector<FrameSize>* sizes);
+
+  // 枚举指定格式与分辨率支持的帧间隔
+  // @param intervals 输出参数，帧间隔列表（按帧率从高到低排序）
+  // @return 成功返回 true；驱动不支持 VIDIOC_ENUM_FRAMEINTERVALS 时返回 false
+  bool EnumFrameIntervals(uint32_t pixel_format, uint32_t width,
+                          uint32_t height,
+                          std::vector<FrameInterval>* intervals);
+
+  // 通过 VIDIOC_S_PARM 设置帧间隔（需在 SetFormat 之后、StartStreaming 之前）
+  // @param interval 期望的帧间隔
+  // @param actual 输出参数，驱动实际采用的帧间隔，可为 nullptr
+  // @return 成功返回 true；驱动不支持设置帧率时返回 false
+  bool SetFrameInterval(const FrameInterval& interval,
+                        FrameInterval* actual = nullptr);
+
+  // 通过 VIDIOC_G_PARM 获取当前帧间隔
+  // @return 成功返回 true，失败返回 false
+  bool GetFrameInterval(FrameInterval* interval);
+
+  // 通过 VIDIOC_S_SELECTION 设置捕获矩形（需在 SetFormat 之后、分配缓冲区
+  // 之前）。驱动把矩形调整到硬件支持的范围与对齐，并可能随之修改格式，
+  // 调用者应重新 GetFormat
+  // @param target V4L2_SEL_TGT_CROP（传感器上的裁剪区域）或
+  //               V4L2_SEL_TGT_COMPOSE（裁剪结果在缓冲区中的位置与大小）
+  // @param rect 期望的矩形
+  // @param actual 输出参数，驱动实际采用的矩形，可为 nullptr
+  // @return 成功返回 true；驱动不支持该选择目标时返回 false 且不打印错误
+  bool SetSelection(uint32_t target, const struct v4l2_rect& rect,
+                    struct v4l2_rect* actual = nullptr);
+
+  // 通过 VIDIOC_G_SELECTION 获取矩形，如 V4L2_SEL_TGT_CROP_BOUNDS
+  // @return 成功返回 true；驱动不支持该选择目标时返回 false 且不打印错误
+  bool GetSelection(uint32_t target, struct v4l2_rect* rect);
+
+  // 枚举设备的控制项（VIDIOC_QUERY_EXT_CTRL），跳过控制类标题、已禁用的
+  // 以及字符串、复合类型的控制项；菜单类型同时枚举菜单项
+  // @param controls 输出参数，按驱动枚举顺序排列
+  // @return 成功返回 true，驱动不支持扩展控制查询返回 false
+  bool QueryControls(std::vector<ControlInfo>* controls);
+
+  // 批量读取控制值（VIDIOC_G_EXT_CTRLS）
+  // @param controls 各项的 id 由调用者填写，值写回 value（64 位类型为 value64）
+  // @param count 控制项数量
+  // @return 成功返回 true，失败返回 false
+  bool GetControls(struct v4l2_ext_control* controls, uint32_t count);
+
+  // 批量设置控制值，所有控制项在一次 VIDIOC_S_EXT_CTRLS 中提交
+  // 可在视频流运行期间调用，成功后 controls 中为驱动实际采用的值
+  // @param controls 要设置的控制项（64 位类型使用 value64）
+  // @param count 控制项数量
+  // @param error_index 输出参数，失败时驱动报告的出错位置（等于 count 表示
+  //                    校验阶段失败、没有任何控制项被修改），可为 nullptr
+  // @return 成功返回 true，失败返回 false
+  bool SetControls(struct v4l2_ext_control* controls, uint32_t count,
+                   uint32_t* error_index = nullptr);
+
+  // 映射缓冲区时预先建立页表（MAP_POPULATE 并逐页读取），
+  // 第一轮帧出队不再缺页；须在 InitMemoryMapping/InitDmaBuf 之前设置
+  void SetPrefaultBuffers(bool prefault) { prefault_buffers_ = prefault; }
+
   // 初始化内存映射缓冲区
+  // 未在流式传输、缓冲区数量相同且已映射的缓冲区放得下当前格式时，直接
+  // 复用已有映射，不再 REQBUFS/munmap/mmap
   // @param buffer_count 缓冲区数量，通常为 4
   // @return 成功返回 true，失败返回 false
   bool InitMemoryMapping(uint32_t buffer_count = 4);
 
-  // 清理内存映射缓冲区
+  // 初始化内存映射缓冲区并通过 VIDIOC_EXPBUF 导出为 DMABUF
+  // 每个缓冲区可同时通过 start 被 CPU 访问、通过 dmabuf_fd 交给
+  // GPU/硬件编码器/显示平面，无需 CPU 拷贝
+  // @param buffer_count 缓冲区数量
+  // @return 成功返回 true；驱动不支持导出时返回 false
+  bool InitDmaBuf(uint32_t buffer_count = 4);
+
+  // 导入外部分配的 DMABUF（V4L2_MEMORY_DMABUF）
+  // fd 的所有权仍归调用者，须在 CleanupMemoryMapping 之后再关闭
+  // 多平面 API 下只支持单内存平面格式
+  // @param dmabuf_fds 外部 DMABUF 文件描述符列表
+  // @param length 每个 DMABUF 的大小，需不小于当前格式的 sizeimage
+  // @return 成功返回 true，失败返回 false
+  bool ImportDmaBuf(const std::vector<int>& dmabuf_fds, size_t length);
+
+  // 使用应用提供的内存（V4L2_MEMORY_USERPTR），通常来自 HugePageBufferPool
+  // 前 driver_buffer_count 个缓冲区交给驱动，其余作为备用：出队时立即换入
+  // 备用缓冲区重新入队，因此租约持有帧不会占用驱动缓冲区，
+  // 环形缓冲可以超过驱动的缓冲区数量而无需重新 REQBUFS
+  // 内存的所有权仍归调用者，须在 CleanupMemoryMapping 之后再释放
+  // 多平面 API 下只支持单内存平面格式
+  // @param buffers 缓冲区地址列表
+  // @param length 每个缓冲区的大小，需不小于当前格式的 sizeimage
+  // @param driver_buffer_count 交给驱动的缓冲区数量
+  // @return 成功返回 true，失败返回 false
+  bool InitUserPtr(const std::vector<void*>& buffers, size_t length,
+                   uint32_t driver_buffer_count = 4);
+
+  // 清理内存映射缓冲区（同时关闭导出的 DMABUF），未在流式传输时还会
+  // 释放驱动侧的缓冲区，之后可以设置不同的格式
   void CleanupMemoryMapping();
 
+  // 获取当前缓冲区的内存类型，如 V4L2_MEMORY_MMAP
+  uint32_t GetMemoryType() const { return memory_; }
+
   // 开始视频流捕获
   // @return 成功返回 true，失败返回 false
   bool StartStreaming();
@@ -78,35 +378,186 @@ class V4L2Device {
   // @return 成功返回 true，失败返回 false
   bool StopStreaming();
 
-  // 读取一帧数据
-  // @param frame_data 输出参数，帧数据指针
-  // @param frame_size 输出参数，帧数据大小
+  // 快速重启视频流（STREAMOFF + STREAMON），保留格式与缓冲区映射，
+  // 用于驱动报告 EIO 等可恢复的错误；丢帧统计不清零
+  // 所有租约必须已经释放（STREAMOFF 会收回全部缓冲区）
   // @return 成功返回 true，失败返回 false
-  bool ReadFrame(void** frame_data, size_t* frame_size);
+  bool RestartStreaming();
+
+  // 关闭并重新打开同一设备节点（设备断开后重新出现），恢复格式、帧间隔、
+  // 缓冲区（只支持 InitMemoryMapping/InitDmaBuf 分配的缓冲区）与视频流
+  // 缓冲区与流状态取自 SaveRestoreState 保存的值（未保存时先保存当前状态），
+  // 失败的尝试已关闭设备，之后的重试仍按保存的状态恢复；成功后清除保存的状态
+  // 所有租约必须已经释放
+  // @return 成功返回 true；设备尚未重新出现等情况返回 false
+  bool Reopen();
+
+  // 保存 Reopen 需要恢复的缓冲区数量、DMABUF 导出与流状态
+  // 应在出错后、第一次 RestartStreaming/Reopen 之前调用一次；
+  // 之后只有调用者的 StopStreaming/CleanupMemoryMapping/Close 会清除
+  void SaveRestoreState();
+
+  // 最近一次 DequeueFrame 失败的 errno（没有帧可出队不算失败），
+  // 0 表示没有错误
+  int GetLastError() const { return last_error_; }
+
+  // 获取设备路径
+  const std::string& GetDevicePath() const { return device_path_; }
+
+  // 等待驱动填充好一帧（基于 poll，不消耗 CPU）
+  // @param timeout_ms 超时时间（毫秒），-1 表示无限等待
+  // @return 有可出队的帧返回 true，超时或失败返回 false
+  bool WaitForFrame(int timeout_ms);
+
+  // 出队一帧数据，缓冲区由租约持有直到租约释放
+  // @param lease 输出参数，帧租约（原有租约会先被释放）
+  // @return 成功返回 true；无可用帧（EAGAIN）或失败返回 false
+  bool DequeueFrame(FrameLease* lease);
 
   // 将帧数据入队（用于循环缓冲区）
   // @return 成功返回 true，失败返回 false
   bool QueueBuffer(uint32_t index);
 
+  // 获取已映射的缓冲区数量
+  uint32_t GetBufferCount() const { return buffers_.size(); }
+
+  // 获取已映射的缓冲区描述
+  // @return 索引无效时返回 nullptr
+  const FrameBuffer* GetBuffer(uint32_t index) const {
+    return index < buffers_.size() ? &buffers_[index] : nullptr;
+  }
+
+  // 获取当前被租约持有的缓冲区数量
+  uint32_t GetLeasedBufferCount() const { return leased_buffers_.load(); }
+
+  // 设置逐帧延迟统计（传入 nullptr 关闭），tracker 须比设备活得更久
+  void SetLatencyTracker(FrameLatencyTracker* tracker) {
+    latency_tracker_ = tracker;
+  }
+
+  // 丢帧事件回调，在调用 DequeueFrame 的线程中同步执行
+  using DropCallback = std::function<void(const DropEvent& event)>;
+
+  // 设置丢帧事件回调（传入空函数关闭），须在 StartStreaming 之前设置
+  void SetDropCallback(const DropCallback& callback) {
+    drop_callback_ = callback;
+  }
+
+  // 获取丢帧统计，可在其他线程调用
+  // @param stats 输出参数，统计信息
+  void GetDropStats(DropStats* stats) const;
+
   // 获取文件描述符（用于 select/poll）
   int GetFileDescriptor() const { return fd_; }
 
  private:
+  friend class FrameLease;
+
   int fd_;  // 设备文件描述符
+  uint32_t buf_type_;  // 捕获队列类型（VIDEO_CAPTURE 或 VIDEO_CAPTURE_MPLANE）
   std::vector<FrameBuffer> buffers_;  // 内存映射缓冲区列表
   bool streaming_;  // 是否正在流式传输
+  uint32_t memory_;  // 缓冲区内存类型（V4L2_MEMORY_MMAP/DMABUF/USERPTR）
+  bool prefault_buffers_;  // 映射时预先建立页表
+  int last_error_;         // 最近一次出队失败的 errno
+
+  // 重新打开设备时恢复的配置
+  std::string device_path_;
+  uint32_t format_width_;           // 最近一次 SetFormat 的参数，
+  uint32_t format_height_;          // pixel_format 为 0 表示未设置
+  uint32_t format_pixel_format_;
+  FrameInterval frame_interval_;    // 最近一次设置成功的帧间隔，
+                                    // numerator 为 0 表示未设置
+  uint32_t requested_buffer_count_;  // 最近一次 MMAP 缓冲区请求数量
+  bool exported_dmabuf_;             // 缓冲区是否已导出为 DMABUF
+  bool has_restore_state_;           // 以下三项是否为 SaveRestoreState 保存
+  uint32_t restore_buffer_count_;    // Reopen 恢复的缓冲区数量，0 表示不恢复
+  bool restore_dmabuf_;              // Reopen 是否重新导出 DMABUF
+  bool restore_streaming_;           // Reopen 后是否 STREAMON
+  std::vector<void*> spare_buffers_;  // USERPTR 模式的备用缓冲区
+  std::mutex spare_mutex_;            // 保护 spare_buffers_（租约可在其他线程释放）
+  FrameLatencyTracker* latency_tracker_;  // 逐帧延迟统计，可为 nullptr
+  std::atomic<uint32_t> leased_buffers_;  // 被租约持有的缓冲区数量
+
+  // 丢帧检测
+  DropCallback drop_callback_;
+  size_t expected_frame_size_;  // 非压缩格式的 sizeimage，0 表示不检查
+  bool has_sequence_;           // 是否已收到过帧
+  uint32_t last_sequence_;      // 上一帧的驱动帧序号
+  std::atomic<uint64_t> frames_;
+  std::atomic<uint64_t> dropped_frames_;
+  std::atomic<uint64_t> error_frames_;
+  std::atomic<uint64_t> short_frames_;
 
   // 查询设备能力
   bool QueryCapabilities(struct v4l2_capability* cap);
 
-  // 查询支持的像素格式
-  bool QueryFormats(std::vector<uint32_t>* formats);
+  // 查询支持的像素格式及其分辨率、帧间隔
+  bool QueryFormats(std::vector<uint32_t>* formats,
+                    std::vector<FormatCapability>* format_caps);
+
+  // 多平面 API 下检查当前格式是否为单内存平面（DMABUF 导入/USERPTR 需要）
+  bool CheckSinglePlane();
+
+  // 当前格式是否已是给定的分辨率与像素格式（不打印错误）
+  bool FormatMatches(uint32_t width, uint32_t height, uint32_t pixel_format);
+
+  // 已映射的 MMAP 缓冲区能否直接用于给定的缓冲区数量与当前格式
+  bool CanReuseBuffers(uint32_t buffer_count);
+
+  // 将所有缓冲区入队并 STREAMON，不清零丢帧统计
+  bool StreamOn();
+
+  // STREAMOFF，不改变保存的恢复状态
+  bool StreamOff();
+
+  // 释放缓冲区（CleanupMemoryMapping 的实现），不改变保存的恢复状态
+  void ReleaseBuffers();
+
+  // 关闭设备（Close 的实现），不改变保存的恢复状态
+  void CloseDevice();
+
+  // 请求指定内存类型的缓冲区
+  // @return 成功返回驱动实际分配的数量，失败返回 0
+  uint32_t RequestBuffers(uint32_t buffer_count, uint32_t memory);
+
+  // 导入的 DMABUF 被 CPU 映射时，前后需要进行缓存同步
+  void BeginCpuAccess(uint32_t index);
+  void EndCpuAccess(uint32_t index);
+
+  // 用出队的 v4l2_buffer 填充租约并记录出队时刻
+  // @param data 第 0 个平面的起始地址，其余平面取自 buffers_
+  void FillLease(FrameLease* lease, const struct v4l2_buffer& buf,
+                 const void* data);
+
+  // 根据帧序号、错误标志和 bytesused 检测丢帧/坏帧
+  // @param bytesused 各平面有效数据长度之和
+  void TrackDrops(const struct v4l2_buffer& buf, size_t bytesused);
+
+  // USERPTR 模式：租约释放时归还备用缓冲区
+  void ReturnSpareBuffer(void* buffer);
 };
 
 // 工具函数：查找可用的视频设备
+// 各 /dev/video* 节点并行探测，结果按节点编号排序；
+// 只返回支持视频捕获（单平面或多平面）的节点（UVC 的元数据节点会被跳过）
 // @param devices 输出参数，找到的设备列表
+// @param cache 设备信息缓存，可为 nullptr；命中时跳过格式枚举
 // @return 找到的设备数量
-int FindVideoDevices(std::vector<DeviceInfo>* devices);
+int FindVideoDevices(std::vector<DeviceInfo>* devices,
+                     DeviceInfoCache* cache = nullptr);
+
+// 工具函数：探测单个视频节点
+// @param device_path 设备路径
+// @param cache 设备信息缓存，可为 nullptr
+// @param info 输出参数，设备信息
+// @return 是支持视频捕获的节点返回 true，否则返回 false
+bool ProbeVideoDevice(const std::string& device_path, DeviceInfoCache* cache,
+                      DeviceInfo* info);
+
+// 工具函数：获取 CLOCK_MONOTONIC 时间（微秒）
+// 与驱动 v4l2_buffer.timestamp 使用同一时钟
+int64_t MonotonicMicros();
 
 // 工具函数：像素格式转字符串
 // @param pixel_format 像素格式，如 V4L2_PIX_FMT_UYVY
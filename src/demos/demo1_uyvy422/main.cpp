@@ -1,3 +1,5 @@
+#include <poll.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
@@ -6,31 +8,117 @@
 #include <unistd.h>
 #include <sys/stat.h>
 #include <sys/types.h>
-#include <fstream>
-#include <iomanip>
-#include <sstream>
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <thread>
 #include <vector>
 
+#include "camera_controls.h"
+#include "capture_loop.h"
+#include "format_selector.h"
+#include "frame_container.h"
+#include "frame_writer.h"
+#include "latency_histogram.h"
+#include "metrics.h"
+#include "motion_detector.h"
+#include "pretrigger_recorder.h"
+#ifdef V4L2_DEMO_HAVE_JPEG
+#include "mjpeg_decode_stage.h"
+#endif
 #include "v4l2_utils.h"
 
+using v4l2_demo::CameraControls;
+using v4l2_demo::CaptureLoop;
+using v4l2_demo::CaptureMode;
+using v4l2_demo::CaptureTarget;
+using v4l2_demo::ContainerWriter;
+using v4l2_demo::ControlInfo;
+using v4l2_demo::ControlStats;
+using v4l2_demo::ContainerWriterOptions;
+using v4l2_demo::ContainerWriterStats;
+using v4l2_demo::ApplyCaptureMode;
+using v4l2_demo::SelectCaptureMode;
 using v4l2_demo::V4L2Device;
+using v4l2_demo::Counter;
+using v4l2_demo::Gauge;
+using v4l2_demo::MetricType;
+using v4l2_demo::MetricsExporter;
+using v4l2_demo::MetricsExporterOptions;
+using v4l2_demo::MetricsRegistry;
 using v4l2_demo::DeviceInfo;
+using v4l2_demo::DropEvent;
+using v4l2_demo::DropReason;
+using v4l2_demo::DropStats;
+using v4l2_demo::FrameLatencyTracker;
+using v4l2_demo::FrameLease;
+using v4l2_demo::FrameWriter;
+using v4l2_demo::FrameWriterOptions;
+using v4l2_demo::FrameWriterStats;
+#ifdef V4L2_DEMO_HAVE_JPEG
+using v4l2_demo::DecodedFrame;
+using v4l2_demo::MjpegDecodeOptions;
+using v4l2_demo::MjpegDecodeStage;
+using v4l2_demo::MjpegDecodeStats;
+#endif
+using v4l2_demo::MotionDetector;
+using v4l2_demo::MotionDetectorOptions;
+using v4l2_demo::MotionResult;
+using v4l2_demo::MotionStats;
+using v4l2_demo::OverflowPolicy;
+using v4l2_demo::PreTriggerOptions;
+using v4l2_demo::PreTriggerRecorder;
+using v4l2_demo::PreTriggerStats;
+using v4l2_demo::RecoveryOptions;
 using v4l2_demo::FindVideoDevices;
+using v4l2_demo::FormatCapability;
+using v4l2_demo::FrameInterval;
 using v4l2_demo::PixelFormatToString;
+using v4l2_demo::VideoFormat;
 
 // 配置参数
 namespace {
-// 视频格式配置
+// 默认捕获目标（可通过命令行参数 宽x高@帧率 覆盖）
 constexpr uint32_t kVideoWidth = 640;
 constexpr uint32_t kVideoHeight = 480;
+constexpr double kVideoMinFps = 30;
 
-// 帧保存配置
-constexpr int kMaxSavedFrames = 20;  // 最多保存 20 张图片
+// 帧保存配置：帧连同格式、驱动时间戳与帧序号追加到分段录制容器
 constexpr int kSaveIntervalSeconds = 1;  // 每秒保存一帧
 constexpr const char* kOutputDirectory = "output";  // 输出目录
-
-// 优先选择的格式列表（按优先级排序）
-// 优先选择未压缩格式，然后是压缩格式
+constexpr const char* kRecordingPrefix = "output/capture";  // 分段路径前缀
+constexpr uint64_t kSegmentMaxBytes = 64ull << 20;  // 单个分段 64 MB
+constexpr uint32_t kMaxSegments = 8;  // 只保留最近 8 个分段
+
+// 运动检测：画面静止时跳过定时保存，运动结束后再保存 kMotionHoldSeconds 秒；
+// 长时间静止时每 kMotionKeyframeSeconds 秒仍保存一帧。压缩格式无法分析，
+// 总是按定时保存
+constexpr double kMotionHoldSeconds = 2;
+constexpr int kMotionKeyframeSeconds = 30;
+
+// 预触发录制：内存中保留最近 kPreTriggerSeconds 秒的每一帧，收到 SIGUSR1
+// 时连同之后 kPostTriggerSeconds 秒的帧写入 output/event_<时间>_NNNN.v4lc
+constexpr double kPreTriggerSeconds = 3;
+constexpr double kPostTriggerSeconds = 3;
+constexpr const char* kEventPrefix = "output/event";
+
+// 运行时控制：标准输入每行一条 "名称=值" 命令，由捕获线程在下一帧前批量应用
+// 控制命令线程每 kControlPollMs 毫秒检查一次退出标志
+constexpr int kControlPollMs = 200;
+
+// 驱动缓冲区数量与写入队列容量
+// 写入队列持有租约，容量必须小于缓冲区数量，否则驱动会无缓冲区可用
+constexpr uint32_t kBufferCount = 4;
+constexpr size_t kWriterQueueCapacity = 2;
+
+// 指标导出：Prometheus 抓取端口与周期写入的 JSON 文件
+// 帧率按最近 kFpsWindowSeconds 秒计算，能反映近期的卡顿
+constexpr int kMetricsPort = 9464;
+constexpr const char* kMetricsJsonPath = "output/metrics.json";
+constexpr double kFpsWindowSeconds = 5;
+
+// 优先选择的格式列表（按优先级排序），分辨率和帧率相同时生效
+// 未压缩格式超出 USB 带宽时由选择器自动改用压缩格式
 // 格式说明：
 // - YUYV (4:2:2): 未压缩，每2像素4字节，640x480约600KB，质量高，实时性好
 // - UYVY (4:2:2): 类似YUYV，字节顺序不同
@@ -44,17 +132,44 @@ constexpr uint32_t kPreferredFormats[] = {
     V4L2_PIX_FMT_MJPEG,  // Motion-JPEG (压缩，可直接查看)
     V4L2_PIX_FMT_JPEG,   // JPEG (压缩，可直接查看)
 };
-constexpr size_t kPreferredFormatsCount = sizeof(kPreferredFormats) / sizeof(kPreferredFormats[0]);
-
-// 帧统计信息
-struct FrameStats {
-  uint64_t total_frames;      // 总帧数
-  uint64_t saved_frames;      // 已保存帧数
-  time_t start_time;          // 开始时间
-  time_t last_save_time;      // 上次保存时间
-  time_t last_print_time;     // 上次打印时间
-  uint32_t current_frame_index;  // 当前保存的帧索引（用于循环覆盖）
+
+// 保存状态（只在捕获线程中访问）
+struct SaveState {
+  time_t last_save_time;      // 上次检查保存的时间
+  time_t last_written_time;   // 上次实际保存的时间
+};
+
+// 捕获线程更新的指标，计数在导出线程中汇总，热路径上没有系统调用
+struct CaptureMetrics {
+  Counter* frames;        // 出队的帧数
+  Counter* bytes;         // 出队的字节数
+  Counter* saved;         // 进入写入队列的帧数
+  Counter* save_dropped;  // 写入队列满被丢弃的帧数
+  Counter* motion_skipped;  // 画面静止而跳过保存的帧数
+  Counter* dropped;       // 驱动丢帧数（帧序号间隔）
+  Counter* error_frames;  // 数据不完整或出错的帧数
+  Gauge* frame_size;      // 最近一帧的大小
 };
+
+// 捕获循环实例，供信号处理函数请求退出
+CaptureLoop* g_capture_loop = nullptr;
+
+// 预触发录制器，供信号处理函数触发事件
+PreTriggerRecorder* g_recorder = nullptr;
+
+// SIGINT/SIGTERM 处理函数：唤醒捕获循环退出
+void HandleStopSignal(int /* signum */) {
+  if (g_capture_loop) {
+    g_capture_loop->Stop();
+  }
+}
+
+// SIGUSR1 处理函数：触发预触发录制（只写原子变量）
+void HandleTriggerSignal(int /* signum */) {
+  if (g_recorder) {
+    g_recorder->Trigger();
+  }
+}
 }  // namespace
 
 // 创建输出目录
@@ -73,101 +188,47 @@ bool CreateOutputDirectory() {
   return true;
 }
 
-// 根据像素格式获取文件扩展名
-// @param pixel_format 像素格式
-// @return 文件扩展名（不含点号）
-// 
-// 说明：
-// - MJPEG/JPEG: 压缩格式，保存为 .jpg，可直接用图片查看器打开
-// - YUYV/UYVY/YUV420: 未压缩的 YUV 格式，保存为 .raw
-//   .raw 文件是原始二进制数据，包含未压缩的像素数据，需要专门的工具查看
-//   对于 640x480 的 YUYV 格式，文件大小约为 614,400 字节 (约 600 KB)
-//   查看方法：使用 FFmpeg 转换，如：
-//   ffmpeg -f rawvideo -pixel_format yuyv422 -video_size 640x480 -i frame_000.raw frame_000.png
-std::string GetFileExtension(uint32_t pixel_format) {
-  if (pixel_format == V4L2_PIX_FMT_MJPEG || pixel_format == V4L2_PIX_FMT_JPEG) {
-    return "jpg";
-  }
-  // 其他格式（YUYV, UYVY, YUV420 等）使用 raw
-  // .raw 文件是原始二进制数据，不能直接用图片查看器打开
-  return "raw";
-}
-
-// 生成输出文件名
-// @param frame_index 帧索引（0-19，用于循环覆盖）
-// @param pixel_format 像素格式
-// @return 文件路径
-std::string GenerateOutputFilename(int frame_index, uint32_t pixel_format) {
-  std::ostringstream oss;
-  std::string ext = GetFileExtension(pixel_format);
-  oss << kOutputDirectory << "/frame_" << std::setfill('0') << std::setw(3)
-      << frame_index << "." << ext;
-  return oss.str();
-}
-
-// 保存帧数据到文件
-// @param frame_data 帧数据指针
-// @param frame_size 帧数据大小
-// @param frame_index 帧索引
-// @param pixel_format 像素格式
-// @return 成功返回 true，失败返回 false
-bool SaveFrameToFile(const void* frame_data, size_t frame_size,
-                     int frame_index, uint32_t pixel_format) {
-  std::string filename = GenerateOutputFilename(frame_index, pixel_format);
-  std::ofstream file(filename, std::ios::binary);
-  if (!file.is_open()) {
-    fprintf(stderr, "无法打开文件 %s 进行写入\n", filename.c_str());
-    return false;
-  }
-
-  file.write(reinterpret_cast<const char*>(frame_data), frame_size);
-  file.close();
-
-  if (!file.good()) {
-    fprintf(stderr, "写入文件 %s 失败\n", filename.c_str());
+// 提交帧到异步写入器，追加到录制容器（零拷贝，写完后缓冲区才交还驱动）
+// 在捕获线程中调用，不打印：结果计入指标，由状态行与导出器展示
+// @param writer 异步写入器
+// @param lease 帧租约，调用后被转移给写入器
+// @param container 录制容器，由写入线程追加
+// @param metrics 捕获指标
+// @return 进入写入队列返回 true，被丢弃返回 false
+bool SaveFrameToRecording(FrameWriter* writer, FrameLease* lease,
+                     ContainerWriter* container,
+                     const CaptureMetrics& metrics) {
+  if (!writer->SubmitLease(lease, container)) {
+    metrics.save_dropped->Add();
     return false;
   }
-
-  // 保存成功时打印到新行，避免与实时信息冲突
-  printf("\n[保存] %s (大小: %zu 字节, 格式: %s)\n", filename.c_str(),
-         frame_size, PixelFormatToString(pixel_format).c_str());
+  metrics.saved->Add();
   return true;
 }
 
-// 打印帧信息（每秒打印一次，避免刷屏）
-// @param stats 帧统计信息（会被更新 last_print_time）
-// @param frame_data 帧数据指针（未使用，保留用于未来扩展）
-// @param frame_size 帧数据大小
+// 打印状态行（由指标导出线程每秒调用一次，不占用捕获线程）
+// @param registry 指标注册表，用于读取时间窗帧率
+// @param metrics 捕获指标
+// @param latency 逐帧延迟统计
 // @param width 视频宽度
 // @param height 视频高度
 // @param pixel_format 像素格式
-// @return 如果打印了信息返回 true，否则返回 false
-bool PrintFrameInfo(FrameStats* stats, const void* /* frame_data */,
-                    size_t frame_size, uint32_t width, uint32_t height,
-                    uint32_t pixel_format) {
-  if (!stats) {
-    return false;
-  }
-
-  time_t current_time = time(nullptr);
-  
-  // 每秒只打印一次
-  if (difftime(current_time, stats->last_print_time) < 1.0) {
-    return false;
-  }
-
-  stats->last_print_time = current_time;
-  
-  double elapsed_seconds = difftime(current_time, stats->start_time);
-  double fps = (elapsed_seconds > 0) ? stats->total_frames / elapsed_seconds : 0;
-
-  // 使用 \r 和 ANSI 转义码实现原地更新，避免刷屏
-  printf("\r[%lu 帧] FPS: %.2f | 已保存: %lu | 尺寸: %ux%u | 格式: %s | 帧大小: %zu 字节    ",
-         stats->total_frames, fps, stats->saved_frames, width, height,
-         PixelFormatToString(pixel_format).c_str(), frame_size);
-  fflush(stdout);  // 立即刷新输出
-
-  return true;
+// @param motion 运动检测统计
+void PrintFrameInfo(MetricsRegistry* registry, const CaptureMetrics& metrics,
+                    const FrameLatencyTracker& latency, uint32_t width,
+                    uint32_t height, uint32_t pixel_format,
+                    const MotionStats& motion) {
+  // 使用 \r 原地更新，避免刷屏
+  printf("\r[%lu 帧] FPS(%.0fs): %.2f | 已保存: %lu | 静止跳过: %lu | "
+         "丢帧: %lu | 变化: %.1f%% | 出队延迟 p99: %lu us | 尺寸: %ux%u | "
+         "格式: %s | 帧大小: %ld 字节    ",
+         metrics.frames->Value(), kFpsWindowSeconds,
+         registry->GetRate("v4l2_frames_total"), metrics.saved->Value(),
+         metrics.motion_skipped->Value(), metrics.dropped->Value(),
+         motion.last_score * 100, latency.sensor_to_dequeue.Percentile(99),
+         width, height, PixelFormatToString(pixel_format).c_str(),
+         metrics.frame_size->Value());
+  fflush(stdout);
 }
 
 // 查找前置摄像头设备
@@ -197,42 +258,150 @@ std::string FindFrontCamera(const std::vector<DeviceInfo>& devices) {
   return first_device;
 }
 
-// 打印所有支持的格式
-// @param formats 格式列表
-void PrintSupportedFormats(const std::vector<uint32_t>& formats) {
-  printf("设备支持的像素格式 (%zu 种):\n", formats.size());
-  for (size_t i = 0; i < formats.size(); ++i) {
-    printf("  [%zu] %s (0x%08X)\n", i, PixelFormatToString(formats[i]).c_str(),
-           formats[i]);
+// 打印所有支持的格式及其分辨率、帧率
+// @param format_caps 格式能力列表
+void PrintSupportedFormats(const std::vector<FormatCapability>& format_caps) {
+  printf("设备支持的像素格式 (%zu 种):\n", format_caps.size());
+  for (size_t i = 0; i < format_caps.size(); ++i) {
+    const FormatCapability& cap = format_caps[i];
+    printf("  [%zu] %s (0x%08X)%s\n", i,
+           PixelFormatToString(cap.pixel_format).c_str(), cap.pixel_format,
+           cap.compressed ? " 压缩" : "");
+    for (const auto& size : cap.sizes) {
+      printf("      %ux%u:", size.width, size.height);
+      for (const FrameInterval& interval : size.intervals) {
+        printf(" %.4g", static_cast<double>(interval.denominator) /
+                            interval.numerator);
+      }
+      printf(size.intervals.empty() ? "\n" : " fps\n");
+    }
   }
   printf("\n");
 }
 
-// 从支持的格式中选择最合适的格式
-// @param supported_formats 设备支持的格式列表
-// @return 选中的格式，如果未找到返回 0
-uint32_t SelectBestFormat(const std::vector<uint32_t>& supported_formats) {
-  // 按优先级查找格式
-  for (size_t i = 0; i < kPreferredFormatsCount; ++i) {
-    uint32_t preferred_format = kPreferredFormats[i];
-    for (uint32_t supported_format : supported_formats) {
-      if (supported_format == preferred_format) {
-        return preferred_format;
+// 打印所有控制项及其取值范围与当前值
+// @param controls 控制项表
+void PrintControls(const CameraControls& controls) {
+  printf("设备控制项 (%zu 个):\n", controls.controls().size());
+  for (const ControlInfo& info : controls.controls()) {
+    int64_t value = 0;
+    controls.GetValue(info.id, &value);
+    printf("  %-32s 0x%08X [%ld, %ld] 步长 %lu 默认 %ld 当前 %ld%s%s\n",
+           CameraControls::MakeKey(info.name).c_str(), info.id, info.minimum,
+           info.maximum, info.step, info.default_value, value,
+           (info.flags & V4L2_CTRL_FLAG_READ_ONLY) ? " 只读" : "",
+           (info.flags & V4L2_CTRL_FLAG_INACTIVE) ? " 未激活" : "");
+    for (const auto& item : info.menu) {
+      printf("      %ld: %s\n", item.index, item.name.c_str());
+    }
+  }
+  printf("\n");
+}
+
+// 执行一条控制命令："名称=值"，菜单型控制项的值也可以是菜单项名称；
+// "?" 打印控制项列表
+// @param controls 控制项表
+// @param line 命令行（不含换行符）
+void HandleControlCommand(CameraControls* controls, const std::string& line) {
+  if (line.empty()) {
+    return;
+  }
+  if (line == "?") {
+    printf("\n");
+    PrintControls(*controls);
+    return;
+  }
+  size_t equal = line.find('=');
+  const ControlInfo* info =
+      equal == std::string::npos ? nullptr
+                                 : controls->Find(line.substr(0, equal));
+  if (!info) {
+    fprintf(stderr, "\n未知的控制命令: %s（格式: 名称=值，? 列出控制项）\n",
+            line.c_str());
+    return;
+  }
+
+  std::string text = line.substr(equal + 1);
+  char* end = nullptr;
+  int64_t value = strtoll(text.c_str(), &end, 0);
+  if (text.empty() || *end != '\0') {
+    bool found = false;
+    for (const auto& item : info->menu) {
+      if (CameraControls::MakeKey(item.name) ==
+          CameraControls::MakeKey(text)) {
+        value = item.index;
+        found = true;
+        break;
       }
     }
+    if (!found) {
+      fprintf(stderr, "\n无效的值: %s\n", text.c_str());
+      return;
+    }
+  }
+  if (!controls->Request(info->id, value)) {
+    fprintf(stderr, "\n控制项 %s 为只读\n", info->name.c_str());
   }
+}
 
-  // 如果没有找到优先格式，返回第一个支持的格式
-  if (!supported_formats.empty()) {
-    return supported_formats[0];
+// 控制命令线程：从标准输入按行读取命令，只调用 Request，不访问设备
+// @param controls 控制项表
+// @param stop 退出标志
+void RunControlCommands(CameraControls* controls,
+                        const std::atomic<bool>* stop) {
+  std::string pending;
+  char buffer[256];
+  while (!stop->load(std::memory_order_relaxed)) {
+    struct pollfd pfd;
+    pfd.fd = STDIN_FILENO;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, kControlPollMs) <= 0) {
+      continue;
+    }
+    ssize_t n = read(STDIN_FILENO, buffer, sizeof(buffer));
+    if (n <= 0) {
+      return;  // 标准输入关闭（如后台运行）
+    }
+    pending.append(buffer, n);
+    size_t newline;
+    while ((newline = pending.find('\n')) != std::string::npos) {
+      HandleControlCommand(controls, pending.substr(0, newline));
+      pending.erase(0, newline + 1);
+    }
   }
+}
 
-  return 0;
+// 解析命令行中的捕获目标，格式为 宽x高@帧率，如 1920x1080@30
+// @return 格式正确返回 true，否则返回 false
+bool ParseCaptureTarget(const char* arg, CaptureTarget* target) {
+  unsigned int width, height;
+  double fps = kVideoMinFps;
+  int count = sscanf(arg, "%ux%u@%lf", &width, &height, &fps);
+  if (count < 2 || width == 0 || height == 0 || fps <= 0) {
+    return false;
+  }
+  target->width = width;
+  target->height = height;
+  target->min_fps = fps;
+  return true;
 }
 
-int main(int /* argc */, char* /* argv */[]) {
+// 用法: demo1_uyvy422 [宽x高@帧率]，默认 640x480@30
+int main(int argc, char* argv[]) {
   printf("=== V4L2 Demo 1: 视频流捕获 ===\n\n");
 
+  CaptureTarget target;
+  target.width = kVideoWidth;
+  target.height = kVideoHeight;
+  target.min_fps = kVideoMinFps;
+  target.preferred_formats.assign(std::begin(kPreferredFormats),
+                                  std::end(kPreferredFormats));
+  if (argc > 1 && !ParseCaptureTarget(argv[1], &target)) {
+    fprintf(stderr, "用法: %s [宽x高@帧率]，如 1920x1080@30\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
   // 查找可用的视频设备
   std::vector<DeviceInfo> devices;
   int device_count = FindVideoDevices(&devices);
@@ -281,25 +450,41 @@ int main(int /* argc */, char* /* argv */[]) {
   printf("  设备名称: %s\n", device_info.card_name.c_str());
   printf("  驱动名称: %s\n", device_info.driver_name.c_str());
   printf("  总线信息: %s\n", device_info.bus_info.c_str());
+  printf("  捕获接口: %s\n", device.IsMultiPlanar() ? "多平面 (MPLANE)" : "单平面");
   printf("  支持的格式数量: %zu\n", device_info.formats.size());
   printf("\n");
 
   // 打印所有支持的格式
-  PrintSupportedFormats(device_info.formats);
+  PrintSupportedFormats(device_info.format_caps);
+
+  // 控制项只枚举一次，之后的查询与修改都使用缓存表
+  CameraControls controls;
+  if (controls.Init(&device)) {
+    PrintControls(controls);
+  } else {
+    fprintf(stderr, "警告: 无法枚举控制项，运行时控制不可用\n");
+  }
 
-  // 自动选择最合适的格式
-  uint32_t selected_format = SelectBestFormat(device_info.formats);
-  if (selected_format == 0) {
-    fprintf(stderr, "错误: 设备不支持任何已知的像素格式\n");
+  // 根据目标分辨率、帧率和总线带宽选择格式
+  CaptureMode mode;
+  if (!SelectCaptureMode(device_info, target, &mode)) {
+    fprintf(stderr, "错误: 设备不支持任何可用的捕获模式\n");
     return EXIT_FAILURE;
   }
+  uint32_t selected_format = mode.pixel_format;
+
+  printf("目标: %ux%u @ ≥%.4g fps\n", target.width, target.height,
+         target.min_fps);
+  printf("自动选择: %ux%u, 格式: %s, 帧率: %.4g fps", mode.width,
+         mode.height, PixelFormatToString(mode.pixel_format).c_str(),
+         mode.fps);
+  if (!mode.compressed) {
+    printf(", 带宽: %.1f MB/s", mode.bandwidth / 1e6);
+  }
+  printf("\n\n");
 
-  printf("自动选择格式: %s\n\n", PixelFormatToString(selected_format).c_str());
-
-  // 设置视频格式
-  printf("设置视频格式: %ux%u, 格式: %s\n", kVideoWidth, kVideoHeight,
-         PixelFormatToString(selected_format).c_str());
-  if (!device.SetFormat(kVideoWidth, kVideoHeight, selected_format)) {
+  // 设置视频格式与帧率
+  if (!ApplyCaptureMode(&device, mode)) {
     fprintf(stderr, "错误: 无法设置视频格式\n");
     return EXIT_FAILURE;
   }
@@ -323,9 +508,69 @@ int main(int /* argc */, char* /* argv */[]) {
     selected_format = actual_format;
   }
 
+  // 录制容器：文件头记录格式与行跨度，之后的帧只追加，旧分段按数量淘汰
+  VideoFormat video_format;
+  if (!device.GetFormat(&video_format)) {
+    fprintf(stderr, "错误: 无法获取视频格式\n");
+    return EXIT_FAILURE;
+  }
+  ContainerWriterOptions container_options;
+  container_options.path_prefix = kRecordingPrefix;
+  container_options.pixel_format = actual_format;
+  container_options.width = actual_width;
+  container_options.height = actual_height;
+  container_options.bytes_per_line = video_format.bytesperline[0];
+  container_options.max_segment_bytes = kSegmentMaxBytes;
+  container_options.max_segments = kMaxSegments;
+  ContainerWriter container;
+  if (!container.Open(container_options)) {
+    fprintf(stderr, "错误: 无法创建录制文件\n");
+    return EXIT_FAILURE;
+  }
+
+  // 逐帧延迟统计（基于驱动时间戳）
+  FrameLatencyTracker latency;
+  device.SetLatencyTracker(&latency);
+
+  // 指标注册表：捕获线程只做计数，汇总与导出在导出线程中完成
+  MetricsRegistry registry;
+  CaptureMetrics metrics;
+  metrics.frames = registry.AddCounter("v4l2_frames_total", "出队的帧数", "",
+                                       kFpsWindowSeconds);
+  metrics.bytes = registry.AddCounter("v4l2_frame_bytes_total",
+                                      "出队的帧数据字节数", "",
+                                      kFpsWindowSeconds);
+  metrics.saved = registry.AddCounter("v4l2_saved_frames_total",
+                                      "进入写入队列的帧数");
+  metrics.save_dropped = registry.AddCounter(
+      "v4l2_save_dropped_frames_total", "写入队列满被丢弃的帧数");
+  metrics.motion_skipped = registry.AddCounter(
+      "v4l2_motion_skipped_frames_total", "画面静止而跳过保存的帧数");
+  metrics.dropped = registry.AddCounter("v4l2_dropped_frames_total",
+                                        "根据帧序号间隔推断的驱动丢帧数");
+  metrics.error_frames = registry.AddCounter("v4l2_error_frames_total",
+                                             "数据不完整或出错的帧数");
+  metrics.frame_size = registry.AddGauge("v4l2_frame_size_bytes",
+                                         "最近一帧的大小");
+  registry.AddExternalHistogram("v4l2_sensor_to_dequeue_us",
+                                "驱动时间戳到应用出队的延迟（微秒）",
+                                &latency.sensor_to_dequeue);
+  registry.AddExternalHistogram("v4l2_dequeue_to_release_us",
+                                "出队到租约释放的延迟（微秒）",
+                                &latency.dequeue_to_release);
+
+  // 丢帧检测：驱动帧序号不连续或缓冲区出错时计数
+  device.SetDropCallback([&metrics](const DropEvent& event) {
+    if (event.reason == DropReason::kSequenceGap) {
+      metrics.dropped->Add(event.count);
+    } else {
+      metrics.error_frames->Add();
+    }
+  });
+
   // 初始化内存映射
   printf("初始化内存映射缓冲区...\n");
-  if (!device.InitMemoryMapping(4)) {
+  if (!device.InitMemoryMapping(kBufferCount)) {
     fprintf(stderr, "错误: 无法初始化内存映射\n");
     return EXIT_FAILURE;
   }
@@ -339,54 +584,252 @@ int main(int /* argc */, char* /* argv */[]) {
   }
   printf("视频流已启动\n\n");
 
-  // 初始化统计信息
-  FrameStats stats = {};
-  stats.start_time = time(nullptr);
-  stats.last_save_time = stats.start_time;
-  stats.last_print_time = stats.start_time;
-  stats.current_frame_index = 0;
+  SaveState save_state;
+  save_state.last_save_time = time(nullptr);
+  save_state.last_written_time = save_state.last_save_time;
+
+  // 运动检测逐帧运行，保持期按帧计算；关键帧由保存逻辑按实际保存时间处理
+  MotionDetectorOptions motion_options;
+  motion_options.hold_seconds = kMotionHoldSeconds;
+  MotionDetector detector(motion_options);
+  registry.AddCallback("v4l2_motion_score", "最近一帧的变化块比例",
+                       MetricType::kGauge, [&detector]() {
+                         MotionStats motion_stats;
+                         detector.GetStats(&motion_stats);
+                         return motion_stats.last_score;
+                       });
 
   printf("开始捕获视频帧 (按 Ctrl+C 退出)...\n");
   printf("提示: 帧信息每秒更新一次，按 Ctrl+C 退出\n\n");
 
-  // 主循环：读取并处理帧
-  while (true) {
-    void* frame_data = nullptr;
-    size_t frame_size = 0;
-
-    // 读取一帧
-    if (device.ReadFrame(&frame_data, &frame_size)) {
-      stats.total_frames++;
-
-      // 打印帧信息（每秒打印一次）
-      PrintFrameInfo(&stats, frame_data, frame_size, actual_width,
-                     actual_height, actual_format);
-
-      // 检查是否需要保存帧（每秒保存一帧）
-      time_t current_time = time(nullptr);
-      if (difftime(current_time, stats.last_save_time) >=
-          kSaveIntervalSeconds) {
-        // 保存帧（使用实际设置的格式）
-        if (SaveFrameToFile(frame_data, frame_size,
-                            stats.current_frame_index, actual_format)) {
-          stats.saved_frames++;
-          stats.last_save_time = current_time;
-
-          // 更新帧索引（循环覆盖，0-19）
-          stats.current_frame_index =
-              (stats.current_frame_index + 1) % kMaxSavedFrames;
-        }
+  // 事件驱动捕获循环：设备有帧就绪时才被唤醒
+  CaptureLoop loop;
+  if (!loop.Init()) {
+    fprintf(stderr, "错误: 无法初始化捕获循环\n");
+    return EXIT_FAILURE;
+  }
+  // 驱动报错时原地重启视频流，设备断开时按退避间隔等待其重新出现
+  RecoveryOptions recovery_options;
+  recovery_options.enabled = true;
+  loop.SetRecoveryOptions(recovery_options);
+  registry.AddCallback("v4l2_device_recoveries_total", "设备出错后的恢复次数",
+                       MetricType::kCounter, [&loop]() {
+                         return static_cast<double>(loop.GetRecoveryCount());
+                       });
+
+  // 异步写入器：磁盘 I/O 在独立线程完成，不阻塞捕获
+  FrameWriterOptions writer_options;
+  writer_options.queue_capacity = kWriterQueueCapacity;
+  writer_options.overflow_policy = OverflowPolicy::kDropOldest;
+  FrameWriter writer(writer_options);
+  if (!writer.Start()) {
+    fprintf(stderr, "错误: 无法启动写入线程\n");
+    return EXIT_FAILURE;
+  }
+  registry.AddCallback("v4l2_writer_queue_depth", "写入队列深度",
+                       MetricType::kGauge, [&writer]() {
+                         FrameWriterStats writer_stats;
+                         writer.GetStats(&writer_stats);
+                         return static_cast<double>(writer_stats.queue_depth);
+                       });
+  registry.AddCallback("v4l2_writer_bytes_written_total", "已写入磁盘的字节数",
+                       MetricType::kCounter, [&writer]() {
+                         FrameWriterStats writer_stats;
+                         writer.GetStats(&writer_stats);
+                         return static_cast<double>(
+                             writer_stats.bytes_written);
+                       });
+
+  // 预触发录制器：平时只在内存中轮转，没有磁盘 I/O
+  PreTriggerOptions recorder_options;
+  recorder_options.pre_trigger_seconds = kPreTriggerSeconds;
+  recorder_options.post_trigger_seconds = kPostTriggerSeconds;
+  recorder_options.fps = mode.fps > 0 ? mode.fps : kVideoMinFps;
+  // 多内存平面格式按平面拼接保存，槽位取各平面大小之和
+  recorder_options.max_frame_size = 0;
+  for (uint32_t p = 0; p < video_format.plane_count; ++p) {
+    recorder_options.max_frame_size += video_format.sizeimage[p];
+  }
+  recorder_options.container = container_options;
+  recorder_options.container.path_prefix = kEventPrefix;
+  recorder_options.container.max_segments = 0;
+  PreTriggerRecorder recorder(recorder_options);
+  if (!recorder.Start()) {
+    fprintf(stderr, "错误: 无法启动预触发录制\n");
+    return EXIT_FAILURE;
+  }
+  registry.AddCallback("v4l2_pretrigger_buffered_frames",
+                       "预触发环中保留的帧数", MetricType::kGauge,
+                       [&recorder]() {
+                         PreTriggerStats recorder_stats;
+                         recorder.GetStats(&recorder_stats);
+                         return static_cast<double>(recorder_stats.buffered);
+                       });
+  registry.AddCallback("v4l2_pretrigger_events_total", "预触发录制的事件数",
+                       MetricType::kCounter, [&recorder]() {
+                         PreTriggerStats recorder_stats;
+                         recorder.GetStats(&recorder_stats);
+                         return static_cast<double>(recorder_stats.events);
+                       });
+
+  registry.AddCallback("v4l2_control_updates_total", "已应用的控制项修改数",
+                       MetricType::kCounter, [&controls]() {
+                         ControlStats control_stats;
+                         controls.GetStats(&control_stats);
+                         return static_cast<double>(control_stats.applied);
+                       });
+
+  // 指标导出与状态行打印都在导出线程中，端口被占用时只打印状态行
+  MetricsExporterOptions exporter_options;
+  exporter_options.http_port = kMetricsPort;
+  exporter_options.json_path = kMetricsJsonPath;
+  exporter_options.report_callback = [&]() {
+    MotionStats motion_stats;
+    detector.GetStats(&motion_stats);
+    PrintFrameInfo(&registry, metrics, latency, actual_width, actual_height,
+                   actual_format, motion_stats);
+  };
+  MetricsExporter exporter;
+  if (exporter.Start(&registry, exporter_options)) {
+    printf("指标: http://localhost:%d/metrics，%s\n\n", kMetricsPort,
+           kMetricsJsonPath);
+  } else {
+    exporter_options.http_port = 0;
+    if (!exporter.Start(&registry, exporter_options)) {
+      fprintf(stderr, "警告: 无法启动指标导出\n");
+    }
+  }
+
+#ifdef V4L2_DEMO_HAVE_JPEG
+  // 压缩格式：多线程解码为 I420，帧在内存中可供后续处理
+  std::unique_ptr<MjpegDecodeStage> decoder;
+  if (actual_format == V4L2_PIX_FMT_MJPEG ||
+      actual_format == V4L2_PIX_FMT_JPEG) {
+    MjpegDecodeOptions decode_options;
+    decode_options.width = actual_width;
+    decode_options.height = actual_height;
+    decode_options.output_format = V4L2_PIX_FMT_YUV420;
+    decoder.reset(new MjpegDecodeStage(decode_options));
+    // 解码后的 I420 帧按捕获顺序到达，可在此交给后续处理（转换、显示等）
+    if (!decoder->Start([](const DecodedFrame& /* frame */) {})) {
+      fprintf(stderr, "警告: 无法启动 MJPEG 解码，只保存压缩帧\n");
+      decoder.reset();
+    }
+  }
+#endif
+
+  g_capture_loop = &loop;
+  g_recorder = &recorder;
+  signal(SIGINT, HandleStopSignal);
+  signal(SIGTERM, HandleStopSignal);
+  signal(SIGUSR1, HandleTriggerSignal);
+  printf("预触发录制: 保留最近 %.0f 秒，kill -USR1 %d 触发\n",
+         kPreTriggerSeconds, getpid());
+  printf("运行时控制: 输入 名称=值 回车修改（如 brightness=128），? 列出\n\n");
+
+  std::atomic<bool> control_stop(false);
+  std::thread control_thread(RunControlCommands, &controls, &control_stop);
+
+  // 主循环：读取并处理帧（租约持有期间缓冲区不会被驱动覆盖）
+  bool ok = loop.Run(&device, [&](FrameLease* lease) {
+    // 其他线程请求的控制修改在两次出队之间合并为一次 ioctl 提交
+    controls.ApplyPending();
+
+    metrics.frames->Add();
+    metrics.bytes->Add(lease->size());
+    metrics.frame_size->Set(lease->size());
+
+#ifdef V4L2_DEMO_HAVE_JPEG
+    // 解码阶段拷贝压缩数据，不影响后续保存租约
+    if (decoder) {
+      decoder->Submit(*lease);
+    }
+#endif
+
+    // 每帧拷贝进预触发环（保存会转移租约，必须在其之前）
+    recorder.Push(*lease);
+
+    // 每帧都做运动检测（只读取亮度），得到逐帧的变化比例
+    MotionResult motion = detector.Process(
+        lease->data(), lease->size(), actual_format, actual_width,
+        actual_height, video_format.bytesperline[0], lease->dequeue_time_us());
+
+    // 检查是否需要保存帧（每秒最多一帧，画面静止时跳过）
+    time_t current_time = time(nullptr);
+    if (difftime(current_time, save_state.last_save_time) >=
+        kSaveIntervalSeconds) {
+      bool keyframe = difftime(current_time, save_state.last_written_time) >=
+                      kMotionKeyframeSeconds;
+      if (!motion.pass && !keyframe) {
+        metrics.motion_skipped->Add();
+        save_state.last_save_time = current_time;
+      } else if (SaveFrameToRecording(&writer, lease, &container, metrics)) {
+        save_state.last_save_time = current_time;
+        save_state.last_written_time = current_time;
       }
-    } else {
-      // 没有可用的帧，短暂休眠避免 CPU 占用过高
-      usleep(10000);  // 10ms
     }
+  });
+  g_capture_loop = nullptr;
+  g_recorder = nullptr;
+  control_stop = true;
+  control_thread.join();
+
+  // 写完剩余的帧并归还所有租约后才能停止视频流
+  recorder.Stop();
+  writer.Stop();
+  exporter.Stop();
+  FrameWriterStats writer_stats;
+  writer.GetStats(&writer_stats);
+  container.Close();
+  ContainerWriterStats container_stats;
+  container.GetStats(&container_stats);
+
+  printf("\n捕获结束，共 %lu 帧\n", metrics.frames->Value());
+  printf("写入: %lu 帧, 丢弃: %lu 帧, 失败: %lu 帧, 平均延迟: %.2f ms, "
+         "最大延迟: %.2f ms\n",
+         writer_stats.written, writer_stats.dropped, writer_stats.failed,
+         writer_stats.avg_latency_ms, writer_stats.max_latency_ms);
+  PreTriggerStats recorder_stats;
+  recorder.GetStats(&recorder_stats);
+  MotionStats motion_stats;
+  detector.GetStats(&motion_stats);
+  printf("运动检测: %lu 帧中 %lu 帧有运动, 静止跳过保存 %lu 次\n",
+         motion_stats.frames, motion_stats.motion_frames,
+         metrics.motion_skipped->Value());
+  ControlStats control_stats;
+  controls.GetStats(&control_stats);
+  printf("运行时控制: %lu 次请求, 应用 %lu 项 (%lu 次提交), 失败 %lu 项\n",
+         control_stats.requests, control_stats.applied, control_stats.batches,
+         control_stats.failures);
+  printf("预触发录制: %lu 个事件, 写入 %lu 帧, 丢弃 %lu 帧\n",
+         recorder_stats.events_saved, recorder_stats.frames_saved,
+         recorder_stats.dropped + recorder_stats.oversized);
+  printf("录制: %lu 帧, %u 个分段, 最后一个: %s\n", container_stats.frames,
+         container_stats.segments,
+         ContainerWriter::SegmentPath(kRecordingPrefix,
+                                      container_stats.current_segment)
+             .c_str());
+  DropStats drop_stats;
+  device.GetDropStats(&drop_stats);
+  printf("设备恢复: %lu 次\n", loop.GetRecoveryCount());
+  printf("驱动丢帧: %lu 帧, 错误帧: %lu 帧, 不完整帧: %lu 帧\n",
+         drop_stats.dropped, drop_stats.error_frames, drop_stats.short_frames);
+  latency.Print();
+
+#ifdef V4L2_DEMO_HAVE_JPEG
+  if (decoder) {
+    decoder->Stop();
+    MjpegDecodeStats decode_stats;
+    decoder->GetStats(&decode_stats);
+    printf("MJPEG 解码: %lu 帧, 失败: %lu 帧, 丢弃: %lu 帧, 平均耗时: %.2f ms\n",
+           decode_stats.decoded, decode_stats.failed, decode_stats.dropped,
+           decode_stats.avg_decode_ms);
   }
+#endif
 
-  // 清理资源（通常不会执行到这里，因为循环是无限的）
+  // 清理资源
   device.StopStreaming();
   device.Close();
 
-  return EXIT_SUCCESS;
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
 }
-
@@ -0,0 +1,213 @@
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <memory>
+#include <vector>
+
+#include "device_discovery.h"
+#include "frame_synchronizer.h"
+#include "multi_capture_engine.h"
+#include "v4l2_utils.h"
+
+using v4l2_demo::CameraConfig;
+using v4l2_demo::CaptureEngineOptions;
+using v4l2_demo::CameraStats;
+using v4l2_demo::DeviceEvent;
+using v4l2_demo::DeviceEventType;
+using v4l2_demo::DeviceInfo;
+using v4l2_demo::DeviceInfoCache;
+using v4l2_demo::DeviceWatcher;
+using v4l2_demo::FrameLease;
+using v4l2_demo::FrameSet;
+using v4l2_demo::FrameSyncOptions;
+using v4l2_demo::FrameSyncStats;
+using v4l2_demo::FrameSynchronizer;
+using v4l2_demo::MultiCaptureEngine;
+using v4l2_demo::PixelFormatToString;
+
+namespace {
+// 视频格式配置
+constexpr uint32_t kVideoWidth = 640;
+constexpr uint32_t kVideoHeight = 480;
+constexpr uint32_t kBufferCount = 4;
+
+// 帧同步：默认容差（30 fps 时小于半个帧周期），每个摄像头最多持有的
+// 待匹配帧数（小于 kBufferCount，驱动始终有缓冲区可用）
+constexpr double kDefaultSyncToleranceMs = 8;
+constexpr size_t kSyncMaxPending = 2;
+
+// 退出标志，由信号处理函数设置
+volatile sig_atomic_t g_stop_requested = 0;
+
+void HandleStopSignal(int /* signum */) {
+  g_stop_requested = 1;
+}
+
+// 选择格式：优先 YUYV，否则使用设备支持的第一个格式
+uint32_t SelectFormat(const std::vector<uint32_t>& formats) {
+  for (uint32_t format : formats) {
+    if (format == V4L2_PIX_FMT_YUYV) {
+      return format;
+    }
+  }
+  return formats.empty() ? 0 : formats[0];
+}
+}  // namespace
+
+// 用法: demo2_multi_capture [--thread-per-camera] [--rt-priority N] [--mlock]
+//                            [--prefault] [--sync [容差毫秒]]
+// 打开所有支持视频捕获的设备，由同一个引擎并发捕获并每秒打印统计
+//   --rt-priority N 捕获线程使用 SCHED_FIFO 优先级 N（1-99）
+//   --mlock         mlockall 锁定进程内存
+//   --prefault      映射缓冲区时预先建立页表
+//   --sync          按驱动时间戳把各摄像头的帧分组
+int main(int argc, char* argv[]) {
+  printf("=== V4L2 Demo 2: 多摄像头捕获 ===\n\n");
+
+  bool thread_per_camera = false;
+  bool prefault_buffers = false;
+  bool sync = false;
+  double sync_tolerance_ms = kDefaultSyncToleranceMs;
+  CaptureEngineOptions engine_options;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--thread-per-camera") == 0) {
+      thread_per_camera = true;
+    } else if (strcmp(argv[i], "--rt-priority") == 0 && i + 1 < argc) {
+      engine_options.reactor_sched_priority = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--mlock") == 0) {
+      engine_options.lock_memory = true;
+    } else if (strcmp(argv[i], "--prefault") == 0) {
+      prefault_buffers = true;
+    } else if (strcmp(argv[i], "--sync") == 0) {
+      sync = true;
+      // 可选的容差参数
+      if (i + 1 < argc && argv[i + 1][0] != '-') {
+        sync_tolerance_ms = atof(argv[++i]);
+      }
+    } else {
+      fprintf(stderr, "未知参数: %s\n", argv[i]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  // 设备信息缓存：重启时命中的设备跳过格式枚举
+  DeviceInfoCache cache(DeviceInfoCache::DefaultPath());
+  cache.Load();
+
+  // 热插拔监视器完成初始扫描，之后增量更新设备列表
+  DeviceWatcher watcher;
+  if (!watcher.Init(&cache)) {
+    fprintf(stderr, "错误: 无法初始化设备监视器\n");
+    return EXIT_FAILURE;
+  }
+  cache.Save();
+
+  std::vector<DeviceInfo> devices;
+  watcher.GetDevices(&devices);
+  if (devices.empty()) {
+    fprintf(stderr, "错误: 未找到可用的视频设备\n");
+    return EXIT_FAILURE;
+  }
+
+  // 同步器在所有摄像头加入后才知道摄像头数量，先创建空指针供回调捕获
+  MultiCaptureEngine engine(engine_options);
+  std::unique_ptr<FrameSynchronizer> synchronizer;
+  long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+  for (const auto& device : devices) {
+    uint32_t format = SelectFormat(device.formats);
+    if (format == 0) {
+      continue;
+    }
+
+    CameraConfig config;
+    config.device_path = device.device_path;
+    config.width = kVideoWidth;
+    config.height = kVideoHeight;
+    config.pixel_format = format;
+    config.buffer_count = kBufferCount;
+    // 独立线程模式下每个摄像头依次绑定到不同的 CPU 核
+    config.cpu_core =
+        (cpu_count > 0) ? engine.GetCameraCount() % cpu_count : -1;
+    config.sched_priority = engine_options.reactor_sched_priority;
+    config.prefault_buffers = prefault_buffers;
+
+    int id = engine.AddCamera(config, [&synchronizer](int camera_id,
+                                                      FrameLease* lease) {
+      if (synchronizer) {
+        synchronizer->Push(camera_id, lease);
+      }
+    });
+    if (id < 0) {
+      fprintf(stderr, "跳过设备 %s\n", device.device_path.c_str());
+      continue;
+    }
+    printf("摄像头 %d: %s (%s, %s)\n", id, device.device_path.c_str(),
+           device.card_name.c_str(), PixelFormatToString(format).c_str());
+  }
+
+  if (engine.GetCameraCount() == 0) {
+    fprintf(stderr, "错误: 没有可用的摄像头\n");
+    return EXIT_FAILURE;
+  }
+
+  if (sync) {
+    // 帧组的租约在回调返回后释放，可在回调中转移给多视图处理
+    FrameSyncOptions sync_options;
+    sync_options.camera_count = engine.GetCameraCount();
+    sync_options.tolerance_us =
+        static_cast<int64_t>(sync_tolerance_ms * 1000);
+    sync_options.max_pending = kSyncMaxPending;
+    synchronizer.reset(
+        new FrameSynchronizer(sync_options, [](FrameSet* /* set */) {}));
+    printf("帧同步: %zu 个摄像头，容差 %.1f ms\n", engine.GetCameraCount(),
+           sync_tolerance_ms);
+  }
+
+  signal(SIGINT, HandleStopSignal);
+  signal(SIGTERM, HandleStopSignal);
+
+  printf("\n启动捕获 (%s 模式，按 Ctrl+C 退出)...\n\n",
+         thread_per_camera ? "每摄像头独立线程" : "单反应器");
+  if (!engine.Start(thread_per_camera)) {
+    fprintf(stderr, "错误: 无法启动捕获\n");
+    return EXIT_FAILURE;
+  }
+
+  std::vector<CameraStats> stats;
+  while (!g_stop_requested) {
+    sleep(1);
+
+    // 新插入的设备只打印提示，不加入运行中的引擎
+    watcher.ProcessEvents([](const DeviceEvent& event) {
+      printf("%s: %s (%s)\n",
+             event.type == DeviceEventType::kAdded ? "设备接入" : "设备移除",
+             event.info.device_path.c_str(), event.info.card_name.c_str());
+    });
+
+    engine.GetStats(&stats);
+    for (size_t i = 0; i < stats.size(); ++i) {
+      printf("[%zu] %s | FPS: %.2f | 帧数: %lu | 丢帧: %lu | 坏帧: %lu\n", i,
+             stats[i].device_path.c_str(), stats[i].fps, stats[i].frames,
+             stats[i].dropped, stats[i].error_frames + stats[i].short_frames);
+    }
+    if (synchronizer) {
+      FrameSyncStats sync_stats;
+      synchronizer->GetStats(&sync_stats);
+      printf("同步 | 帧组: %lu | 时间差 平均: %.0f us 最大: %ld us | "
+             "未匹配: %lu | 过晚: %lu | 溢出: %lu\n",
+             sync_stats.groups, sync_stats.avg_spread_us,
+             sync_stats.max_spread_us, sync_stats.unmatched, sync_stats.late,
+             sync_stats.overflow);
+    }
+    printf("\n");
+  }
+
+  engine.Stop();
+  if (synchronizer) {
+    synchronizer->Clear();
+  }
+  printf("捕获结束\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,200 @@
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+
+#include "capture_loop.h"
+#include "format_selector.h"
+#include "m2m_encoder_sink.h"
+#include "motion_detector.h"
+#include "v4l2_utils.h"
+
+using v4l2_demo::ApplyCaptureMode;
+using v4l2_demo::CaptureLoop;
+using v4l2_demo::CaptureMode;
+using v4l2_demo::CaptureTarget;
+using v4l2_demo::DeviceInfo;
+using v4l2_demo::FindVideoDevices;
+using v4l2_demo::FrameLease;
+using v4l2_demo::M2mEncoderOptions;
+using v4l2_demo::M2mEncoderSink;
+using v4l2_demo::M2mEncoderStats;
+using v4l2_demo::MotionDetector;
+using v4l2_demo::MotionDetectorOptions;
+using v4l2_demo::MotionStats;
+using v4l2_demo::PixelFormatToString;
+using v4l2_demo::SelectCaptureMode;
+using v4l2_demo::V4L2Device;
+using v4l2_demo::VideoFormat;
+
+namespace {
+// 录制目标：编码器需要非压缩输入
+constexpr uint32_t kVideoWidth = 1280;
+constexpr uint32_t kVideoHeight = 720;
+constexpr double kVideoMinFps = 30;
+
+// 共享模式下编码器会持有部分捕获缓冲区，需要比单纯捕获多几个
+constexpr uint32_t kBufferCount = 6;
+
+constexpr const char* kOutputDirectory = "output";
+constexpr const char* kOutputPath = "output/capture.h264";
+
+// --motion：画面静止时不送编码器，运动结束后继续编码 2 秒，静止期间每 10 秒
+// 编码一帧。Annex-B 码流没有时间戳，跳过的时段在播放时被压缩
+constexpr double kMotionHoldSeconds = 2;
+constexpr double kMotionKeyframeSeconds = 10;
+
+// 捕获循环实例，供信号处理函数请求退出
+CaptureLoop* g_capture_loop = nullptr;
+
+void HandleStopSignal(int /* signum */) {
+  if (g_capture_loop) {
+    g_capture_loop->Stop();
+  }
+}
+}  // namespace
+
+// 用法: demo3_h264_record [--motion] [捕获设备] [编码器设备]
+// 捕获非压缩视频并送入 V4L2 M2M 硬件编码器，录制为 H.264 Annex-B 码流
+int main(int argc, char* argv[]) {
+  printf("=== V4L2 Demo 3: 硬件编码录制 ===\n\n");
+  bool motion_gate = false;
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--motion") == 0) {
+      motion_gate = true;
+    } else {
+      args.push_back(argv[i]);
+    }
+  }
+
+  std::vector<DeviceInfo> devices;
+  FindVideoDevices(&devices);
+  DeviceInfo device_info;
+  bool found = false;
+  for (const auto& info : devices) {
+    if (args.empty() || info.device_path == args[0]) {
+      device_info = info;
+      found = true;
+      break;
+    }
+  }
+  if (!found) {
+    fprintf(stderr, "错误: 未找到可用的视频捕获设备\n");
+    return EXIT_FAILURE;
+  }
+  printf("使用设备: %s (%s)\n", device_info.device_path.c_str(),
+         device_info.card_name.c_str());
+
+  if (mkdir(kOutputDirectory, 0755) != 0 && errno != EEXIST) {
+    fprintf(stderr, "无法创建输出目录 %s: %s\n", kOutputDirectory,
+            strerror(errno));
+    return EXIT_FAILURE;
+  }
+
+  V4L2Device device;
+  if (!device.Open(device_info.device_path)) {
+    return EXIT_FAILURE;
+  }
+
+  CaptureTarget target;
+  target.width = kVideoWidth;
+  target.height = kVideoHeight;
+  target.min_fps = kVideoMinFps;
+  target.allow_compressed = false;
+  CaptureMode mode;
+  if (!SelectCaptureMode(device_info, target, &mode) ||
+      !ApplyCaptureMode(&device, mode)) {
+    fprintf(stderr, "错误: 设备没有可用的非压缩格式\n");
+    return EXIT_FAILURE;
+  }
+  printf("捕获格式: %ux%u %s @ %.4g fps\n", mode.width, mode.height,
+         PixelFormatToString(mode.pixel_format).c_str(), mode.fps);
+
+  // 优先导出 DMABUF 与编码器共享，驱动不支持时退回普通内存映射
+  if (!device.InitDmaBuf(kBufferCount)) {
+    printf("驱动不支持 DMABUF 导出，使用拷贝模式\n");
+    if (!device.InitMemoryMapping(kBufferCount)) {
+      fprintf(stderr, "错误: 无法初始化内存映射\n");
+      return EXIT_FAILURE;
+    }
+  }
+
+  M2mEncoderOptions options;
+  options.encoder_path = args.size() > 1 ? args[1] : "";
+  options.output_path = kOutputPath;
+  M2mEncoderSink sink;
+  if (!sink.Init(&device, options)) {
+    fprintf(stderr, "错误: 无法初始化硬件编码器\n");
+    return EXIT_FAILURE;
+  }
+
+  CaptureLoop loop;
+  if (!loop.Init() || !device.StartStreaming()) {
+    fprintf(stderr, "错误: 无法启动视频流\n");
+    return EXIT_FAILURE;
+  }
+
+  g_capture_loop = &loop;
+  signal(SIGINT, HandleStopSignal);
+  signal(SIGTERM, HandleStopSignal);
+  printf("开始录制到 %s (按 Ctrl+C 退出)...\n", kOutputPath);
+
+  // 运动门控只读取亮度；DMABUF 无法映射时帧直接放行
+  MotionDetectorOptions motion_options;
+  motion_options.hold_seconds = kMotionHoldSeconds;
+  motion_options.keyframe_seconds = kMotionKeyframeSeconds;
+  MotionDetector detector(motion_options);
+  VideoFormat format;
+  if (!device.GetFormat(&format)) {
+    fprintf(stderr, "错误: 无法获取视频格式\n");
+    return EXIT_FAILURE;
+  }
+
+  // 租约交给编码器，编码器归还输入缓冲区时才重新入队给驱动；
+  // 被门控跳过的帧随租约析构立即归还
+  bool ok = loop.Run(&device, [&](FrameLease* lease) {
+    if (motion_gate &&
+        !detector
+             .Process(lease->data(), lease->size(), format.pixel_format,
+                      format.width, format.height, format.bytesperline[0],
+                      lease->dequeue_time_us())
+             .pass) {
+      return;
+    }
+    sink.Submit(lease);
+  });
+  g_capture_loop = nullptr;
+
+  // 排空编码器并归还所有租约后才能停止视频流
+  sink.Close();
+  device.StopStreaming();
+
+  M2mEncoderStats stats;
+  sink.GetStats(&stats);
+  printf("\n录制结束: 输入 %lu 帧, 丢弃 %lu 帧, 输出 %lu 包（关键帧 %lu）\n",
+         stats.frames_in, stats.dropped, stats.frames_out, stats.keyframes);
+  printf("原始数据 %.1f MB -> 码流 %.1f MB", stats.bytes_in / 1e6,
+         stats.bytes_out / 1e6);
+  if (stats.bytes_out > 0) {
+    printf("（压缩比 %.0f:1）", static_cast<double>(stats.bytes_in) /
+                                   stats.bytes_out);
+  }
+  printf("\n模式: %s%s\n", stats.dmabuf ? "DMABUF 共享" : "拷贝",
+         stats.converted ? "（格式转换）" : "");
+  if (motion_gate) {
+    MotionStats motion_stats;
+    detector.GetStats(&motion_stats);
+    printf("运动门控: %lu 帧中编码 %lu 帧, 跳过 %lu 帧\n",
+           motion_stats.frames, motion_stats.passed, motion_stats.skipped);
+  }
+  printf("播放: ffplay %s；封装: ffmpeg -i %s -c copy capture.mp4\n",
+         kOutputPath, kOutputPath);
+
+  device.Close();
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
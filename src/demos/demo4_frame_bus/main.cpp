@@ -0,0 +1,221 @@
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+#include "capture_loop.h"
+#include "format_selector.h"
+#include "frame_bus.h"
+#include "v4l2_utils.h"
+
+using v4l2_demo::ApplyCaptureMode;
+using v4l2_demo::CaptureLoop;
+using v4l2_demo::CaptureMode;
+using v4l2_demo::CaptureTarget;
+using v4l2_demo::DeviceInfo;
+using v4l2_demo::FindVideoDevices;
+using v4l2_demo::FrameBusMode;
+using v4l2_demo::FrameBusOptions;
+using v4l2_demo::FrameBusPublisher;
+using v4l2_demo::FrameBusReader;
+using v4l2_demo::FrameBusReaderStats;
+using v4l2_demo::FrameBusStats;
+using v4l2_demo::FrameLease;
+using v4l2_demo::FrameView;
+using v4l2_demo::MonotonicMicros;
+using v4l2_demo::PixelFormatToString;
+using v4l2_demo::SelectCaptureMode;
+using v4l2_demo::V4L2Device;
+
+namespace {
+constexpr const char* kSocketPath = "/tmp/v4l2_demo_frame_bus.sock";
+
+// DMABUF 模式下发布者持有 kSlotCount 帧，驱动还需要留出轮转的缓冲区
+constexpr uint32_t kSlotCount = 4;
+constexpr uint32_t kBufferCount = kSlotCount + 4;
+
+// 亮度采样间隔（字节），读者只做轻量计算以演示直接读取共享内存
+constexpr size_t kSampleStride = 64;
+
+volatile sig_atomic_t g_running = 1;
+CaptureLoop* g_capture_loop = nullptr;
+
+void HandleStopSignal(int /* signum */) {
+  g_running = 0;
+  if (g_capture_loop) {
+    g_capture_loop->Stop();
+  }
+}
+
+void PrintUsage(const char* program) {
+  fprintf(stderr,
+          "用法:\n"
+          "  %s publish [设备] [--dmabuf]  捕获并发布到帧总线\n"
+          "  %s subscribe                  作为读者连接帧总线\n",
+          program, program);
+}
+
+int RunPublisher(int argc, char* argv[]) {
+  std::string device_path;
+  bool use_dmabuf = false;
+  for (int i = 2; i < argc; ++i) {
+    if (strcmp(argv[i], "--dmabuf") == 0) {
+      use_dmabuf = true;
+    } else {
+      device_path = argv[i];
+    }
+  }
+
+  std::vector<DeviceInfo> devices;
+  FindVideoDevices(&devices);
+  DeviceInfo device_info;
+  bool found = false;
+  for (const auto& info : devices) {
+    if (device_path.empty() || info.device_path == device_path) {
+      device_info = info;
+      found = true;
+      break;
+    }
+  }
+  if (!found) {
+    fprintf(stderr, "错误: 未找到可用的视频捕获设备\n");
+    return EXIT_FAILURE;
+  }
+
+  V4L2Device device;
+  if (!device.Open(device_info.device_path)) {
+    return EXIT_FAILURE;
+  }
+  CaptureTarget target;
+  CaptureMode mode;
+  if (!SelectCaptureMode(device_info, target, &mode) ||
+      !ApplyCaptureMode(&device, mode)) {
+    fprintf(stderr, "错误: 设备不支持任何可用的捕获模式\n");
+    return EXIT_FAILURE;
+  }
+  printf("发布 %s: %ux%u %s @ %.4g fps\n", device_info.device_path.c_str(),
+         mode.width, mode.height,
+         PixelFormatToString(mode.pixel_format).c_str(), mode.fps);
+
+  bool buffers_ready = use_dmabuf ? device.InitDmaBuf(kBufferCount)
+                                  : device.InitMemoryMapping(kBufferCount);
+  if (!buffers_ready) {
+    fprintf(stderr, "错误: 无法初始化缓冲区\n");
+    return EXIT_FAILURE;
+  }
+
+  FrameBusOptions options;
+  options.socket_path = kSocketPath;
+  options.mode = use_dmabuf ? FrameBusMode::kDmaBuf : FrameBusMode::kCopy;
+  options.slot_count = kSlotCount;
+  FrameBusPublisher publisher;
+  if (!publisher.Init(&device, options)) {
+    fprintf(stderr, "错误: 无法创建帧总线\n");
+    return EXIT_FAILURE;
+  }
+
+  CaptureLoop loop;
+  if (!loop.Init() || !device.StartStreaming()) {
+    fprintf(stderr, "错误: 无法启动视频流\n");
+    return EXIT_FAILURE;
+  }
+  g_capture_loop = &loop;
+  signal(SIGINT, HandleStopSignal);
+  signal(SIGTERM, HandleStopSignal);
+  printf("帧总线: %s（%s 模式），在其他终端运行 subscribe 连接\n",
+         kSocketPath, use_dmabuf ? "DMABUF 零拷贝" : "共享内存");
+
+  time_t last_report = time(nullptr);
+  bool ok = loop.Run(&device, [&](FrameLease* lease) {
+    publisher.Publish(lease);
+    time_t now = time(nullptr);
+    if (now != last_report) {
+      last_report = now;
+      FrameBusStats stats;
+      publisher.GetStats(&stats);
+      printf("\r已发布: %lu 帧 | 丢弃: %lu | 读者: %lu    ", stats.published,
+             stats.dropped, stats.clients);
+      fflush(stdout);
+    }
+  });
+  g_capture_loop = nullptr;
+
+  // 先关闭总线归还持有的租约，再停止视频流
+  publisher.Close();
+  device.StopStreaming();
+  printf("\n发布结束\n");
+  device.Close();
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int RunSubscriber() {
+  FrameBusReader reader;
+  if (!reader.Connect(kSocketPath)) {
+    fprintf(stderr, "错误: 无法连接帧总线，发布者是否已启动？\n");
+    return EXIT_FAILURE;
+  }
+  signal(SIGINT, HandleStopSignal);
+  signal(SIGTERM, HandleStopSignal);
+  printf("已连接 %s\n", kSocketPath);
+
+  uint64_t frames = 0;
+  uint64_t last_frames = 0;
+  int64_t last_report_us = MonotonicMicros();
+  uint32_t average = 0;
+  FrameView view;
+  memset(&view, 0, sizeof(view));
+  while (g_running && reader.IsConnected()) {
+    if (!reader.WaitForFrame(1000)) {
+      continue;
+    }
+    while (reader.BeginRead(&view)) {
+      // 直接在共享内存上计算，结果只有 EndRead 确认后才采用
+      const uint8_t* data = static_cast<const uint8_t*>(view.data());
+      uint64_t sum = 0;
+      size_t samples = 0;
+      for (size_t i = 0; i < view.size(); i += kSampleStride) {
+        sum += data[i];
+        samples++;
+      }
+      if (reader.EndRead(view)) {
+        average = samples ? sum / samples : 0;
+        frames++;
+      }
+    }
+
+    int64_t now_us = MonotonicMicros();
+    if (now_us - last_report_us >= 1000000) {
+      FrameBusReaderStats stats;
+      reader.GetStats(&stats);
+      printf("\r读取: %lu 帧 | FPS: %.1f | 被覆盖: %lu | 跳过: %lu | "
+             "%ux%u %s | 采样均值: %u    ",
+             frames,
+             (frames - last_frames) * 1e6 / (now_us - last_report_us),
+             stats.torn, stats.overruns, view.width, view.height,
+             PixelFormatToString(view.pixel_format).c_str(), average);
+      fflush(stdout);
+      last_frames = frames;
+      last_report_us = now_us;
+    }
+  }
+  printf("\n读者退出\n");
+  return EXIT_SUCCESS;
+}
+}  // namespace
+
+// 用法: demo4_frame_bus publish [设备] [--dmabuf] | subscribe
+// 一个进程捕获并发布，任意多个进程通过共享内存读取同一路视频
+int main(int argc, char* argv[]) {
+  printf("=== V4L2 Demo 4: 多进程帧总线 ===\n\n");
+  if (argc >= 2 && strcmp(argv[1], "publish") == 0) {
+    return RunPublisher(argc, argv);
+  }
+  if (argc >= 2 && strcmp(argv[1], "subscribe") == 0) {
+    return RunSubscriber();
+  }
+  PrintUsage(argv[0]);
+  return EXIT_FAILURE;
+}
@@ -0,0 +1,275 @@
+#include <linux/videodev2.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "capture_loop.h"
+#include "format_selector.h"
+#include "frame_pipeline.h"
+#include "pipeline_stages.h"
+#include "v4l2_utils.h"
+
+using v4l2_demo::ApplyCaptureMode;
+using v4l2_demo::ApplyScaleTarget;
+using v4l2_demo::CallbackStage;
+using v4l2_demo::CaptureLoop;
+using v4l2_demo::CaptureMode;
+using v4l2_demo::CaptureTarget;
+using v4l2_demo::ConvertStage;
+using v4l2_demo::CropStage;
+using v4l2_demo::DeviceInfo;
+using v4l2_demo::FileSinkOptions;
+using v4l2_demo::FileSinkStage;
+using v4l2_demo::FindVideoDevices;
+using v4l2_demo::FrameLease;
+using v4l2_demo::FramePipeline;
+using v4l2_demo::MonotonicMicros;
+using v4l2_demo::OverflowPolicy;
+using v4l2_demo::PipelineFrame;
+using v4l2_demo::PipelineStage;
+using v4l2_demo::PipelineStats;
+using v4l2_demo::PixelFormatToString;
+using v4l2_demo::ScalePlan;
+using v4l2_demo::ScaleStage;
+using v4l2_demo::ScaleTarget;
+using v4l2_demo::SelectCaptureMode;
+using v4l2_demo::StageExecution;
+using v4l2_demo::StageOptions;
+using v4l2_demo::StageResult;
+using v4l2_demo::V4L2Device;
+using v4l2_demo::VideoFormat;
+
+namespace {
+// 管线中的源帧持有驱动缓冲区，缓冲区数量需大于各根阶段的队列容量之和
+constexpr uint32_t kBufferCount = 8;
+
+// 文件 sink 每隔多少帧保存一帧
+constexpr uint32_t kSaveEveryN = 30;
+
+// 亮度采样间隔（字节）
+constexpr size_t kSampleStride = 64;
+
+CaptureLoop* g_capture_loop = nullptr;
+
+void HandleStopSignal(int /* signum */) {
+  if (g_capture_loop) {
+    g_capture_loop->Stop();
+  }
+}
+
+// 解析 "宽x高" 与可选的 "x,y,宽,高"
+// @return 参数格式正确返回 true
+bool ParseScaleTarget(int argc, char* argv[], ScaleTarget* target) {
+  if (argc < 3) {
+    return true;
+  }
+  if (sscanf(argv[2], "%ux%u", &target->width, &target->height) != 2 ||
+      target->width == 0 || target->height == 0) {
+    return false;
+  }
+  return argc < 4 ||
+         sscanf(argv[3], "%d,%d,%u,%u", &target->roi.left, &target->roi.top,
+                &target->roi.width, &target->roi.height) == 4;
+}
+
+// 在 parent 之后接上软件裁剪与缩放阶段
+// @return 最后一个阶段的索引，不需要软件处理时返回 parent
+int AddScaleStages(FramePipeline* pipeline, const ScalePlan& plan,
+                   int parent) {
+  StageOptions options;
+  options.queue_capacity = 2;
+  if (plan.NeedsSoftwareCrop()) {
+    parent = pipeline->AddStage(
+        std::unique_ptr<PipelineStage>(new CropStage(
+            plan.software_crop.left, plan.software_crop.top,
+            plan.software_crop.width, plan.software_crop.height)),
+        parent, options);
+  }
+  if (plan.NeedsSoftwareScale()) {
+    parent = pipeline->AddStage(
+        std::unique_ptr<PipelineStage>(
+            new ScaleStage(plan.output_width, plan.output_height)),
+        parent, options);
+  }
+  return parent;
+}
+
+void PrintStats(const PipelineStats& stats) {
+  printf("源帧: %lu | 丢弃: %lu\n", stats.pushed, stats.dropped);
+  printf("  %-20s %8s %7s %6s %6s %9s %9s %9s\n", "阶段", "处理", "FPS",
+         "丢弃", "失败", "队列", "平均ms", "最大ms");
+  for (const auto& stage : stats.stages) {
+    printf("  %-20s %8lu %7.1f %6lu %6lu %4zu/%-4zu %9.2f %9.2f\n",
+           stage.name.c_str(), stage.processed, stage.fps, stage.dropped,
+           stage.failed, stage.queue_depth, stage.queue_capacity,
+           stage.avg_process_ms, stage.max_process_ms);
+  }
+}
+}  // namespace
+
+// 用法: demo5_pipeline [设备] [输出宽x高 [感兴趣区域 x,y,宽,高]]
+// 捕获 -> 转换为 NV12（共享线程池）-> 每 30 帧保存一帧（独占线程），
+// 同时源帧扇出给亮度统计阶段；每秒打印各阶段吞吐与队列占用
+// 指定输出尺寸时先让驱动裁剪/缩放（VIDIOC_S_SELECTION + S_FMT），
+// 驱动没做完的部分在转换前由裁剪与缩放阶段补上
+int main(int argc, char* argv[]) {
+  printf("=== V4L2 Demo 5: 帧处理管线 ===\n\n");
+  std::string device_path = argc >= 2 ? argv[1] : "";
+  ScaleTarget scale_target;
+  if (!ParseScaleTarget(argc, argv, &scale_target)) {
+    fprintf(stderr, "用法: %s [设备] [宽x高 [x,y,宽,高]]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  std::vector<DeviceInfo> devices;
+  FindVideoDevices(&devices);
+  DeviceInfo device_info;
+  bool found = false;
+  for (const auto& info : devices) {
+    if (device_path.empty() || info.device_path == device_path) {
+      device_info = info;
+      found = true;
+      break;
+    }
+  }
+  if (!found) {
+    fprintf(stderr, "错误: 未找到可用的视频捕获设备\n");
+    return EXIT_FAILURE;
+  }
+
+  V4L2Device device;
+  if (!device.Open(device_info.device_path)) {
+    return EXIT_FAILURE;
+  }
+  CaptureTarget target;
+  CaptureMode mode;
+  if (!SelectCaptureMode(device_info, target, &mode) ||
+      !ApplyCaptureMode(&device, mode)) {
+    fprintf(stderr, "错误: 设备不支持任何可用的捕获模式\n");
+    return EXIT_FAILURE;
+  }
+  ScalePlan scale_plan;
+  bool scaling = scale_target.width != 0;
+  if (scaling && !ApplyScaleTarget(&device, scale_target, &scale_plan)) {
+    return EXIT_FAILURE;
+  }
+  VideoFormat format;
+  if (!device.GetFormat(&format) || !device.InitMemoryMapping(kBufferCount)) {
+    fprintf(stderr, "错误: 无法初始化缓冲区\n");
+    return EXIT_FAILURE;
+  }
+  printf("捕获 %s: %ux%u %s @ %.4g fps\n", device_info.device_path.c_str(),
+         format.width, format.height,
+         PixelFormatToString(format.pixel_format).c_str(), mode.fps);
+  if (scaling) {
+    printf("输出 %ux%u: 驱动%s%s，软件裁剪 %ux%u+%d+%d%s\n",
+           scale_plan.output_width, scale_plan.output_height,
+           scale_plan.hardware_crop ? "裁剪" : "未裁剪",
+           scale_plan.hardware_scale ? "并缩放" : "",
+           scale_plan.software_crop.width, scale_plan.software_crop.height,
+           scale_plan.software_crop.left, scale_plan.software_crop.top,
+           scale_plan.NeedsSoftwareScale() ? "，软件缩放" : "");
+  }
+
+  // 解码/转换阶段：压缩格式需要 libjpeg
+  bool compressed = format.pixel_format == V4L2_PIX_FMT_MJPEG ||
+                    format.pixel_format == V4L2_PIX_FMT_JPEG;
+  std::unique_ptr<PipelineStage> to_nv12;
+  if (compressed) {
+#ifdef V4L2_DEMO_HAVE_JPEG
+    to_nv12.reset(new v4l2_demo::JpegDecodeStage(V4L2_PIX_FMT_NV12));
+#else
+    fprintf(stderr, "错误: 设备只输出 MJPEG，但编译时未找到 libjpeg\n");
+    return EXIT_FAILURE;
+#endif
+  } else {
+    to_nv12.reset(new ConvertStage(V4L2_PIX_FMT_NV12));
+  }
+
+  // 非压缩源在转换前缩小，减少转换的数据量；MJPEG 只能在解码后处理
+  FramePipeline pipeline;
+  StageOptions convert_options;
+  convert_options.queue_capacity = 2;
+  int convert;
+  if (!scaling) {
+    convert = pipeline.AddStage(std::move(to_nv12), -1, convert_options);
+  } else if (compressed) {
+    convert = AddScaleStages(
+        &pipeline, scale_plan,
+        pipeline.AddStage(std::move(to_nv12), -1, convert_options));
+  } else {
+    convert = pipeline.AddStage(std::move(to_nv12),
+                                AddScaleStages(&pipeline, scale_plan, -1),
+                                convert_options);
+  }
+
+  FileSinkOptions file_options;
+  file_options.path_pattern = "output/pipeline_%03d.nv12";
+  file_options.every_n = kSaveEveryN;
+  file_options.max_files = 10;
+  StageOptions sink_options;
+  sink_options.execution = StageExecution::kDedicatedThread;
+  pipeline.AddStage(std::unique_ptr<PipelineStage>(
+                        new FileSinkStage(file_options)),
+                    convert, sink_options);
+
+  // 统计分支只看最新帧，来不及处理时丢弃旧帧而不是反压
+  std::atomic<uint32_t> average_luma(0);
+  StageOptions stats_options;
+  stats_options.queue_capacity = 2;
+  stats_options.overflow_policy = OverflowPolicy::kDropOldest;
+  pipeline.AddStage(
+      std::unique_ptr<PipelineStage>(new CallbackStage(
+          "luma",
+          [&average_luma](const PipelineFrame& input, PipelineFrame*) {
+            // 打包 YUV 的偶数字节与平面格式的开头都是亮度，仅作粗略统计
+            const uint8_t* data = static_cast<const uint8_t*>(input.data());
+            uint64_t sum = 0;
+            size_t samples = 0;
+            for (size_t i = 0; i < input.size(); i += kSampleStride) {
+              sum += data[i];
+              samples++;
+            }
+            average_luma = samples ? sum / samples : 0;
+            return StageResult::kConsume;
+          })),
+      -1, stats_options);
+
+  CaptureLoop loop;
+  if (!pipeline.Start(format) || !loop.Init() || !device.StartStreaming()) {
+    fprintf(stderr, "错误: 无法启动管线或视频流\n");
+    return EXIT_FAILURE;
+  }
+  g_capture_loop = &loop;
+  signal(SIGINT, HandleStopSignal);
+  signal(SIGTERM, HandleStopSignal);
+  printf("按 Ctrl+C 停止\n\n");
+
+  int64_t last_report_us = MonotonicMicros();
+  bool ok = loop.Run(&device, [&](FrameLease* lease) {
+    pipeline.Push(lease);
+    int64_t now_us = MonotonicMicros();
+    if (now_us - last_report_us >= 1000000) {
+      last_report_us = now_us;
+      PipelineStats stats;
+      pipeline.GetStats(&stats);
+      PrintStats(stats);
+      printf("  采样亮度: %u\n\n", average_luma.load());
+    }
+  });
+  g_capture_loop = nullptr;
+
+  // 先停止管线归还所有租约，再停止视频流
+  pipeline.Stop();
+  device.StopStreaming();
+  PipelineStats stats;
+  pipeline.GetStats(&stats);
+  printf("\n最终统计:\n");
+  PrintStats(stats);
+  device.Close();
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
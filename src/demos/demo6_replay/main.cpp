@@ -0,0 +1,137 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+
+#include "frame_container.h"
+#include "v4l2_utils.h"
+
+using v4l2_demo::ContainerFrame;
+using v4l2_demo::ContainerInfo;
+using v4l2_demo::ContainerReader;
+using v4l2_demo::PixelFormatToString;
+
+namespace {
+
+void PrintUsage(const char* program) {
+  fprintf(stderr,
+          "用法:\n"
+          "  %s <分段.v4lc>                        打印格式与帧统计\n"
+          "  %s <分段.v4lc> <帧号|@时间戳us> <输出>  导出一帧原始数据\n",
+          program, program);
+}
+
+// 打印分段的格式、时间跨度、平均帧率与帧序号间隔（录制时的丢帧）
+void PrintSummary(const ContainerReader& reader) {
+  const ContainerInfo& info = reader.info();
+  size_t count = reader.GetFrameCount();
+  printf("分段 %u: %ux%u, 格式: %s, 行跨度: %u, 索引: %s\n", info.segment,
+         info.width, info.height,
+         PixelFormatToString(info.pixel_format).c_str(), info.bytes_per_line,
+         info.indexed ? "完整" : "扫描重建");
+  printf("帧数: %zu\n", count);
+  if (count == 0) {
+    return;
+  }
+
+  ContainerFrame first, last, frame;
+  if (!reader.GetFrame(0, &first) || !reader.GetFrame(count - 1, &last)) {
+    fprintf(stderr, "错误: 帧记录损坏\n");
+    return;
+  }
+  uint64_t total_bytes = 0;
+  uint64_t sequence_gaps = 0;
+  uint32_t previous_sequence = first.sequence;
+  for (size_t i = 0; i < count; ++i) {
+    if (!reader.GetFrame(i, &frame)) {
+      fprintf(stderr, "错误: 帧 %zu 记录损坏\n", i);
+      return;
+    }
+    total_bytes += frame.size;
+    if (i > 0 && frame.sequence != previous_sequence + 1) {
+      ++sequence_gaps;
+    }
+    previous_sequence = frame.sequence;
+  }
+
+  double duration_s = (last.timestamp_us - first.timestamp_us) / 1e6;
+  printf("时间戳: %ld.%06ld - %ld.%06ld (%.3f 秒)\n",
+         first.timestamp_us / 1000000, first.timestamp_us % 1000000,
+         last.timestamp_us / 1000000, last.timestamp_us % 1000000, duration_s);
+  printf("帧序号: %u - %u, 不连续 %lu 处\n", first.sequence, last.sequence,
+         sequence_gaps);
+  if (duration_s > 0) {
+    printf("平均帧率: %.2f fps\n", (count - 1) / duration_s);
+  }
+  printf("数据量: %lu 字节, 平均每帧 %lu 字节\n", total_bytes,
+         total_bytes / count);
+}
+
+// 把一帧写入文件
+// @return 成功返回 true，失败返回 false
+bool WriteFrame(const ContainerFrame& frame, const char* path) {
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    fprintf(stderr, "无法打开文件 %s 进行写入: %s\n", path, strerror(errno));
+    return false;
+  }
+  const uint8_t* data = static_cast<const uint8_t*>(frame.data);
+  size_t remaining = frame.size;
+  while (remaining > 0) {
+    ssize_t n = write(fd, data, remaining);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fprintf(stderr, "写入文件 %s 失败: %s\n", path, strerror(errno));
+      close(fd);
+      return false;
+    }
+    data += n;
+    remaining -= n;
+  }
+  close(fd);
+  return true;
+}
+}  // namespace
+
+// 用法见 PrintUsage
+// 读取 demo1 录制的分段容器：mmap 后按索引直接定位，不解析整个文件
+int main(int argc, char* argv[]) {
+  if (argc != 2 && argc != 4) {
+    PrintUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  ContainerReader reader;
+  if (!reader.Open(argv[1])) {
+    return EXIT_FAILURE;
+  }
+  if (argc == 2) {
+    PrintSummary(reader);
+    return EXIT_SUCCESS;
+  }
+
+  // 帧号直接索引；@时间戳 在索引上二分查找不早于该时刻的第一帧
+  size_t index;
+  if (argv[2][0] == '@') {
+    index = reader.FindFrame(strtoll(argv[2] + 1, nullptr, 10));
+  } else {
+    index = strtoull(argv[2], nullptr, 10);
+  }
+  ContainerFrame frame;
+  if (!reader.GetFrame(index, &frame)) {
+    fprintf(stderr, "错误: 帧 %zu 不存在（共 %zu 帧）\n", index,
+            reader.GetFrameCount());
+    return EXIT_FAILURE;
+  }
+  if (!WriteFrame(frame, argv[3])) {
+    return EXIT_FAILURE;
+  }
+  printf("已导出帧 %zu (序号 %u, 时间戳 %ld us, %zu 字节) 到 %s\n", index,
+         frame.sequence, frame.timestamp_us, frame.size, argv[3]);
+  return EXIT_SUCCESS;
+}
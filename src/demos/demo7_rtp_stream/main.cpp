@@ -0,0 +1,210 @@
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+
+#include "capture_loop.h"
+#include "format_selector.h"
+#include "rtp_sink.h"
+#include "v4l2_utils.h"
+
+using v4l2_demo::ApplyCaptureMode;
+using v4l2_demo::CaptureLoop;
+using v4l2_demo::CaptureMode;
+using v4l2_demo::CaptureTarget;
+using v4l2_demo::DeviceInfo;
+using v4l2_demo::FindVideoDevices;
+using v4l2_demo::FrameLease;
+using v4l2_demo::PixelFormatToString;
+using v4l2_demo::RtpSink;
+using v4l2_demo::RtpSinkOptions;
+using v4l2_demo::RtpSinkStats;
+using v4l2_demo::SelectCaptureMode;
+using v4l2_demo::V4L2Device;
+using v4l2_demo::VideoFormat;
+
+namespace {
+constexpr uint32_t kVideoWidth = 1280;
+constexpr uint32_t kVideoHeight = 720;
+constexpr double kVideoMinFps = 30;
+
+// 发送器最多持有 3 帧（等待零拷贝完成），其余缓冲区留给驱动
+constexpr uint32_t kBufferCount = 6;
+constexpr uint32_t kMaxInFlightFrames = 3;
+
+constexpr const char* kOutputDirectory = "output";
+constexpr const char* kSdpPath = "output/stream.sdp";
+
+// 捕获循环实例，供信号处理函数请求退出
+CaptureLoop* g_capture_loop = nullptr;
+
+void HandleStopSignal(int /* signum */) {
+  if (g_capture_loop) {
+    g_capture_loop->Stop();
+  }
+}
+
+// 解析 host[:port]，IPv6 地址写作 [addr]:port
+bool ParseDestination(const std::string& text, RtpSinkOptions* options) {
+  std::string host = text;
+  std::string port;
+  if (!host.empty() && host[0] == '[') {
+    size_t end = host.find(']');
+    if (end == std::string::npos) {
+      return false;
+    }
+    if (end + 1 < host.size()) {
+      if (host[end + 1] != ':') {
+        return false;
+      }
+      port = host.substr(end + 2);
+    }
+    host = host.substr(1, end - 1);
+  } else if (host.find(':') == host.rfind(':') &&
+             host.find(':') != std::string::npos) {
+    port = host.substr(host.find(':') + 1);
+    host = host.substr(0, host.find(':'));
+  }
+  if (host.empty()) {
+    return false;
+  }
+  options->host = host;
+  if (!port.empty()) {
+    int value = atoi(port.c_str());
+    if (value <= 0 || value > 65535) {
+      return false;
+    }
+    options->port = static_cast<uint16_t>(value);
+  }
+  return true;
+}
+}  // namespace
+
+// 用法: demo7_rtp_stream [--no-zerocopy] 接收端地址[:端口] [设备]
+// 捕获非压缩视频，按 RFC 4175 以 RTP/UDP 发送到接收端，并写出 SDP
+int main(int argc, char* argv[]) {
+  printf("=== V4L2 Demo 7: RTP 网络推流 ===\n\n");
+  RtpSinkOptions options;
+  options.max_frames = kMaxInFlightFrames;
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--no-zerocopy") == 0) {
+      options.zerocopy = false;
+    } else {
+      args.push_back(argv[i]);
+    }
+  }
+  if (args.empty() || !ParseDestination(args[0], &options)) {
+    fprintf(stderr,
+            "用法: %s [--no-zerocopy] 接收端地址[:端口] [设备]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  std::vector<DeviceInfo> devices;
+  FindVideoDevices(&devices);
+  DeviceInfo device_info;
+  bool found = false;
+  for (const auto& info : devices) {
+    if (args.size() < 2 || info.device_path == args[1]) {
+      device_info = info;
+      found = true;
+      break;
+    }
+  }
+  if (!found) {
+    fprintf(stderr, "错误: 未找到可用的视频捕获设备\n");
+    return EXIT_FAILURE;
+  }
+  printf("使用设备: %s (%s)\n", device_info.device_path.c_str(),
+         device_info.card_name.c_str());
+
+  if (mkdir(kOutputDirectory, 0755) != 0 && errno != EEXIST) {
+    fprintf(stderr, "无法创建输出目录 %s: %s\n", kOutputDirectory,
+            strerror(errno));
+    return EXIT_FAILURE;
+  }
+
+  V4L2Device device;
+  if (!device.Open(device_info.device_path)) {
+    return EXIT_FAILURE;
+  }
+
+  // RFC 4175 的 4:2:2 采样即 UYVY 字节顺序，可直接引用驱动缓冲区发送
+  CaptureTarget target;
+  target.width = kVideoWidth;
+  target.height = kVideoHeight;
+  target.min_fps = kVideoMinFps;
+  target.allow_compressed = false;
+  target.preferred_formats = {V4L2_PIX_FMT_UYVY, V4L2_PIX_FMT_RGB24,
+                              V4L2_PIX_FMT_BGR24, V4L2_PIX_FMT_ABGR32};
+  CaptureMode mode;
+  if (!SelectCaptureMode(device_info, target, &mode) ||
+      !ApplyCaptureMode(&device, mode)) {
+    fprintf(stderr, "错误: 设备没有可用的非压缩格式\n");
+    return EXIT_FAILURE;
+  }
+  printf("捕获格式: %ux%u %s @ %.4g fps\n", mode.width, mode.height,
+         PixelFormatToString(mode.pixel_format).c_str(), mode.fps);
+
+  if (!device.InitMemoryMapping(kBufferCount)) {
+    fprintf(stderr, "错误: 无法初始化内存映射\n");
+    return EXIT_FAILURE;
+  }
+  VideoFormat format;
+  if (!device.GetFormat(&format)) {
+    fprintf(stderr, "错误: 无法获取视频格式\n");
+    return EXIT_FAILURE;
+  }
+
+  RtpSink sink;
+  if (!sink.Init(format, options)) {
+    fprintf(stderr, "错误: 无法初始化 RTP 发送\n");
+    return EXIT_FAILURE;
+  }
+  std::string sdp = sink.GetSdp();
+  FILE* file = fopen(kSdpPath, "w");
+  if (!file || fwrite(sdp.data(), 1, sdp.size(), file) != sdp.size()) {
+    fprintf(stderr, "写入 %s 失败: %s\n", kSdpPath, strerror(errno));
+  }
+  if (file) {
+    fclose(file);
+  }
+
+  CaptureLoop loop;
+  if (!loop.Init() || !device.StartStreaming()) {
+    fprintf(stderr, "错误: 无法启动视频流\n");
+    return EXIT_FAILURE;
+  }
+
+  g_capture_loop = &loop;
+  signal(SIGINT, HandleStopSignal);
+  signal(SIGTERM, HandleStopSignal);
+  printf("推流到 %s:%u，SDP 已写入 %s (按 Ctrl+C 退出)...\n",
+         options.host.c_str(), options.port, kSdpPath);
+
+  // 租约交给发送器，零拷贝完成通知到达后才重新入队给驱动
+  bool ok = loop.Run(&device, [&](FrameLease* lease) { sink.Submit(lease); });
+  g_capture_loop = nullptr;
+
+  // 等待在途帧完成并归还所有租约后才能停止视频流
+  sink.Close();
+  device.StopStreaming();
+
+  RtpSinkStats stats;
+  sink.GetStats(&stats);
+  printf("\n推流结束: 发送 %lu 帧, 丢弃 %lu 帧, %lu 包 %.1f MB\n",
+         stats.frames, stats.dropped, stats.packets, stats.bytes / 1e6);
+  printf("sendmsg %lu 次（失败 %lu）, 零拷贝 %lu 次（内核拷贝 %lu）\n",
+         stats.sends, stats.send_errors, stats.zerocopy_sends,
+         stats.zerocopy_copied);
+  printf("模式: %s%s\n", stats.zerocopy ? "MSG_ZEROCOPY" : "拷贝",
+         stats.gso ? " + UDP GSO" : "");
+  printf("接收: ffplay -protocol_whitelist file,udp,rtp %s\n", kSdpPath);
+
+  device.Close();
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}